@@ -0,0 +1,494 @@
+/**
+* Copyright 2015-2024 Daniel Weiner
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include <NetworkTool/LatencyCommand.h>
+
+#include <Fusion/Argparse.h>
+#include <Fusion/Network.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace NetworkTool
+{
+namespace
+{
+struct Scenario
+{
+    std::string_view name;
+    bool noDelay{ false };
+    bool cork{ false };
+    bool quickAck{ false };
+    int32_t notSentLowMark{ 0 };
+
+    // Open a new connection for every request, optionally carrying the
+    // request in the SYN.
+    bool reconnect{ false };
+    bool fastOpen{ false };
+};
+
+using namespace std::string_view_literals;
+
+constexpr std::array<Scenario, 7> SCENARIOS{ {
+    { .name = "default"sv },
+    { .name = "nodelay"sv, .noDelay = true },
+    { .name = "cork"sv, .cork = true },
+    { .name = "quickack"sv, .quickAck = true },
+    { .name = "notsent-lowat"sv, .noDelay = true, .notSentLowMark = 16 * 1024 },
+    { .name = "connect"sv, .noDelay = true, .reconnect = true },
+    { .name = "fastopen"sv, .noDelay = true, .reconnect = true, .fastOpen = true },
+} };
+
+Result<void> Configure(
+    Network& network,
+    Socket sock,
+    const Scenario& scenario)
+{
+    using namespace SocketOptions;
+
+    if (auto result = network.SetSocketOption(
+        sock,
+        NoDelay(scenario.noDelay)); !result)
+    {
+        return result;
+    }
+    if (scenario.notSentLowMark > 0)
+    {
+        return network.SetSocketOption(
+            sock,
+            TcpNotSentLowMark(scenario.notSentLowMark));
+    }
+    return Success;
+}
+
+Result<void> RecvAll(
+    Network& network,
+    Socket sock,
+    const Scenario& scenario,
+    uint8_t* buffer,
+    size_t size)
+{
+    while (size > 0)
+    {
+        auto result = network.Recv(sock, buffer, size);
+        if (!result)
+        {
+            return result.Error();
+        }
+        if (*result == 0)
+        {
+            return Failure(E_NET_DISCONNECTED);
+        }
+
+        // Quick ACK mode is left by the kernel on its own, re-arm it after
+        // every read so the peer's next segment is not held by Nagle.
+        if (scenario.quickAck)
+        {
+            (void)network.SetSocketOption(
+                sock,
+                SocketOptions::TcpQuickAck(true));
+        }
+
+        buffer += *result;
+        size -= *result;
+    }
+    return Success;
+}
+
+Result<void> SendAll(
+    Network& network,
+    Socket sock,
+    const uint8_t* buffer,
+    size_t size)
+{
+    while (size > 0)
+    {
+        auto result = network.Send(sock, buffer, size);
+        if (!result)
+        {
+            return result.Error();
+        }
+
+        buffer += *result;
+        size -= *result;
+    }
+    return Success;
+}
+
+// Send a length prefixed message the way naive protocol code does, header
+// and body in separate writes. This is the pattern which runs into Nagle's
+// algorithm meeting a delayed ACK.
+Result<void> SendMessage(
+    Network& network,
+    Socket sock,
+    const Scenario& scenario,
+    const std::vector<uint8_t>& message)
+{
+    using namespace SocketOptions;
+
+    if (scenario.cork)
+    {
+        if (auto result = network.SetSocketOption(sock, TcpCork(true)); !result)
+        {
+            return result;
+        }
+    }
+    if (auto result = SendAll(network, sock, message.data(), 4); !result)
+    {
+        return result;
+    }
+    if (auto result = SendAll(
+        network,
+        sock,
+        message.data() + 4,
+        message.size() - 4); !result)
+    {
+        return result;
+    }
+    if (scenario.cork)
+    {
+        return network.SetSocketOption(sock, TcpCork(false));
+    }
+    return Success;
+}
+
+Result<void> RecvMessage(
+    Network& network,
+    Socket sock,
+    const Scenario& scenario,
+    std::vector<uint8_t>& message)
+{
+    uint32_t length = 0;
+
+    message.resize(4);
+    if (auto result = RecvAll(network, sock, scenario, message.data(), 4); !result)
+    {
+        return result;
+    }
+
+    memcpy(&length, message.data(), sizeof(length));
+    message.resize(4 + length);
+
+    return RecvAll(network, sock, scenario, message.data() + 4, length);
+}
+
+// Echoes every message back on each accepted connection, one connection at
+// a time, until the listener is shut down.
+void Serve(
+    Network& network,
+    Socket listener,
+    const Scenario& scenario)
+{
+    std::vector<uint8_t> message;
+
+    while (true)
+    {
+        auto accepted = network.Accept(listener);
+        if (!accepted)
+        {
+            return;
+        }
+
+        Socket sock = accepted->sock;
+        if (Configure(network, sock, scenario))
+        {
+            while (RecvMessage(network, sock, scenario, message)
+                && SendMessage(network, sock, scenario, message))
+            { }
+        }
+        (void)network.Close(sock);
+    }
+}
+
+struct Latency
+{
+    Clock::duration p50{ 0 };
+    Clock::duration p99{ 0 };
+    Clock::duration max{ 0 };
+};
+
+Latency Summarize(std::vector<Clock::duration>& samples)
+{
+    Latency latency;
+    if (samples.empty())
+    {
+        return latency;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    latency.p50 = samples[samples.size() / 2];
+    latency.p99 = samples[std::min(
+        samples.size() - 1,
+        (samples.size() * 99) / 100)];
+    latency.max = samples.back();
+    return latency;
+}
+
+int64_t Micros(Clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+}  // namespace
+
+Result<void> LatencyCommand::Run(Options options)
+{
+    LatencyCommand cmd(std::move(options));
+    return cmd.Run();
+}
+
+void LatencyCommand::Setup(
+    ArgumentCommand& cmd,
+    Options& options)
+{
+    using namespace std::string_view_literals;
+
+    cmd.Help("Measure loopback request latency with TCP latency options"sv);
+
+    cmd.AddArgument(options.requests, "requests"sv, 'n')
+        .Help("Number of requests per scenario"sv);
+    cmd.AddArgument(options.size, "size"sv, 's')
+        .Help("Payload size of each request in bytes"sv);
+}
+
+LatencyCommand::LatencyCommand(Options options)
+    : m_options(std::move(options))
+{ }
+
+LatencyCommand::~LatencyCommand()
+{
+    if (network)
+    {
+        network->Stop();
+        network.reset();
+    }
+}
+
+Result<void> LatencyCommand::Run()
+{
+    using namespace SocketOptions;
+
+    if (m_options.requests == 0 || m_options.size > UINT32_MAX)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid options (requests={},size={})",
+                m_options.requests, m_options.size);
+    }
+
+    if (auto result = Network::Create(); !result)
+    {
+        return result.Error()
+            .WithContext("failed to create network");
+    }
+    else
+    {
+        network = std::move(*result);
+    }
+
+    std::vector<uint8_t> request(4 + m_options.size, uint8_t('x'));
+    std::vector<uint8_t> response;
+
+    const uint32_t length = uint32_t(m_options.size);
+    memcpy(request.data(), &length, sizeof(length));
+
+    fmt::print(FMT_STRING("{:<16}{:>10}{:>10}{:>10}\n"),
+        "scenario", "p50(us)", "p99(us)", "max(us)");
+
+    for (const Scenario& scenario : SCENARIOS)
+    {
+        Socket listener{ INVALID_SOCKET };
+        Socket client{ INVALID_SOCKET };
+        std::thread server;
+
+        // Tears the scenario down on every exit path, shutting the listener
+        // down unblocks the server thread in Accept().
+        auto cleanup = [&] {
+            if (client != INVALID_SOCKET)
+            {
+                (void)network->Close(client);
+                client = INVALID_SOCKET;
+            }
+            if (listener != INVALID_SOCKET)
+            {
+                (void)network->Shutdown(listener, SocketShutdownMode::Both);
+            }
+            if (server.joinable())
+            {
+                server.join();
+            }
+            if (listener != INVALID_SOCKET)
+            {
+                (void)network->Close(listener);
+                listener = INVALID_SOCKET;
+            }
+        };
+
+        auto run = [&]() -> Result<Latency> {
+            if (auto result = network->CreateSocket(TCPv4); !result)
+            {
+                return result.Error();
+            }
+            else
+            {
+                listener = *result;
+            }
+
+            (void)network->SetSocketOption(listener, ReuseAddress(true));
+            if (scenario.fastOpen)
+            {
+                // Needs the server bit of net.ipv4.tcp_fastopen, without it
+                // the handshake simply completes before the data is sent.
+                (void)network->SetSocketOption(listener, TcpFastOpen(64));
+            }
+
+            SocketAddress address{ InaddrLoopback, 0 };
+            if (auto result = network->Bind(listener, address); !result)
+            {
+                return result.Error();
+            }
+            if (auto result = network->Listen(listener, 64); !result)
+            {
+                return result.Error();
+            }
+            if (auto result = network->GetSockName(listener); !result)
+            {
+                return result.Error();
+            }
+            else
+            {
+                address = *result;
+            }
+
+            server = std::thread([this, listener, &scenario] {
+                Serve(*network, listener, scenario);
+            });
+
+            std::vector<Clock::duration> samples;
+            samples.reserve(m_options.requests);
+
+            for (size_t i = 0; i < m_options.requests; ++i)
+            {
+                if (client == INVALID_SOCKET)
+                {
+                    if (auto result = network->CreateSocket(TCPv4); !result)
+                    {
+                        return result.Error();
+                    }
+                    else
+                    {
+                        client = *result;
+                    }
+                    if (auto result = Configure(*network, client, scenario); !result)
+                    {
+                        return result.Error();
+                    }
+                }
+
+                // Connection setup is part of the measured latency for the
+                // reconnecting scenarios, that is the cost Fast Open removes.
+                Clock::time_point start = Clock::now();
+
+                if (scenario.reconnect)
+                {
+                    auto result = scenario.fastOpen
+                        ? network->ConnectWithData(
+                            client,
+                            address,
+                            request.data(),
+                            request.size())
+                        : network->ConnectWithData(
+                            client,
+                            address,
+                            nullptr,
+                            0);
+                    if (!result)
+                    {
+                        return result.Error();
+                    }
+
+                    size_t sent = *result;
+                    if (auto r = SendAll(
+                        *network,
+                        client,
+                        request.data() + sent,
+                        request.size() - sent); !r)
+                    {
+                        return r.Error();
+                    }
+                }
+                else
+                {
+                    if (i == 0)
+                    {
+                        if (auto result = network->Connect(client, address); !result)
+                        {
+                            return result.Error();
+                        }
+                        start = Clock::now();
+                    }
+                    if (auto result = SendMessage(*network, client, scenario, request); !result)
+                    {
+                        return result.Error();
+                    }
+                }
+
+                if (auto result = RecvMessage(*network, client, scenario, response); !result)
+                {
+                    return result.Error();
+                }
+                samples.push_back(Clock::now() - start);
+
+                if (response != request)
+                {
+                    return Failure(E_FAILURE)
+                        .WithContext("response mismatch for request '{}'", i);
+                }
+
+                if (scenario.reconnect)
+                {
+                    (void)network->Close(client);
+                    client = INVALID_SOCKET;
+                }
+            }
+
+            return Summarize(samples);
+        };
+
+        Result<Latency> result = run();
+        cleanup();
+
+        if (!result)
+        {
+            return result.Error()
+                .WithContext("scenario '{}' failed", scenario.name);
+        }
+
+        fmt::print(FMT_STRING("{:<16}{:>10}{:>10}{:>10}\n"),
+            scenario.name,
+            Micros(result->p50),
+            Micros(result->p99),
+            Micros(result->max));
+    }
+
+    return Success;
+}
+}  // namespace NetworkTool
@@ -14,6 +14,7 @@
 
 #include <NetworkTool/Main.h>
 #include <NetworkTool/ClientCommand.h>
+#include <NetworkTool/LatencyCommand.h>
 #include <NetworkTool/LookupCommand.h>
 #include <NetworkTool/ServerCommand.h>
 
@@ -46,6 +47,14 @@ namespace Fusion
 
         ClientCommand::Setup(clientCmd, clientOptions);
 
+        LatencyCommand::Options latencyOptions;
+        auto& latencyCmd = parser.AddCommand("latency"sv)
+            .Action([&](const ArgumentCommand&) -> Result<void> {
+                return LatencyCommand::Run(std::move(latencyOptions));
+            });
+
+        LatencyCommand::Setup(latencyCmd, latencyOptions);
+
         LookupCommand::Options lookupOptions;
         auto& lookupCmd = parser.AddCommand("lookup"sv)
             .Action([&](const ArgumentCommand&) -> Result<void> {
@@ -55,7 +64,7 @@ namespace Fusion
         LookupCommand::Setup(lookupCmd, lookupOptions);
 
         ServerCommand::Options serverOptions;
-        auto& serverCmd = parser.AddCommand("client"sv)
+        auto& serverCmd = parser.AddCommand("server"sv)
             .Action([&](const ArgumentCommand&) -> Result<void> {
                 return ServerCommand::Run(std::move(serverOptions));
             });
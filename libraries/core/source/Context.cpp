@@ -16,6 +16,11 @@
 
 #include <Fusion/Context.h>
 
+#include <Fusion/Assert.h>
+#include <Fusion/Macros.h>
+
+#include <algorithm>
+
 namespace Fusion
 {
 Context::Context()
@@ -52,7 +57,21 @@ Context& Context::operator=(Context&& ctx) noexcept
 
 void Context::Cancel()
 {
-    m_state->flag.store(true);
+    std::lock_guard lock(m_state->mutex);
+
+    if (m_state->flag.exchange(true))
+    {
+        return;
+    }
+
+    // Invoked under the lock so RemoveCallback() can promise the callback
+    // is no longer running once it returns.
+    for (auto& [id, fn] : m_state->callbacks)
+    {
+        FUSION_UNUSED(id);
+        fn();
+    }
+    m_state->callbacks.clear();
 }
 
 bool Context::IsCancelled() const
@@ -70,8 +89,59 @@ bool Context::IsCancelled() const
     return false;
 }
 
+bool Context::IsExpired() const
+{
+    if (auto deadline = m_state->deadline.load())
+    {
+        return Clock::now().time_since_epoch().count() >= deadline;
+    }
+    return false;
+}
+
+std::optional<Clock::time_point> Context::Deadline() const
+{
+    if (auto deadline = m_state->deadline.load())
+    {
+        return Clock::time_point(Clock::duration(deadline));
+    }
+    return std::nullopt;
+}
+
 void Context::ReleaseDeadline()
 {
     m_state->deadline.store(0);
 }
+
+uint64_t Context::AddCallback(CancelCallback fn)
+{
+    FUSION_ASSERT(fn);
+    std::lock_guard lock(m_state->mutex);
+
+    uint64_t id = m_state->nextCallback++;
+
+    if (m_state->flag.load())
+    {
+        fn();
+        return id;
+    }
+
+    m_state->callbacks.emplace_back(id, std::move(fn));
+    return id;
+}
+
+void Context::RemoveCallback(uint64_t id)
+{
+    std::lock_guard lock(m_state->mutex);
+
+    auto& callbacks = m_state->callbacks;
+    auto iter = std::find_if(
+        callbacks.begin(),
+        callbacks.end(),
+        [id](const auto& callback) { return callback.first == id; });
+
+    if (iter != callbacks.end())
+    {
+        callbacks.erase(iter);
+    }
+}
 }  // namespace Fusion
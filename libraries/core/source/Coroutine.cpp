@@ -0,0 +1,305 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/Coroutine.h>
+
+#include <Fusion/Macros.h>
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+namespace Fusion
+{
+// -------------------------------------------------------------
+// TaskPromise                                             START
+void Internal::TaskPromiseBase::unhandled_exception() const noexcept
+{
+    std::terminate();
+}
+// TaskPromise                                               END
+// -------------------------------------------------------------
+// Reactor                                                 START
+Reactor::ReadyAwaiter::ReadyAwaiter(
+    Reactor& reactor,
+    Socket sock,
+    SocketOperation op)
+    : m_reactor(reactor)
+    , m_sock(sock)
+    , m_op(op)
+{ }
+
+bool Reactor::ReadyAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_handle = handle;
+
+    if (auto result = m_reactor.Register(*this); !result)
+    {
+        // Resume straight away and report the failure from await_resume().
+        m_result = result.Error();
+        return false;
+    }
+    return true;
+}
+
+Result<void> Reactor::ReadyAwaiter::await_resume()
+{
+    return std::move(m_result);
+}
+
+Reactor::SleepAwaiter::SleepAwaiter(
+    Reactor& reactor,
+    Clock::time_point deadline)
+    : m_reactor(reactor)
+    , m_deadline(deadline)
+{ }
+
+bool Reactor::SleepAwaiter::await_ready() const
+{
+    return m_deadline <= Clock::now();
+}
+
+bool Reactor::SleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_handle = handle;
+    return m_reactor.Register(*this);
+}
+
+Result<void> Reactor::SleepAwaiter::await_resume()
+{
+    return std::move(m_result);
+}
+
+Reactor::Reactor(SocketService& service)
+    : m_service(service)
+{ }
+
+Reactor::~Reactor()
+{
+    std::vector<std::coroutine_handle<>> cancelled;
+    {
+        std::lock_guard lock(m_mutex);
+
+        m_stopped = true;
+
+        for (auto& [sock, waiters] : m_waiters)
+        {
+            for (ReadyAwaiter* waiter : { waiters.read, waiters.write })
+            {
+                if (waiter)
+                {
+                    waiter->m_result = Failure(E_CANCELLED)
+                        .WithContext("reactor destroyed");
+                    cancelled.push_back(waiter->m_handle);
+                }
+            }
+            (void)m_service.Remove(
+                sock,
+                SocketOperation::Read | SocketOperation::Write);
+        }
+        m_waiters.clear();
+
+        for (auto& [deadline, waiter] : m_timers)
+        {
+            FUSION_UNUSED(deadline);
+
+            waiter->m_result = Failure(E_CANCELLED)
+                .WithContext("reactor destroyed");
+            cancelled.push_back(waiter->m_handle);
+        }
+        m_timers.clear();
+    }
+
+    // Outside the lock, the coroutines may try to wait on the reactor
+    // again and are turned away.
+    for (std::coroutine_handle<> handle : cancelled)
+    {
+        handle.resume();
+    }
+}
+
+Reactor::ReadyAwaiter Reactor::Readable(Socket sock)
+{
+    return ReadyAwaiter{ *this, sock, SocketOperation::Read };
+}
+
+Reactor::ReadyAwaiter Reactor::Writable(Socket sock)
+{
+    return ReadyAwaiter{ *this, sock, SocketOperation::Write };
+}
+
+Reactor::SleepAwaiter Reactor::Sleep(Clock::duration duration)
+{
+    return SleepAwaiter{ *this, Clock::now() + duration };
+}
+
+Reactor::SleepAwaiter Reactor::SleepUntil(Clock::time_point deadline)
+{
+    return SleepAwaiter{ *this, deadline };
+}
+
+Result<void> Reactor::Register(ReadyAwaiter& awaiter)
+{
+    if (awaiter.m_sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+
+    std::unique_lock lock(m_mutex);
+
+    if (m_stopped)
+    {
+        return Failure(E_CANCELLED)
+            .WithContext("reactor destroyed");
+    }
+
+    Waiters& waiters = m_waiters[awaiter.m_sock];
+    ReadyAwaiter*& slot = (awaiter.m_op == SocketOperation::Read)
+        ? waiters.read
+        : waiters.write;
+
+    if (slot)
+    {
+        return Failure(E_RESOURCE_NOT_AVAILABLE)
+            .WithContext("socket '{}' already has a waiter", awaiter.m_sock);
+    }
+    slot = &awaiter;
+
+    // The waiter is published first, an event reported by a Run() on
+    // another thread as soon as the interest is added has to find it.
+    if (auto result = m_service.Add(awaiter.m_sock, awaiter.m_op); !result)
+    {
+        slot = nullptr;
+
+        if (!waiters.read && !waiters.write)
+        {
+            m_waiters.erase(awaiter.m_sock);
+        }
+        return result.Error()
+            .WithContext("failed to wait on socket '{}'", awaiter.m_sock);
+    }
+    return Success;
+}
+
+bool Reactor::Register(SleepAwaiter& awaiter)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_stopped)
+    {
+        awaiter.m_result = Failure(E_CANCELLED)
+            .WithContext("reactor destroyed");
+        return false;
+    }
+
+    auto iter = m_timers.emplace(awaiter.m_deadline, &awaiter);
+
+    // A Run() blocked on a later deadline has to recompute its timeout.
+    if (iter == m_timers.begin())
+    {
+        lock.unlock();
+        m_service.Notify();
+    }
+    return true;
+}
+
+Result<size_t> Reactor::Run(Clock::duration timeout)
+{
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (!m_timers.empty())
+        {
+            const Clock::duration next = std::max(
+                Clock::duration::zero(),
+                m_timers.begin()->first - Clock::now());
+
+            if (timeout < Clock::duration::zero() || next < timeout)
+            {
+                timeout = next;
+            }
+        }
+    }
+
+    auto events = m_service.Execute(timeout);
+    if (!events)
+    {
+        return events.Error();
+    }
+
+    std::vector<std::coroutine_handle<>> ready;
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (const SocketEvent& event : *events)
+        {
+            auto iter = m_waiters.find(event.sock);
+            if (iter == m_waiters.end())
+            {
+                continue;
+            }
+
+            Waiters& waiters = iter->second;
+            auto done = SocketOperation::None;
+
+            auto wake = [&](ReadyAwaiter*& waiter, SocketOperation op) {
+                if (!waiter || !+(event.events & (op | SocketOperation::Error)))
+                {
+                    return;
+                }
+                if (event.error != E_SUCCESS)
+                {
+                    waiter->m_result = Failure(event.error);
+                }
+
+                ready.push_back(waiter->m_handle);
+                waiter = nullptr;
+                done |= op;
+            };
+
+            wake(waiters.read, SocketOperation::Read);
+            wake(waiters.write, SocketOperation::Write);
+
+            if (done != SocketOperation::None)
+            {
+                (void)m_service.Remove(event.sock, done);
+            }
+            if (!waiters.read && !waiters.write)
+            {
+                m_waiters.erase(iter);
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+
+        while (!m_timers.empty() && m_timers.begin()->first <= now)
+        {
+            ready.push_back(m_timers.begin()->second->m_handle);
+            m_timers.erase(m_timers.begin());
+        }
+    }
+
+    for (std::coroutine_handle<> handle : ready)
+    {
+        handle.resume();
+    }
+    return ready.size();
+}
+// Reactor                                                   END
+// -------------------------------------------------------------
+}  // namespace Fusion
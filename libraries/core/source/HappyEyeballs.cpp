@@ -0,0 +1,348 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/HappyEyeballs.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Memory.h>
+
+#include <algorithm>
+#include <deque>
+
+namespace Fusion
+{
+std::vector<AddressInfo> SortHappyEyeballs(
+    std::span<const AddressInfo> addresses,
+    size_t firstFamilyCount)
+{
+    std::deque<const AddressInfo*> first;
+    std::deque<const AddressInfo*> second;
+    AddressFamily preferred = AddressFamily::None;
+
+    for (const AddressInfo& info : addresses)
+    {
+        const AddressFamily family = info.address.Family();
+        if (family != AddressFamily::Inet4 && family != AddressFamily::Inet6)
+        {
+            continue;
+        }
+        if (preferred == AddressFamily::None)
+        {
+            preferred = family;
+        }
+        (family == preferred ? first : second).push_back(&info);
+    }
+
+    std::vector<AddressInfo> sorted;
+    sorted.reserve(first.size() + second.size());
+
+    for (size_t i = 0; i < std::max<size_t>(firstFamilyCount, 1)
+        && !first.empty(); ++i)
+    {
+        sorted.push_back(*first.front());
+        first.pop_front();
+    }
+
+    bool other = true;
+    while (!first.empty() || !second.empty())
+    {
+        auto& queue = (other && !second.empty()) || first.empty()
+            ? second
+            : first;
+
+        sorted.push_back(*queue.front());
+        queue.pop_front();
+        other = !other;
+    }
+
+    return sorted;
+}
+
+namespace
+{
+struct Attempt
+{
+    Socket sock{ INVALID_SOCKET };
+    const AddressInfo* info{ nullptr };
+};
+
+class Racer final
+{
+public:
+    Racer(Network& network, SocketService& service, const Context& ctx)
+        : m_network(network)
+        , m_service(service)
+        , m_ctx(ctx)
+    { }
+
+    ~Racer()
+    {
+        for (const Attempt& attempt : m_pending)
+        {
+            Drop(attempt.sock);
+        }
+    }
+
+    //
+    // Start connecting to 'info'. Returns the socket when the connect
+    // completed right away, which is common on loopback, otherwise
+    // INVALID_SOCKET while the attempt is pending.
+    //
+    Result<Socket> Start(const AddressInfo& info)
+    {
+        const SocketType type = info.type != SocketType::None
+            ? info.type
+            : SocketType::Stream;
+        const SocketProtocol proto = info.protocol != SocketProtocol::None
+            ? info.protocol
+            : SocketProtocol::Tcp;
+
+        Socket sock{ INVALID_SOCKET };
+        if (auto result = m_network.CreateSocket(
+            info.address.Family(),
+            proto,
+            type); !result)
+        {
+            return result.Error();
+        }
+        else
+        {
+            sock = *result;
+        }
+
+        if (auto result = m_network.SetBlocking(sock, false); !result)
+        {
+            (void)m_network.Close(sock);
+            return result.Error();
+        }
+
+        auto result = m_network.Connect(sock, info.address);
+        if (result)
+        {
+            m_pending.push_back(Attempt{ sock, &info });
+            return sock;
+        }
+        if (result.Error().Error() != E_NET_INPROGRESS)
+        {
+            (void)m_network.Close(sock);
+            return result.Error()
+                .WithContext("failed to connect to '{}'", info.address);
+        }
+
+        if (auto added = m_service.Add(sock, SocketOperation::Write); !added)
+        {
+            (void)m_network.Close(sock);
+            return added.Error();
+        }
+        if (auto watched = m_service.Watch(sock, m_ctx); !watched)
+        {
+            Drop(sock);
+            return watched.Error();
+        }
+
+        m_pending.push_back(Attempt{ sock, &info });
+        return INVALID_SOCKET;
+    }
+
+    //
+    // Learn how the pending attempt on 'sock' ended. Failed attempts are
+    // closed and forgotten.
+    //
+    Result<void> Finish(Socket sock)
+    {
+        auto iter = Find(sock);
+        FUSION_ASSERT(iter != m_pending.end());
+
+        // Connecting again reports whether the socket is connected or why
+        // the attempt failed.
+        auto result = m_network.Connect(sock, iter->info->address);
+        if (result || result.Error().Error() == E_NET_CONNECTED)
+        {
+            return Success;
+        }
+
+        Failure failure = result.Error()
+            .WithContext("failed to connect to '{}'", iter->info->address);
+
+        Drop(sock);
+        m_pending.erase(iter);
+        return failure;
+    }
+
+    //
+    // Hand 'sock' to the caller and close every other attempt.
+    //
+    HappyEyeballsConnection Win(Socket sock)
+    {
+        auto iter = Find(sock);
+        FUSION_ASSERT(iter != m_pending.end());
+
+        HappyEyeballsConnection connection{
+            .sock = sock,
+            .info = *iter->info,
+        };
+
+        (void)m_service.Close(sock);
+        m_pending.erase(iter);
+        return connection;
+    }
+
+    bool IsPending(Socket sock) const
+    {
+        return Find(sock) != m_pending.end();
+    }
+
+    bool Empty() const
+    {
+        return m_pending.empty();
+    }
+
+private:
+    std::vector<Attempt>::iterator Find(Socket sock)
+    {
+        return std::find_if(m_pending.begin(), m_pending.end(),
+            [sock](const Attempt& a) { return a.sock == sock; });
+    }
+
+    std::vector<Attempt>::const_iterator Find(Socket sock) const
+    {
+        return std::find_if(m_pending.begin(), m_pending.end(),
+            [sock](const Attempt& a) { return a.sock == sock; });
+    }
+
+    void Drop(Socket sock)
+    {
+        (void)m_service.Close(sock);
+        (void)m_network.Close(sock);
+    }
+
+private:
+    Network& m_network;
+    SocketService& m_service;
+    const Context& m_ctx;
+    std::vector<Attempt> m_pending;
+};
+}  // namespace
+
+Result<HappyEyeballsConnection> ConnectHappyEyeballs(
+    Network& network,
+    std::span<const AddressInfo> addresses,
+    const Context& ctx,
+    const HappyEyeballsParams& params)
+{
+    if (params.attemptDelay < Clock::duration::zero())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("attempt delay must not be negative");
+    }
+
+    const std::vector<AddressInfo> sorted = SortHappyEyeballs(
+        addresses,
+        params.firstFamilyCount);
+
+    if (sorted.empty())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("no Inet4 or Inet6 address to connect to");
+    }
+    if (ctx.IsCancelled())
+    {
+        return Failure(ctx.IsExpired() ? E_NET_TIMEOUT : E_CANCELLED);
+    }
+
+    std::unique_ptr<SocketService> service;
+    if (auto result = SocketService::Create(network); !result)
+    {
+        return result.Error()
+            .WithContext("failed to create socket service");
+    }
+    else
+    {
+        service = std::move(*result);
+    }
+    FUSION_SCOPE_GUARD([&] { service->Stop(); });
+
+    Racer racer(network, *service, ctx);
+    Failure failure(E_NET_CONN_REFUSED);
+
+    size_t next = 0;
+    Clock::time_point nextAttempt = network.Now();
+
+    while (true)
+    {
+        const Clock::time_point now = network.Now();
+
+        if (next < sorted.size() && (racer.Empty() || now >= nextAttempt))
+        {
+            const AddressInfo& info = sorted[next++];
+            nextAttempt = now + params.attemptDelay;
+
+            auto started = racer.Start(info);
+            if (!started)
+            {
+                failure = started.Error();
+                nextAttempt = now;
+            }
+            else if (*started != INVALID_SOCKET)
+            {
+                return racer.Win(*started);
+            }
+            continue;
+        }
+
+        if (racer.Empty())
+        {
+            return failure;
+        }
+
+        Clock::duration timeout = std::chrono::seconds(-1);
+        if (next < sorted.size())
+        {
+            timeout = std::max(nextAttempt - now, Clock::duration::zero());
+        }
+
+        auto events = service->Execute(timeout);
+        if (!events)
+        {
+            return events.Error()
+                .WithContext("failed to wait for connection attempts");
+        }
+
+        for (const SocketEvent& event : *events)
+        {
+            if (!racer.IsPending(event.sock))
+            {
+                continue;
+            }
+            if (event.error != E_SUCCESS)
+            {
+                return Failure(event.error);
+            }
+
+            if (auto finished = racer.Finish(event.sock); finished)
+            {
+                return racer.Win(event.sock);
+            }
+            else
+            {
+                failure = finished.Error();
+                nextAttempt = network.Now();
+            }
+        }
+    }
+}
+}  // namespace Fusion
@@ -0,0 +1,580 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Http.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Internal/Network.h>
+#include <Fusion/StringUtil.h>
+
+#include <curl/curl.h>
+#include <fmt/format.h>
+
+#include <array>
+#include <utility>
+
+namespace Fusion
+{
+static_assert(std::is_same_v<curl_socket_t, Socket>,
+    "libcurl sockets must match Fusion sockets");
+
+struct HttpClient::Transfer
+{
+    HttpRequest request;
+    HttpResponse response;
+    HttpCompletion completion;
+
+    CURL* easy{ nullptr };
+    curl_slist* headers{ nullptr };
+    std::array<char, CURL_ERROR_SIZE> error{};
+};
+
+namespace
+{
+size_t OnWriteBody(char* data, size_t size, size_t count, void* userp)
+{
+    auto* response = static_cast<HttpResponse*>(userp);
+    response->body.append(data, size * count);
+    return size * count;
+}
+
+size_t OnWriteHeader(char* data, size_t size, size_t count, void* userp)
+{
+    auto* response = static_cast<HttpResponse*>(userp);
+    std::string_view line(data, size * count);
+
+    // A new status line starts a new header block (redirects, 100-continue).
+    if (line.starts_with("HTTP/"))
+    {
+        response->headers.clear();
+        return size * count;
+    }
+
+    if (size_t colon = line.find(':'); colon != std::string_view::npos)
+    {
+        response->headers.emplace_back(
+            StringUtil::Trim(line.substr(0, colon)),
+            StringUtil::Trim(line.substr(colon + 1)));
+    }
+    return size * count;
+}
+
+Failure GetCurlFailure(CURLcode code, const char* detail)
+{
+    const Error* error = &E_HTTP_FAILURE;
+
+    switch (code)
+    {
+    case CURLE_OPERATION_TIMEDOUT:
+        error = &E_NET_TIMEOUT;
+        break;
+    case CURLE_COULDNT_CONNECT:
+        error = &E_NET_CONN_REFUSED;
+        break;
+    case CURLE_GOT_NOTHING:
+    case CURLE_RECV_ERROR:
+    case CURLE_SEND_ERROR:
+        error = &E_NET_DISCONNECTED;
+        break;
+    default:
+        break;
+    }
+
+    return Failure(*error).WithContext("{}: {}",
+        curl_easy_strerror(code),
+        (detail && *detail) ? detail : "no detail");
+}
+}  // namespace
+
+// -------------------------------------------------------------
+// HttpClient                                              START
+
+Result<std::unique_ptr<HttpClient>> HttpClient::Create(
+    SocketService& service,
+    Params params)
+{
+    if (params.maxInFlight == 0)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("maxInFlight must be greater than zero");
+    }
+
+    auto client = std::make_unique<HttpClient>(service, params);
+
+    if (auto result = client->Start(); !result)
+    {
+        return result.Error();
+    }
+    return client;
+}
+
+HttpClient::HttpClient(SocketService& service, Params params)
+    : m_service(service)
+    , m_params(params)
+{ }
+
+HttpClient::~HttpClient()
+{
+    // Completions may call back into the client, they run on transfers
+    // already taken out of it and any new Submit() is refused.
+    m_stopping = true;
+
+    auto pending = std::exchange(m_pending, {});
+    auto active = std::exchange(m_active, {});
+
+    for (auto& [easy, transfer] : active)
+    {
+        curl_multi_remove_handle(m_multi, easy);
+        curl_slist_free_all(transfer->headers);
+        curl_easy_cleanup(easy);
+    }
+
+    for (auto& transfer : pending)
+    {
+        Finish(*transfer, Failure(E_CANCELLED));
+    }
+    for (auto& [easy, transfer] : active)
+    {
+        FUSION_UNUSED(easy);
+        Finish(*transfer, Failure(E_CANCELLED));
+    }
+
+    for (void* easy : m_handles)
+    {
+        curl_easy_cleanup(easy);
+    }
+    m_handles.clear();
+
+    // Pooled connections are closed by the cleanup below, unregister them
+    // while the descriptors are still valid.
+    for (auto& [sock, ops] : m_sockets)
+    {
+        (void)m_service.Remove(sock, ops);
+    }
+    m_sockets.clear();
+
+    if (m_multi)
+    {
+        curl_multi_setopt(m_multi, CURLMOPT_SOCKETFUNCTION, nullptr);
+        curl_multi_setopt(m_multi, CURLMOPT_TIMERFUNCTION, nullptr);
+        curl_multi_cleanup(m_multi);
+        m_multi = nullptr;
+    }
+}
+
+Result<void> HttpClient::Start()
+{
+    m_multi = curl_multi_init();
+    if (!m_multi)
+    {
+        return Failure(E_INSUFFICIENT_RESOURCES)
+            .WithContext("failed to create curl multi handle");
+    }
+
+    curl_multi_setopt(m_multi, CURLMOPT_SOCKETFUNCTION, &HttpClient::OnSocket);
+    curl_multi_setopt(m_multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(m_multi, CURLMOPT_TIMERFUNCTION, &HttpClient::OnTimer);
+    curl_multi_setopt(m_multi, CURLMOPT_TIMERDATA, this);
+    curl_multi_setopt(
+        m_multi,
+        CURLMOPT_MAXCONNECTS,
+        static_cast<long>(m_params.connectionCacheSize));
+    curl_multi_setopt(
+        m_multi,
+        CURLMOPT_MAX_TOTAL_CONNECTIONS,
+        static_cast<long>(m_params.maxConnections));
+    curl_multi_setopt(
+        m_multi,
+        CURLMOPT_MAX_HOST_CONNECTIONS,
+        static_cast<long>(m_params.maxHostConnections));
+
+    return Success;
+}
+
+Result<void> HttpClient::Submit(
+    HttpRequest request,
+    HttpCompletion completion)
+{
+    if (m_stopping)
+    {
+        return Failure(E_CANCELLED)
+            .WithContext("client is being destroyed");
+    }
+    if (request.url.empty())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("request url is required");
+    }
+
+    auto transfer = std::make_unique<Transfer>();
+    transfer->request = std::move(request);
+    transfer->completion = std::move(completion);
+
+    if (m_active.size() >= m_params.maxInFlight)
+    {
+        m_pending.push_back(std::move(transfer));
+        return Success;
+    }
+    return Activate(transfer);
+}
+
+Result<void> HttpClient::Execute(Clock::duration timeout)
+{
+    using namespace std::chrono;
+
+    Clock::duration wait = Timeout();
+
+    if (timeout >= Clock::duration::zero() && timeout < wait)
+    {
+        wait = timeout;
+    }
+
+    if (wait == Clock::duration::max())
+    {
+        wait = seconds(-1);
+    }
+
+    // Pollers work in milliseconds, convert the way they do.
+    auto events = m_service.Execute(
+        milliseconds(Internal::ToPollTimeout(wait)));
+    if (!events)
+    {
+        return events.Error();
+    }
+    return Process(*events);
+}
+
+Result<void> HttpClient::Process(std::span<const SocketEvent> events)
+{
+    for (const SocketEvent& event : events)
+    {
+        if (!m_sockets.contains(event.sock))
+        {
+            continue;
+        }
+
+        int flags = 0;
+        if (+(event.events & SocketOperation::Read))
+        {
+            flags |= CURL_CSELECT_IN;
+        }
+        if (+(event.events & SocketOperation::Write))
+        {
+            flags |= CURL_CSELECT_OUT;
+        }
+        if (+(event.events & SocketOperation::Error))
+        {
+            flags |= CURL_CSELECT_ERR;
+        }
+
+        if (auto result = Action(event.sock, flags); !result)
+        {
+            return result;
+        }
+    }
+
+    if (m_deadline != Clock::time_point::max() && Clock::now() >= m_deadline)
+    {
+        m_deadline = Clock::time_point::max();
+
+        if (auto result = Action(CURL_SOCKET_TIMEOUT, 0); !result)
+        {
+            return result;
+        }
+    }
+
+    return Complete();
+}
+
+Clock::duration HttpClient::Timeout() const
+{
+    if (m_deadline == Clock::time_point::max())
+    {
+        return Clock::duration::max();
+    }
+    return std::max(m_deadline - Clock::now(), Clock::duration::zero());
+}
+
+size_t HttpClient::InFlight() const
+{
+    return m_active.size();
+}
+
+size_t HttpClient::Pending() const
+{
+    return m_pending.size();
+}
+
+Result<void> HttpClient::Activate(std::unique_ptr<Transfer>& transfer)
+{
+    CURL* easy = nullptr;
+
+    if (!m_handles.empty())
+    {
+        // Recycled handles keep their DNS and TLS session caches.
+        easy = m_handles.back();
+        m_handles.pop_back();
+        curl_easy_reset(easy);
+    }
+    else if (easy = curl_easy_init(); !easy)
+    {
+        return Failure(E_INSUFFICIENT_RESOURCES)
+            .WithContext("failed to create curl easy handle");
+    }
+
+    const HttpRequest& request = transfer->request;
+    HttpResponse& response = transfer->response;
+
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, transfer->error.data());
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &OnWriteBody);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, &OnWriteHeader);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, &response);
+
+    if (request.method == "GET")
+    {
+        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+    }
+    else if (request.method == "HEAD")
+    {
+        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+    }
+    else
+    {
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    }
+
+    if (!request.body.empty() || request.method == "POST")
+    {
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body.data());
+        curl_easy_setopt(
+            easy,
+            CURLOPT_POSTFIELDSIZE_LARGE,
+            static_cast<curl_off_t>(request.body.size()));
+    }
+
+    for (const auto& [name, value] : request.headers)
+    {
+        std::string header = fmt::format("{}: {}", name, value);
+
+        if (curl_slist* list = curl_slist_append(
+            transfer->headers,
+            header.c_str()); list)
+        {
+            transfer->headers = list;
+        }
+    }
+    if (transfer->headers)
+    {
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    }
+
+    if (request.timeout > Clock::duration::zero())
+    {
+        curl_easy_setopt(
+            easy,
+            CURLOPT_TIMEOUT_MS,
+            static_cast<long>(std::chrono::duration_cast<
+                std::chrono::milliseconds>(request.timeout).count()));
+    }
+
+    if (CURLMcode code = curl_multi_add_handle(m_multi, easy); code != CURLM_OK)
+    {
+        curl_slist_free_all(transfer->headers);
+        transfer->headers = nullptr;
+        curl_easy_cleanup(easy);
+
+        return Failure(E_HTTP_FAILURE)
+            .WithContext("failed to add transfer: {}",
+                curl_multi_strerror(code));
+    }
+
+    transfer->easy = easy;
+    m_active.emplace(easy, std::move(transfer));
+    return Success;
+}
+
+Result<void> HttpClient::Action(Socket sock, int events)
+{
+    int running = 0;
+
+    if (CURLMcode code = curl_multi_socket_action(
+        m_multi,
+        sock,
+        events,
+        &running); code != CURLM_OK)
+    {
+        return Failure(E_HTTP_FAILURE)
+            .WithContext("socket action failed on '{}': {}",
+                sock, curl_multi_strerror(code));
+    }
+    return Success;
+}
+
+Result<void> HttpClient::Complete()
+{
+    int queued = 0;
+
+    while (CURLMsg* message = curl_multi_info_read(m_multi, &queued))
+    {
+        if (message->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        // The message is invalidated once the handle is removed.
+        CURL* easy = message->easy_handle;
+        CURLcode code = message->data.result;
+
+        auto iter = m_active.find(easy);
+        FUSION_ASSERT(iter != m_active.end());
+
+        std::unique_ptr<Transfer> transfer = std::move(iter->second);
+        m_active.erase(iter);
+
+        curl_multi_remove_handle(m_multi, easy);
+
+        Result<HttpResponse> result = [&]() -> Result<HttpResponse>
+        {
+            if (code != CURLE_OK)
+            {
+                return GetCurlFailure(code, transfer->error.data());
+            }
+
+            curl_easy_getinfo(
+                easy,
+                CURLINFO_RESPONSE_CODE,
+                &transfer->response.status);
+            return std::move(transfer->response);
+        }();
+
+        curl_slist_free_all(transfer->headers);
+        transfer->headers = nullptr;
+        transfer->easy = nullptr;
+
+        if (m_handles.size() < m_params.maxInFlight)
+        {
+            m_handles.push_back(easy);
+        }
+        else
+        {
+            curl_easy_cleanup(easy);
+        }
+
+        Finish(*transfer, std::move(result));
+    }
+
+    while (!m_pending.empty() && m_active.size() < m_params.maxInFlight)
+    {
+        std::unique_ptr<Transfer> transfer = std::move(m_pending.front());
+        m_pending.pop_front();
+
+        if (auto result = Activate(transfer); !result)
+        {
+            Finish(*transfer, std::move(result.Error()));
+        }
+    }
+
+    return Success;
+}
+
+void HttpClient::Finish(Transfer& transfer, Result<HttpResponse> result)
+{
+    if (HttpCompletion completion = std::move(transfer.completion); completion)
+    {
+        completion(std::move(result));
+    }
+}
+
+int HttpClient::OnSocket(
+    void* easy,
+    Socket sock,
+    int what,
+    void* userp,
+    void*)
+{
+    FUSION_UNUSED(easy);
+    auto* client = static_cast<HttpClient*>(userp);
+
+    SocketOperation ops = SocketOperation::None;
+    switch (what)
+    {
+    case CURL_POLL_IN:
+        ops = SocketOperation::Read;
+        break;
+    case CURL_POLL_OUT:
+        ops = SocketOperation::Write;
+        break;
+    case CURL_POLL_INOUT:
+        ops = SocketOperation::Read | SocketOperation::Write;
+        break;
+    default:
+        break;
+    }
+
+    auto iter = client->m_sockets.find(sock);
+    SocketOperation current = (iter != client->m_sockets.end())
+        ? iter->second
+        : SocketOperation::None;
+
+    if (ops == SocketOperation::None)
+    {
+        if (iter != client->m_sockets.end())
+        {
+            (void)client->m_service.Remove(sock, current);
+            client->m_sockets.erase(iter);
+        }
+        return 0;
+    }
+
+    ops |= SocketOperation::Error;
+
+    if (SocketOperation removed = current & ~ops; removed != SocketOperation::None)
+    {
+        if (!client->m_service.Remove(sock, removed))
+        {
+            return -1;
+        }
+    }
+    if (SocketOperation added = ops & ~current; added != SocketOperation::None)
+    {
+        if (!client->m_service.Add(sock, added))
+        {
+            return -1;
+        }
+    }
+
+    client->m_sockets[sock] = ops;
+    return 0;
+}
+
+int HttpClient::OnTimer(void* multi, long timeoutMs, void* userp)
+{
+    FUSION_UNUSED(multi);
+    auto* client = static_cast<HttpClient*>(userp);
+
+    client->m_deadline = (timeoutMs < 0)
+        ? Clock::time_point::max()
+        : Clock::now() + std::chrono::milliseconds(timeoutMs);
+    return 0;
+}
+
+// HttpClient                                                END
+// -------------------------------------------------------------
+}  // namespace Fusion
@@ -25,12 +25,17 @@
 #include <Fusion/Internal/IocpSocketService.h>
 #include <Fusion/Internal/EPollSocketService.h>
 #include <Fusion/Internal/KQueueSocketService.h>
+#include <Fusion/Internal/PollSocketService.h>
 #include <Fusion/Internal/SelectSocketService.h>
 #include <Fusion/Internal/StandardNetwork.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Fusion
@@ -481,6 +486,8 @@ int32_t Internal::GetSocketOptLevel(SocketOpt option)
 {
     static const int32_t s_socketLevels[size_t(SocketOpt::_Count)] = {
         int32_t(SOL_SOCKET),   // Broadcast
+        int32_t(SOL_SOCKET),   // BusyPoll
+        int32_t(SOL_SOCKET),   // BusyPollBudget
         int32_t(SOL_SOCKET),   // Debug
         int32_t(SOL_SOCKET),   // DontRoute
         int32_t(SOL_SOCKET),   // KeepAlive
@@ -490,6 +497,7 @@ int32_t Internal::GetSocketOptLevel(SocketOpt option)
         int32_t(IPPROTO_IP),   // MulticastTTL
         int32_t(IPPROTO_TCP),  // NoDelay
         int32_t(SOL_SOCKET),   // OobInline
+        int32_t(SOL_SOCKET),   // PreferBusyPoll
         int32_t(SOL_SOCKET),   // RecvBuf
         int32_t(SOL_SOCKET),   // RecvLowMark
         int32_t(SOL_SOCKET),   // RecvTimeout
@@ -499,11 +507,19 @@ int32_t Internal::GetSocketOptLevel(SocketOpt option)
         int32_t(SOL_SOCKET),   // SendLowMark
         int32_t(SOL_SOCKET),   // SendTimeout
         int32_t(SOL_SOCKET),   // SocketError
+        int32_t(IPPROTO_TCP),  // TcpCork
+        int32_t(IPPROTO_TCP),  // TcpDeferAccept
+        int32_t(IPPROTO_TCP),  // TcpFastOpen
+        int32_t(IPPROTO_TCP),  // TcpFastOpenConnect
         int32_t(IPPROTO_TCP),  // TcpKeepAlive
         int32_t(IPPROTO_TCP),  // TcpKeepCount
         int32_t(IPPROTO_TCP),  // TcpKeepIdle
         int32_t(IPPROTO_TCP),  // TcpKeepInterval
+        int32_t(IPPROTO_TCP),  // TcpNotSentLowMark
+        int32_t(IPPROTO_TCP),  // TcpQuickAck
         int32_t(IPPROTO_IP),   // TimeToLive
+        int32_t(IPPROTO_UDP),  // UdpGro
+        int32_t(IPPROTO_UDP),  // UdpSegment
     };
 
     return s_socketLevels[size_t(option)];
@@ -513,6 +529,13 @@ int32_t Internal::GetSocketOpt(SocketOpt option)
 {
     static const int32_t s_socketOptions[size_t(SocketOpt::_Count)] = {
         int32_t(SO_BROADCAST),       // Broadcast
+#if FUSION_PLATFORM_LINUX
+        int32_t(SO_BUSY_POLL),       // BusyPoll
+        int32_t(SO_BUSY_POLL_BUDGET), // BusyPollBudget
+#else
+        int32_t(-1),                 // BusyPoll
+        int32_t(-1),                 // BusyPollBudget
+#endif
         int32_t(SO_DEBUG),           // Debug
         int32_t(SO_DONTROUTE),       // DontRoute
         int32_t(SO_KEEPALIVE),       // KeepAlive
@@ -522,6 +545,11 @@ int32_t Internal::GetSocketOpt(SocketOpt option)
         int32_t(IP_MULTICAST_TTL),   // MulticastTTL
         int32_t(TCP_NODELAY),        // NoDelay
         int32_t(SO_OOBINLINE),       // OobInline
+#if FUSION_PLATFORM_LINUX
+        int32_t(SO_PREFER_BUSY_POLL), // PreferBusyPoll
+#else
+        int32_t(-1),                 // PreferBusyPoll
+#endif
         int32_t(SO_RCVBUF),          // RecvBuf
         int32_t(SO_RCVLOWAT),        // RecvLowMark
         int32_t(SO_RCVTIMEO),        // RecvTimeout
@@ -535,6 +563,17 @@ int32_t Internal::GetSocketOpt(SocketOpt option)
         int32_t(SO_SNDLOWAT),        // SendLowMark
         int32_t(SO_SNDTIMEO),        // SendTimeout
         int32_t(SO_ERROR),           // SocketError
+#if FUSION_PLATFORM_LINUX
+        int32_t(TCP_CORK),           // TcpCork
+        int32_t(TCP_DEFER_ACCEPT),   // TcpDeferAccept
+        int32_t(TCP_FASTOPEN),       // TcpFastOpen
+        int32_t(TCP_FASTOPEN_CONNECT), // TcpFastOpenConnect
+#else
+        int32_t(-1),                 // TcpCork
+        int32_t(-1),                 // TcpDeferAccept
+        int32_t(-1),                 // TcpFastOpen
+        int32_t(-1),                 // TcpFastOpenConnect
+#endif
 #if FUSION_PLATFORM_DARWIN
         int32_t(TCP_KEEPALIVE),      // TcpKeepAlive
 #else
@@ -547,7 +586,21 @@ int32_t Internal::GetSocketOpt(SocketOpt option)
         int32_t(-1),                 // TcpKeepIdle
 #endif
         int32_t(TCP_KEEPINTVL),      // TcpKeepInterval
+#if FUSION_PLATFORM_LINUX
+        int32_t(TCP_NOTSENT_LOWAT),  // TcpNotSentLowMark
+        int32_t(TCP_QUICKACK),       // TcpQuickAck
+#else
+        int32_t(-1),                 // TcpNotSentLowMark
+        int32_t(-1),                 // TcpQuickAck
+#endif
         int32_t(IP_TTL),             // TimeToLive
+#if FUSION_PLATFORM_LINUX
+        int32_t(UDP_GRO),            // UdpGro
+        int32_t(UDP_SEGMENT),        // UdpSegment
+#else
+        int32_t(-1),                 // UdpGro
+        int32_t(-1),                 // UdpSegment
+#endif
     };
 
     return s_socketOptions[size_t(option)];
@@ -559,6 +612,8 @@ std::string_view ToString(SocketOpt option)
 
     static constexpr std::string_view s_optStrings[size_t(SocketOpt::_Count)] = {
         "SO_BROADCAST"sv,       // Broadcast
+        "SO_BUSY_POLL"sv,       // BusyPoll
+        "SO_BUSY_POLL_BUDGET"sv, // BusyPollBudget
         "SO_DEBUG"sv,           // Debug
         "SO_DONTROUTE"sv,       // DontRoute
         "SO_KEEPALIVE"sv,       // KeepAlive
@@ -568,6 +623,7 @@ std::string_view ToString(SocketOpt option)
         "IP_MULTICAST_TTL"sv,   // MulticastTTL
         "SO_NODELAY"sv,         // NoDelay
         "SO_OOBINLINE"sv,       // OobInline
+        "SO_PREFER_BUSY_POLL"sv, // PreferBusyPoll
         "SO_RECVBUF"sv,         // RecvBuf
         "SO_RCVLOWAT"sv,        // RecvLowMark
         "SO_RCVTIMEO"sv,        // RecvTimeout
@@ -577,11 +633,19 @@ std::string_view ToString(SocketOpt option)
         "SO_SNDLOWAT"sv,        // SendLowMark
         "SO_SNDTIMEO"sv,        // SendTimeout
         "SO_SOCKERR"sv,         // SocketError
+        "TCP_CORK"sv,           // TcpCork
+        "TCP_DEFER_ACCEPT"sv,   // TcpDeferAccept
+        "TCP_FASTOPEN"sv,       // TcpFastOpen
+        "TCP_FASTOPEN_CONNECT"sv, // TcpFastOpenConnect
         "TCP_KEEPALIVE"sv,      // TcpKeepAlive
         "TCP_KEEPCNT"sv,        // TcpKeepCount
         "TCP_KEEPIDLE"sv,       // TcpKeepIdle
         "TCP_KEEPINTVL"sv,      // TcpKeepInterval
+        "TCP_NOTSENT_LOWAT"sv,  // TcpNotSentLowMark
+        "TCP_QUICKACK"sv,       // TcpQuickAck
         "IP_TTL"sv,             // TimeToLive
+        "UDP_GRO"sv,            // UdpGro
+        "UDP_SEGMENT"sv,        // UdpSegment
     };
 
     return s_optStrings[size_t(option)];
@@ -607,13 +671,13 @@ std::ostream& operator<<(std::ostream& o, SocketOpt option)
 // SocketProtocol                                          START
 int32_t Internal::GetSocketProtocol(SocketProtocol protocol)
 {
-    static const int32_t s_socketProtocols[] = {
-        int32_t(IPPROTO_NONE),
-        int32_t(IPPROTO_TCP),
-        int32_t(IPPROTO_UDP),
-        int32_t(IPPROTO_ICMP),
-        int32_t(IPPROTO_IP),
-        int32_t(IPPROTO_RAW),
+    static const int32_t s_socketProtocols[size_t(SocketProtocol::_Count)] = {
+        int32_t(IPPROTO_NONE),  // None
+        int32_t(IPPROTO_ICMP),  // Icmp
+        int32_t(IPPROTO_IP),    // Ip
+        int32_t(IPPROTO_RAW),   // Raw
+        int32_t(IPPROTO_TCP),   // Tcp
+        int32_t(IPPROTO_UDP),   // Udp
     };
 
     return s_socketProtocols[static_cast<size_t>(protocol)];
@@ -1568,6 +1632,221 @@ Result<Socket> Network::CreateSocket(SocketConfig config) const
     return CreateSocket(config.family, config.protocol, config.type);
 }
 
+static Failure ContextFailure(const Context& ctx)
+{
+    return ctx.IsExpired() ? Failure(E_NET_TIMEOUT) : Failure(E_CANCELLED);
+}
+
+// Shuts the socket down when the context is cancelled while the calling
+// thread waits on it, poll() has no other way of being interrupted.
+class ContextGuard final
+{
+public:
+    ContextGuard(const Network& network, Socket sock, const Context& ctx)
+        : m_ctx(ctx)
+    {
+        m_callback = m_ctx.AddCallback([&network, sock] {
+            (void)network.Shutdown(sock, SocketShutdownMode::Both);
+        });
+    }
+
+    ~ContextGuard()
+    {
+        m_ctx.RemoveCallback(m_callback);
+    }
+
+private:
+    Context m_ctx;
+    uint64_t m_callback{ 0 };
+};
+
+static Result<void> WaitFor(
+    Socket sock,
+    PollFlags flags,
+    const Context& ctx)
+{
+    while (!ctx.IsCancelled())
+    {
+        Clock::duration timeout{ -1 };
+        if (auto deadline = ctx.Deadline())
+        {
+            timeout = std::max(
+                *deadline - Clock::now(),
+                Clock::duration::zero());
+        }
+
+        PollFd fd{ .sock = sock, .events = flags };
+        auto result = Poll(fd, timeout);
+
+        if (!result)
+        {
+            return result.Error();
+        }
+        if (*result > 0 && +(fd.events & PollFlags::Invalid))
+        {
+            return Failure(E_INVALID_ARGUMENT)
+                .WithContext("socket '{}' is not an open system socket", sock);
+        }
+        if (*result > 0)
+        {
+            return Success;
+        }
+    }
+    return ContextFailure(ctx);
+}
+
+Result<void> Network::Connect(
+    Socket client,
+    const SocketAddress& address,
+    const Context& ctx) const
+{
+    if (ctx.IsCancelled())
+    {
+        return ContextFailure(ctx);
+    }
+    if (auto result = SetBlocking(client, false); !result)
+    {
+        return result;
+    }
+
+    auto result = Connect(client, address);
+    if (result || result.Error().Error() != E_NET_INPROGRESS)
+    {
+        return result;
+    }
+
+    ContextGuard guard(*this, client, ctx);
+
+    if (auto wait = WaitFor(client, PollFlags::Write, ctx); !wait)
+    {
+        return wait;
+    }
+    if (ctx.IsCancelled())
+    {
+        return ContextFailure(ctx);
+    }
+
+    // Connecting again reports how the pending attempt ended, either that
+    // the socket is connected or the reason it failed.
+    if (auto again = Connect(client, address); !again)
+    {
+        if (again.Error().Error() == E_NET_CONNECTED)
+        {
+            return Success;
+        }
+        return again.Error()
+            .WithContext("failed to connect socket '{}' to '{}'",
+                client, address);
+    }
+    return Success;
+}
+
+Result<size_t> Network::Recv(
+    Socket sock,
+    void* buffer,
+    size_t size,
+    const Context& ctx) const
+{
+    if (ctx.IsCancelled())
+    {
+        return ContextFailure(ctx);
+    }
+
+    ContextGuard guard(*this, sock, ctx);
+
+    while (true)
+    {
+        if (auto wait = WaitFor(sock, PollFlags::Read, ctx); !wait)
+        {
+            return wait.Error();
+        }
+
+        auto result = Recv(sock, buffer, size);
+
+        // The shutdown used to wake us reads as end of stream.
+        if (ctx.IsCancelled() && (!result || *result == 0))
+        {
+            return ContextFailure(ctx);
+        }
+        if (!result && result.Error().Error() == E_NET_WOULD_BLOCK)
+        {
+            continue;
+        }
+        return result;
+    }
+}
+
+Result<size_t> Network::Send(
+    Socket sock,
+    const void* buffer,
+    size_t size,
+    const Context& ctx) const
+{
+    if (ctx.IsCancelled())
+    {
+        return ContextFailure(ctx);
+    }
+
+    ContextGuard guard(*this, sock, ctx);
+
+    while (true)
+    {
+        if (auto wait = WaitFor(sock, PollFlags::Write, ctx); !wait)
+        {
+            return wait.Error();
+        }
+
+        auto result = Send(sock, buffer, size, MessageOption::NoSignal);
+
+        if (ctx.IsCancelled() && !result)
+        {
+            return ContextFailure(ctx);
+        }
+        if (!result && result.Error().Error() == E_NET_WOULD_BLOCK)
+        {
+            continue;
+        }
+        return result;
+    }
+}
+
+Result<size_t> Network::ConnectWithData(
+    Socket client,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t size) const
+{
+    if (auto result = Connect(client, address); !result)
+    {
+        return result.Error();
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+    return Send(client, buffer, size);
+}
+
+Result<std::array<Socket, 2>> Network::CreateSocketPair(
+    AddressFamily family,
+    SocketType type) const
+{
+    FUSION_UNUSED(family);
+    FUSION_UNUSED(type);
+
+    return Failure{ E_NOT_SUPPORTED };
+}
+
+Clock::time_point Network::Now() const
+{
+    return Clock::now();
+}
+
+std::unique_ptr<SocketService> Network::CreateSocketService()
+{
+    return nullptr;
+}
+
 Result<size_t> Network::Recv(
     Socket sock,
     void* buffer,
@@ -1592,6 +1871,34 @@ Result<size_t> Network::Send(
     return Send(sock, buffer, length, MessageOption::None);
 }
 
+Result<Network::RecvDescriptorsData> Network::RecvDescriptors(
+    Socket sock,
+    std::span<Socket> descriptors,
+    void* buffer,
+    size_t size) const
+{
+    FUSION_UNUSED(sock);
+    FUSION_UNUSED(descriptors);
+    FUSION_UNUSED(buffer);
+    FUSION_UNUSED(size);
+
+    return Failure{ E_NOT_SUPPORTED };
+}
+
+Result<size_t> Network::SendDescriptors(
+    Socket sock,
+    std::span<const Socket> descriptors,
+    const void* buffer,
+    size_t size) const
+{
+    FUSION_UNUSED(sock);
+    FUSION_UNUSED(descriptors);
+    FUSION_UNUSED(buffer);
+    FUSION_UNUSED(size);
+
+    return Failure{ E_NOT_SUPPORTED };
+}
+
 Result<size_t> Network::SendTo(
     Socket sock,
     const SocketAddress& address,
@@ -1600,6 +1907,61 @@ Result<size_t> Network::SendTo(
 {
     return SendTo(sock, address, buffer, length, MessageOption::None);
 }
+
+Result<size_t> Network::SendToSegmented(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t length,
+    size_t segmentSize,
+    MessageOption flags) const
+{
+    FUSION_ASSERT(buffer);
+    if (segmentSize == 0)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid segment size");
+    }
+
+    const auto* data = static_cast<const uint8_t*>(buffer);
+    size_t sent = 0;
+
+    while (sent < length)
+    {
+        size_t size = std::min(segmentSize, length - sent);
+
+        auto result = SendTo(sock, address, data + sent, size, flags);
+        if (!result)
+        {
+            // Report partial progress, the caller resumes from 'sent'.
+            if (sent > 0)
+            {
+                return sent;
+            }
+            return result.Error();
+        }
+
+        sent += *result;
+    }
+
+    return sent;
+}
+
+Result<size_t> Network::SendToSegmented(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t length,
+    size_t segmentSize) const
+{
+    return SendToSegmented(
+        sock,
+        address,
+        buffer,
+        length,
+        segmentSize,
+        MessageOption::None);
+}
 // Network                                                   END
 // -------------------------------------------------------------
 // SocketPair                                              START
@@ -1804,6 +2166,242 @@ Socket SocketPair::Writer() const
 }
 // SocketPair                                                END
 // -------------------------------------------------------------
+// ListenerDescriptor                                      START
+namespace
+{
+// Every batch of descriptors travels with a header followed by one length
+// prefixed name per descriptor. Both ends run on the same host, fields are
+// kept in native byte order.
+struct HandoffHeader
+{
+    uint32_t magic;
+    uint32_t total;
+    uint32_t count;
+    uint32_t length;
+};
+
+constexpr uint32_t HANDOFF_MAGIC = 0x464C4831;  // "FLH1"
+constexpr size_t HANDOFF_BATCH = 32;
+constexpr size_t HANDOFF_NAME_LENGTH = UINT8_MAX;
+
+Result<void> SendAll(
+    const Network& network,
+    Socket sock,
+    const uint8_t* data,
+    size_t size)
+{
+    while (size > 0)
+    {
+        auto result = network.Send(sock, data, size);
+        if (!result)
+        {
+            return result.Error();
+        }
+        data += *result;
+        size -= *result;
+    }
+    return Success;
+}
+
+Result<void> RecvAll(
+    const Network& network,
+    Socket sock,
+    uint8_t* data,
+    size_t size)
+{
+    while (size > 0)
+    {
+        auto result = network.Recv(sock, data, size);
+        if (!result)
+        {
+            return result.Error();
+        }
+        data += *result;
+        size -= *result;
+    }
+    return Success;
+}
+}  // namespace
+
+Result<void> SendListeners(
+    const Network& network,
+    Socket channel,
+    std::span<const ListenerDescriptor> listeners)
+{
+    for (const ListenerDescriptor& listener : listeners)
+    {
+        if (listener.sock == INVALID_SOCKET)
+        {
+            return Failure{ E_INVALID_ARGUMENT }
+                .WithContext("invalid socket for listener '{}'", listener.name);
+        }
+        if (listener.name.size() > HANDOFF_NAME_LENGTH)
+        {
+            return Failure{ E_INVALID_ARGUMENT }
+                .WithContext("listener name '{}' exceeds '{}' characters",
+                    listener.name, HANDOFF_NAME_LENGTH);
+        }
+    }
+
+    std::vector<uint8_t> payload;
+    std::array<Socket, HANDOFF_BATCH> descriptors;
+    size_t offset = 0;
+
+    // An empty handoff still sends one header so the successor does not
+    // wait forever.
+    do
+    {
+        size_t count = std::min(HANDOFF_BATCH, listeners.size() - offset);
+
+        payload.resize(sizeof(HandoffHeader));
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ListenerDescriptor& listener = listeners[offset + i];
+
+            descriptors[i] = listener.sock;
+            payload.push_back(uint8_t(listener.name.size()));
+            payload.insert(
+                payload.end(),
+                listener.name.begin(),
+                listener.name.end());
+        }
+
+        HandoffHeader header{
+            .magic = HANDOFF_MAGIC,
+            .total = uint32_t(listeners.size()),
+            .count = uint32_t(count),
+            .length = uint32_t(payload.size() - sizeof(HandoffHeader)),
+        };
+        memcpy(payload.data(), &header, sizeof(header));
+
+        auto sent = network.SendDescriptors(
+            channel,
+            std::span<const Socket>(descriptors.data(), count),
+            payload.data(),
+            payload.size());
+
+        if (!sent)
+        {
+            return sent.Error()
+                .WithContext("failed to send '{}' listeners on '{}'",
+                    count, channel);
+        }
+        if (auto result = SendAll(
+            network,
+            channel,
+            payload.data() + *sent,
+            payload.size() - *sent); !result)
+        {
+            return result.Error();
+        }
+
+        offset += count;
+    }
+    while (offset < listeners.size());
+
+    return Success;
+}
+
+Result<std::vector<ListenerDescriptor>> RecvListeners(
+    const Network& network,
+    Socket channel)
+{
+    std::vector<ListenerDescriptor> listeners;
+
+    // Descriptors already received are closed if the handoff fails half way.
+    bool complete = false;
+    FUSION_SCOPE_GUARD([&] {
+        if (!complete)
+        {
+            for (const ListenerDescriptor& listener : listeners)
+            {
+                (void)network.Close(listener.sock);
+            }
+        }
+    });
+
+    std::vector<uint8_t> payload;
+    std::array<Socket, HANDOFF_BATCH> descriptors;
+    size_t total = 0;
+
+    do
+    {
+        HandoffHeader header{};
+        auto* data = reinterpret_cast<uint8_t*>(&header);
+
+        // The descriptors are attached to the first bytes of the batch.
+        auto received = network.RecvDescriptors(
+            channel,
+            descriptors,
+            data,
+            sizeof(header));
+
+        if (!received)
+        {
+            return received.Error()
+                .WithContext("failed to receive listeners on '{}'", channel);
+        }
+
+        for (size_t i = 0; i < received->count; ++i)
+        {
+            listeners.push_back(ListenerDescriptor{ .sock = descriptors[i] });
+        }
+
+        if (auto result = RecvAll(
+            network,
+            channel,
+            data + received->received,
+            sizeof(header) - received->received); !result)
+        {
+            return result.Error();
+        }
+
+        if (header.magic != HANDOFF_MAGIC
+            || header.count > HANDOFF_BATCH
+            || header.count != received->count
+            || header.length > header.count * (HANDOFF_NAME_LENGTH + 1))
+        {
+            return Failure{ E_INVALID_ARGUMENT }
+                .WithContext("malformed listener handoff on '{}'", channel);
+        }
+
+        total = header.total;
+
+        payload.resize(header.length);
+        if (auto result = RecvAll(
+            network,
+            channel,
+            payload.data(),
+            payload.size()); !result)
+        {
+            return result.Error();
+        }
+
+        size_t first = listeners.size() - header.count;
+        size_t pos = 0;
+
+        for (size_t i = first; i < listeners.size(); ++i)
+        {
+            size_t length = pos < payload.size() ? payload[pos++] : SIZE_MAX;
+            if (length > payload.size() - pos)
+            {
+                return Failure{ E_INVALID_ARGUMENT }
+                    .WithContext("malformed listener name on '{}'", channel);
+            }
+
+            listeners[i].name.assign(
+                reinterpret_cast<const char*>(payload.data() + pos),
+                length);
+            pos += length;
+        }
+    }
+    while (listeners.size() < total);
+
+    complete = true;
+    return listeners;
+}
+// ListenerDescriptor                                        END
+// -------------------------------------------------------------
 // Poll                                                    START
 Result<size_t> Poll(
     PollFd& fd,
@@ -1845,6 +2443,17 @@ Result<std::unique_ptr<SocketService>> SocketService::Create(
 
     std::unique_ptr<SocketService> service;
 
+    // A network without system sockets brings its own service.
+    if (auto custom = network.CreateSocketService())
+    {
+        if (auto result = custom->Start(); !result)
+        {
+            return result.Error()
+                .WithContext("failed to start socket service");
+        }
+        return custom;
+    }
+
     switch (type)
     {
 #if FUSION_PLATFORM_WINDOWS
@@ -1876,6 +2485,19 @@ Result<std::unique_ptr<SocketService>> SocketService::Create(
 #else
     case Type::Kqueue:
         return Failure{ E_NOT_SUPPORTED };
+#endif
+#if FUSION_PLATFORM_POSIX
+#if !FUSION_PLATFORM_LINUX && !FUSION_PLATFORM_APPLE
+    case Type::Default:
+#endif
+    case Type::Poll:
+    {
+        service = std::make_unique<PollSocketService>(network);
+        break;
+    }
+#else
+    case Type::Poll:
+        return Failure{ E_NOT_SUPPORTED };
 #endif
     default:
     {
@@ -1893,10 +2515,347 @@ Result<std::unique_ptr<SocketService>> SocketService::Create(
     return service;
 }
 
+struct SocketService::Watches
+{
+    struct Entry
+    {
+        Context ctx;
+        uint64_t callback{ 0 };
+        std::multimap<Clock::time_point, Socket>::iterator deadline;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<Socket, Entry> sockets;
+    std::multimap<Clock::time_point, Socket> deadlines;
+    bool cancelled{ false };
+
+    // Backend events merged with the ended watches, only touched by the
+    // thread calling Execute().
+    std::vector<SocketEvent> events;
+};
+
+SocketService::SocketService()
+    : m_watches(std::make_unique<Watches>())
+{ }
+
+SocketService::~SocketService()
+{
+    std::vector<Watches::Entry> entries;
+    {
+        std::lock_guard lock(m_watches->mutex);
+
+        for (auto& [sock, entry] : m_watches->sockets)
+        {
+            FUSION_UNUSED(sock);
+            entries.push_back(std::move(entry));
+        }
+        m_watches->sockets.clear();
+    }
+
+    for (Watches::Entry& entry : entries)
+    {
+        entry.ctx.RemoveCallback(entry.callback);
+    }
+}
+
+Result<void> SocketService::Close(Socket sock)
+{
+    Unwatch(sock);
+    return CloseInternal(sock);
+}
+
 Result<std::span<SocketEvent>> SocketService::Execute()
 {
     return Execute(std::chrono::seconds(-1));
 }
+
+Result<std::span<SocketEvent>> SocketService::Execute(Clock::duration timeout)
+{
+    {
+        std::lock_guard lock(m_watches->mutex);
+
+        if (m_watches->cancelled)
+        {
+            timeout = Clock::duration::zero();
+        }
+        else if (!m_watches->deadlines.empty())
+        {
+            using namespace std::chrono;
+
+            // Backends wait in whole milliseconds, rounding down would wake
+            // just short of the deadline.
+            Clock::duration remaining = ceil<milliseconds>(std::max(
+                m_watches->deadlines.begin()->first - Clock::now(),
+                Clock::duration::zero()));
+
+            if (timeout < Clock::duration::zero() || remaining < timeout)
+            {
+                timeout = remaining;
+            }
+        }
+    }
+
+    auto result = ExecuteInternal(timeout);
+    if (!result)
+    {
+        return result;
+    }
+
+    std::vector<Watches::Entry> ended;
+    std::vector<SocketEvent> fired;
+    {
+        std::lock_guard lock(m_watches->mutex);
+
+        auto end = [&](auto iter, const Error& error) {
+            if (iter->second.deadline != m_watches->deadlines.end())
+            {
+                m_watches->deadlines.erase(iter->second.deadline);
+            }
+            fired.push_back(SocketEvent{
+                .sock = iter->first,
+                .events = SocketOperation::Error,
+                .error = error,
+            });
+            ended.push_back(std::move(iter->second));
+            m_watches->sockets.erase(iter);
+        };
+
+        // Cancellation is signalled through a flag, the watches only need
+        // to be searched when one of their contexts was cancelled.
+        if (std::exchange(m_watches->cancelled, false))
+        {
+            for (auto iter = m_watches->sockets.begin();
+                iter != m_watches->sockets.end();)
+            {
+                auto next = std::next(iter);
+                const Context& ctx = iter->second.ctx;
+
+                if (ctx.IsCancelled())
+                {
+                    end(iter, ctx.IsExpired() ? E_NET_TIMEOUT : E_CANCELLED);
+                }
+                iter = next;
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        while (!m_watches->deadlines.empty()
+            && m_watches->deadlines.begin()->first <= now)
+        {
+            auto iter = m_watches->sockets.find(
+                m_watches->deadlines.begin()->second);
+            FUSION_ASSERT(iter != m_watches->sockets.end());
+
+            Watches::Entry& entry = iter->second;
+            m_watches->deadlines.erase(entry.deadline);
+            entry.deadline = m_watches->deadlines.end();
+
+            if (auto deadline = entry.ctx.Deadline(); !deadline)
+            {
+                // Released, only cancellation ends the watch now.
+                continue;
+            }
+            else if (*deadline > now)
+            {
+                entry.deadline = m_watches->deadlines.emplace(*deadline, iter->first);
+                continue;
+            }
+
+            end(iter, E_NET_TIMEOUT);
+        }
+    }
+
+    for (Watches::Entry& entry : ended)
+    {
+        entry.ctx.RemoveCallback(entry.callback);
+    }
+
+    if (fired.empty())
+    {
+        return result;
+    }
+
+    std::vector<SocketEvent>& events = m_watches->events;
+    events.assign(result->begin(), result->end());
+
+    for (const SocketEvent& event : fired)
+    {
+        auto iter = std::find(events.begin(), events.end(), event.sock);
+        if (iter != events.end())
+        {
+            iter->events |= event.events;
+            iter->error = event.error;
+        }
+        else
+        {
+            events.push_back(event);
+        }
+    }
+
+    return std::span<SocketEvent>{ events };
+}
+
+Result<void> SocketService::Watch(Socket sock, const Context& ctx)
+{
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+
+    Unwatch(sock);
+
+    Watches::Entry entry{ .ctx = ctx };
+
+    // Registered before the watch is visible, a context cancelled in
+    // between is caught by the check below.
+    entry.callback = entry.ctx.AddCallback([this] {
+        {
+            std::lock_guard lock(m_watches->mutex);
+            m_watches->cancelled = true;
+        }
+        Notify();
+    });
+
+    std::unique_lock lock(m_watches->mutex);
+
+    auto [iter, inserted] = m_watches->sockets.emplace(sock, std::move(entry));
+    FUSION_ASSERT(inserted);
+
+    bool earliest = false;
+
+    iter->second.deadline = m_watches->deadlines.end();
+    if (auto deadline = ctx.Deadline())
+    {
+        iter->second.deadline = m_watches->deadlines.emplace(*deadline, sock);
+        earliest = (iter->second.deadline == m_watches->deadlines.begin());
+    }
+
+    if (ctx.IsCancelled())
+    {
+        m_watches->cancelled = true;
+    }
+    lock.unlock();
+
+    // A wait already in progress may run past the new deadline.
+    if (earliest)
+    {
+        Notify();
+    }
+    return Success;
+}
+
+void SocketService::Unwatch(Socket sock)
+{
+    std::unique_lock lock(m_watches->mutex);
+
+    auto iter = m_watches->sockets.find(sock);
+    if (iter == m_watches->sockets.end())
+    {
+        return;
+    }
+
+    Watches::Entry entry = std::move(iter->second);
+    if (entry.deadline != m_watches->deadlines.end())
+    {
+        m_watches->deadlines.erase(entry.deadline);
+    }
+    m_watches->sockets.erase(iter);
+    lock.unlock();
+
+    // Outside the lock, the callback takes it while the context is locked.
+    entry.ctx.RemoveCallback(entry.callback);
+}
+
+Result<void> SocketService::SetBusyPoll(const BusyPoll& options)
+{
+    FUSION_UNUSED(options);
+
+    return Failure(E_NOT_SUPPORTED)
+        .WithContext("socket service does not support busy polling");
+}
+
+SocketService::Stats SocketService::GetStats() const
+{
+    return Stats{};
+}
+
+SocketService::Stats& SocketService::Stats::operator+=(const Stats& stats)
+{
+    spinPolls += stats.spinPolls;
+    spinWakeups += stats.spinWakeups;
+    blocks += stats.blocks;
+    blockWakeups += stats.blockWakeups;
+    spinTime += stats.spinTime;
+    blockTime += stats.blockTime;
+    return *this;
+}
+
+int32_t Internal::ToPollTimeout(Clock::duration timeout)
+{
+    using namespace std::chrono;
+
+    if (timeout < Clock::duration::zero())
+    {
+        return -1;
+    }
+
+    const auto ms = ceil<milliseconds>(timeout).count();
+    return int32_t(std::min<decltype(ms)>(ms, INT32_MAX));
+}
+
+Result<void> Internal::ApplyBusyPoll(
+    const Network& network,
+    Socket sock,
+    const SocketService::BusyPoll& options)
+{
+    // Descriptors that are not sockets, an eventfd for instance, have no
+    // busy polling to configure.
+    auto notSocket = [](const Result<void>& result) {
+        return result.Error().Error().platformCode == ENOTSOCK;
+    };
+
+    if (options.socketBusyPoll.count() > 0)
+    {
+        auto usec = static_cast<int32_t>(options.socketBusyPoll.count());
+
+        if (auto result = network.SetSocketOption(
+            sock,
+            SocketOpt::BusyPoll,
+            &usec,
+            sizeof(usec)); !result)
+        {
+            return notSocket(result) ? Success : result;
+        }
+    }
+    if (options.socketBudget > 0)
+    {
+        int32_t budget = options.socketBudget;
+
+        if (auto result = network.SetSocketOption(
+            sock,
+            SocketOpt::BusyPollBudget,
+            &budget,
+            sizeof(budget)); !result)
+        {
+            return notSocket(result) ? Success : result;
+        }
+    }
+    if (options.preferBusyPoll)
+    {
+        int32_t prefer = 1;
+
+        if (auto result = network.SetSocketOption(
+            sock,
+            SocketOpt::PreferBusyPoll,
+            &prefer,
+            sizeof(prefer)); !result)
+        {
+            return notSocket(result) ? Success : result;
+        }
+    }
+    return Success;
+}
 // SocketService                                             END
 // -------------------------------------------------------------
 
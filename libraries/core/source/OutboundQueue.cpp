@@ -0,0 +1,326 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/OutboundQueue.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Memory.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace Fusion
+{
+Result<std::unique_ptr<OutboundQueue>> OutboundQueue::Create(
+    Network& network,
+    SocketService& service,
+    Socket sock,
+    Params params,
+    WatermarkCallback callback)
+{
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+    if (params.chunkSize == 0)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("chunkSize must be greater than zero");
+    }
+    if (params.highWatermark == 0
+        || params.lowWatermark > params.highWatermark)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid watermarks (low={},high={})",
+                params.lowWatermark, params.highWatermark);
+    }
+    if (params.limit != 0 && params.limit < params.highWatermark)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("limit '{}' is below the high watermark '{}'",
+                params.limit, params.highWatermark);
+    }
+
+    return std::make_unique<OutboundQueue>(
+        network,
+        service,
+        sock,
+        params,
+        std::move(callback));
+}
+
+OutboundQueue::OutboundQueue(
+    Network& network,
+    SocketService& service,
+    Socket sock,
+    Params params,
+    WatermarkCallback callback)
+    : m_network(network)
+    , m_service(service)
+    , m_sock(sock)
+    , m_params(params)
+    , m_callback(std::move(callback))
+{
+    if (m_params.limit == 0)
+    {
+        m_params.limit = m_params.highWatermark * 2;
+    }
+}
+
+OutboundQueue::~OutboundQueue()
+{
+    (void)SetWriteInterest(false);
+}
+
+Result<size_t> OutboundQueue::Write(const void* data, size_t size)
+{
+    FUSION_ASSERT(data || size == 0);
+    if (size == 0)
+    {
+        return size_t(0);
+    }
+
+    if (m_size + size > m_params.limit)
+    {
+        return Failure(E_NET_WOULD_BLOCK)
+            .WithContext("outbound queue full ({} of {} bytes queued)",
+                m_size, m_params.limit);
+    }
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t sent = 0;
+
+    // Nothing is queued ahead of this write, hand it straight to the socket
+    // and only copy what it does not accept.
+    if (m_chunks.empty())
+    {
+        while (sent < size)
+        {
+            auto result = m_network.Send(m_sock, bytes + sent, size - sent);
+            if (!result)
+            {
+                if (result.Error().Error() == E_NET_WOULD_BLOCK)
+                {
+                    break;
+                }
+                if (sent == 0)
+                {
+                    return result.Error();
+                }
+                return sent;
+            }
+            sent += *result;
+        }
+
+        if (sent == size)
+        {
+            return size;
+        }
+    }
+
+    // Only the remainder needs room, a write the socket took whole never
+    // allocates.
+    auto reserved = Reserve(size - sent);
+    FUSION_SCOPE_GUARD([&] { Trim(); });
+
+    if (!reserved)
+    {
+        if (sent == 0)
+        {
+            return reserved.Error();
+        }
+        return sent;
+    }
+
+    if (auto result = SetWriteInterest(true); !result)
+    {
+        if (sent == 0)
+        {
+            return result.Error();
+        }
+        return sent;
+    }
+    Append(bytes + sent, size - sent);
+
+    if (!m_paused && m_size >= m_params.highWatermark)
+    {
+        m_paused = true;
+        Notify(true);
+    }
+    return size;
+}
+
+Result<void> OutboundQueue::Flush()
+{
+    while (!m_chunks.empty())
+    {
+        Chunk& chunk = m_chunks.front();
+
+        auto result = m_network.Send(
+            m_sock,
+            chunk.data.get() + chunk.begin,
+            chunk.end - chunk.begin);
+
+        if (!result)
+        {
+            if (result.Error().Error() == E_NET_WOULD_BLOCK)
+            {
+                break;
+            }
+            return result.Error();
+        }
+
+        chunk.begin += *result;
+        m_size -= *result;
+
+        if (chunk.begin == chunk.end)
+        {
+            Release(std::move(chunk));
+            m_chunks.pop_front();
+        }
+    }
+
+    if (m_chunks.empty())
+    {
+        if (auto result = SetWriteInterest(false); !result)
+        {
+            return result;
+        }
+    }
+
+    if (m_paused && m_size <= m_params.lowWatermark)
+    {
+        m_paused = false;
+        Notify(false);
+    }
+    return Success;
+}
+
+Socket OutboundQueue::GetSocket() const
+{
+    return m_sock;
+}
+
+bool OutboundQueue::IsPaused() const
+{
+    return m_paused;
+}
+
+size_t OutboundQueue::Size() const
+{
+    return m_size;
+}
+
+size_t OutboundQueue::Capacity() const
+{
+    return (m_chunks.size() + m_spares.size()) * m_params.chunkSize;
+}
+
+Result<void> OutboundQueue::Reserve(size_t size)
+{
+    size_t available = m_spares.size() * m_params.chunkSize;
+    if (!m_chunks.empty())
+    {
+        available += m_params.chunkSize - m_chunks.back().end;
+    }
+
+    while (available < size)
+    {
+        Chunk chunk;
+        chunk.data.reset(new (std::nothrow) uint8_t[m_params.chunkSize]);
+
+        if (!chunk.data)
+        {
+            return Failure(E_INSUFFICIENT_RESOURCES)
+                .WithContext("failed to allocate '{}' byte chunk",
+                    m_params.chunkSize);
+        }
+        m_spares.push_back(std::move(chunk));
+        available += m_params.chunkSize;
+    }
+    return Success;
+}
+
+void OutboundQueue::Append(const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        if (m_chunks.empty() || m_chunks.back().end == m_params.chunkSize)
+        {
+            FUSION_ASSERT(!m_spares.empty());
+
+            m_chunks.push_back(std::move(m_spares.back()));
+            m_spares.pop_back();
+        }
+
+        Chunk& chunk = m_chunks.back();
+        size_t count = std::min(size, m_params.chunkSize - chunk.end);
+
+        memcpy(chunk.data.get() + chunk.end, data, count);
+        chunk.end += count;
+        m_size += count;
+
+        data += count;
+        size -= count;
+    }
+}
+
+void OutboundQueue::Trim()
+{
+    if (m_spares.size() > m_params.spareChunks)
+    {
+        m_spares.resize(m_params.spareChunks);
+    }
+}
+
+Result<void> OutboundQueue::SetWriteInterest(bool enabled)
+{
+    if (m_writeInterest == enabled)
+    {
+        return Success;
+    }
+
+    auto result = enabled
+        ? m_service.Add(m_sock, SocketOperation::Write)
+        : m_service.Remove(m_sock, SocketOperation::Write);
+
+    if (result)
+    {
+        m_writeInterest = enabled;
+    }
+    return result;
+}
+
+void OutboundQueue::Release(Chunk chunk)
+{
+    if (m_spares.size() < m_params.spareChunks)
+    {
+        chunk.begin = 0;
+        chunk.end = 0;
+        m_spares.push_back(std::move(chunk));
+    }
+}
+
+void OutboundQueue::Notify(bool paused)
+{
+    if (m_callback)
+    {
+        m_callback(paused);
+    }
+}
+}  // namespace Fusion
@@ -0,0 +1,364 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/RateLimiter.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Hash.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace Fusion
+{
+template<typename Key>
+static uint64_t HashKey(const Key& key)
+{
+    FNV<FNV1A<uint64_t>> fnv;
+    fnv.Data(key.address.data(), key.address.size());
+    fnv.Scalar(key.port);
+    fnv.Scalar(uint8_t(key.family));
+    return fnv.Done();
+}
+
+Result<std::unique_ptr<RateLimiter>> RateLimiter::Create(Params params)
+{
+    if (!(params.rate > 0) || !std::isfinite(params.rate))
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid rate '{}'", params.rate);
+    }
+    if (!(params.burst >= 1) || !std::isfinite(params.burst))
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid burst '{}'", params.burst);
+    }
+    if (params.maxPeers == 0 || params.shards == 0)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid limits (maxPeers={},shards={})",
+                params.maxPeers, params.shards);
+    }
+    if (params.idleTimeout < Clock::duration::zero())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("idleTimeout must not be negative");
+    }
+
+    return std::make_unique<RateLimiter>(params);
+}
+
+RateLimiter::RateLimiter(Params params)
+    : m_params(params)
+{
+    m_params.shards = std::bit_ceil(std::max<size_t>(m_params.shards, 1));
+    m_params.maxPeers = std::max(m_params.maxPeers, m_params.shards);
+    m_shardCapacity = (m_params.maxPeers + m_params.shards - 1) / m_params.shards;
+    m_shards = std::make_unique<Shard[]>(m_params.shards);
+}
+
+RateLimiter::~RateLimiter() = default;
+
+bool RateLimiter::TryAcquire(const SocketAddress& peer, double tokens)
+{
+    return TryAcquire(MakeKey(peer), tokens, Clock::now());
+}
+
+bool RateLimiter::TryAcquire(const InetAddress& peer, double tokens)
+{
+    return TryAcquire(
+        MakeKey(AddressFamily::Inet4, peer.Data(), InetAddress::SIZE),
+        tokens,
+        Clock::now());
+}
+
+bool RateLimiter::TryAcquire(const Inet6Address& peer, double tokens)
+{
+    return TryAcquire(
+        MakeKey(AddressFamily::Inet6, peer.Data(), Inet6Address::SIZE),
+        tokens,
+        Clock::now());
+}
+
+bool RateLimiter::TryAcquire(
+    const SocketAddress& peer,
+    double tokens,
+    Clock::time_point now)
+{
+    return TryAcquire(MakeKey(peer), tokens, now);
+}
+
+bool RateLimiter::TryAcquire(
+    const Key& key,
+    double tokens,
+    Clock::time_point now)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+
+    ExpireLocked(shard, now);
+
+    BucketList::iterator bucket;
+    if (auto iter = shard.index.find(key); iter != shard.index.end())
+    {
+        bucket = iter->second;
+        Refill(*bucket, now);
+
+        // Most recently used peers live at the front.
+        shard.lru.splice(shard.lru.begin(), shard.lru, bucket);
+    }
+    else
+    {
+        if (shard.index.size() >= m_shardCapacity)
+        {
+            // Reuse the least recently used node instead of allocating.
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.splice(shard.lru.begin(), shard.lru, std::prev(shard.lru.end()));
+        }
+        else
+        {
+            shard.lru.emplace_front();
+        }
+
+        bucket = shard.lru.begin();
+        bucket->key = key;
+        bucket->tokens = m_params.burst;
+        bucket->updated = now;
+        shard.index.emplace(key, bucket);
+    }
+
+    if (bucket->tokens < tokens)
+    {
+        return false;
+    }
+
+    bucket->tokens -= tokens;
+    return true;
+}
+
+Clock::duration RateLimiter::RetryAfter(
+    const SocketAddress& peer,
+    double tokens,
+    Clock::time_point now) const
+{
+    using namespace std::chrono;
+
+    const Key key = MakeKey(peer);
+    Shard& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+
+    auto iter = shard.index.find(key);
+    if (iter == shard.index.end())
+    {
+        return Clock::duration::zero();
+    }
+
+    Bucket bucket = *iter->second;
+    Refill(bucket, now);
+
+    if (bucket.tokens >= tokens)
+    {
+        return Clock::duration::zero();
+    }
+    if (tokens > m_params.burst)
+    {
+        return Clock::duration::max();
+    }
+
+    const duration<double> wait((tokens - bucket.tokens) / m_params.rate);
+    return ceil<Clock::duration>(wait);
+}
+
+void RateLimiter::Remove(const SocketAddress& peer)
+{
+    const Key key = MakeKey(peer);
+    Shard& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+
+    if (auto iter = shard.index.find(key); iter != shard.index.end())
+    {
+        shard.lru.erase(iter->second);
+        shard.index.erase(iter);
+    }
+}
+
+size_t RateLimiter::Expire(Clock::time_point now)
+{
+    size_t expired = 0;
+
+    for (size_t i = 0; i < m_params.shards; ++i)
+    {
+        Shard& shard = m_shards[i];
+        std::lock_guard lock(shard.mutex);
+
+        size_t before = shard.index.size();
+        ExpireLocked(shard, now);
+        expired += before - shard.index.size();
+    }
+    return expired;
+}
+
+void RateLimiter::Clear()
+{
+    for (size_t i = 0; i < m_params.shards; ++i)
+    {
+        Shard& shard = m_shards[i];
+        std::lock_guard lock(shard.mutex);
+
+        shard.index.clear();
+        shard.lru.clear();
+    }
+}
+
+size_t RateLimiter::Size() const
+{
+    size_t size = 0;
+
+    for (size_t i = 0; i < m_params.shards; ++i)
+    {
+        const Shard& shard = m_shards[i];
+        std::lock_guard lock(shard.mutex);
+
+        size += shard.index.size();
+    }
+    return size;
+}
+
+bool RateLimiter::Key::operator==(const Key& key) const
+{
+    return family == key.family
+        && port == key.port
+        && address == key.address;
+}
+
+RateLimiter::Key RateLimiter::MakeKey(const SocketAddress& peer) const
+{
+    uint16_t port = 0;
+    Key key;
+
+    switch (peer.Family())
+    {
+    case AddressFamily::Inet4:
+        port = peer.Inet().port;
+        key = MakeKey(
+            AddressFamily::Inet4,
+            peer.Inet().address.Data(),
+            InetAddress::SIZE);
+        break;
+    case AddressFamily::Inet6:
+        port = peer.Inet6().port;
+        key = MakeKey(
+            AddressFamily::Inet6,
+            peer.Inet6().address.Data(),
+            Inet6Address::SIZE);
+        break;
+    default:
+        // Local peers carry no address worth telling apart, they share a
+        // single bucket per family.
+        key = MakeKey(peer.Family(), nullptr, 0);
+        break;
+    }
+
+    if (m_params.includePort && port != 0)
+    {
+        key.port = port;
+        key.hash = HashKey(key);
+    }
+    return key;
+}
+
+RateLimiter::Key RateLimiter::MakeKey(
+    AddressFamily family,
+    const uint8_t* address,
+    size_t size) const
+{
+    FUSION_ASSERT(size <= Inet6Address::SIZE);
+
+    Key key;
+    key.family = family;
+
+    if (size > 0)
+    {
+        memcpy(key.address.data(), address, size);
+    }
+
+    // IPv4 peers arriving on a dual stack socket are the same host as when
+    // they connect over IPv4.
+    if (family == AddressFamily::Inet6)
+    {
+        Inet6Address inet6;
+        inet6.Assign(address);
+
+        if (inet6.IsMappedV4())
+        {
+            const InetAddress inet = inet6.AsV4();
+
+            key.address = {};
+            key.family = AddressFamily::Inet4;
+            memcpy(key.address.data(), inet.Data(), InetAddress::SIZE);
+        }
+    }
+
+    key.hash = HashKey(key);
+    return key;
+}
+
+RateLimiter::Shard& RateLimiter::GetShard(const Key& key) const
+{
+    // The low bits select the hash table bucket, use the high bits here so
+    // peers within a shard still spread over its table.
+    return m_shards[size_t(key.hash >> 32) & (m_params.shards - 1)];
+}
+
+void RateLimiter::Refill(Bucket& bucket, Clock::time_point now) const
+{
+    using namespace std::chrono;
+
+    if (now <= bucket.updated)
+    {
+        return;
+    }
+
+    const duration<double> elapsed = now - bucket.updated;
+    bucket.tokens = std::min(
+        m_params.burst,
+        bucket.tokens + elapsed.count() * m_params.rate);
+    bucket.updated = now;
+}
+
+void RateLimiter::ExpireLocked(Shard& shard, Clock::time_point now)
+{
+    if (m_params.idleTimeout == Clock::duration::zero())
+    {
+        return;
+    }
+
+    // Buckets are kept in order of use, the idle ones collect at the back.
+    while (!shard.lru.empty())
+    {
+        const Bucket& bucket = shard.lru.back();
+        if (now - bucket.updated < m_params.idleTimeout)
+        {
+            break;
+        }
+
+        shard.index.erase(bucket.key);
+        shard.lru.pop_back();
+    }
+}
+}  // namespace Fusion
@@ -66,6 +66,12 @@ Result<void> SelectSocketService::Add(
     }
     else
     {
+        if (auto result = ApplyBusyPoll(m_network, sock, m_busyPoll); !result)
+        {
+            return result.Error()
+                .WithContext("failed to enable busy polling on '{}'", sock);
+        }
+
         m_events.push_back(SocketEvent{
             .sock = sock,
             .events = events
@@ -76,7 +82,7 @@ Result<void> SelectSocketService::Add(
     return Success;
 }
 
-Result<void> SelectSocketService::Close(Socket sock)
+Result<void> SelectSocketService::CloseInternal(Socket sock)
 {
     std::unique_lock lock(m_mutex);
 
@@ -99,7 +105,43 @@ Result<void> SelectSocketService::Close(Socket sock)
 }
 
 Result<std::span<SocketEvent>>
-SelectSocketService::Execute(Clock::duration timeout)
+SelectSocketService::ExecuteInternal(Clock::duration timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        FUSION_ASSERT(m_events.empty());
+        FUSION_ASSERT(m_results.empty());
+
+        return Failure(E_CANCELLED);
+    }
+
+    const Clock::duration spin = m_busyPoll.spin;
+    lock.unlock();
+
+    Stats stats;
+    auto result = SpinThenBlock(
+        spin,
+        timeout,
+        stats,
+        [this](Clock::duration t) { return Wait(t); });
+
+    lock.lock();
+    m_stats += stats;
+
+    if (!result)
+    {
+        return result.Error();
+    }
+    if (!*result || m_results.empty())
+    {
+        return std::span<SocketEvent>{};
+    }
+    return { m_results };
+}
+
+Result<bool> SelectSocketService::Wait(Clock::duration timeout)
 {
     std::unique_lock<std::mutex> lock(m_mutex);
 
@@ -166,7 +208,8 @@ SelectSocketService::Execute(Clock::duration timeout)
     struct timeval* duration = nullptr;
     struct timeval storage = { 0 };
 
-    if (timeout > Clock::duration::zero())
+    // A zero timeout polls, only negative timeouts block indefinitely.
+    if (timeout >= Clock::duration::zero())
     {
         memset(&storage, 0, sizeof(timeval));
         duration = &storage;
@@ -181,24 +224,21 @@ SelectSocketService::Execute(Clock::duration timeout)
     }
 
     m_polling = true;
+    m_results.clear();
     lock.unlock();
 
-    Clock::time_point start = Clock::now();
     int res = ::select(nFds, &reads, &writes, &errors, duration);
-    Clock::time_point end = Clock::now();
-
-    FUSION_UNUSED(start);
-    FUSION_UNUSED(end);
 
     lock.lock();
 
     FUSION_ASSERT(m_polling);
     m_polling = false;
     m_notify = false;
+    m_cond.notify_all();
 
     if (m_shutdown)
     {
-        return {};
+        return true;
     }
 
     if (res == SOCKET_ERROR)
@@ -209,11 +249,14 @@ SelectSocketService::Execute(Clock::duration timeout)
 
     if (res == 0)
     {
-        return {};
+        return false;
     }
 
+    bool notified = false;
     if (FD_ISSET(notify, &reads))
     {
+        notified = true;
+
         if (auto result = m_pipe.Drain(); !result)
         {
             return result.Error()
@@ -222,7 +265,6 @@ SelectSocketService::Execute(Clock::duration timeout)
         }
     }
 
-    m_results.clear();
     m_results.reserve(m_events.size());
 
     for (SocketEvent& ev : m_events)
@@ -262,7 +304,7 @@ SelectSocketService::Execute(Clock::duration timeout)
             });
         }
     }
-    return { m_results };
+    return notified || !m_results.empty();
 }
 
 void SelectSocketService::Notify()
@@ -323,6 +365,35 @@ Result<void> SelectSocketService::Remove(
     return Success;
 }
 
+Result<void> SelectSocketService::SetBusyPoll(const BusyPoll& options)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return Failure(E_FAILURE);
+    }
+
+    m_busyPoll = options;
+
+    for (const SocketEvent& ev : m_events)
+    {
+        if (auto result = ApplyBusyPoll(m_network, ev.sock, options); !result)
+        {
+            return result.Error()
+                .WithContext("failed to enable busy polling on '{}'", ev.sock);
+        }
+    }
+
+    return Success;
+}
+
+SocketService::Stats SelectSocketService::GetStats() const
+{
+    std::unique_lock lock(m_mutex);
+    return m_stats;
+}
+
 Result<void> SelectSocketService::Start()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -0,0 +1,616 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/SharedMemoryChannel.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Macros.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#if FUSION_PLATFORM_LINUX
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Fusion
+{
+static constexpr uint64_t CHANNEL_MAGIC = 0x314d48534e535546;  // FUSNSHM1
+static constexpr size_t CHANNEL_MIN_CAPACITY = 4096;
+static constexpr size_t CHANNEL_MAX_CAPACITY = size_t(1) << 30;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+//
+// Positions count bytes since the channel was created and only ever grow,
+// the offset into the ring is the position modulo the capacity.
+//
+struct SharedMemoryChannel::Ring
+{
+    //
+    // Bytes received, written by the consumer.
+    //
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+
+    //
+    // Bytes sent, written by the producer.
+    //
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+
+    //
+    // Raised by a side about to sleep on its eventfd, cleared by the peer
+    // when it signals the eventfd.
+    //
+    alignas(64) std::atomic<uint32_t> consumerWaiting{ 0 };
+    std::atomic<uint32_t> producerWaiting{ 0 };
+};
+
+struct SharedMemoryChannel::Header
+{
+    uint64_t magic{ 0 };
+    uint64_t capacity{ 0 };
+    std::atomic<uint32_t> closed[2]{ 0, 0 };
+
+    //
+    // Ring N carries the data sent by side N, the creator is side 0.
+    //
+    Ring rings[2];
+};
+
+// -------------------------------------------------------------
+// Platform                                                START
+#if FUSION_PLATFORM_LINUX
+static Result<Socket> CreateMemory(size_t size)
+{
+    int fd = ::memfd_create("fusion-channel", MFD_CLOEXEC);
+    if (fd == -1)
+    {
+        return Failure::Errno()
+            .WithContext("failed to create shared memory");
+    }
+    if (::ftruncate(fd, off_t(size)) == -1)
+    {
+        Failure failure = Failure::Errno()
+            .WithContext("failed to size shared memory to '{}' bytes", size);
+
+        ::close(fd);
+        return failure;
+    }
+    return Socket(fd);
+}
+
+static Result<Socket> CreateEvent()
+{
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1)
+    {
+        return Failure::Errno()
+            .WithContext("failed to create eventfd");
+    }
+    return Socket(fd);
+}
+
+static Result<size_t> MemorySize(Socket memory)
+{
+    struct stat st{};
+    if (::fstat(memory, &st) == -1)
+    {
+        return Failure::Errno()
+            .WithContext("failed to stat shared memory '{}'", memory);
+    }
+    return size_t(st.st_size);
+}
+
+static Result<void*> MapMemory(Socket memory, size_t size)
+{
+    void* data = ::mmap(
+        nullptr,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        memory,
+        0);
+
+    if (data == MAP_FAILED)
+    {
+        return Failure::Errno()
+            .WithContext("failed to map '{}' bytes of shared memory", size);
+    }
+    return data;
+}
+
+static void UnmapMemory(void* data, size_t size)
+{
+    ::munmap(data, size);
+}
+
+static void CloseDescriptor(Socket fd)
+{
+    ::close(fd);
+}
+
+static void ReadEvent(Socket event)
+{
+    uint64_t value = 0;
+    (void)!::read(event, &value, sizeof(value));
+}
+
+static void WriteEvent(Socket event)
+{
+    const uint64_t value = 1;
+    (void)!::write(event, &value, sizeof(value));
+}
+#else
+static Result<Socket> CreateMemory(size_t size)
+{
+    FUSION_UNUSED(size);
+    return Failure(E_NOT_SUPPORTED);
+}
+
+static Result<Socket> CreateEvent()
+{
+    return Failure(E_NOT_SUPPORTED);
+}
+
+static Result<size_t> MemorySize(Socket memory)
+{
+    FUSION_UNUSED(memory);
+    return Failure(E_NOT_SUPPORTED);
+}
+
+static Result<void*> MapMemory(Socket memory, size_t size)
+{
+    FUSION_UNUSED(memory);
+    FUSION_UNUSED(size);
+    return Failure(E_NOT_SUPPORTED);
+}
+
+static void UnmapMemory(void* data, size_t size)
+{
+    FUSION_UNUSED(data);
+    FUSION_UNUSED(size);
+}
+
+static void CloseDescriptor(Socket fd)
+{
+    FUSION_UNUSED(fd);
+}
+
+static void ReadEvent(Socket event)
+{
+    FUSION_UNUSED(event);
+}
+
+static void WriteEvent(Socket event)
+{
+    FUSION_UNUSED(event);
+}
+#endif  // FUSION_PLATFORM_LINUX
+// Platform                                                  END
+// -------------------------------------------------------------
+// SharedMemoryChannel                                     START
+Result<std::unique_ptr<SharedMemoryChannel>> SharedMemoryChannel::Create()
+{
+    return Create(Params{});
+}
+
+Result<std::unique_ptr<SharedMemoryChannel>> SharedMemoryChannel::Create(
+    Params params)
+{
+    if (params.capacity == 0 || params.capacity > CHANNEL_MAX_CAPACITY)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid capacity '{}'", params.capacity);
+    }
+
+    const size_t capacity = std::bit_ceil(
+        std::max(params.capacity, CHANNEL_MIN_CAPACITY));
+    const size_t size = DataOffset() + 2 * capacity;
+
+    auto channel = std::make_unique<SharedMemoryChannel>();
+    channel->m_capacity = capacity;
+    channel->m_side = 0;
+
+    if (auto memory = CreateMemory(size); !memory)
+    {
+        return memory.Error();
+    }
+    else
+    {
+        channel->m_descriptors[0] = *memory;
+    }
+
+    for (size_t i = 1; i < channel->m_descriptors.size(); ++i)
+    {
+        if (auto event = CreateEvent(); !event)
+        {
+            return event.Error();
+        }
+        else
+        {
+            channel->m_descriptors[i] = *event;
+        }
+    }
+
+    if (auto result = channel->Map(channel->m_descriptors[0], size, true);
+        !result)
+    {
+        return result.Error();
+    }
+    return channel;
+}
+
+Result<std::unique_ptr<SharedMemoryChannel>> SharedMemoryChannel::Open(
+    std::span<const Socket> descriptors)
+{
+    auto channel = std::make_unique<SharedMemoryChannel>();
+    channel->m_side = 1;
+
+    for (size_t i = 0; i < descriptors.size(); ++i)
+    {
+        if (i < channel->m_descriptors.size())
+        {
+            channel->m_descriptors[i] = descriptors[i];
+        }
+        else if (descriptors[i] != INVALID_SOCKET)
+        {
+            CloseDescriptor(descriptors[i]);
+        }
+    }
+
+    if (descriptors.size() != channel->m_descriptors.size()
+        || std::find(
+            channel->m_descriptors.begin(),
+            channel->m_descriptors.end(),
+            INVALID_SOCKET) != channel->m_descriptors.end())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("expected '{}' descriptors, received '{}'",
+                channel->m_descriptors.size(),
+                descriptors.size());
+    }
+
+    size_t size = 0;
+    if (auto result = MemorySize(channel->m_descriptors[0]); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        size = *result;
+    }
+
+    if (auto result = channel->Map(channel->m_descriptors[0], size, false);
+        !result)
+    {
+        return result.Error();
+    }
+    return channel;
+}
+
+SharedMemoryChannel::SharedMemoryChannel() = default;
+
+size_t SharedMemoryChannel::DataOffset()
+{
+    // The rings start on their own page.
+    return (sizeof(Header) + 4095) & ~size_t(4095);
+}
+
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    Close();
+
+    if (m_header)
+    {
+        UnmapMemory(m_header, m_size);
+    }
+    for (Socket fd : m_descriptors)
+    {
+        if (fd != INVALID_SOCKET)
+        {
+            CloseDescriptor(fd);
+        }
+    }
+}
+
+Result<void> SharedMemoryChannel::Map(
+    Socket memory,
+    size_t size,
+    bool initialize)
+{
+    if (size <= DataOffset())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("shared memory of '{}' bytes is too small", size);
+    }
+
+    void* data = nullptr;
+    if (auto result = MapMemory(memory, size); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        data = *result;
+    }
+
+    m_header = static_cast<Header*>(data);
+    m_size = size;
+
+    if (initialize)
+    {
+        new (data) Header{};
+        m_header->magic = CHANNEL_MAGIC;
+        m_header->capacity = m_capacity;
+        return Success;
+    }
+
+    const uint64_t capacity = m_header->capacity;
+
+    if (m_header->magic != CHANNEL_MAGIC
+        || capacity < CHANNEL_MIN_CAPACITY
+        || capacity > CHANNEL_MAX_CAPACITY
+        || !std::has_single_bit(capacity)
+        || DataOffset() + 2 * capacity != size)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("shared memory does not hold a channel");
+    }
+
+    m_capacity = size_t(capacity);
+    return Success;
+}
+
+std::array<Socket, 3> SharedMemoryChannel::Descriptors() const
+{
+    return m_descriptors;
+}
+
+Socket SharedMemoryChannel::Handle() const
+{
+    return m_descriptors[1 + m_side];
+}
+
+size_t SharedMemoryChannel::Capacity() const
+{
+    return m_capacity;
+}
+
+uint8_t* SharedMemoryChannel::Data(size_t ring) const
+{
+    return reinterpret_cast<uint8_t*>(m_header)
+        + DataOffset()
+        + ring * m_capacity;
+}
+
+void SharedMemoryChannel::Drain() const
+{
+    ReadEvent(Handle());
+}
+
+void SharedMemoryChannel::Signal(Socket event) const
+{
+    WriteEvent(event);
+}
+
+void SharedMemoryChannel::Rearm()
+{
+    // Drain() consumes every pending wakeup, including one meant for the
+    // other direction. Signal ourselves again when that direction is
+    // waiting and can already make progress. Called after every Drain().
+    const size_t peer = 1 - m_side;
+    const bool closed = m_header->closed[peer].load() != 0;
+    bool ready = false;
+
+    if (m_recvBlocked.load())
+    {
+        const Ring& in = m_header->rings[peer];
+        ready |= closed || in.tail.load() != in.head.load();
+    }
+    if (m_sendBlocked.load())
+    {
+        const Ring& out = m_header->rings[m_side];
+        ready |= closed || out.tail.load() - out.head.load() < m_capacity;
+    }
+
+    if (ready)
+    {
+        Signal(Handle());
+    }
+}
+
+Result<size_t> SharedMemoryChannel::Send(const void* buffer, size_t size)
+{
+    FUSION_ASSERT(m_header);
+    FUSION_ASSERT(buffer || size == 0);
+
+    const size_t peer = 1 - m_side;
+
+    if (m_closed || m_header->closed[peer].load())
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    Ring& ring = m_header->rings[m_side];
+    const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+
+    if (tail - head == m_capacity)
+    {
+        m_sendBlocked = true;
+        Drain();
+
+        // Announce the wait before looking again, a consumer which frees
+        // space afterwards is guaranteed to see the flag.
+        ring.producerWaiting.store(1);
+        head = ring.head.load();
+
+        const bool full = (tail - head == m_capacity);
+        if (!full)
+        {
+            ring.producerWaiting.store(0);
+            m_sendBlocked = false;
+        }
+
+        // Whether or not this call blocks, the wakeup Drain() consumed may
+        // have been meant for a Recv() waiting on the same eventfd.
+        Rearm();
+
+        if (full)
+        {
+            return Failure(E_NET_WOULD_BLOCK);
+        }
+    }
+    m_sendBlocked = false;
+
+    if (tail - head > m_capacity)
+    {
+        return Corrupted(head, tail);
+    }
+
+    const size_t count = std::min(size, size_t(m_capacity - (tail - head)));
+    const size_t offset = size_t(tail & (m_capacity - 1));
+    const size_t first = std::min(count, m_capacity - offset);
+
+    const auto* data = static_cast<const uint8_t*>(buffer);
+    std::memcpy(Data(m_side) + offset, data, first);
+    std::memcpy(Data(m_side), data + first, count - first);
+
+    ring.tail.store(tail + count);
+
+    if (ring.consumerWaiting.load() && ring.consumerWaiting.exchange(0))
+    {
+        Signal(m_descriptors[1 + peer]);
+    }
+    return count;
+}
+
+Result<size_t> SharedMemoryChannel::Recv(void* buffer, size_t size)
+{
+    FUSION_ASSERT(m_header);
+    FUSION_ASSERT(buffer || size == 0);
+
+    if (m_closed)
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    const size_t peer = 1 - m_side;
+    Ring& ring = m_header->rings[peer];
+
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+    if (tail == head)
+    {
+        m_recvBlocked = true;
+        Drain();
+
+        ring.consumerWaiting.store(1);
+        tail = ring.tail.load();
+
+        // Whatever the peer sent before closing is visible once the
+        // closed flag is.
+        const bool closed = (tail == head) && m_header->closed[peer].load();
+        if (closed)
+        {
+            tail = ring.tail.load();
+        }
+
+        if (tail != head || closed)
+        {
+            ring.consumerWaiting.store(0);
+            m_recvBlocked = false;
+        }
+
+        // As in Send(), pass on a wakeup meant for the other direction.
+        Rearm();
+
+        if (tail == head)
+        {
+            if (closed)
+            {
+                return Failure(E_NET_DISCONNECTED);
+            }
+            return Failure(E_NET_WOULD_BLOCK);
+        }
+    }
+    m_recvBlocked = false;
+
+    // The peer's tail is only trusted as far as the ring reaches, anything
+    // more would copy from past the end of the mapping.
+    if (tail - head > m_capacity)
+    {
+        return Corrupted(head, tail);
+    }
+
+    const size_t count = std::min(size, size_t(tail - head));
+    const size_t offset = size_t(head & (m_capacity - 1));
+    const size_t first = std::min(count, m_capacity - offset);
+
+    auto* data = static_cast<uint8_t*>(buffer);
+    std::memcpy(data, Data(peer) + offset, first);
+    std::memcpy(data + first, Data(peer), count - first);
+
+    ring.head.store(head + count);
+
+    if (ring.producerWaiting.load() && ring.producerWaiting.exchange(0))
+    {
+        Signal(m_descriptors[1 + peer]);
+    }
+    return count;
+}
+
+Failure SharedMemoryChannel::Corrupted(uint64_t head, uint64_t tail)
+{
+    Close();
+
+    return Failure(E_FAILURE)
+        .WithContext("ring positions head={} tail={} do not fit the '{}' "
+            "byte capacity, closing the channel", head, tail, m_capacity);
+}
+
+void SharedMemoryChannel::Close()
+{
+    if (m_closed || !m_header)
+    {
+        return;
+    }
+    m_closed = true;
+
+    const size_t peer = 1 - m_side;
+
+    m_header->closed[m_side].store(1);
+    Signal(m_descriptors[1 + peer]);
+}
+// SharedMemoryChannel                                       END
+// -------------------------------------------------------------
+}  // namespace Fusion
@@ -0,0 +1,1682 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/SimulatedNetwork.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Macros.h>
+#include <Fusion/Random.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Fusion::Internal
+{
+class SimulatedSocketService;
+
+static constexpr uint16_t EPHEMERAL_PORT_FIRST = 49152;
+
+// Simulated sockets are numbered from here, past the largest descriptor
+// the system can hand out (Linux caps fs.nr_open below 2^30), so that
+// Poll() reports them as invalid rather than polling somebody's file.
+static constexpr Socket SOCKET_FIRST = Socket(1) << 30;
+static constexpr Clock::time_point NEVER = Clock::time_point::max();
+
+//
+// Data in flight to a socket, visible to it from 'at'.
+//
+struct SimulatedSegment
+{
+    Clock::time_point at;
+    std::vector<uint8_t> data;
+    SocketAddress from;
+    bool fin{ false };
+};
+
+struct SimulatedSocket
+{
+    enum class State : uint8_t
+    {
+        Idle,
+        Listening,
+        Connecting,
+        Connected,
+    };
+
+    AddressFamily family{ AddressFamily::None };
+    SocketType type{ SocketType::None };
+    State state{ State::Idle };
+    bool blocking{ true };
+
+    SocketAddress local;
+    SocketAddress peer;
+    std::string binding;
+
+    //
+    // The connected peer socket, which may have been closed since.
+    //
+    Socket remote{ INVALID_SOCKET };
+    Clock::time_point established{ NEVER };
+    Error connectError{ E_SUCCESS };
+
+    std::deque<SimulatedSegment> inbound;
+    size_t offset{ 0 };
+    std::deque<std::pair<Clock::time_point, Socket>> backlog;
+    uint32_t backlogSize{ 0 };
+
+    //
+    // Bytes sent and not yet received by the peer.
+    //
+    size_t unread{ 0 };
+    Clock::time_point linkFree{ };
+    Clock::time_point lastDelivery{ };
+    bool readShutdown{ false };
+    bool writeShutdown{ false };
+
+    SimulatedSocketService* service{ nullptr };
+    SocketOperation interest{ SocketOperation::None };
+};
+
+struct SimulatedWakeup
+{
+    Clock::time_point at;
+    Socket sock{ INVALID_SOCKET };
+
+    bool operator>(const SimulatedWakeup& other) const
+    {
+        return at > other.at;
+    }
+};
+
+struct SimulatedState
+{
+    mutable std::mutex mutex;
+
+    SimulatedNetwork::Params params;
+    SimulatedNetwork::Stats stats;
+    XorShift128 random;
+
+    Clock::time_point now{ };
+    Socket nextSocket{ SOCKET_FIRST };
+    uint16_t nextPort{ EPHEMERAL_PORT_FIRST };
+
+    std::unordered_map<Socket, SimulatedSocket> sockets;
+    std::unordered_map<std::string, Socket> bindings;
+    std::priority_queue<
+        SimulatedWakeup,
+        std::vector<SimulatedWakeup>,
+        std::greater<SimulatedWakeup>> wakeups;
+
+    explicit SimulatedState(const SimulatedNetwork::Params& p)
+        : params(p)
+        , random(p.seed)
+    { }
+
+    Result<SimulatedSocket*> Find(Socket sock);
+    void Schedule(Socket sock, Clock::time_point at);
+    void AdvanceTo(Clock::time_point at);
+    void Dispatch();
+    void Update(SimulatedSocket& s);
+
+    bool Chance(double probability);
+    Clock::duration Jitter();
+    Clock::time_point Depart(SimulatedSocket& from, size_t size);
+
+    Result<void> BindTo(Socket sock, SimulatedSocket& s, SocketAddress address);
+    Result<void> BindEphemeral(
+        Socket sock,
+        SimulatedSocket& s,
+        const SocketAddress& destination);
+    Socket Lookup(SocketType type, const SocketAddress& address) const;
+
+    void Transmit(
+        SimulatedSocket& from,
+        Socket to,
+        const uint8_t* data,
+        size_t size,
+        bool fin);
+    void TransmitDatagram(
+        SimulatedSocket& from,
+        Socket to,
+        const uint8_t* data,
+        size_t size);
+
+    SocketOperation Readiness(SimulatedSocket& s);
+    void Release(Socket sock);
+};
+
+//
+// Waits in virtual time, an Execute() with nothing ready moves the clock
+// to the next delivery instead of sleeping.
+//
+class SimulatedSocketService final : public SocketService
+{
+public:
+    explicit SimulatedSocketService(std::shared_ptr<SimulatedState> state)
+        : m_state(std::move(state))
+    { }
+
+    ~SimulatedSocketService() override
+    {
+        Stop();
+    }
+
+    Result<void> Add(Socket sock, SocketOperation events) override
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        if (m_stopped)
+        {
+            return Failure(E_FAILURE);
+        }
+
+        SimulatedSocket* s = nullptr;
+        if (auto result = m_state->Find(sock); !result)
+        {
+            return result.Error();
+        }
+        else
+        {
+            s = *result;
+        }
+
+        if (s->service && s->service != this)
+        {
+            return Failure(E_INVALID_ARGUMENT)
+                .WithContext("socket '{}' belongs to another service", sock);
+        }
+
+        s->service = this;
+        s->interest |= events;
+        m_candidates.insert(sock);
+        return Success;
+    }
+
+    void Notify() override
+    {
+        std::lock_guard lock(m_state->mutex);
+        m_notified = true;
+    }
+
+    Result<void> Remove(Socket sock, SocketOperation events) override
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        if (m_stopped)
+        {
+            return Failure(E_FAILURE);
+        }
+
+        auto iter = m_state->sockets.find(sock);
+        if (iter != m_state->sockets.end() && iter->second.service == this)
+        {
+            iter->second.interest &= ~events;
+            if ((iter->second.interest & ~SocketOperation::Error)
+                == SocketOperation::None)
+            {
+                Forget(iter->first, iter->second);
+            }
+        }
+        return Success;
+    }
+
+    Result<void> Start() override
+    {
+        return Success;
+    }
+
+    void Stop() override
+    {
+        Stop(nullptr);
+    }
+
+    void Stop(std::function<void(Failure&)> fn) override
+    {
+        {
+            std::lock_guard lock(m_state->mutex);
+
+            if (m_stopped)
+            {
+                return;
+            }
+            m_stopped = true;
+
+            for (auto& [sock, s] : m_state->sockets)
+            {
+                if (s.service == this)
+                {
+                    s.service = nullptr;
+                    s.interest = SocketOperation::None;
+                }
+            }
+            m_candidates.clear();
+            m_results.clear();
+        }
+
+        if (fn)
+        {
+            Failure f(E_SUCCESS);
+            fn(f);
+        }
+    }
+
+    //
+    // Called with the state locked when a socket of this service may have
+    // become ready.
+    //
+    void Wake(Socket sock)
+    {
+        m_candidates.insert(sock);
+    }
+
+    //
+    // Called with the state locked.
+    //
+    void Forget(Socket sock, SimulatedSocket& s)
+    {
+        s.service = nullptr;
+        s.interest = SocketOperation::None;
+        m_candidates.erase(sock);
+    }
+
+protected:
+    Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) override
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        if (m_stopped)
+        {
+            return Failure(E_CANCELLED);
+        }
+
+        const Clock::time_point end = timeout < Clock::duration::zero()
+            ? NEVER
+            : m_state->now + timeout;
+
+        while (true)
+        {
+            m_state->Dispatch();
+            m_results.clear();
+
+            for (auto iter = m_candidates.begin(); iter != m_candidates.end();)
+            {
+                auto found = m_state->sockets.find(*iter);
+                if (found == m_state->sockets.end()
+                    || found->second.service != this)
+                {
+                    iter = m_candidates.erase(iter);
+                    continue;
+                }
+
+                SimulatedSocket& s = found->second;
+                SocketOperation ready = m_state->Readiness(s) & s.interest;
+
+                if (ready == SocketOperation::None)
+                {
+                    iter = m_candidates.erase(iter);
+                    continue;
+                }
+
+                m_results.push_back(SocketEvent{
+                    .sock = *iter,
+                    .events = ready,
+                });
+                ++iter;
+            }
+
+            if (!m_results.empty() || std::exchange(m_notified, false))
+            {
+                break;
+            }
+
+            // Nothing is in flight, an unbounded wait would never end.
+            if (m_state->wakeups.empty())
+            {
+                if (end != NEVER)
+                {
+                    m_state->AdvanceTo(end);
+                }
+                break;
+            }
+
+            const Clock::time_point next = m_state->wakeups.top().at;
+            if (next > end)
+            {
+                m_state->AdvanceTo(end);
+                break;
+            }
+            m_state->AdvanceTo(next);
+        }
+
+        // Sockets are reported in a stable order, runs replay exactly.
+        std::sort(m_results.begin(), m_results.end(),
+            [](const SocketEvent& a, const SocketEvent& b) {
+                return a.sock < b.sock;
+            });
+
+        return std::span<SocketEvent>{ m_results };
+    }
+
+    Result<void> CloseInternal(Socket sock) override
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        auto iter = m_state->sockets.find(sock);
+        if (iter != m_state->sockets.end() && iter->second.service == this)
+        {
+            Forget(iter->first, iter->second);
+        }
+        return Success;
+    }
+
+private:
+    std::shared_ptr<SimulatedState> m_state;
+    std::unordered_set<Socket> m_candidates;
+    std::vector<SocketEvent> m_results;
+    bool m_notified{ false };
+    bool m_stopped{ false };
+};
+
+Result<SimulatedSocket*> SimulatedState::Find(Socket sock)
+{
+    auto iter = sockets.find(sock);
+    if (iter == sockets.end())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket '{}'", sock);
+    }
+    return &iter->second;
+}
+
+void SimulatedState::Schedule(Socket sock, Clock::time_point at)
+{
+    if (at != NEVER)
+    {
+        wakeups.push(SimulatedWakeup{ at, sock });
+    }
+}
+
+void SimulatedState::AdvanceTo(Clock::time_point at)
+{
+    now = std::max(now, at);
+}
+
+void SimulatedState::Dispatch()
+{
+    while (!wakeups.empty() && wakeups.top().at <= now)
+    {
+        const Socket sock = wakeups.top().sock;
+        wakeups.pop();
+
+        auto iter = sockets.find(sock);
+        if (iter != sockets.end() && iter->second.service)
+        {
+            iter->second.service->Wake(sock);
+        }
+    }
+}
+
+void SimulatedState::Update(SimulatedSocket& s)
+{
+    if (s.state == SimulatedSocket::State::Connecting && s.established <= now)
+    {
+        s.state = s.connectError == E_SUCCESS
+            ? SimulatedSocket::State::Connected
+            : SimulatedSocket::State::Idle;
+    }
+}
+
+bool SimulatedState::Chance(double probability)
+{
+    return probability > 0 && Random::Double(random) < probability;
+}
+
+Clock::duration SimulatedState::Jitter()
+{
+    if (params.jitter <= Clock::duration::zero())
+    {
+        return Clock::duration::zero();
+    }
+    return Clock::duration(Clock::duration::rep(
+        Random::Double(random) * double(params.jitter.count())));
+}
+
+Clock::time_point SimulatedState::Depart(SimulatedSocket& from, size_t size)
+{
+    // A link carries one segment at a time, the next waits for the wire.
+    Clock::duration transmission = Clock::duration::zero();
+    if (params.bandwidth > 0)
+    {
+        using namespace std::chrono;
+
+        transmission = duration_cast<Clock::duration>(
+            duration<double>(double(size) / double(params.bandwidth)));
+    }
+
+    from.linkFree = std::max(now, from.linkFree) + transmission;
+    return from.linkFree;
+}
+
+static std::string BindingKey(SocketType type, const SocketAddress& address)
+{
+    std::string key;
+    key.push_back(char(type));
+    key.push_back(char(address.Family()));
+
+    switch (address.Family())
+    {
+    case AddressFamily::Inet4:
+    {
+        const auto& inet = address.Inet();
+        key.append(reinterpret_cast<const char*>(&inet.port), sizeof(inet.port));
+        key.append(
+            reinterpret_cast<const char*>(inet.address.Data()),
+            InetAddress::SIZE);
+        break;
+    }
+    case AddressFamily::Inet6:
+    {
+        const auto& inet6 = address.Inet6();
+        key.append(reinterpret_cast<const char*>(&inet6.port), sizeof(inet6.port));
+        key.append(
+            reinterpret_cast<const char*>(inet6.address.Data()),
+            Inet6Address::SIZE);
+        break;
+    }
+    case AddressFamily::Unix:
+        key.append(address.Unix().path);
+        break;
+    default:
+        break;
+    }
+    return key;
+}
+
+static uint16_t GetPort(const SocketAddress& address)
+{
+    switch (address.Family())
+    {
+    case AddressFamily::Inet4:
+        return address.Inet().port;
+    case AddressFamily::Inet6:
+        return address.Inet6().port;
+    default:
+        return 0;
+    }
+}
+
+static SocketAddress WithPort(const SocketAddress& address, uint16_t port)
+{
+    SocketAddress result = address;
+
+    switch (address.Family())
+    {
+    case AddressFamily::Inet4:
+        result.Inet().port = port;
+        break;
+    case AddressFamily::Inet6:
+        result.Inet6().port = port;
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+static SocketAddress Wildcard(const SocketAddress& address)
+{
+    if (address.Family() == AddressFamily::Inet6)
+    {
+        return SocketAddress(Inet6Address{}, GetPort(address));
+    }
+    return SocketAddress(InetAddress{}, GetPort(address));
+}
+
+Socket SimulatedState::Lookup(
+    SocketType type,
+    const SocketAddress& address) const
+{
+    if (auto iter = bindings.find(BindingKey(type, address));
+        iter != bindings.end())
+    {
+        return iter->second;
+    }
+    if (address.Family() == AddressFamily::Inet4
+        || address.Family() == AddressFamily::Inet6)
+    {
+        if (auto iter = bindings.find(BindingKey(type, Wildcard(address)));
+            iter != bindings.end())
+        {
+            return iter->second;
+        }
+    }
+    return INVALID_SOCKET;
+}
+
+Result<void> SimulatedState::BindTo(
+    Socket sock,
+    SimulatedSocket& s,
+    SocketAddress address)
+{
+    if (!s.binding.empty())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("socket '{}' is already bound", sock);
+    }
+    if (address.Family() != s.family)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("address family does not match socket '{}'", sock);
+    }
+
+    if (GetPort(address) == 0 && s.family != AddressFamily::Unix)
+    {
+        // Walk the ephemeral range once looking for a free port.
+        for (size_t i = 0; i < 65536 - EPHEMERAL_PORT_FIRST; ++i)
+        {
+            const uint16_t port = nextPort;
+            nextPort = nextPort == 65535 ? EPHEMERAL_PORT_FIRST : nextPort + 1;
+
+            SocketAddress candidate = WithPort(address, port);
+            if (!bindings.contains(BindingKey(s.type, candidate)))
+            {
+                address = candidate;
+                break;
+            }
+        }
+        if (GetPort(address) == 0)
+        {
+            return Failure(E_RESOURCE_NOT_AVAILABLE)
+                .WithContext("out of ephemeral ports");
+        }
+    }
+
+    std::string key = BindingKey(s.type, address);
+    if (bindings.contains(key))
+    {
+        return Failure(E_RESOURCE_NOT_AVAILABLE)
+            .WithContext("address already in use");
+    }
+
+    bindings.emplace(key, sock);
+    s.binding = std::move(key);
+    s.local = address;
+    return Success;
+}
+
+Result<void> SimulatedState::BindEphemeral(
+    Socket sock,
+    SimulatedSocket& s,
+    const SocketAddress& destination)
+{
+    if (!s.binding.empty())
+    {
+        return Success;
+    }
+
+    // Every address is local, the peer's address serves as the source.
+    return BindTo(sock, s, WithPort(destination, 0));
+}
+
+void SimulatedState::Transmit(
+    SimulatedSocket& from,
+    Socket to,
+    const uint8_t* data,
+    size_t size,
+    bool fin)
+{
+    auto iter = sockets.find(to);
+    if (iter == sockets.end())
+    {
+        return;
+    }
+
+    Clock::time_point at = Depart(from, size) + params.latency + Jitter();
+    if (Chance(params.loss))
+    {
+        ++stats.lost;
+        at += params.retransmitTimeout;
+    }
+
+    // Streams are ordered, nothing overtakes a delayed segment.
+    at = std::max(at, from.lastDelivery);
+    from.lastDelivery = at;
+
+    iter->second.inbound.push_back(SimulatedSegment{
+        .at = at,
+        .data = std::vector<uint8_t>(data, data + size),
+        .from = from.local,
+        .fin = fin,
+    });
+
+    ++stats.segments;
+    stats.bytes += size;
+    Schedule(to, at);
+}
+
+void SimulatedState::TransmitDatagram(
+    SimulatedSocket& from,
+    Socket to,
+    const uint8_t* data,
+    size_t size)
+{
+    ++stats.segments;
+    stats.bytes += size;
+
+    if (Chance(params.loss))
+    {
+        ++stats.lost;
+        return;
+    }
+
+    auto iter = sockets.find(to);
+    if (iter == sockets.end())
+    {
+        return;
+    }
+
+    Clock::time_point at = Depart(from, size) + params.latency + Jitter();
+    if (Chance(params.reorder))
+    {
+        at += params.reorderDelay;
+    }
+
+    // Datagrams queue in delivery order, a delayed one is overtaken.
+    auto& inbound = iter->second.inbound;
+    auto pos = std::upper_bound(inbound.begin(), inbound.end(), at,
+        [](Clock::time_point t, const SimulatedSegment& segment) {
+            return t < segment.at;
+        });
+
+    inbound.insert(pos, SimulatedSegment{
+        .at = at,
+        .data = std::vector<uint8_t>(data, data + size),
+        .from = from.local,
+    });
+    Schedule(to, at);
+}
+
+SocketOperation SimulatedState::Readiness(SimulatedSocket& s)
+{
+    using State = SimulatedSocket::State;
+
+    Update(s);
+
+    auto ready = SocketOperation::None;
+    const bool delivered = !s.inbound.empty() && s.inbound.front().at <= now;
+
+    if (s.type == SocketType::Datagram)
+    {
+        ready |= SocketOperation::Write;
+        if (delivered)
+        {
+            ready |= SocketOperation::Read;
+        }
+        return ready;
+    }
+
+    switch (s.state)
+    {
+    case State::Listening:
+        if (!s.backlog.empty() && s.backlog.front().first <= now)
+        {
+            ready |= SocketOperation::Read;
+        }
+        break;
+    case State::Connected:
+    {
+        if (delivered || s.readShutdown)
+        {
+            ready |= SocketOperation::Read;
+        }
+        if (!sockets.contains(s.remote))
+        {
+            ready |= SocketOperation::Write;
+        }
+        else if (!s.writeShutdown && s.unread < params.bufferSize)
+        {
+            ready |= SocketOperation::Write;
+        }
+        break;
+    }
+    case State::Idle:
+        if (s.connectError != E_SUCCESS)
+        {
+            ready |= SocketOperation::Read
+                | SocketOperation::Write
+                | SocketOperation::Error;
+        }
+        break;
+    default:
+        break;
+    }
+    return ready;
+}
+
+void SimulatedState::Release(Socket sock)
+{
+    auto iter = sockets.find(sock);
+    if (iter == sockets.end())
+    {
+        return;
+    }
+
+    SimulatedSocket& s = iter->second;
+    if (s.service)
+    {
+        s.service->Forget(sock, s);
+    }
+
+    Update(s);
+    if ((s.state == SimulatedSocket::State::Connected
+        || s.state == SimulatedSocket::State::Connecting)
+        && !s.writeShutdown)
+    {
+        Transmit(s, s.remote, nullptr, 0, true);
+    }
+
+    if (!s.binding.empty())
+    {
+        bindings.erase(s.binding);
+    }
+
+    std::deque<std::pair<Clock::time_point, Socket>> backlog;
+    backlog.swap(s.backlog);
+    sockets.erase(iter);
+
+    // Connections nobody accepted are reset along with the listener.
+    for (const auto& [at, pending] : backlog)
+    {
+        FUSION_UNUSED(at);
+        Release(pending);
+    }
+}
+}  // namespace Fusion::Internal
+
+namespace Fusion
+{
+using Internal::SimulatedSocket;
+
+static Failure NoSystemSocket(Socket sock)
+{
+    return Failure(E_NOT_SUPPORTED)
+        .WithContext("socket '{}' is simulated, waiting on a Context needs "
+            "a system socket", sock);
+}
+
+static Result<void> ValidateParams(const SimulatedNetwork::Params& params)
+{
+    if (params.latency < Clock::duration::zero()
+        || params.jitter < Clock::duration::zero()
+        || params.reorderDelay < Clock::duration::zero()
+        || params.retransmitTimeout < Clock::duration::zero())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("delays must not be negative");
+    }
+    if (!(params.loss >= 0 && params.loss <= 1)
+        || !(params.reorder >= 0 && params.reorder <= 1))
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid probabilities (loss={},reorder={})",
+                params.loss, params.reorder);
+    }
+    if (params.bufferSize == 0)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("bufferSize must not be zero");
+    }
+    return Success;
+}
+
+Result<std::unique_ptr<SimulatedNetwork>> SimulatedNetwork::Create()
+{
+    return Create(Params{});
+}
+
+Result<std::unique_ptr<SimulatedNetwork>> SimulatedNetwork::Create(
+    Params params)
+{
+    if (auto result = ValidateParams(params); !result)
+    {
+        return result.Error();
+    }
+    return std::make_unique<SimulatedNetwork>(params);
+}
+
+SimulatedNetwork::SimulatedNetwork(Params params)
+    : m_state(std::make_shared<Internal::SimulatedState>(params))
+{ }
+
+SimulatedNetwork::~SimulatedNetwork() = default;
+
+Clock::time_point SimulatedNetwork::Now() const
+{
+    std::lock_guard lock(m_state->mutex);
+    return m_state->now;
+}
+
+void SimulatedNetwork::Advance(Clock::duration duration)
+{
+    std::lock_guard lock(m_state->mutex);
+    m_state->AdvanceTo(m_state->now + std::max(duration, Clock::duration::zero()));
+}
+
+Result<void> SimulatedNetwork::SetParams(Params params)
+{
+    if (auto result = ValidateParams(params); !result)
+    {
+        return result;
+    }
+
+    std::lock_guard lock(m_state->mutex);
+    m_state->params = params;
+    return Success;
+}
+
+SimulatedNetwork::Stats SimulatedNetwork::GetStats() const
+{
+    std::lock_guard lock(m_state->mutex);
+    return m_state->stats;
+}
+
+Result<Network::AcceptedSocketData> SimulatedNetwork::Accept(Socket sock) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->state != SimulatedSocket::State::Listening)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("socket '{}' is not listening", sock);
+    }
+
+    if (s->backlog.empty())
+    {
+        return Failure(E_NET_WOULD_BLOCK);
+    }
+    if (s->backlog.front().first > m_state->now)
+    {
+        if (!s->blocking)
+        {
+            return Failure(E_NET_WOULD_BLOCK);
+        }
+        m_state->AdvanceTo(s->backlog.front().first);
+    }
+
+    const Socket accepted = s->backlog.front().second;
+    s->backlog.pop_front();
+
+    return AcceptedSocketData{
+        .sock = accepted,
+        .address = m_state->sockets.at(accepted).peer,
+    };
+}
+
+Result<void> SimulatedNetwork::Bind(
+    Socket sock,
+    const SocketAddress& address) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        return m_state->BindTo(sock, **result, address);
+    }
+}
+
+Result<Socket> SimulatedNetwork::CreateSocket(
+    AddressFamily family,
+    SocketProtocol proto,
+    SocketType type) const
+{
+    FUSION_UNUSED(proto);
+
+    if (family != AddressFamily::Inet4
+        && family != AddressFamily::Inet6
+        && family != AddressFamily::Unix)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("unsupported address family '{}'", family);
+    }
+    if (type != SocketType::Stream && type != SocketType::Datagram)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("unsupported socket type '{}'", type);
+    }
+
+    std::lock_guard lock(m_state->mutex);
+
+    const Socket sock = m_state->nextSocket++;
+    SimulatedSocket& s = m_state->sockets[sock];
+    s.family = family;
+    s.type = type;
+    return sock;
+}
+
+Result<std::array<Socket, 2>> SimulatedNetwork::CreateSocketPair(
+    AddressFamily family,
+    SocketType type) const
+{
+    std::array<Socket, 2> pair{ INVALID_SOCKET, INVALID_SOCKET };
+
+    for (Socket& sock : pair)
+    {
+        if (auto result = CreateSocket(family, SocketProtocol::None, type);
+            !result)
+        {
+            (void)Close(pair[0]);
+            return result.Error();
+        }
+        else
+        {
+            sock = *result;
+        }
+    }
+
+    std::lock_guard lock(m_state->mutex);
+
+    for (size_t i = 0; i < pair.size(); ++i)
+    {
+        SimulatedSocket& s = m_state->sockets.at(pair[i]);
+        s.state = SimulatedSocket::State::Connected;
+        s.remote = pair[1 - i];
+        s.established = m_state->now;
+    }
+    return pair;
+}
+
+std::unique_ptr<SocketService> SimulatedNetwork::CreateSocketService()
+{
+    return std::make_unique<Internal::SimulatedSocketService>(m_state);
+}
+
+Result<void> SimulatedNetwork::Connect(
+    Socket sock,
+    const SocketAddress& address) const
+{
+    using State = SimulatedSocket::State;
+
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (auto result = m_state->BindEphemeral(sock, *s, address); !result)
+    {
+        return result;
+    }
+
+    if (s->type == SocketType::Datagram)
+    {
+        s->peer = address;
+        return Success;
+    }
+
+    m_state->Update(*s);
+
+    if (s->state == State::Connecting)
+    {
+        if (!s->blocking || s->established == Internal::NEVER)
+        {
+            return s->blocking
+                ? Failure(E_NET_TIMEOUT)
+                : Failure(E_NET_INPROGRESS);
+        }
+        m_state->AdvanceTo(s->established);
+        m_state->Update(*s);
+    }
+    if (s->state == State::Connected)
+    {
+        // Connecting again reports the completed handshake, as connect()
+        // does.
+        return Failure(E_NET_CONNECTED);
+    }
+    if (s->connectError != E_SUCCESS)
+    {
+        Failure failure(std::exchange(s->connectError, E_SUCCESS));
+        return failure.WithContext("failed to connect to '{}'", address);
+    }
+    if (s->state == State::Listening)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("socket '{}' is listening", sock);
+    }
+
+    const Clock::duration latency = m_state->params.latency;
+    const Socket listener = m_state->Lookup(SocketType::Stream, address);
+
+    s->state = State::Connecting;
+    s->peer = address;
+    ++m_state->stats.connections;
+
+    auto found = m_state->sockets.find(listener);
+    if (found == m_state->sockets.end()
+        || found->second.state != State::Listening)
+    {
+        s->connectError = E_NET_CONN_REFUSED;
+        s->established = m_state->now + 2 * latency + m_state->Jitter();
+    }
+    else if (found->second.backlog.size() >= found->second.backlogSize)
+    {
+        // A full accept queue drops the handshake, the attempt hangs.
+        s->established = Internal::NEVER;
+    }
+    else
+    {
+        const Socket server = m_state->nextSocket++;
+        SimulatedSocket& accepted = m_state->sockets[server];
+        SimulatedSocket& l = m_state->sockets.at(listener);
+
+        accepted.family = l.family;
+        accepted.type = SocketType::Stream;
+        accepted.state = State::Connected;
+        accepted.local = address;
+        accepted.peer = s->local;
+        accepted.remote = sock;
+        accepted.established = m_state->now + latency;
+
+        const Clock::time_point arrival = m_state->now + latency + m_state->Jitter();
+        l.backlog.emplace_back(arrival, server);
+        m_state->Schedule(listener, arrival);
+
+        s->remote = server;
+        s->established = arrival + latency + m_state->Jitter();
+    }
+    m_state->Schedule(sock, s->established);
+
+    if (!s->blocking)
+    {
+        return Failure(E_NET_INPROGRESS);
+    }
+    if (s->established == Internal::NEVER)
+    {
+        return Failure(E_NET_TIMEOUT)
+            .WithContext("no answer from '{}'", address);
+    }
+
+    m_state->AdvanceTo(s->established);
+    m_state->Update(*s);
+
+    if (s->connectError != E_SUCCESS)
+    {
+        Failure failure(std::exchange(s->connectError, E_SUCCESS));
+        return failure.WithContext("failed to connect to '{}'", address);
+    }
+    return Success;
+}
+
+Result<void> SimulatedNetwork::Connect(
+    Socket sock,
+    const SocketAddress& address,
+    const Context& ctx) const
+{
+    FUSION_UNUSED(address);
+    FUSION_UNUSED(ctx);
+
+    return NoSystemSocket(sock);
+}
+
+Result<void> SimulatedNetwork::Close(Socket sock) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+
+    m_state->Release(sock);
+    return Success;
+}
+
+Result<SocketAddress> SimulatedNetwork::GetPeerName(Socket sock) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    m_state->Update(*s);
+    if (s->state != SimulatedSocket::State::Connected
+        && !(s->type == SocketType::Datagram && !s->peer.IsEmpty()))
+    {
+        return Failure(E_FAILURE)
+            .WithContext("socket '{}' is not connected", sock);
+    }
+    return s->peer;
+}
+
+Result<SocketAddress> SimulatedNetwork::GetSockName(Socket sock) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        return (*result)->local;
+    }
+}
+
+Result<void> SimulatedNetwork::GetSocketOption(
+    Socket sock,
+    SocketOpt option,
+    void* data,
+    size_t size) const
+{
+    FUSION_UNUSED(option);
+
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+
+    std::memset(data, 0, size);
+    return Success;
+}
+
+Result<void> SimulatedNetwork::Listen(
+    Socket sock,
+    uint32_t backlog) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->type != SocketType::Stream || s->binding.empty())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("socket '{}' is not a bound stream socket", sock);
+    }
+
+    // Like Linux, a backlog of N holds N + 1 connections.
+    s->state = SimulatedSocket::State::Listening;
+    s->backlogSize = backlog + 1;
+    return Success;
+}
+
+Result<size_t> SimulatedNetwork::Recv(
+    Socket sock,
+    void* buffer,
+    size_t length,
+    MessageOption flags) const
+{
+    FUSION_ASSERT(buffer || length == 0);
+
+    SimulatedSocket* s = nullptr;
+    std::unique_lock lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->type == SocketType::Datagram)
+    {
+        lock.unlock();
+
+        auto result = RecvFrom(sock, buffer, length, flags);
+        if (!result)
+        {
+            return result.Error();
+        }
+        return result->received;
+    }
+
+    m_state->Update(*s);
+    if (s->state != SimulatedSocket::State::Connected)
+    {
+        return Failure(E_FAILURE)
+            .WithContext("socket '{}' is not connected", sock);
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (s->readShutdown)
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+
+    if (s->inbound.empty())
+    {
+        return Failure(E_NET_WOULD_BLOCK);
+    }
+    if (s->inbound.front().at > m_state->now)
+    {
+        if (!s->blocking)
+        {
+            return Failure(E_NET_WOULD_BLOCK);
+        }
+        m_state->AdvanceTo(s->inbound.front().at);
+    }
+
+    const bool peek = +(flags & MessageOption::Peek);
+    auto* out = static_cast<uint8_t*>(buffer);
+    size_t received = 0;
+    size_t offset = s->offset;
+
+    for (auto iter = s->inbound.begin();
+        iter != s->inbound.end()
+            && iter->at <= m_state->now
+            && received < length;)
+    {
+        if (iter->fin)
+        {
+            if (received == 0)
+            {
+                return Failure(E_NET_DISCONNECTED);
+            }
+            break;
+        }
+
+        const size_t count = std::min(length - received, iter->data.size() - offset);
+        std::memcpy(out + received, iter->data.data() + offset, count);
+        received += count;
+        offset += count;
+
+        if (offset < iter->data.size())
+        {
+            break;
+        }
+
+        offset = 0;
+        if (peek)
+        {
+            ++iter;
+        }
+        else
+        {
+            iter = s->inbound.erase(iter);
+        }
+    }
+
+    if (!peek)
+    {
+        s->offset = offset;
+
+        // The window opens again at the sender.
+        auto remote = m_state->sockets.find(s->remote);
+        if (remote != m_state->sockets.end())
+        {
+            remote->second.unread -= std::min(remote->second.unread, received);
+            m_state->Schedule(s->remote, m_state->now);
+        }
+    }
+    return received;
+}
+
+Result<size_t> SimulatedNetwork::Recv(
+    Socket sock,
+    void* buffer,
+    size_t length,
+    const Context& ctx) const
+{
+    FUSION_UNUSED(buffer);
+    FUSION_UNUSED(length);
+    FUSION_UNUSED(ctx);
+
+    return NoSystemSocket(sock);
+}
+
+Result<Network::RecvFromData> SimulatedNetwork::RecvFrom(
+    Socket sock,
+    void* buffer,
+    size_t length,
+    MessageOption flags) const
+{
+    FUSION_ASSERT(buffer || length == 0);
+
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->type != SocketType::Datagram)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("RecvFrom() on stream socket '{}'", sock);
+    }
+
+    if (s->inbound.empty())
+    {
+        return Failure(E_NET_WOULD_BLOCK);
+    }
+    if (s->inbound.front().at > m_state->now)
+    {
+        if (!s->blocking)
+        {
+            return Failure(E_NET_WOULD_BLOCK);
+        }
+        m_state->AdvanceTo(s->inbound.front().at);
+    }
+
+    const Internal::SimulatedSegment& datagram = s->inbound.front();
+    const size_t count = std::min(length, datagram.data.size());
+    std::memcpy(buffer, datagram.data.data(), count);
+
+    RecvFromData data{
+        .received = count,
+        .address = datagram.from,
+        .buffer = buffer,
+        .size = length,
+    };
+
+    if (!(flags & MessageOption::Peek))
+    {
+        s->inbound.pop_front();
+    }
+    return data;
+}
+
+Result<size_t> SimulatedNetwork::Send(
+    Socket sock,
+    const void* buffer,
+    size_t length,
+    MessageOption flags) const
+{
+    FUSION_ASSERT(buffer || length == 0);
+
+    SimulatedSocket* s = nullptr;
+    std::unique_lock lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->type == SocketType::Datagram)
+    {
+        if (s->peer.IsEmpty())
+        {
+            return Failure(E_FAILURE)
+                .WithContext("socket '{}' is not connected", sock);
+        }
+
+        const SocketAddress peer = s->peer;
+        lock.unlock();
+
+        return SendTo(sock, peer, buffer, length, flags);
+    }
+
+    m_state->Update(*s);
+    if (s->state != SimulatedSocket::State::Connected)
+    {
+        return Failure(E_FAILURE)
+            .WithContext("socket '{}' is not connected", sock);
+    }
+    if (s->writeShutdown)
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+    if (!m_state->sockets.contains(s->remote))
+    {
+        return Failure(E_NET_CONN_RESET);
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    const size_t space = m_state->params.bufferSize - std::min(
+        m_state->params.bufferSize,
+        s->unread);
+
+    if (space == 0)
+    {
+        return Failure(E_NET_WOULD_BLOCK);
+    }
+
+    const size_t count = std::min(space, length);
+    s->unread += count;
+
+    m_state->Transmit(
+        *s,
+        s->remote,
+        static_cast<const uint8_t*>(buffer),
+        count,
+        false);
+    return count;
+}
+
+Result<size_t> SimulatedNetwork::Send(
+    Socket sock,
+    const void* buffer,
+    size_t length,
+    const Context& ctx) const
+{
+    FUSION_UNUSED(buffer);
+    FUSION_UNUSED(length);
+    FUSION_UNUSED(ctx);
+
+    return NoSystemSocket(sock);
+}
+
+Result<size_t> SimulatedNetwork::SendTo(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t length,
+    MessageOption flags) const
+{
+    FUSION_ASSERT(buffer || length == 0);
+
+    std::unique_lock lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    if (s->type != SocketType::Datagram)
+    {
+        lock.unlock();
+        return Send(sock, buffer, length, flags);
+    }
+
+    if (auto result = m_state->BindEphemeral(sock, *s, address); !result)
+    {
+        return result.Error();
+    }
+
+    // Datagrams to an address nobody bound vanish, as they would on a
+    // real network.
+    const Socket to = m_state->Lookup(SocketType::Datagram, address);
+    m_state->TransmitDatagram(
+        *s,
+        to,
+        static_cast<const uint8_t*>(buffer),
+        length);
+    return length;
+}
+
+Result<void> SimulatedNetwork::SetBlocking(
+    Socket sock,
+    bool blocking) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        (*result)->blocking = blocking;
+    }
+    return Success;
+}
+
+Result<void> SimulatedNetwork::SetSocketOption(
+    Socket sock,
+    SocketOpt option,
+    const void* data,
+    size_t size) const
+{
+    FUSION_UNUSED(option);
+    FUSION_UNUSED(data);
+    FUSION_UNUSED(size);
+
+    std::lock_guard lock(m_state->mutex);
+
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    return Success;
+}
+
+Result<void> SimulatedNetwork::Shutdown(
+    Socket sock,
+    SocketShutdownMode mode) const
+{
+    std::lock_guard lock(m_state->mutex);
+
+    SimulatedSocket* s = nullptr;
+    if (auto result = m_state->Find(sock); !result)
+    {
+        return result.Error();
+    }
+    else
+    {
+        s = *result;
+    }
+
+    m_state->Update(*s);
+    if (s->state != SimulatedSocket::State::Connected)
+    {
+        return Failure(E_FAILURE)
+            .WithContext("socket '{}' is not connected", sock);
+    }
+
+    if (mode == SocketShutdownMode::Read || mode == SocketShutdownMode::Both)
+    {
+        s->readShutdown = true;
+        m_state->Schedule(sock, m_state->now);
+    }
+    if ((mode == SocketShutdownMode::Write || mode == SocketShutdownMode::Both)
+        && !s->writeShutdown)
+    {
+        m_state->Transmit(*s, s->remote, nullptr, 0, true);
+        s->writeShutdown = true;
+    }
+    return Success;
+}
+
+Result<void> SimulatedNetwork::Start()
+{
+    return Success;
+}
+
+void SimulatedNetwork::Stop()
+{
+    Stop(nullptr);
+}
+
+void SimulatedNetwork::Stop(std::function<void(Failure&)> fn)
+{
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        std::vector<Socket> open;
+        for (const auto& [sock, s] : m_state->sockets)
+        {
+            FUSION_UNUSED(s);
+            open.push_back(sock);
+        }
+        for (Socket sock : open)
+        {
+            m_state->Release(sock);
+        }
+    }
+
+    if (fn)
+    {
+        Failure f(E_SUCCESS);
+        fn(f);
+    }
+}
+}  // namespace Fusion
@@ -20,10 +20,18 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
 #include <map>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Fusion
 {
@@ -51,196 +59,1815 @@ void Thread::SetName(std::string_view name)
 // Thread                                                    END
 // -------------------------------------------------------------
 // ThreadPool                                              START
-struct ThreadPool::Task
+namespace
+{
+//
+// Identifies the pool and slot of the worker running on this thread so
+// tasks submitted from inside a task can stay on the worker's own queue.
+//
+struct WorkerSlot
+{
+    const void* scheduler{ nullptr };
+    size_t index{ 0 };
+};
+
+thread_local WorkerSlot tlsWorker;
+
+size_t GetBucket(Clock::duration duration)
+{
+    using namespace std::chrono;
+
+    const auto ns = uint64_t(std::max<int64_t>(
+        duration_cast<nanoseconds>(duration).count(),
+        0));
+
+    return std::min<size_t>(
+        std::bit_width(ns),
+        ThreadPool::Stats::Histogram::BUCKETS - 1);
+}
+
+void Record(ThreadPool::Stats::Histogram& histogram, Clock::duration duration)
+{
+    ++histogram.buckets[GetBucket(duration)];
+    ++histogram.count;
+    histogram.total += duration;
+}
+
+//
+// Only ever written by the worker that owns it, readers take relaxed
+// snapshots, so updates are plain loads and stores rather than RMWs.
+//
+void Increment(std::atomic<uint64_t>& counter, uint64_t value = 1)
+{
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+}
+
+struct AtomicHistogram
+{
+    std::array<std::atomic<uint64_t>, ThreadPool::Stats::Histogram::BUCKETS> buckets{};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> total{ 0 };
+
+    void Add(Clock::duration duration)
+    {
+        Increment(buckets[GetBucket(duration)]);
+        Increment(count);
+        Increment(total, uint64_t(std::max<Clock::rep>(duration.count(), 0)));
+    }
+
+    void CopyTo(ThreadPool::Stats::Histogram& histogram) const
+    {
+        ThreadPool::Stats::Histogram copy;
+
+        for (size_t i = 0; i < buckets.size(); ++i)
+        {
+            copy.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        copy.count = count.load(std::memory_order_relaxed);
+        copy.total = Clock::duration(
+            Clock::rep(total.load(std::memory_order_relaxed)));
+
+        histogram += copy;
+    }
+};
+}  // namespace
+
+struct alignas(64) ThreadPool::Task
 {
+    // First, so that it starts on the slot's own alignment.
+    alignas(std::max_align_t) std::byte storage[TASK_STORAGE];
+
+    Task* next{ nullptr };
     uint64_t id{ UINT64_MAX };
-    TaskFn fn;
-    CompletionHandler completer;
+    TaskFn fn{ nullptr };
+
+    // Separate link for strand queues, which are filled without a lock.
+    std::atomic<Task*> strandNext{ nullptr };
+
+    // Only kept up to date while the pool collects stats.
+    Clock::rep enqueued{ 0 };
+    const char* name{ nullptr };
+
+    // A task cancelled while queued stays linked until a worker comes
+    // across it. Cancel() and that worker both let go of it through
+    // ReleaseCancelled(), the second one returns the slot.
+    std::atomic<uint32_t> released{ 0 };
+};
+
+struct ThreadPool::Thread
+{
+    std::thread thread;
+    std::string_view threadName;
+    size_t index{ 0 };
+
+    // Guarded by the scheduler's pool lock. A slot that is not live may
+    // still hold the thread of a retired worker until it is reused.
+    bool live{ false };
+};
+
+//
+// A set of intrusive FIFO lists, one per priority, behind its own lock.
+// Every worker owns one and the pool keeps one more for submitters outside
+// the pool. The per-priority sizes are readable without the lock so that
+// idle workers can skip empty queues without touching their mutex.
+//
+class alignas(64) ThreadPool::Queue final
+{
+public:
+    static constexpr size_t LEVELS = size_t(Priority::High) + 1;
+
+public:
+    void Push(TaskList& tasks, Priority priority)
+    {
+        const size_t level = std::min(size_t(priority), LEVELS - 1);
+
+        std::lock_guard lock(m_mutex);
+
+        List& list = m_tasks[level];
+
+        if (list.tail)
+        {
+            list.tail->next = tasks.head;
+        }
+        else
+        {
+            list.head = tasks.head;
+        }
+        list.tail = tasks.tail;
+
+        m_sizes[level].fetch_add(tasks.count, std::memory_order_relaxed);
+    }
+
+    Task* Pop(size_t level)
+    {
+        if (m_sizes[level].load(std::memory_order_relaxed) == 0)
+        {
+            return nullptr;
+        }
+
+        std::lock_guard lock(m_mutex);
+
+        List& list = m_tasks[level];
+        Task* task = list.head;
+
+        if (task)
+        {
+            Unlink(level, nullptr, task);
+        }
+        return task;
+    }
+
+    //
+    // Unlink the first task of 'level' whose id has none of the 'keep'
+    // bits set.
+    //
+    Task* Evict(size_t level, uint64_t keep)
+    {
+        if (m_sizes[level].load(std::memory_order_relaxed) == 0)
+        {
+            return nullptr;
+        }
+
+        std::lock_guard lock(m_mutex);
+
+        Task* prev = nullptr;
+
+        for (Task* task = m_tasks[level].head; task; task = task->next)
+        {
+            if ((task->id & keep) == 0)
+            {
+                Unlink(level, prev, task);
+                return task;
+            }
+            prev = task;
+        }
+        return nullptr;
+    }
+
+    void Drain(std::vector<Task*>& out)
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (size_t level = 0; level < LEVELS; ++level)
+        {
+            for (Task* task = m_tasks[level].head; task;)
+            {
+                out.push_back(std::exchange(task, task->next));
+            }
+
+            m_tasks[level] = List{};
+            m_sizes[level].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t Size(size_t level) const
+    {
+        return m_sizes[level].load(std::memory_order_relaxed);
+    }
+
+    bool Empty() const
+    {
+        for (const auto& size : m_sizes)
+        {
+            if (size.load() != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct List
+    {
+        Task* head{ nullptr };
+        Task* tail{ nullptr };
+    };
+
+    void Unlink(size_t level, Task* prev, Task* task)
+    {
+        List& list = m_tasks[level];
+
+        (prev ? prev->next : list.head) = task->next;
+
+        if (list.tail == task)
+        {
+            list.tail = prev;
+        }
+
+        task->next = nullptr;
+        m_sizes[level].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex m_mutex;
+    std::array<List, LEVELS> m_tasks;
+    std::array<std::atomic<size_t>, LEVELS> m_sizes{};
+};
+
+struct ThreadPool::Scheduler
+{
+    // Task slots are carved out of blocks that live as long as the pool.
+    // Workers keep a private cache of free slots and hand half of it back
+    // to the shared list once it grows past SLOT_CACHE.
+    static constexpr size_t SLOT_BLOCK = 64;
+    static constexpr size_t SLOT_CACHE = 256;
+
+    struct alignas(64) SlotCache
+    {
+        Task* head{ nullptr };
+        size_t count{ 0 };
+    };
+
+    static_assert(Stats::PRIORITIES == Queue::LEVELS);
+
+    // Histograms of one worker slot, allocated when the pool collects
+    // stats. Named tasks are rare enough to go through a lock which only
+    // GetStats() contends on.
+    struct Timings
+    {
+        struct Named
+        {
+            Stats::Histogram wait;
+            Stats::Histogram run;
+        };
+
+        std::array<AtomicHistogram, Queue::LEVELS> wait;
+        std::array<AtomicHistogram, Queue::LEVELS> run;
+
+        std::mutex mutex;
+        std::unordered_map<const char*, Named> named;
+
+        void Add(
+            size_t level,
+            const char* name,
+            Clock::duration waited,
+            Clock::duration ran)
+        {
+            wait[level].Add(waited);
+            run[level].Add(ran);
+
+            if (name)
+            {
+                std::lock_guard lock(mutex);
+
+                Named& entry = named[name];
+                Record(entry.wait, waited);
+                Record(entry.run, ran);
+            }
+        }
+    };
+
+    // Counters per worker slot, only written by the worker itself.
+    struct alignas(64) Activity
+    {
+        std::atomic<uint64_t> completed{ 0 };
+        std::atomic<uint64_t> steals{ 0 };
+        std::atomic<uint64_t> idle{ 0 };
+        std::unique_ptr<Timings> timings;
+
+        // Position in 'rotation', not shared with anybody.
+        size_t turn{ 0 };
+    };
+
+    // The order in which a worker prefers the priority levels, every
+    // level appearing as often as its weight and spread out evenly.
+    std::vector<uint8_t> rotation;
+
+    void BuildRotation(const std::array<uint8_t, Queue::LEVELS>& weights)
+    {
+        size_t total = 0;
+        for (uint8_t weight : weights)
+        {
+            total += weight;
+        }
+
+        // Smooth weighted round-robin: each step credits every level with
+        // its weight and picks the one with the most credit, which then
+        // pays back the total.
+        std::array<int64_t, Queue::LEVELS> credit{};
+        rotation.reserve(total);
+
+        for (size_t step = 0; step < total; ++step)
+        {
+            size_t pick = 0;
+
+            for (size_t level = 0; level < Queue::LEVELS; ++level)
+            {
+                credit[level] += weights[level];
+
+                if (credit[level] > credit[pick]
+                    || (credit[level] == credit[pick] && level > pick))
+                {
+                    pick = level;
+                }
+            }
+
+            credit[pick] -= int64_t(total);
+            rotation.push_back(uint8_t(pick));
+        }
+    }
+
+    // Set in the ids of tasks that DropOldest() has to leave alone. Ids
+    // never count up this far, and the bit survives the 'first + i' of a
+    // batch.
+    static constexpr uint64_t KEEP_TASK = uint64_t(1) << 63;
+
+    std::atomic<uint64_t> nextTaskId{ 1 };
+    std::atomic<bool> running{ true };
+
+    // Queued tasks by id, so that Cancel() does not have to search the
+    // queues. Whoever takes a task's entry out decides what becomes of
+    // it: the worker that dequeued it runs it, Cancel() cancels it.
+    static constexpr size_t INDEX_SHARDS = 64;
+
+    struct alignas(64) IndexShard
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Task*> tasks;
+    };
+
+    std::array<IndexShard, INDEX_SHARDS> index;
+
+    void Track(Task* task)
+    {
+        IndexShard& shard = index[task->id % INDEX_SHARDS];
+
+        std::lock_guard lock(shard.mutex);
+        const bool added = shard.tasks.emplace(task->id, task).second;
+
+        FUSION_ASSERT(added);
+        FUSION_UNUSED(added);
+    }
+
+    Task* Untrack(uint64_t id)
+    {
+        IndexShard& shard = index[id % INDEX_SHARDS];
+
+        std::lock_guard lock(shard.mutex);
+        auto node = shard.tasks.extract(id);
+
+        return node ? node.mapped() : nullptr;
+    }
+
+    Queue injection;
+    std::vector<std::unique_ptr<Queue>> workers;
+
+    // Workers with nothing to run or steal sleep here. 'sleepers' lets
+    // submitters skip the notify while every worker is busy.
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<uint32_t> sleepers{ 0 };
+
+    // Workers come and go between 'minThreads' and one per slot. Queues,
+    // caches and counters exist for every slot up front so that nobody
+    // scanning them races with a worker being added, and only the slots
+    // below 'slotLimit' can be live.
+    std::mutex poolMutex;
+    std::condition_variable poolCond;
+    std::thread supervisor;
+    size_t minThreads{ 0 };
+    bool supervised{ false };
+    std::atomic<size_t> liveThreads{ 0 };
+    std::atomic<size_t> slotLimit{ 0 };
+    std::atomic<uint32_t> blocked{ 0 };
+    std::unique_ptr<Activity[]> activity;
+
+    // Admission control, only maintained when the queues are bounded.
+    // 'queued' counts tasks sitting in any queue, submitters blocked on a
+    // full pool wait on 'spaceCond'.
+    size_t capacity{ 0 };
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<uint32_t> waitingSubmitters{ 0 };
+    std::mutex spaceMutex;
+    std::condition_variable spaceCond;
+
+    void Dequeued(size_t count)
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+
+        queued.fetch_sub(count);
+
+        // Pairs with the increment in Admit(), either the submitter sees
+        // the room or we see it waiting.
+        if (waitingSubmitters.load() > 0)
+        {
+            {
+                std::lock_guard lock(spaceMutex);
+            }
+            spaceCond.notify_all();
+        }
+    }
+
+    std::mutex slotMutex;
+    Task* freeSlots{ nullptr };
+    std::vector<std::unique_ptr<Task[]>> slotBlocks;
+    std::vector<SlotCache> slotCaches;
+
+    // Delayed tasks ordered by deadline. Periodic timers keep their index
+    // entry while they run so that Cancel() can stop the next run.
+    static constexpr Clock::rep NO_TIMER = std::numeric_limits<Clock::rep>::max();
+
+    struct Timer
+    {
+        Task* task{ nullptr };
+        Priority priority{ Priority::Default };
+    };
+
+    using TimerMap = std::multimap<Clock::time_point, Timer>;
+
+    struct TimerState
+    {
+        TimerMap::iterator iter;
+        bool periodic{ false };
+        bool armed{ true };
+        bool cancelled{ false };
+    };
+
+    std::mutex timerMutex;
+    TimerMap timers;
+    std::unordered_map<uint64_t, TimerState> timerIndex;
+
+    // Earliest deadline in Clock ticks, checked without the lock before
+    // every dequeue. 'timerEpoch' moves whenever it gets earlier so that
+    // the worker sleeping on the old deadline wakes to recompute it.
+    std::atomic<Clock::rep> nextTimer{ NO_TIMER };
+    std::atomic<uint64_t> timerEpoch{ 0 };
+
+    // One sleeping worker waits for the next deadline, guarded by 'mutex'.
+    bool timerWatcher{ false };
+
+    void UpdateNextTimerLocked()
+    {
+        nextTimer.store(timers.empty()
+            ? NO_TIMER
+            : timers.begin()->first.time_since_epoch().count());
+    }
+
+    bool Empty() const
+    {
+        if (!injection.Empty())
+        {
+            return false;
+        }
+
+        const size_t limit = slotLimit.load();
+        for (size_t i = 0; i < limit; ++i)
+        {
+            if (!workers[i]->Empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t Completed() const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            total += activity[i].completed.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Wake(size_t count)
+    {
+        // Pairs with the sleepers increment in DequeueTask(), the lock
+        // round-trip closes the window between its check and its wait.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        const uint32_t sleeping = sleepers.load();
+        if (sleeping == 0)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+        }
+
+        if (count >= sleeping)
+        {
+            cond.notify_all();
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            cond.notify_one();
+        }
+    }
+
+    void Drain(std::vector<Task*>& out)
+    {
+        injection.Drain(out);
+
+        for (auto& queue : workers)
+        {
+            queue->Drain(out);
+        }
+    }
+
+    Task* TakeSlotsLocked(size_t max, size_t& count)
+    {
+        if (!freeSlots)
+        {
+            auto& block = slotBlocks.emplace_back(
+                std::make_unique<Task[]>(SLOT_BLOCK));
+
+            for (size_t i = 0; i < SLOT_BLOCK; ++i)
+            {
+                block[i].next = (i + 1 < SLOT_BLOCK) ? &block[i + 1] : nullptr;
+            }
+            freeSlots = &block[0];
+        }
+
+        Task* head = freeSlots;
+        Task* tail = head;
+
+        for (count = 1; count < max && tail->next; ++count)
+        {
+            tail = tail->next;
+        }
+
+        freeSlots = std::exchange(tail->next, nullptr);
+        return head;
+    }
+};
+
+ThreadPool::ThreadPool(Options options)
+    : m_options(std::move(options))
+    , m_scheduler(std::make_unique<Scheduler>())
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    const size_t ceiling = (m_options.maxThreads)
+        ? m_options.maxThreads
+        : SIZE_MAX;
+    const size_t threadCount = (m_options.threads)
+        ? std::min<size_t>(m_options.threads, ceiling)
+        : std::clamp<size_t>(
+            std::thread::hardware_concurrency(),
+            1,
+            ceiling);
+    const size_t maxThreads = (m_options.maxThreads)
+        ? ceiling
+        : threadCount;
+
+    m_threads.reserve(maxThreads);
+    scheduler.workers.reserve(maxThreads);
+    scheduler.slotCaches.resize(maxThreads);
+    scheduler.activity = std::make_unique<Scheduler::Activity[]>(maxThreads);
+
+    for (size_t i = 0; i < maxThreads; ++i)
+    {
+        scheduler.workers.push_back(std::make_unique<Queue>());
+
+        if (m_options.collectStats)
+        {
+            scheduler.activity[i].timings =
+                std::make_unique<Scheduler::Timings>();
+        }
+
+        m_threads.push_back(Thread{
+            .threadName = m_options.threadName,
+            .index = i,
+        });
+    }
+
+    scheduler.BuildRotation(m_options.weights);
+    scheduler.capacity = m_options.queueCapacity;
+    scheduler.minThreads = threadCount;
+    scheduler.supervised = (threadCount < maxThreads)
+        && (m_options.stallTimeout > Clock::duration::zero());
+
+    {
+        std::lock_guard lock(scheduler.poolMutex);
+
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            StartThreadLocked(m_threads[i]);
+        }
+    }
+
+    if (scheduler.supervised)
+    {
+        scheduler.supervisor = std::thread([this]() { Supervise(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    std::vector<Task*> tasks;
+
+    // Shutdown the queues
+
+    {
+        std::lock_guard lock(m_scheduler->mutex);
+        m_scheduler->running = false;
+    }
+
+    m_scheduler->cond.notify_all();
+
+    // Nothing starts a worker once it sees the pool stopped under this
+    // lock, so the joins below cannot miss one.
+    {
+        std::lock_guard lock(m_scheduler->poolMutex);
+    }
+    m_scheduler->poolCond.notify_all();
+
+    {
+        std::lock_guard lock(m_scheduler->spaceMutex);
+    }
+    m_scheduler->spaceCond.notify_all();
+
+    m_scheduler->Drain(tasks);
+    std::erase_if(tasks, [this](Task* task) { return !ClaimTask(task); });
+
+    {
+        std::lock_guard lock(m_scheduler->timerMutex);
+
+        for (auto& [deadline, timer] : m_scheduler->timers)
+        {
+            tasks.push_back(timer.task);
+        }
+
+        m_scheduler->timers.clear();
+        m_scheduler->timerIndex.clear();
+        m_scheduler->UpdateNextTimerLocked();
+    }
+
+    Failure reason(E_CANCELLED);
+
+    for (Task* task : tasks)
+    {
+        CompleteTask(task, &reason);
+    }
+
+    // Join the active threads, and the retired ones not reused yet
+
+    if (m_scheduler->supervisor.joinable())
+    {
+        m_scheduler->supervisor.join();
+    }
+
+    for (Thread& thread : m_threads)
+    {
+        if (thread.thread.joinable())
+        {
+            thread.thread.join();
+        }
+    }
+
+    // Fail any tasks that might have come in while we were executing above.
+
+    tasks.clear();
+    m_scheduler->Drain(tasks);
+    std::erase_if(tasks, [this](Task* task) { return !ClaimTask(task); });
+
+    for (Task* task : tasks)
+    {
+        CompleteTask(task, &reason);
+    }
+}
+
+void ThreadPool::Cancel(uint64_t id)
+{
+    Scheduler& scheduler = *m_scheduler;
+    Failure reason(E_CANCELLED);
+
+    {
+        std::unique_lock lock(scheduler.timerMutex);
+
+        if (auto iter = scheduler.timerIndex.find(id);
+            iter != scheduler.timerIndex.end())
+        {
+            Scheduler::TimerState& state = iter->second;
+
+            if (state.armed)
+            {
+                Task* task = state.iter->second.task;
+
+                scheduler.timers.erase(state.iter);
+                scheduler.timerIndex.erase(iter);
+                scheduler.UpdateNextTimerLocked();
+
+                lock.unlock();
+                CompleteTask(task, &reason);
+                return;
+            }
+
+            // A periodic timer between runs, stop the next re-arm. If the
+            // run is still queued it is cancelled below directly.
+            state.cancelled = true;
+        }
+    }
+
+    // No entry means a worker dequeued it already, or it never was queued.
+    // The task stays linked in its queue, the worker that comes across it
+    // only lets go of the slot.
+    if (Task* task = scheduler.Untrack(id))
+    {
+        scheduler.Dequeued(1);
+
+        task->fn(task->storage, &reason);
+        ReleaseCancelled(task);
+    }
+}
+
+bool ThreadPool::IsRunningInThisThread() const
+{
+    return Callstack<ThreadPool, ThreadPool*>::Contains(this);
+}
+
+ThreadPool::Task* ThreadPool::AllocateTask()
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    if (tlsWorker.scheduler == &scheduler)
+    {
+        Scheduler::SlotCache& cache = scheduler.slotCaches[tlsWorker.index];
+
+        if (!cache.head)
+        {
+            std::lock_guard lock(scheduler.slotMutex);
+            cache.head = scheduler.TakeSlotsLocked(
+                Scheduler::SLOT_BLOCK,
+                cache.count);
+        }
+
+        Task* task = std::exchange(cache.head, cache.head->next);
+        --cache.count;
+
+        task->next = nullptr;
+        return task;
+    }
+
+    std::lock_guard lock(scheduler.slotMutex);
+
+    size_t count = 0;
+    return scheduler.TakeSlotsLocked(1, count);
+}
+
+void* ThreadPool::InitTask(Task* task, TaskFn fn)
+{
+    static_assert(sizeof(Task) == 128, "task slots span two cache lines");
+
+    task->fn = fn;
+    return task->storage;
+}
+
+void ThreadPool::SetTaskName(Task* task, const char* name)
+{
+    task->name = name;
+}
+
+void ThreadPool::ReleaseTask(Task* task)
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    task->id = UINT64_MAX;
+    task->fn = nullptr;
+    task->name = nullptr;
+
+    if (tlsWorker.scheduler == &scheduler)
+    {
+        Scheduler::SlotCache& cache = scheduler.slotCaches[tlsWorker.index];
+
+        task->next = std::exchange(cache.head, task);
+
+        if (++cache.count <= Scheduler::SLOT_CACHE)
+        {
+            return;
+        }
+
+        // Slots freed here were mostly allocated by submitters outside the
+        // pool, give half of them back so the shared list does not run dry.
+        Task* tail = cache.head;
+        for (size_t i = 1; i < Scheduler::SLOT_CACHE / 2; ++i)
+        {
+            tail = tail->next;
+        }
+
+        Task* head = std::exchange(cache.head, tail->next);
+        cache.count -= Scheduler::SLOT_CACHE / 2;
+
+        std::lock_guard lock(scheduler.slotMutex);
+        tail->next = scheduler.freeSlots;
+        scheduler.freeSlots = head;
+        return;
+    }
+
+    std::lock_guard lock(scheduler.slotMutex);
+    task->next = std::exchange(scheduler.freeSlots, task);
+}
+
+void ThreadPool::CompleteTask(Task* task, Failure* error)
+{
+    task->fn(task->storage, error);
+    ReleaseTask(task);
+}
+
+bool ThreadPool::ClaimTask(Task* task)
+{
+    if (m_scheduler->Untrack(task->id))
+    {
+        return true;
+    }
+
+    ReleaseCancelled(task);
+    return false;
+}
+
+void ThreadPool::ReleaseCancelled(Task* task)
+{
+    if (task->released.fetch_add(1, std::memory_order_acq_rel) == 1)
+    {
+        task->released.store(0, std::memory_order_relaxed);
+        ReleaseTask(task);
+    }
+}
+
+ThreadPool::Task* ThreadPool::DequeueTask(size_t worker, size_t& level)
+{
+    Scheduler& scheduler = *m_scheduler;
+    Scheduler::Activity& activity = scheduler.activity[worker];
+
+    while (scheduler.running.load(std::memory_order_relaxed))
+    {
+        const size_t count = scheduler.slotLimit.load(
+            std::memory_order_relaxed);
+
+        const Clock::rep next = scheduler.nextTimer.load(
+            std::memory_order_relaxed);
+
+        if (next != Scheduler::NO_TIMER
+            && Clock::now().time_since_epoch().count() >= next)
+        {
+            FireTimers();
+        }
+
+        // Priority wins over locality: a task of the chosen level anywhere
+        // in the pool runs before another level on this worker's own queue.
+        const auto find = [&](size_t from) -> Task* {
+            if (Task* task = scheduler.workers[worker]->Pop(from))
+            {
+                return task;
+            }
+            if (Task* task = scheduler.injection.Pop(from))
+            {
+                return task;
+            }
+            for (size_t i = 1; i < count; ++i)
+            {
+                Queue& victim = *scheduler.workers[(worker + i) % count];
+
+                if (Task* task = victim.Pop(from))
+                {
+                    Increment(activity.steals);
+                    return task;
+                }
+            }
+            return nullptr;
+        };
+
+        // Tasks cancelled while queued are unlinked here, skip past them.
+        const auto take = [&](size_t from) -> Task* {
+            while (Task* task = find(from))
+            {
+                if (ClaimTask(task))
+                {
+                    return task;
+                }
+            }
+            return nullptr;
+        };
+
+        // The level whose turn it is goes first, the rest in priority order.
+        size_t preferred = Queue::LEVELS;
+
+        if (!scheduler.rotation.empty())
+        {
+            preferred = scheduler.rotation[
+                activity.turn++ % scheduler.rotation.size()];
+
+            if (Task* task = take(preferred))
+            {
+                level = preferred;
+                scheduler.Dequeued(1);
+                return task;
+            }
+        }
+
+        for (level = Queue::LEVELS; level-- > 0;)
+        {
+            if (level == preferred)
+            {
+                continue;
+            }
+            if (Task* task = take(level))
+            {
+                scheduler.Dequeued(1);
+                return task;
+            }
+        }
+
+        std::unique_lock lock(scheduler.mutex);
+
+        // Announce the intent to sleep before the final look at the queues,
+        // a submitter either sees us here or we see its task.
+        scheduler.sleepers.fetch_add(1);
+
+        const uint64_t epoch = scheduler.timerEpoch.load();
+        const Clock::rep deadline = scheduler.nextTimer.load();
+        const Clock::time_point asleep = Clock::now();
+
+        if (deadline != Scheduler::NO_TIMER && !scheduler.timerWatcher)
+        {
+            scheduler.timerWatcher = true;
+
+            scheduler.cond.wait_until(
+                lock,
+                Clock::time_point(Clock::duration(deadline)),
+                [&]() {
+                    return !scheduler.running.load()
+                        || !scheduler.Empty()
+                        || scheduler.timerEpoch.load() != epoch;
+                });
+
+            scheduler.timerWatcher = false;
+
+            // Hand the watch to another sleeper if this worker leaves for
+            // other work before the deadline.
+            if (scheduler.sleepers.load() > 1)
+            {
+                scheduler.cond.notify_one();
+            }
+        }
+        else
+        {
+            const auto ready = [&]() {
+                return !scheduler.running.load()
+                    || !scheduler.Empty()
+                    || scheduler.timerEpoch.load() != epoch
+                    || (!scheduler.timerWatcher
+                        && scheduler.nextTimer.load() != Scheduler::NO_TIMER);
+            };
+
+            if (scheduler.liveThreads.load() > scheduler.minThreads)
+            {
+                if (!scheduler.cond.wait_for(lock, m_options.idleTimeout, ready)
+                    && RetireThread(worker))
+                {
+                    return nullptr;
+                }
+            }
+            else
+            {
+                scheduler.cond.wait(lock, ready);
+            }
+        }
+
+        Increment(
+            activity.idle,
+            uint64_t((Clock::now() - asleep).count()));
+
+        if (scheduler.sleepers.fetch_sub(1) == 1 && scheduler.supervised)
+        {
+            // Every worker is busy now, the supervisor starts watching for
+            // queued work that does not get picked up.
+            lock.unlock();
+            {
+                std::lock_guard guard(scheduler.poolMutex);
+            }
+            scheduler.poolCond.notify_all();
+        }
+    }
+
+    return nullptr;
+}
+
+uint64_t ThreadPool::ReserveTaskId()
+{
+    return m_scheduler->nextTaskId.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::ArmTimer(
+    Task* task,
+    uint64_t id,
+    Clock::time_point deadline,
+    Priority priority,
+    bool periodic)
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    std::unique_lock lock(scheduler.timerMutex);
+
+    if (!scheduler.running.load())
+    {
+        lock.unlock();
+
+        Failure reason(E_CANCELLED);
+        CompleteTask(task, &reason);
+        return;
+    }
+
+    // A periodic timer coming back from its run is re-armed in the same
+    // critical section that checks for a Cancel() issued while it ran.
+    if (auto index = scheduler.timerIndex.find(id);
+        periodic
+        && index != scheduler.timerIndex.end()
+        && index->second.cancelled)
+    {
+        scheduler.timerIndex.erase(index);
+        lock.unlock();
+
+        Failure reason(E_CANCELLED);
+        CompleteTask(task, &reason);
+        return;
+    }
+
+    task->id = id;
+
+    auto iter = scheduler.timers.emplace(deadline, Scheduler::Timer{
+        .task = task,
+        .priority = priority,
+    });
+
+    scheduler.timerIndex.insert_or_assign(id, Scheduler::TimerState{
+        .iter = iter,
+        .periodic = periodic,
+    });
+
+    if (iter != scheduler.timers.begin())
+    {
+        return;
+    }
+
+    // New earliest deadline, the watching worker has to recompute its
+    // sleep and the others may have to start watching.
+    scheduler.UpdateNextTimerLocked();
+    scheduler.timerEpoch.fetch_add(1);
+    lock.unlock();
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (scheduler.sleepers.load() > 0)
+    {
+        {
+            std::lock_guard guard(scheduler.mutex);
+        }
+        scheduler.cond.notify_all();
+    }
+}
+
+void ThreadPool::ForgetTimer(uint64_t id)
+{
+    std::lock_guard lock(m_scheduler->timerMutex);
+
+    auto iter = m_scheduler->timerIndex.find(id);
+    if (iter != m_scheduler->timerIndex.end() && !iter->second.armed)
+    {
+        m_scheduler->timerIndex.erase(iter);
+    }
+}
+
+void ThreadPool::FireTimers()
+{
+    Scheduler& scheduler = *m_scheduler;
+    std::array<TaskList, Queue::LEVELS> due;
+
+    {
+        std::lock_guard lock(scheduler.timerMutex);
+
+        const Clock::time_point now = Clock::now();
+
+        while (!scheduler.timers.empty()
+            && scheduler.timers.begin()->first <= now)
+        {
+            auto iter = scheduler.timers.begin();
+            const Scheduler::Timer timer = iter->second;
+
+            auto index = scheduler.timerIndex.find(timer.task->id);
+            FUSION_ASSERT(index != scheduler.timerIndex.end());
+
+            if (index->second.periodic)
+            {
+                index->second.armed = false;
+            }
+            else
+            {
+                scheduler.timerIndex.erase(index);
+            }
+            scheduler.timers.erase(iter);
+
+            const size_t level = std::min(
+                size_t(timer.priority),
+                Queue::LEVELS - 1);
+
+            AppendTask(due[level], timer.task);
+        }
+
+        scheduler.UpdateNextTimerLocked();
+    }
+
+    for (size_t level = Queue::LEVELS; level-- > 0;)
+    {
+        if (due[level].count > 0)
+        {
+            if (scheduler.capacity > 0)
+            {
+                scheduler.queued.fetch_add(due[level].count);
+            }
+            PushTasks(due[level], Priority(level));
+        }
+    }
+}
+
+void ThreadPool::RunThread(
+    ThreadPool* pool,
+    Thread& thread)
+{
+    FUSION_CALLSTACK_ENTRY(ThreadPool, pool);
+
+    tlsWorker = WorkerSlot{
+        .scheduler = pool->m_scheduler.get(),
+        .index = thread.index,
+    };
+
+    if (!thread.threadName.empty())
+    {
+        // ThreadUtil::SetName(thread.threadName);
+    }
+
+    Scheduler::Activity& activity = pool->m_scheduler->activity[thread.index];
+    size_t level = 0;
+
+    while (Task* task = pool->DequeueTask(thread.index, level))
+    {
+        if (!activity.timings)
+        {
+            pool->CompleteTask(task, nullptr);
+        }
+        else
+        {
+            // The slot is recycled by CompleteTask(), read it first.
+            const char* name = task->name;
+            const Clock::time_point enqueued{ Clock::duration(task->enqueued) };
+            const Clock::time_point start = Clock::now();
+
+            pool->CompleteTask(task, nullptr);
+
+            activity.timings->Add(
+                level,
+                name,
+                start - enqueued,
+                Clock::now() - start);
+        }
+
+        Increment(activity.completed);
+    }
+
+    tlsWorker = WorkerSlot{};
+}
+
+bool ThreadPool::AddThreadLocked()
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    if (!scheduler.running.load()
+        || scheduler.liveThreads.load() >= m_threads.size())
+    {
+        return false;
+    }
+
+    for (Thread& thread : m_threads)
+    {
+        if (!thread.live)
+        {
+            StartThreadLocked(thread);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::StartThreadLocked(Thread& thread)
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    // A retired worker gave up its slot for good before it left
+    // DequeueTask(), it is at most unwinding.
+    if (thread.thread.joinable())
+    {
+        thread.thread.join();
+    }
+
+    thread.live = true;
+    scheduler.liveThreads.fetch_add(1);
+
+    if (scheduler.slotLimit.load() <= thread.index)
+    {
+        scheduler.slotLimit.store(thread.index + 1);
+    }
+
+    thread.thread = std::thread([
+            slot = &thread,
+            pool{ this }]()
+        {
+            RunThread(pool, *slot);
+        });
+}
+
+bool ThreadPool::RetireThread(size_t worker)
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    std::lock_guard lock(scheduler.poolMutex);
+
+    if (!scheduler.running.load()
+        || scheduler.liveThreads.load() <= scheduler.minThreads)
+    {
+        return false;
+    }
+
+    // Only the worker itself queues onto its own queue, and it is idle, so
+    // nothing is left behind in it.
+    m_threads[worker].live = false;
+    scheduler.liveThreads.fetch_sub(1);
+
+    size_t limit = scheduler.slotLimit.load();
+    while (limit > 0 && !m_threads[limit - 1].live)
+    {
+        --limit;
+    }
+    scheduler.slotLimit.store(limit);
+
+    if (scheduler.sleepers.fetch_sub(1) == 1 && scheduler.supervised)
+    {
+        scheduler.poolCond.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::Supervise()
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    std::unique_lock lock(scheduler.poolMutex);
+
+    while (scheduler.running.load())
+    {
+        // Work cannot be starved while a worker is idle, there is nothing
+        // to watch until the last one gets busy.
+        scheduler.poolCond.wait(lock, [&]() {
+            return !scheduler.running.load()
+                || scheduler.sleepers.load() == 0;
+        });
+
+        const uint64_t completed = scheduler.Completed();
+
+        if (scheduler.poolCond.wait_for(
+            lock,
+            m_options.stallTimeout,
+            [&]() { return !scheduler.running.load(); }))
+        {
+            break;
+        }
+
+        // Queued work nobody picked up for a whole interval, while either
+        // no task finished or some worker is known to be blocked. Busy
+        // workers that keep finishing tasks would only be slowed down by
+        // more threads competing for the same cores.
+        const bool stalled = (scheduler.Completed() == completed)
+            || (scheduler.blocked.load() > 0);
+
+        if (stalled
+            && scheduler.sleepers.load() == 0
+            && !scheduler.Empty())
+        {
+            AddThreadLocked();
+        }
+    }
+}
+
+uint64_t ThreadPool::EnqueueTask(
+    Task* task,
+    Priority priority,
+    Admission admission)
+{
+    TaskList list;
+    AppendTask(list, task);
+
+    return EnqueueTasks(list, priority, admission);
+}
+
+void ThreadPool::AppendTask(TaskList& list, Task* task)
+{
+    task->next = nullptr;
+
+    if (list.tail)
+    {
+        list.tail->next = task;
+    }
+    else
+    {
+        list.head = task;
+    }
+    list.tail = task;
+    ++list.count;
+}
+
+uint64_t ThreadPool::EnqueueTasks(
+    TaskList& list,
+    Priority priority,
+    Admission admission)
+{
+    Scheduler& scheduler = *m_scheduler;
+
+    if (list.count == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    if (scheduler.capacity > 0)
+    {
+        if (admission == Admission::Internal)
+        {
+            scheduler.queued.fetch_add(list.count);
+        }
+        else if (auto result = Admit(list.count, priority); !result)
+        {
+            Failure reason = result.Error();
+
+            for (Task* task = list.head; task;)
+            {
+                CompleteTask(std::exchange(task, task->next), &reason);
+            }
+            return UINT64_MAX;
+        }
+    }
+
+    // Ids are assigned before the push, a worker may finish a task and
+    // reuse its slot before Push() returns.
+    uint64_t id = scheduler.nextTaskId.fetch_add(
+        list.count,
+        std::memory_order_relaxed);
+
+    if (admission != Admission::Default)
+    {
+        id |= Scheduler::KEEP_TASK;
+    }
+
+    uint64_t next = id;
+    for (Task* task = list.head; task; task = task->next)
+    {
+        task->id = next++;
+    }
+
+    PushTasks(list, priority);
+    return id;
+}
+
+Result<void> ThreadPool::Admit(size_t count, Priority priority)
+{
+    Scheduler& scheduler = *m_scheduler;
+    const size_t capacity = scheduler.capacity;
+
+    size_t queued = scheduler.queued.load();
+
+    while (true)
+    {
+        if (queued + count <= capacity)
+        {
+            if (scheduler.queued.compare_exchange_weak(queued, queued + count))
+            {
+                return Success;
+            }
+            continue;
+        }
+
+        if (m_options.overflow == Overflow::DropOldest && DropOldest(priority))
+        {
+            queued = scheduler.queued.load();
+            continue;
+        }
+
+        if (m_options.overflow != Overflow::Block)
+        {
+            return Failure(E_INSUFFICIENT_RESOURCES)
+                .WithContext("queue capacity of '{}' tasks reached", capacity);
+        }
+
+        // A batch larger than the whole capacity goes in once the queues
+        // are empty, and workers never wait on themselves.
+        if (tlsWorker.scheduler == &scheduler || queued == 0)
+        {
+            scheduler.queued.fetch_add(count);
+            return Success;
+        }
 
-    explicit operator bool() const { return id != UINT64_MAX; }
-};
+        {
+            std::unique_lock lock(scheduler.spaceMutex);
 
-struct ThreadPool::Thread
-{
-    std::thread thread;
-    std::string_view threadName;
-    Queue* queue{ nullptr };
-};
+            scheduler.waitingSubmitters.fetch_add(1);
+            scheduler.spaceCond.wait(lock, [&]() {
+                const size_t current = scheduler.queued.load();
 
-class ThreadPool::Queue final
-{
-public:
-    using TaskMap = std::multimap<Priority, Task, std::greater<>>;
-    using TaskIdMap = std::unordered_map<uint64_t, TaskMap::iterator>;
+                return !scheduler.running.load()
+                    || current + count <= capacity
+                    || current == 0;
+            });
+            scheduler.waitingSubmitters.fetch_sub(1);
+        }
 
-public:
-    uint64_t nextTaskId{ 1 };
-    TaskMap tasks;
-    TaskIdMap idMap;
+        if (!scheduler.running.load())
+        {
+            return Failure(E_CANCELLED);
+        }
 
-    std::condition_variable cond;
-    std::mutex mutex;
-    bool running{ true };
+        queued = scheduler.queued.load();
+    }
+}
 
-public:
-    Task PopFront()
+bool ThreadPool::DropOldest(Priority priority)
+{
+    Scheduler& scheduler = *m_scheduler;
+    const size_t top = std::min(size_t(priority), Queue::LEVELS - 1);
+
+    for (size_t level = 0; level <= top; ++level)
     {
-        FUSION_ASSERT(!tasks.empty());
+        const auto evict = [&](Queue& queue) -> Task* {
+            while (Task* task = queue.Evict(level, Scheduler::KEEP_TASK))
+            {
+                if (ClaimTask(task))
+                {
+                    return task;
+                }
+            }
+            return nullptr;
+        };
+
+        // The injection queue is drained in FIFO order and holds what came
+        // from outside the pool, its head is the best guess at the oldest.
+        Task* task = evict(scheduler.injection);
+
+        for (size_t i = 0; !task && i < scheduler.slotLimit.load(); ++i)
+        {
+            task = evict(*scheduler.workers[i]);
+        }
 
-        auto node = tasks.extract(begin(tasks));
-        idMap.erase(node.mapped().id);
+        if (task)
+        {
+            scheduler.Dequeued(1);
 
-        return std::move(node.mapped());
+            Failure reason = Failure(E_INSUFFICIENT_RESOURCES)
+                .WithContext("dropped to make room for a newer task");
+            CompleteTask(task, &reason);
+            return true;
+        }
     }
-};
+    return false;
+}
 
-ThreadPool::ThreadPool(Options options)
-    : m_options(std::move(options))
-    , m_queue(std::make_unique<Queue>())
+ThreadPool::Load ThreadPool::GetLoad() const
 {
-    size_t threadCount = (m_options.threads)
-        ? std::clamp<size_t>(
-            std::thread::hardware_concurrency(),
-            1,
-            m_options.maxThreads)
-        : m_options.threads;
+    const Scheduler& scheduler = *m_scheduler;
 
-    m_threads.reserve(threadCount);
+    Load load{
+        .capacity = scheduler.capacity,
+        .threads = scheduler.liveThreads.load(),
+    };
 
-    for (size_t i = 0; i < threadCount; ++i)
+    if (scheduler.capacity > 0)
     {
-        Thread* thread = &m_threads.emplace_back(Thread{
-            .threadName = m_options.threadName,
-            .queue = m_queue.get(),
-        });
+        load.queued = scheduler.queued.load();
+    }
+    else
+    {
+        for (size_t level = 0; level < Queue::LEVELS; ++level)
+        {
+            load.queued += scheduler.injection.Size(level);
 
-        thread->thread = std::thread([
-                thread,
-                pool{ this }]()
+            for (size_t i = 0; i < scheduler.slotLimit.load(); ++i)
             {
-                RunThread(pool, *thread);
-            });
+                load.queued += scheduler.workers[i]->Size(level);
+            }
+        }
     }
+
+    const size_t sleeping = scheduler.sleepers.load();
+    load.busy = (load.threads > sleeping) ? load.threads - sleeping : 0;
+    return load;
 }
 
-ThreadPool::~ThreadPool()
+void ThreadPool::PushTasks(
+    TaskList& list,
+    Priority priority)
 {
-    Queue::TaskMap tasks;
+    Scheduler& scheduler = *m_scheduler;
 
-    // Shutdown the queue
+    Queue& queue = (tlsWorker.scheduler == &scheduler)
+        ? *scheduler.workers[tlsWorker.index]
+        : scheduler.injection;
 
+    const size_t count = list.count;
+
+    if (m_options.collectStats)
     {
-        std::lock_guard lock(m_queue->mutex);
+        const Clock::rep now = Clock::now().time_since_epoch().count();
 
-        m_queue->running = false;
-        m_queue->tasks.swap(tasks);
-        m_queue->idMap.clear();
+        for (Task* task = list.head; task; task = task->next)
+        {
+            task->enqueued = now;
+        }
     }
 
-    m_queue->cond.notify_all();
+    for (Task* task = list.head; task; task = task->next)
+    {
+        scheduler.Track(task);
+    }
 
-    Failure reason(E_CANCELLED);
+    queue.Push(list, priority);
+    scheduler.Wake(count);
+}
 
-    for (auto& [priority, task] : tasks)
+void ThreadPool::RunChunks(
+    size_t chunks,
+    ChunkFn fn,
+    void* context)
+{
+    struct Shared
     {
-        task.completer(nullptr, &reason);
-    }
+        size_t chunks;
+        ChunkFn fn;
+        void* context;
 
-    // Join the active threads
+        std::atomic<size_t> next{ 0 };
 
-    for (Thread& thread : m_threads)
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t active{ 0 };
+
+        void Work()
+        {
+            for (size_t chunk = next++; chunk < chunks; chunk = next++)
+            {
+                fn(context, chunk);
+            }
+        }
+    } shared{ .chunks = chunks, .fn = fn, .context = context };
+
+    // The calling thread takes a share of the chunks itself, when it is
+    // one of our workers it also stands in for that worker.
+    size_t helpers = GetThreadCount();
+    if (IsRunningInThisThread())
     {
-        thread.thread.join();
+        --helpers;
     }
+    helpers = std::min(helpers, chunks - 1);
 
-    // Fail any tasks that might have come in while we were executing above.
+    uint64_t first = UINT64_MAX;
 
-    for (auto& [priority, task] : m_queue->tasks)
+    if (helpers > 0)
     {
-        task.completer(nullptr, &reason);
-    }
-}
+        shared.active = helpers;
 
-void ThreadPool::Cancel(uint64_t id)
-{
-    std::lock_guard lock(m_queue->mutex);
+        first = SubmitTasks(helpers, [&shared](Failure* error, size_t) {
+            if (!error)
+            {
+                shared.Work();
+            }
+
+            std::lock_guard lock(shared.mutex);
+            if (--shared.active == 0)
+            {
+                shared.cond.notify_all();
+            }
+        }, Priority::Default, Admission::Internal);
+    }
 
-    auto node = m_queue->idMap.extract(id);
+    shared.Work();
 
-    if (!node)
+    if (helpers == 0)
     {
         return;
     }
 
-    Task& task = node.mapped()->second;
+    // Helpers still queued have nothing left to do, pull them back rather
+    // than waiting for a worker to get to them.
+    {
+        std::lock_guard lock(shared.mutex);
+        if (shared.active == 0)
+        {
+            return;
+        }
+    }
 
-    Failure reason(E_CANCELLED);
-    task.completer(nullptr, &reason);
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        Cancel(first + i);
+    }
 
-    m_queue->tasks.erase(node.mapped());
+    std::unique_lock lock(shared.mutex);
+    shared.cond.wait(lock, [&]() { return shared.active == 0; });
 }
 
-bool ThreadPool::IsRunningInThisThread() const
+size_t ThreadPool::GetThreadCount() const
 {
-    return Callstack<ThreadPool>::Contains(this);
+    return m_scheduler->liveThreads.load();
 }
 
-std::optional<ThreadPool::Task> ThreadPool::DequeueTask(
-    Queue& queue)
+ThreadPool::Stats ThreadPool::GetStats() const
 {
-    std::unique_lock lock(queue.mutex);
+    Scheduler& scheduler = *m_scheduler;
+    Stats stats;
 
-    queue.cond.wait(lock, [&]() {
-        return !queue.tasks.empty() || !queue.running;
-    });
+    for (size_t level = 0; level < Queue::LEVELS; ++level)
+    {
+        size_t queued = scheduler.injection.Size(level);
+
+        for (const auto& queue : scheduler.workers)
+        {
+            queued += queue->Size(level);
+        }
+        stats.priorities[level].queued = queued;
+    }
+
+    {
+        std::lock_guard lock(scheduler.poolMutex);
+
+        const size_t limit = scheduler.slotLimit.load();
+        stats.workers.reserve(limit);
+
+        for (size_t i = 0; i < limit; ++i)
+        {
+            const Scheduler::Activity& activity = scheduler.activity[i];
+
+            stats.workers.push_back(Stats::Worker{
+                .tasks = activity.completed.load(std::memory_order_relaxed),
+                .steals = activity.steals.load(std::memory_order_relaxed),
+                .idle = Clock::duration(Clock::rep(
+                    activity.idle.load(std::memory_order_relaxed))),
+                .live = m_threads[i].live,
+            });
+        }
+    }
+
+    if (!m_options.collectStats)
+    {
+        return stats;
+    }
 
-    if (!queue.running)
+    // Retired slots keep their history, every slot counts.
+    std::map<std::string_view, Stats::Named> named;
+
+    for (size_t i = 0; i < scheduler.workers.size(); ++i)
     {
-        return std::nullopt;
+        Scheduler::Timings& timings = *scheduler.activity[i].timings;
+
+        for (size_t level = 0; level < Queue::LEVELS; ++level)
+        {
+            timings.wait[level].CopyTo(stats.priorities[level].wait);
+            timings.run[level].CopyTo(stats.priorities[level].run);
+        }
+
+        std::lock_guard lock(timings.mutex);
+
+        for (const auto& [name, entry] : timings.named)
+        {
+            Stats::Named& merged = named[name];
+
+            merged.name = name;
+            merged.wait += entry.wait;
+            merged.run += entry.run;
+        }
     }
 
-    return queue.PopFront();
+    stats.named.reserve(named.size());
+    for (auto& [name, entry] : named)
+    {
+        stats.named.push_back(std::move(entry));
+    }
+    return stats;
 }
 
-void ThreadPool::RunThread(
-    ThreadPool* pool,
-    Thread& thread)
+ThreadPool::Stats::Histogram& ThreadPool::Stats::Histogram::operator+=(
+    const Histogram& histogram)
 {
-    FUSION_CALLSTACK_ENTRY(ThreadPool, pool);
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        buckets[i] += histogram.buckets[i];
+    }
+    count += histogram.count;
+    total += histogram.total;
+    return *this;
+}
 
-    Queue* queue = thread.queue;
+Clock::duration ThreadPool::Stats::Histogram::Percentile(double fraction) const
+{
+    using namespace std::chrono;
 
-    if (!thread.threadName.empty())
+    if (count == 0)
     {
-        // ThreadUtil::SetName(thread.threadName);
+        return Clock::duration::zero();
     }
 
-    while (auto task = DequeueTask(*queue))
+    const auto rank = uint64_t(std::clamp(fraction, 0.0, 1.0) * double(count));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < BUCKETS; ++i)
     {
-        task->fn(task->completer);
+        seen += buckets[i];
+
+        if (seen >= std::max<uint64_t>(rank, 1))
+        {
+            return duration_cast<Clock::duration>(
+                nanoseconds(uint64_t(1) << i));
+        }
     }
+    return duration_cast<Clock::duration>(
+        nanoseconds(uint64_t(1) << (BUCKETS - 1)));
 }
 
-uint64_t ThreadPool::SubmitTask(
-    CompletionHandler& completer,
-    TaskFn fn,
-    Priority priority)
+Clock::duration ThreadPool::Stats::Histogram::Mean() const
 {
-    std::unique_lock lock(m_queue->mutex);
+    return (count == 0)
+        ? Clock::duration::zero()
+        : total / Clock::rep(count);
+}
 
-    uint64_t id = m_queue->nextTaskId++;
-    auto it = m_queue->tasks.emplace(priority, Task{
-        .id = id,
-        .fn = std::move(fn),
-        .completer = std::move(completer),
-    });
+ThreadPool::Blocking::Blocking(ThreadPool& pool)
+{
+    Scheduler& scheduler = *pool.m_scheduler;
 
-    m_queue->idMap.emplace(id, it);
-    lock.unlock();
+    if (tlsWorker.scheduler != &scheduler)
+    {
+        return;
+    }
 
-    m_queue->cond.notify_one();
+    m_pool = &pool;
+    scheduler.blocked.fetch_add(1);
 
-    return id;
+    if (scheduler.sleepers.load() == 0 && !scheduler.Empty())
+    {
+        std::lock_guard lock(scheduler.poolMutex);
+        pool.AddThreadLocked();
+    }
+}
+
+ThreadPool::Blocking::~Blocking()
+{
+    if (m_pool)
+    {
+        m_pool->m_scheduler->blocked.fetch_sub(1);
+    }
 }
 // ThreadPool                                                END
 // -------------------------------------------------------------
@@ -248,17 +1875,84 @@ uint64_t ThreadPool::SubmitTask(
 struct ThreadPool::Strand::State
 {
     ThreadPool& pool;
-    ThreadPool::Queue queue;
 
-    State(ThreadPool& p) : pool(p) { }
+    // Intrusive MPSC queue linked through Task::strandNext. Producers only
+    // swing 'tail', the single consumer owns 'head'. The stub keeps the
+    // list non-empty so neither side has to special case it.
+    std::atomic<Task*> tail;
+    Task* head;
+    Task stub;
+
+    // Tasks pushed and not yet run. The push that raises it from zero
+    // schedules the strand, which then stays scheduled until Run() brings
+    // it back to zero, so at most one worker ever runs the strand.
+    std::atomic<size_t> pending{ 0 };
+
+    State(ThreadPool& p)
+        : pool(p)
+        , tail(&stub)
+        , head(&stub)
+    { }
+
+    void Push(Task* task)
+    {
+        task->strandNext.store(nullptr, std::memory_order_relaxed);
+
+        Task* prev = tail.exchange(task, std::memory_order_acq_rel);
+        prev->strandNext.store(task, std::memory_order_release);
+    }
+
+    Task* Pop()
+    {
+        Task* task = head;
+        Task* next = task->strandNext.load(std::memory_order_acquire);
+
+        if (task == &stub)
+        {
+            if (!next)
+            {
+                return nullptr;
+            }
+
+            head = next;
+            task = next;
+            next = next->strandNext.load(std::memory_order_acquire);
+        }
+
+        if (next)
+        {
+            head = next;
+            return task;
+        }
+
+        if (task != tail.load(std::memory_order_acquire))
+        {
+            // A producer swapped the tail but has not linked it yet.
+            return nullptr;
+        }
+
+        Push(&stub);
+
+        next = task->strandNext.load(std::memory_order_acquire);
+        if (next)
+        {
+            head = next;
+            return task;
+        }
+        return nullptr;
+    }
 };
 
 ThreadPool::Strand::Strand(ThreadPool& pool)
-    : m_state(std::make_shared<State>(pool))
+    : m_pool(pool)
+    , m_state(std::make_shared<State>(pool))
 { }
 
-ThreadPool::Strand::Strand(std::shared_ptr<State> state)
-    : m_state(std::move(state))
+ThreadPool::Strand::Strand(
+    ThreadPool& pool,
+    std::shared_ptr<State> state)
+    : m_pool(pool)
+    , m_state(std::move(state))
 { }
 
 ThreadPool::Strand::~Strand()
@@ -266,47 +1960,236 @@ ThreadPool::Strand::~Strand()
 
 Strand ThreadPool::Strand::Duplicate() const
 {
-    return Strand{ m_state };
+    return Strand{ m_pool, m_state };
 }
 
 bool ThreadPool::Strand::IsRunningInThisThread() const
 {
-    return Callstack<Strand>::Contains(this);
+    return Callstack<State, State*>::Contains(m_state.get());
 }
 
-void ThreadPool::Strand::Run()
+void ThreadPool::Strand::Push(Task* task)
 {
-    FUSION_CALLSTACK_ENTRY(Strand, this);
+    m_state->Push(task);
 
-    ThreadPool::Queue& queue = m_state->queue;
+    if (m_state->pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        Schedule(m_state);
+    }
+}
 
-    while (true)
+void ThreadPool::Strand::Schedule(const std::shared_ptr<State>& state)
+{
+    state->pool.SubmitTask([state](Failure* error) {
+        Run(state, error);
+    }, Priority::Default, Admission::Internal);
+}
+
+void ThreadPool::Strand::Run(
+    const std::shared_ptr<State>& state,
+    Failure* error)
+{
+    FUSION_CALLSTACK_ENTRY(State, state.get());
+
+    // A cancelled turn means the pool is going away, there is nowhere to
+    // reschedule to so everything left is cancelled here.
+    for (size_t count = 0; error || count < BATCH; ++count)
     {
-        ThreadPool::Task task;
+        Task* task = nullptr;
+
+        // 'pending' says there is a task, it may just not be linked yet.
+        while (!(task = state->Pop()))
+        {
+            std::this_thread::yield();
+        }
 
-        std::unique_lock lock(queue.mutex);
+        state->pool.CompleteTask(task, error);
 
-        FUSION_ASSERT(queue.running);
-        if (!queue.tasks.empty())
+        if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
         {
-            task = queue.PopFront();
+            return;
         }
-        else
+    }
+
+    Schedule(state);
+}
+// ThreadPool::Strand                                        END
+// -------------------------------------------------------------
+// ThreadPool::TaskGroup                                   START
+struct ThreadPool::TaskGroup::State
+{
+    ThreadPool& pool;
+    Context context;
+    std::atomic<bool> cancelled{ false };
+
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // Children nobody took yet, linked through Task::next.
+    TaskList queued;
+
+    // Children spawned and not finished, whether queued or running.
+    size_t pending{ 0 };
+
+    std::optional<Failure> failure;
+
+    State(ThreadPool& p, Context ctx)
+        : pool(p)
+        , context(std::move(ctx))
+    { }
+
+    Task* Pop()
+    {
+        std::lock_guard lock(mutex);
+
+        Task* child = queued.head;
+        if (child)
         {
-            queue.running = false;
+            queued.head = child->next;
+            if (!queued.head)
+            {
+                queued.tail = nullptr;
+            }
+            --queued.count;
+            child->next = nullptr;
         }
+        return child;
+    }
+};
 
-        lock.unlock();
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool)
+    : TaskGroup(pool, Context{})
+{ }
 
-        if (task)
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool, Context context)
+    : m_pool(pool)
+    , m_state(std::make_shared<State>(pool, std::move(context)))
+{ }
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+    bool outstanding = false;
+    {
+        std::lock_guard lock(m_state->mutex);
+        outstanding = (m_state->pending > 0);
+    }
+
+    if (outstanding)
+    {
+        Cancel();
+        Wait();
+    }
+}
+
+void ThreadPool::TaskGroup::Push(Task* child, Priority priority)
+{
+    {
+        std::lock_guard lock(m_state->mutex);
+
+        ++m_state->pending;
+        AppendTask(m_state->queued, child);
+    }
+
+    // One runner per child, each takes whichever child is first in line.
+    // Runners that find the group empty, because Wait() got there first,
+    // just return. A refused or cancelled runner fails one child in its
+    // place so that the count still comes out even.
+    m_pool.SubmitTask([state = m_state](Failure* error) {
+        if (Task* next = state->Pop())
         {
-            task.fn(task.completer);
-            continue;
+            state->pool.CompleteTask(next, error);
         }
+    }, priority, Admission::Keep);
+}
 
-        return;
-    }  
+void ThreadPool::TaskGroup::Finish(State& state, const Failure* failure)
+{
+    std::lock_guard lock(state.mutex);
+
+    if (failure && !state.failure)
+    {
+        state.failure = *failure;
+        state.cancelled = true;
+    }
+
+    if (--state.pending == 0)
+    {
+        state.cond.notify_all();
+    }
 }
-// ThreadPool::Strand                                        END
+
+bool ThreadPool::TaskGroup::IsCancelled(const State& state)
+{
+    return state.cancelled.load() || state.context.IsCancelled();
+}
+
+bool ThreadPool::TaskGroup::IsCancelled() const
+{
+    return IsCancelled(*m_state);
+}
+
+void ThreadPool::TaskGroup::Cancel()
+{
+    m_state->cancelled = true;
+}
+
+Result<void> ThreadPool::TaskGroup::Wait()
+{
+    // Cancelled children only unwind here, running them is cheap.
+    while (Task* child = m_state->Pop())
+    {
+        m_pool.CompleteTask(child, nullptr);
+    }
+
+    std::unique_lock lock(m_state->mutex);
+    m_state->cond.wait(lock, [&]() { return m_state->pending == 0; });
+
+    if (m_state->failure)
+    {
+        return *m_state->failure;
+    }
+    if (IsCancelled(*m_state))
+    {
+        return Failure(E_CANCELLED);
+    }
+    return Success;
+}
+// ThreadPool::TaskGroup                                     END
+// -------------------------------------------------------------
+// WaitGroup                                               START
+WaitGroup::~WaitGroup()
+{
+    FUSION_ASSERT(m_count == 0);
+}
+
+void WaitGroup::Add(size_t count)
+{
+    std::lock_guard lock(m_mutex);
+    m_count += count;
+}
+
+void WaitGroup::Done()
+{
+    std::lock_guard lock(m_mutex);
+
+    FUSION_ASSERT(m_count > 0);
+    if (--m_count == 0)
+    {
+        m_cond.notify_all();
+    }
+}
+
+void WaitGroup::Wait()
+{
+    std::unique_lock lock(m_mutex);
+    m_cond.wait(lock, [this]() { return m_count == 0; });
+}
+
+bool WaitGroup::WaitFor(Clock::duration timeout)
+{
+    std::unique_lock lock(m_mutex);
+    return m_cond.wait_for(lock, timeout, [this]() { return m_count == 0; });
+}
+// WaitGroup                                                 END
 // -------------------------------------------------------------
 }  // namespace Fusion
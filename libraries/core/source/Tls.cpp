@@ -0,0 +1,1076 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Tls.h>
+
+#include <Fusion/Assert.h>
+#include <Fusion/Memory.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+
+#if FUSION_PLATFORM_LINUX && defined(OPENSSL_IS_BORINGSSL)
+#define FUSION_KERNEL_TLS 1
+#include <Fusion/Internal/Network.h>
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#else
+#define FUSION_KERNEL_TLS 0
+#endif
+
+namespace Fusion
+{
+namespace
+{
+constexpr size_t TLS_RECORD_SIZE = 16 * 1024;
+
+std::string GetOpenSslErrors()
+{
+    std::string errors;
+    while (unsigned long err = ERR_get_error())
+    {
+        std::array<char, 256> buffer{};
+        ERR_error_string_n(err, buffer.data(), buffer.size());
+
+        if (!errors.empty())
+        {
+            errors.append("; ");
+        }
+        errors.append(buffer.data());
+    }
+    return errors;
+}
+
+template<typename Fn>
+Result<size_t> ReadCertificates(std::string_view pem, Fn&& fn)
+{
+    BIO* bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+    if (!bio)
+    {
+        return Failure(E_INSUFFICIENT_RESOURCES);
+    }
+    FUSION_SCOPE_GUARD([&] { BIO_free(bio); });
+
+    size_t count = 0;
+    while (X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr))
+    {
+        bool accepted = fn(cert, count++);
+        X509_free(cert);
+
+        if (!accepted)
+        {
+            return Failure(E_TLS_FAILURE)
+                .WithContext("{}", GetOpenSslErrors());
+        }
+    }
+
+    // Reaching the end of the buffer leaves a 'no start line' error queued.
+    ERR_clear_error();
+
+    if (count == 0)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("no PEM certificates found");
+    }
+    return count;
+}
+
+std::string ReadMemoryBio(BIO* bio)
+{
+    char* data = nullptr;
+    long size = BIO_get_mem_data(bio, &data);
+
+    return (size > 0 && data)
+        ? std::string(data, static_cast<size_t>(size))
+        : std::string();
+}
+}  // namespace
+
+// -------------------------------------------------------------
+// Certificates                                            START
+
+Result<TlsCertificate> CreateSelfSignedCertificate(
+    std::string_view hostname,
+    Clock::duration validity)
+{
+    using namespace std::chrono;
+
+    if (hostname.empty())
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("hostname is required");
+    }
+
+    EVP_PKEY* key = nullptr;
+    {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!ctx)
+        {
+            return Failure(E_INSUFFICIENT_RESOURCES);
+        }
+        FUSION_SCOPE_GUARD([&] { EVP_PKEY_CTX_free(ctx); });
+
+        if (EVP_PKEY_keygen_init(ctx) <= 0
+            || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(
+                ctx, NID_X9_62_prime256v1) <= 0
+            || EVP_PKEY_keygen(ctx, &key) <= 0)
+        {
+            return Failure(E_TLS_FAILURE)
+                .WithContext("key generation failed: {}", GetOpenSslErrors());
+        }
+    }
+    FUSION_SCOPE_GUARD([&] { EVP_PKEY_free(key); });
+
+    X509* cert = X509_new();
+    if (!cert)
+    {
+        return Failure(E_INSUFFICIENT_RESOURCES);
+    }
+    FUSION_SCOPE_GUARD([&] { X509_free(cert); });
+
+    const std::string name(hostname);
+    const auto serial = duration_cast<seconds>(
+        system_clock::now().time_since_epoch()).count();
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), static_cast<long>(serial));
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(
+        X509_getm_notAfter(cert),
+        static_cast<long>(duration_cast<seconds>(validity).count()));
+    X509_set_pubkey(cert, key);
+
+    X509_NAME* subject = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(
+        subject,
+        "CN",
+        MBSTRING_ASC,
+        reinterpret_cast<const unsigned char*>(name.c_str()),
+        -1,
+        -1,
+        0);
+    X509_set_issuer_name(cert, subject);
+
+    // Hostname verification only consults the subjectAltName extension.
+    {
+        GENERAL_NAMES* names = sk_GENERAL_NAME_new_null();
+        GENERAL_NAME* entry = GENERAL_NAME_new();
+        ASN1_IA5STRING* dns = ASN1_IA5STRING_new();
+
+        if (!names || !entry || !dns)
+        {
+            ASN1_IA5STRING_free(dns);
+            GENERAL_NAME_free(entry);
+            GENERAL_NAMES_free(names);
+            return Failure(E_INSUFFICIENT_RESOURCES);
+        }
+
+        ASN1_STRING_set(dns, name.data(), static_cast<int>(name.size()));
+        GENERAL_NAME_set0_value(entry, GEN_DNS, dns);
+        sk_GENERAL_NAME_push(names, entry);
+
+        int added = X509_add1_ext_i2d(
+            cert,
+            NID_subject_alt_name,
+            names,
+            0,
+            X509V3_ADD_DEFAULT);
+        GENERAL_NAMES_free(names);
+
+        if (added != 1)
+        {
+            return Failure(E_TLS_FAILURE)
+                .WithContext("subjectAltName: {}", GetOpenSslErrors());
+        }
+    }
+
+    if (X509_sign(cert, key, EVP_sha256()) <= 0)
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("signing failed: {}", GetOpenSslErrors());
+    }
+
+    BIO* certBio = BIO_new(BIO_s_mem());
+    BIO* keyBio = BIO_new(BIO_s_mem());
+    FUSION_SCOPE_GUARD([&] {
+        BIO_free(certBio);
+        BIO_free(keyBio);
+    });
+
+    if (!certBio || !keyBio)
+    {
+        return Failure(E_INSUFFICIENT_RESOURCES);
+    }
+    if (!PEM_write_bio_X509(certBio, cert)
+        || !PEM_write_bio_PrivateKey(
+            keyBio, key, nullptr, nullptr, 0, nullptr, nullptr))
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("PEM encoding failed: {}", GetOpenSslErrors());
+    }
+
+    TlsCertificate result;
+    result.certificate = ReadMemoryBio(certBio);
+    result.privateKey = ReadMemoryBio(keyBio);
+    return result;
+}
+
+// Certificates                                              END
+// -------------------------------------------------------------
+// TlsContext                                              START
+
+Result<std::unique_ptr<TlsContext>> TlsContext::Create(Params params)
+{
+    auto context = std::make_unique<TlsContext>(std::move(params));
+
+    if (auto result = context->Start(); !result)
+    {
+        return result.Error();
+    }
+    return context;
+}
+
+TlsContext::TlsContext(Params params)
+    : m_params(std::move(params))
+{ }
+
+TlsContext::~TlsContext()
+{
+    {
+        std::unique_lock lock(m_mutex);
+
+        for (auto& [name, session] : m_sessions)
+        {
+            SSL_SESSION_free(session);
+        }
+        m_sessions.clear();
+        m_sessionMap.clear();
+    }
+
+    if (m_ctx)
+    {
+        SSL_CTX_free(m_ctx);
+        m_ctx = nullptr;
+    }
+}
+
+TlsMode TlsContext::Mode() const
+{
+    return m_params.mode;
+}
+
+size_t TlsContext::CachedSessions() const
+{
+    std::unique_lock lock(m_mutex);
+    return m_sessions.size();
+}
+
+Result<void> TlsContext::Start()
+{
+    const bool server = (m_params.mode == TlsMode::Server);
+
+    if (server && (m_params.certificate.empty()
+        || m_params.privateKey.empty()))
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("server contexts require a certificate and key");
+    }
+
+    m_ctx = SSL_CTX_new(TLS_method());
+    if (!m_ctx)
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("{}", GetOpenSslErrors());
+    }
+
+    SSL_CTX_set_min_proto_version(m_ctx, TLS1_2_VERSION);
+
+    if (!m_params.certificate.empty())
+    {
+        auto loaded = ReadCertificates(
+            m_params.certificate,
+            [this](X509* cert, size_t index)
+            {
+                // The first certificate is the leaf, the rest its chain.
+                return (index == 0)
+                    ? SSL_CTX_use_certificate(m_ctx, cert) == 1
+                    : SSL_CTX_add1_chain_cert(m_ctx, cert) == 1;
+            });
+        if (!loaded)
+        {
+            return loaded.Error().WithContext("certificate");
+        }
+    }
+
+    if (!m_params.privateKey.empty())
+    {
+        BIO* bio = BIO_new_mem_buf(
+            m_params.privateKey.data(),
+            static_cast<int>(m_params.privateKey.size()));
+        if (!bio)
+        {
+            return Failure(E_INSUFFICIENT_RESOURCES);
+        }
+        FUSION_SCOPE_GUARD([&] { BIO_free(bio); });
+
+        EVP_PKEY* key = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+        if (!key)
+        {
+            return Failure(E_INVALID_ARGUMENT)
+                .WithContext("private key: {}", GetOpenSslErrors());
+        }
+        FUSION_SCOPE_GUARD([&] { EVP_PKEY_free(key); });
+
+        if (SSL_CTX_use_PrivateKey(m_ctx, key) != 1
+            || SSL_CTX_check_private_key(m_ctx) != 1)
+        {
+            return Failure(E_INVALID_ARGUMENT)
+                .WithContext("private key: {}", GetOpenSslErrors());
+        }
+    }
+
+    if (!m_params.trustedCertificates.empty())
+    {
+        X509_STORE* store = SSL_CTX_get_cert_store(m_ctx);
+
+        auto loaded = ReadCertificates(
+            m_params.trustedCertificates,
+            [store](X509* cert, size_t)
+            {
+                return X509_STORE_add_cert(store, cert) == 1;
+            });
+        if (!loaded)
+        {
+            return loaded.Error().WithContext("trusted certificates");
+        }
+    }
+    else if (m_params.verifyPeer)
+    {
+        SSL_CTX_set_default_verify_paths(m_ctx);
+    }
+
+    int verify = SSL_VERIFY_NONE;
+    if (m_params.verifyPeer)
+    {
+        verify = server
+            ? (SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
+            : SSL_VERIFY_PEER;
+    }
+    SSL_CTX_set_verify(m_ctx, verify, nullptr);
+
+    if (server)
+    {
+        static constexpr unsigned char SESSION_CONTEXT[] = "Fusion";
+
+        SSL_CTX_set_session_id_context(
+            m_ctx,
+            SESSION_CONTEXT,
+            sizeof(SESSION_CONTEXT) - 1);
+
+        if (m_params.sessionCacheSize > 0)
+        {
+            SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_sess_set_cache_size(
+                m_ctx,
+                static_cast<long>(m_params.sessionCacheSize));
+        }
+        else
+        {
+            SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_OFF);
+            SSL_CTX_set_options(m_ctx, SSL_OP_NO_TICKET);
+        }
+    }
+    else if (m_params.sessionCacheSize > 0)
+    {
+        // Sessions are cached here keyed by server name rather than in the
+        // library's internal store, which is keyed by session id only.
+        SSL_CTX_set_session_cache_mode(
+            m_ctx,
+            SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(m_ctx, &TlsContext::OnNewSession);
+    }
+    else
+    {
+        SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    // The PEM inputs are only borrowed for the duration of Create().
+    m_params.certificate = {};
+    m_params.privateKey = {};
+    m_params.trustedCertificates = {};
+
+    return Success;
+}
+
+ssl_session_st* TlsContext::FindSession(const std::string& name)
+{
+    std::unique_lock lock(m_mutex);
+
+    auto it = m_sessionMap.find(name);
+    if (it == m_sessionMap.end())
+    {
+        return nullptr;
+    }
+
+    m_sessions.splice(m_sessions.begin(), m_sessions, it->second);
+
+    SSL_SESSION* session = it->second->second;
+    SSL_SESSION_up_ref(session);
+    return session;
+}
+
+void TlsContext::StoreSession(const std::string& name, ssl_session_st* session)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (auto it = m_sessionMap.find(name); it != m_sessionMap.end())
+    {
+        SSL_SESSION_free(it->second->second);
+        it->second->second = session;
+        m_sessions.splice(m_sessions.begin(), m_sessions, it->second);
+        return;
+    }
+
+    m_sessions.emplace_front(name, session);
+    m_sessionMap.emplace(name, m_sessions.begin());
+
+    while (m_sessions.size() > m_params.sessionCacheSize)
+    {
+        auto& [evicted, old] = m_sessions.back();
+
+        SSL_SESSION_free(old);
+        m_sessionMap.erase(evicted);
+        m_sessions.pop_back();
+    }
+}
+
+int TlsContext::OnNewSession(ssl_st* ssl, ssl_session_st* session)
+{
+    auto* stream = static_cast<TlsStream*>(SSL_get_app_data(ssl));
+
+    if (!stream || stream->m_serverName.empty())
+    {
+        return 0;
+    }
+
+    // Returning 1 transfers the session reference to the cache.
+    stream->m_context.StoreSession(stream->m_serverName, session);
+    return 1;
+}
+
+// TlsContext                                                END
+// -------------------------------------------------------------
+// TlsStream                                               START
+
+Result<std::unique_ptr<TlsStream>> TlsStream::Create(
+    TlsContext& context,
+    Network& network,
+    Socket sock,
+    std::string_view serverName)
+{
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT);
+    }
+
+    auto stream = std::make_unique<TlsStream>(context, network, sock);
+
+    if (auto result = stream->Start(serverName); !result)
+    {
+        return result.Error();
+    }
+    return stream;
+}
+
+TlsStream::TlsStream(
+    TlsContext& context,
+    Network& network,
+    Socket sock)
+    : m_context(context)
+    , m_network(network)
+    , m_sock(sock)
+{ }
+
+TlsStream::~TlsStream()
+{
+    if (m_ssl)
+    {
+        // The SSL object owns both memory BIOs.
+        SSL_free(m_ssl);
+        m_ssl = nullptr;
+        m_rbio = nullptr;
+        m_wbio = nullptr;
+    }
+}
+
+Result<void> TlsStream::Start(std::string_view serverName)
+{
+    m_ssl = SSL_new(m_context.m_ctx);
+    if (!m_ssl)
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("{}", GetOpenSslErrors());
+    }
+
+    m_rbio = BIO_new(BIO_s_mem());
+    m_wbio = BIO_new(BIO_s_mem());
+
+    if (!m_rbio || !m_wbio)
+    {
+        BIO_free(m_rbio);
+        BIO_free(m_wbio);
+        m_rbio = nullptr;
+        m_wbio = nullptr;
+        return Failure(E_INSUFFICIENT_RESOURCES);
+    }
+
+    SSL_set_bio(m_ssl, m_rbio, m_wbio);
+    SSL_set_app_data(m_ssl, this);
+
+    if (m_context.Mode() == TlsMode::Server)
+    {
+        SSL_set_accept_state(m_ssl);
+        return Success;
+    }
+
+    SSL_set_connect_state(m_ssl);
+
+    if (serverName.empty())
+    {
+        return Success;
+    }
+
+    m_serverName = serverName;
+
+    if (!SSL_set_tlsext_host_name(m_ssl, m_serverName.c_str()))
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("server name: {}", GetOpenSslErrors());
+    }
+
+    if (m_context.m_params.verifyPeer)
+    {
+        X509_VERIFY_PARAM* param = SSL_get0_param(m_ssl);
+
+        if (!X509_VERIFY_PARAM_set1_host(
+            param,
+            m_serverName.data(),
+            m_serverName.size()))
+        {
+            return Failure(E_TLS_FAILURE)
+                .WithContext("server name: {}", GetOpenSslErrors());
+        }
+    }
+
+    if (SSL_SESSION* session = m_context.FindSession(m_serverName))
+    {
+        SSL_set_session(m_ssl, session);
+        SSL_SESSION_free(session);
+    }
+    return Success;
+}
+
+Result<void> TlsStream::Handshake()
+{
+    if (m_established)
+    {
+        return Flush();
+    }
+
+    while (true)
+    {
+        int result = SSL_do_handshake(m_ssl);
+        auto flushed = Flush();
+
+        if (!flushed && flushed.Error().Error() != E_NET_WOULD_BLOCK)
+        {
+            return flushed.Error();
+        }
+
+        if (result == 1)
+        {
+            m_established = true;
+            m_wantRead = false;
+
+            if (m_context.m_params.kernelTls)
+            {
+                m_kernelPending = true;
+
+                if (flushed)
+                {
+                    m_kernelPending = false;
+
+                    if (auto enabled = EnableKernelTls();
+                        !enabled && m_kernelFailed)
+                    {
+                        return enabled.Error();
+                    }
+                }
+            }
+            return Success;
+        }
+
+        if (SSL_get_error(m_ssl, result) != SSL_ERROR_WANT_READ)
+        {
+            return GetSslFailure(result, E_TLS_HANDSHAKE);
+        }
+
+        if (auto filled = Fill(); !filled)
+        {
+            return filled.Error();
+        }
+    }
+}
+
+SocketOperation TlsStream::Interest() const
+{
+    SocketOperation ops = SocketOperation::Error;
+
+    if (m_outgoingOffset < m_outgoing.size())
+    {
+        ops |= SocketOperation::Write;
+    }
+    if (!m_established || m_wantRead)
+    {
+        ops |= SocketOperation::Read;
+    }
+    return ops;
+}
+
+bool TlsStream::IsEstablished() const
+{
+    return m_established;
+}
+
+bool TlsStream::IsKernelTls() const
+{
+    return m_kernelTls;
+}
+
+bool TlsStream::IsResumed() const
+{
+    return m_ssl && SSL_session_reused(m_ssl) == 1;
+}
+
+Result<size_t> TlsStream::Recv(void* buffer, size_t size)
+{
+    if (m_kernelFailed)
+    {
+        return KernelFailure();
+    }
+    if (m_kernelTls)
+    {
+        return m_network.Recv(m_sock, buffer, size);
+    }
+    if (!m_established)
+    {
+        if (auto result = Handshake(); !result)
+        {
+            return result.Error();
+        }
+    }
+
+    const int length = static_cast<int>(std::min<size_t>(size, INT_MAX));
+
+    while (true)
+    {
+        int result = SSL_read(m_ssl, buffer, length);
+        if (result > 0)
+        {
+            return static_cast<size_t>(result);
+        }
+
+        int code = SSL_get_error(m_ssl, result);
+        if (code == SSL_ERROR_ZERO_RETURN)
+        {
+            return Failure(E_NET_DISCONNECTED)
+                .WithContext("peer sent close_notify");
+        }
+        if (code != SSL_ERROR_WANT_READ)
+        {
+            return GetSslFailure(result, E_TLS_FAILURE);
+        }
+
+        // Post-handshake messages (tickets, key updates) may need replies.
+        if (auto flushed = Flush();
+            !flushed && flushed.Error().Error() != E_NET_WOULD_BLOCK)
+        {
+            return flushed.Error();
+        }
+        if (auto filled = Fill(); !filled)
+        {
+            return filled.Error();
+        }
+    }
+}
+
+Result<size_t> TlsStream::Send(const void* buffer, size_t size)
+{
+    if (m_kernelFailed)
+    {
+        return KernelFailure();
+    }
+    if (m_kernelTls)
+    {
+        return m_network.Send(m_sock, buffer, size, MessageOption::NoSignal);
+    }
+    if (!m_established)
+    {
+        if (auto result = Handshake(); !result)
+        {
+            return result.Error();
+        }
+    }
+
+    // Do not encrypt more while earlier records are still queued, so the
+    // caller sees socket backpressure rather than unbounded buffering.
+    if (auto flushed = Flush(); !flushed)
+    {
+        return flushed.Error();
+    }
+    if (size == 0)
+    {
+        return size_t(0);
+    }
+
+    const int length = static_cast<int>(
+        std::min<size_t>(size, 4 * TLS_RECORD_SIZE));
+
+    int result = SSL_write(m_ssl, buffer, length);
+    if (result <= 0)
+    {
+        return GetSslFailure(result, E_TLS_FAILURE);
+    }
+
+    if (auto flushed = Flush();
+        !flushed && flushed.Error().Error() != E_NET_WOULD_BLOCK)
+    {
+        return flushed.Error();
+    }
+    return static_cast<size_t>(result);
+}
+
+Result<void> TlsStream::Flush()
+{
+    if (m_kernelFailed)
+    {
+        return KernelFailure();
+    }
+    if (size_t pending = BIO_ctrl_pending(m_wbio); pending > 0)
+    {
+        if (m_outgoingOffset > 0)
+        {
+            m_outgoing.erase(
+                m_outgoing.begin(),
+                m_outgoing.begin() + m_outgoingOffset);
+            m_outgoingOffset = 0;
+        }
+
+        size_t offset = m_outgoing.size();
+        m_outgoing.resize(offset + pending);
+
+        int read = BIO_read(
+            m_wbio,
+            m_outgoing.data() + offset,
+            static_cast<int>(pending));
+        m_outgoing.resize(offset + static_cast<size_t>(std::max(read, 0)));
+    }
+
+    while (m_outgoingOffset < m_outgoing.size())
+    {
+        auto result = m_network.Send(
+            m_sock,
+            m_outgoing.data() + m_outgoingOffset,
+            m_outgoing.size() - m_outgoingOffset,
+            MessageOption::NoSignal);
+
+        if (!result)
+        {
+            return result.Error();
+        }
+        m_outgoingOffset += *result;
+    }
+
+    m_outgoing.clear();
+    m_outgoingOffset = 0;
+
+    if (m_kernelPending)
+    {
+        m_kernelPending = false;
+
+        // Only a socket left half in kernel TLS is an error, anything
+        // short of that keeps the stream in user space.
+        if (auto enabled = EnableKernelTls(); !enabled && m_kernelFailed)
+        {
+            return enabled.Error();
+        }
+    }
+    return Success;
+}
+
+Result<void> TlsStream::Shutdown()
+{
+    if (m_kernelTls)
+    {
+        return m_network.Shutdown(m_sock, SocketShutdownMode::Write);
+    }
+
+    // Queues close_notify, the peer's reply is not awaited.
+    SSL_shutdown(m_ssl);
+    return Flush();
+}
+
+Socket TlsStream::GetSocket() const
+{
+    return m_sock;
+}
+
+Result<void> TlsStream::Fill()
+{
+    std::array<uint8_t, TLS_RECORD_SIZE> buffer;
+
+    auto result = m_network.Recv(m_sock, buffer.data(), buffer.size());
+    if (!result)
+    {
+        m_wantRead = (result.Error().Error() == E_NET_WOULD_BLOCK);
+        return result.Error();
+    }
+    if (*result == 0)
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+
+    m_wantRead = false;
+    BIO_write(m_rbio, buffer.data(), static_cast<int>(*result));
+    return Success;
+}
+
+Failure TlsStream::KernelFailure() const
+{
+    return Failure(E_TLS_FAILURE)
+        .WithContext("kernel TLS was only partially installed");
+}
+
+Failure TlsStream::GetSslFailure(int result, const Error& error) const
+{
+    int code = SSL_get_error(m_ssl, result);
+
+    std::string errors = GetOpenSslErrors();
+    if (code == SSL_ERROR_SSL && SSL_get_verify_result(m_ssl) != X509_V_OK)
+    {
+        errors.append(" (");
+        errors.append(X509_verify_cert_error_string(
+            SSL_get_verify_result(m_ssl)));
+        errors.append(")");
+    }
+    return Failure(error).WithContext("ssl error {}: {}", code, errors);
+}
+
+#if FUSION_KERNEL_TLS
+namespace
+{
+void StoreBigEndian64(uint64_t value, unsigned char* out)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        out[i] = static_cast<unsigned char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+struct KernelTlsKeys
+{
+    const uint8_t* key;
+    const uint8_t* salt;
+    uint64_t sequence;
+};
+
+template<typename Info>
+void MakeCryptoInfo(Info& info, uint16_t cipherType, const KernelTlsKeys& keys)
+{
+    memset(&info, 0, sizeof(info));
+
+    info.info.version = TLS_1_2_VERSION;
+    info.info.cipher_type = cipherType;
+    memcpy(info.key, keys.key, sizeof(info.key));
+    memcpy(info.salt, keys.salt, sizeof(info.salt));
+    StoreBigEndian64(keys.sequence, info.iv);
+    StoreBigEndian64(keys.sequence, info.rec_seq);
+}
+
+//
+// Both directions are built before the ULP is attached, a failure up to
+// and including TCP_ULP leaves the socket untouched. Anything after sets
+// 'attached' since the socket can no longer carry user space records.
+//
+template<typename Info>
+Result<void> InstallKernelTls(
+    Socket sock,
+    uint16_t cipherType,
+    const KernelTlsKeys& tx,
+    const KernelTlsKeys& rx,
+    bool& attached)
+{
+    Info txInfo;
+    Info rxInfo;
+    FUSION_SCOPE_GUARD([&] {
+        OPENSSL_cleanse(&txInfo, sizeof(txInfo));
+        OPENSSL_cleanse(&rxInfo, sizeof(rxInfo));
+    });
+
+    MakeCryptoInfo(txInfo, cipherType, tx);
+    MakeCryptoInfo(rxInfo, cipherType, rx);
+
+    static constexpr char ULP_NAME[] = "tls";
+    if (setsockopt(sock, SOL_TCP, TCP_ULP, ULP_NAME, sizeof(ULP_NAME)) != 0)
+    {
+        return Internal::GetLastNetworkFailure().WithContext("TCP_ULP");
+    }
+    attached = true;
+
+    if (setsockopt(sock, SOL_TLS, TLS_TX, &txInfo, sizeof(txInfo)) != 0)
+    {
+        return Internal::GetLastNetworkFailure().WithContext("TLS_TX");
+    }
+    if (setsockopt(sock, SOL_TLS, TLS_RX, &rxInfo, sizeof(rxInfo)) != 0)
+    {
+        return Internal::GetLastNetworkFailure().WithContext("TLS_RX");
+    }
+    return Success;
+}
+}  // namespace
+#endif
+
+Result<void> TlsStream::EnableKernelTls()
+{
+#if FUSION_KERNEL_TLS
+    if (m_kernelTls)
+    {
+        return Success;
+    }
+    if (SSL_version(m_ssl) != TLS1_2_VERSION)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("kernel TLS requires TLS 1.2");
+    }
+
+    // Records already buffered in user space cannot be handed over.
+    if (BIO_ctrl_pending(m_rbio) > 0 || SSL_pending(m_ssl) > 0)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("unread records are buffered");
+    }
+
+    const SSL_CIPHER* cipher = SSL_get_current_cipher(m_ssl);
+    const int nid = cipher ? SSL_CIPHER_get_cipher_nid(cipher) : NID_undef;
+
+    size_t keySize = 0;
+    if (nid == NID_aes_128_gcm)
+    {
+        keySize = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+    }
+    else if (nid == NID_aes_256_gcm)
+    {
+        keySize = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+    }
+    else
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("kernel TLS requires AES-GCM");
+    }
+
+    // AEAD key block: client key, server key, client salt, server salt.
+    constexpr size_t SALT_SIZE = TLS_CIPHER_AES_GCM_128_SALT_SIZE;
+    const size_t blockSize = SSL_get_key_block_len(m_ssl);
+
+    if (blockSize != 2 * (keySize + SALT_SIZE))
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("unexpected key block size {}", blockSize);
+    }
+
+    std::vector<uint8_t> block(blockSize);
+    FUSION_SCOPE_GUARD([&] { OPENSSL_cleanse(block.data(), block.size()); });
+
+    if (!SSL_generate_key_block(m_ssl, block.data(), block.size()))
+    {
+        return Failure(E_TLS_FAILURE)
+            .WithContext("{}", GetOpenSslErrors());
+    }
+
+    const bool client = (m_context.Mode() == TlsMode::Client);
+    const uint8_t* clientKey = block.data();
+    const uint8_t* serverKey = clientKey + keySize;
+    const uint8_t* clientSalt = serverKey + keySize;
+    const uint8_t* serverSalt = clientSalt + SALT_SIZE;
+
+    const uint8_t* txKey = client ? clientKey : serverKey;
+    const uint8_t* txSalt = client ? clientSalt : serverSalt;
+    const uint8_t* rxKey = client ? serverKey : clientKey;
+    const uint8_t* rxSalt = client ? serverSalt : clientSalt;
+
+    const KernelTlsKeys tx{
+        .key = txKey,
+        .salt = txSalt,
+        .sequence = SSL_get_write_sequence(m_ssl),
+    };
+    const KernelTlsKeys rx{
+        .key = rxKey,
+        .salt = rxSalt,
+        .sequence = SSL_get_read_sequence(m_ssl),
+    };
+
+    bool attached = false;
+    auto installed = (nid == NID_aes_128_gcm)
+        ? InstallKernelTls<tls12_crypto_info_aes_gcm_128>(
+            m_sock, TLS_CIPHER_AES_GCM_128, tx, rx, attached)
+        : InstallKernelTls<tls12_crypto_info_aes_gcm_256>(
+            m_sock, TLS_CIPHER_AES_GCM_256, tx, rx, attached);
+
+    if (!installed)
+    {
+        m_kernelFailed = attached;
+        return installed.Error();
+    }
+
+    m_kernelTls = true;
+    return Success;
+#else
+    return Failure(E_NOT_SUPPORTED)
+        .WithContext("kernel TLS is not available on this platform");
+#endif
+}
+
+// TlsStream                                                 END
+// -------------------------------------------------------------
+}  // namespace Fusion
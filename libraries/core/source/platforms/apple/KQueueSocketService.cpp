@@ -35,7 +35,7 @@ Result<void> KQueueSocketService::Add(
     return Failure{ E_NOT_IMPLEMENTED };
 }
 
-Result<void> KQueueSocketService::Close(Socket sock)
+Result<void> KQueueSocketService::CloseInternal(Socket sock)
 {
     return Failure{ E_NOT_IMPLEMENTED };
 }
@@ -44,7 +44,7 @@ void KQueueSocketService::Notify()
 {}
 
 Result<std::span<SocketEvent>>
-KQueueSocketService::Execute(Clock::duration timeout)
+KQueueSocketService::ExecuteInternal(Clock::duration timeout)
 {
     FUSION_UNUSED(m_network);
 
@@ -20,6 +20,8 @@
 
 #include <sys/epoll.h>
 
+#include <utility>
+
 namespace Fusion::Internal
 {
 static SocketOperation FromSocketEvents(uint32_t events)
@@ -141,6 +143,16 @@ Result<void> EPollSocketService::Add(
     }
     else
     {
+        // Configured before registering, a failure leaves nothing behind.
+        if (sock != m_pipe.Reader())
+        {
+            if (auto result = ApplyBusyPoll(m_network, sock, m_busyPoll); !result)
+            {
+                return result.Error()
+                    .WithContext("failed to enable busy polling on '{}'", sock);
+            }
+        }
+
         event.events = ToEPollEvents(events);
 
         if (epoll_ctl(
@@ -160,7 +172,7 @@ Result<void> EPollSocketService::Add(
     return Success;
 }
 
-Result<void> EPollSocketService::Close(Socket sock)
+Result<void> EPollSocketService::CloseInternal(Socket sock)
 {
     std::lock_guard lock(m_mutex);
 
@@ -202,7 +214,42 @@ Result<void> EPollSocketService::Close(Socket sock)
 }
 
 Result<std::span<SocketEvent>>
-EPollSocketService::Execute(Clock::duration timeout)
+EPollSocketService::ExecuteInternal(Clock::duration timeout)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        FUSION_ASSERT(m_events.empty());
+
+        return Failure(E_CANCELLED);
+    }
+
+    const Clock::duration spin = m_busyPoll.spin;
+    lock.unlock();
+
+    Stats stats;
+    auto result = SpinThenBlock(
+        spin,
+        timeout,
+        stats,
+        [this](Clock::duration t) { return Wait(t); });
+
+    lock.lock();
+    m_stats += stats;
+
+    if (!result)
+    {
+        return result.Error();
+    }
+    if (!*result || m_results.empty())
+    {
+        return std::span<SocketEvent>{};
+    }
+    return { m_results };
+}
+
+Result<bool> EPollSocketService::Wait(Clock::duration timeout)
 {
     std::unique_lock lock(m_mutex);
 
@@ -216,37 +263,42 @@ EPollSocketService::Execute(Clock::duration timeout)
     FUSION_ASSERT(!m_events.empty());
     FUSION_ASSERT(!m_polling);
 
-    auto duration = static_cast<int>(
-        std::chrono::duration_cast<
-            std::chrono::milliseconds>(timeout).count());
+    int duration = ToPollTimeout(timeout);
 
     m_polling = true;
-    lock.unlock();
+    m_results.clear();
 
-    std::vector<struct epoll_event> events(m_events.size());
+    // A notification posted before epoll_wait() started must not be slept
+    // through.
+    if (m_notify)
+    {
+        duration = 0;
+    }
 
-    Clock::time_point start = Clock::now();
+    // Reused across calls so spinning does not allocate.
+    if (m_buffer.size() < m_events.size())
+    {
+        m_buffer.resize(m_events.size());
+    }
+    lock.unlock();
 
     int res = epoll_wait(
         m_poll,
-        events.data(),
-        static_cast<int>(events.size()),
+        m_buffer.data(),
+        static_cast<int>(m_buffer.size()),
         duration);
 
-    Clock::time_point end = Clock::now();
     lock.lock();
 
     FUSION_ASSERT(m_polling);
     m_polling = false;
+    bool notified = std::exchange(m_notify, false);
 
     if (m_shutdown)
     {
-        return std::span<SocketEvent>{};
+        return true;
     }
 
-    FUSION_UNUSED(start);
-    FUSION_UNUSED(end);
-
     if (res == SOCKET_ERROR)
     {
         return GetLastNetworkFailure()
@@ -255,17 +307,16 @@ EPollSocketService::Execute(Clock::duration timeout)
 
     if (res == 0)
     {
-        return std::span<SocketEvent>{};
+        return notified;
     }
 
-    m_results.clear();
     m_results.reserve(res);
     const auto& notify = m_pipe.Reader();
 
     for (int i = 0; i < res; ++i)
     {
-        Socket sock = events[i].data.fd;
-        SocketOperation forward = FromSocketEvents(events[i].events);
+        Socket sock = m_buffer[i].data.fd;
+        SocketOperation forward = FromSocketEvents(m_buffer[i].events);
 
         if (sock == notify)
         {
@@ -274,6 +325,7 @@ EPollSocketService::Execute(Clock::duration timeout)
                 return result.Error()
                     .WithContext("failed to drain the notification socket");
             }
+            notified = true;
             continue;
         }
         if (forward != SocketOperation::None)
@@ -285,12 +337,7 @@ EPollSocketService::Execute(Clock::duration timeout)
         }
     }
 
-    if (!m_results.empty())
-    {
-        return { m_results };
-    }
-
-    return std::span<SocketEvent>{};
+    return notified || !m_results.empty();
 }
 
 void EPollSocketService::Notify()
@@ -307,14 +354,14 @@ void EPollSocketService::NotifyLocked(
 
     if (!m_polling)
     {
+        m_notify = true;
         return;
     }
 
-    size_t writeSize = 0;
     if (auto result = m_network.Send(
         m_pipe.Writer(),
         data,
-        writeSize); !result)
+        sizeof(data)); !result)
     {
         if (m_shutdown)
         {
@@ -362,7 +409,7 @@ Result<void> EPollSocketService::Remove(
         {
             ops &= ~events;
 
-            if ((ops & SocketOperation::Error) == SocketOperation::Error)
+            if (ops == SocketOperation::Error)
             {
                 // Small optimization to ensure that a socket with only an error
                 // event doesn't get left in the pollset.
@@ -408,6 +455,39 @@ Result<void> EPollSocketService::Remove(
         .WithContext("socket '{}' not found in pollset", sock);
 }
 
+Result<void> EPollSocketService::SetBusyPoll(const BusyPoll& options)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return Failure(E_FAILURE);
+    }
+
+    m_busyPoll = options;
+
+    for (const auto& [sock, ops] : m_events)
+    {
+        if (sock == m_pipe.Reader())
+        {
+            continue;
+        }
+        if (auto result = ApplyBusyPoll(m_network, sock, options); !result)
+        {
+            return result.Error()
+                .WithContext("failed to enable busy polling on '{}'", sock);
+        }
+    }
+
+    return Success;
+}
+
+SocketService::Stats EPollSocketService::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
 Result<void> EPollSocketService::Start()
 {
     std::unique_lock lock(m_mutex);
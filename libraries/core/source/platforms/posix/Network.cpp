@@ -21,8 +21,10 @@
 #include <Fusion/Internal/Network.h>
 
 #include <cerrno>
+#include <vector>
 
 #include <fcntl.h>
+#include <poll.h>
 
 namespace Fusion
 {
@@ -164,17 +166,89 @@ Result<void> Internal::Ioctl::SetOption(
 }
 // Ioctl                                                     END
 // -------------------------------------------------------------
+// PollFlags                                               START
+int32_t Internal::GetPollFlags(PollFlags flags)
+{
+    int32_t val = 0;
+
+    if (+(flags & PollFlags::Read))
+    {
+        val |= POLLIN;
+    }
+    if (+(flags & PollFlags::Write))
+    {
+        val |= POLLOUT;
+    }
+    return val;
+}
+
+PollFlags Internal::GetPollFlags(int32_t flags)
+{
+    PollFlags events = PollFlags::None;
+
+    if (flags & POLLERR)
+    {
+        events |= PollFlags::Error;
+    }
+    if (flags & POLLHUP)
+    {
+        events |= PollFlags::HangUp;
+    }
+    if (flags & POLLNVAL)
+    {
+        events |= PollFlags::Invalid;
+    }
+    if (flags & (POLLIN | POLLPRI))
+    {
+        events |= PollFlags::Read;
+    }
+    if (flags & POLLOUT)
+    {
+        events |= PollFlags::Write;
+    }
+
+    return events;
+}
+// PollFlags                                                 END
+// -------------------------------------------------------------
 // Poll                                                    START
 Result<size_t> Poll(
     PollFd* fds,
     size_t count,
     Clock::duration timeout)
 {
-    FUSION_UNUSED(fds);
-    FUSION_UNUSED(count);
-    FUSION_UNUSED(timeout);
+    using namespace Fusion::Internal;
+
+    if (!fds && count > 0)
+    {
+        return Failure{ E_INVALID_ARGUMENT };
+    }
+
+    std::vector<struct pollfd> pollFds(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        struct pollfd& fd = pollFds[i];
+
+        fd.fd = fds[i].sock;
+        fd.revents = 0;
+        fd.events = int16_t(GetPollFlags(fds[i].events));
+    }
+
+    int res = ::poll(pollFds.data(), nfds_t(count), ToPollTimeout(timeout));
+
+    if (res == SOCKET_ERROR)
+    {
+        return GetLastNetworkFailure()
+            .WithContext("failed to poll '{}' sockets", count);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        fds[i].events = GetPollFlags(pollFds[i].revents);
+    }
 
-    return Failure{ E_NOT_IMPLEMENTED };
+    return size_t(res);
 }
 // Poll                                                       END
 // --------------------------------------------------------------
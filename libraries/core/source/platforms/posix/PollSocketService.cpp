@@ -0,0 +1,520 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Internal/PollSocketService.h>
+
+#if FUSION_PLATFORM_POSIX
+
+#include <cerrno>
+#include <utility>
+
+namespace Fusion::Internal
+{
+static int16_t ToPollEvents(SocketOperation ops)
+{
+    int16_t events = 0;
+
+    if (+(ops & SocketOperation::Read))
+    {
+        events |= POLLIN;
+    }
+    if (+(ops & SocketOperation::Write))
+    {
+        events |= POLLOUT;
+    }
+    return events;
+}
+
+static SocketOperation FromPollEvents(int16_t revents, SocketOperation ops)
+{
+    auto forward = SocketOperation::None;
+
+    if (revents & (POLLIN | POLLPRI | POLLHUP))
+    {
+        forward |= SocketOperation::Read;
+    }
+    if (revents & POLLOUT)
+    {
+        forward |= SocketOperation::Write;
+    }
+    if (revents & (POLLERR | POLLNVAL))
+    {
+        // Like select(), a pending error makes the socket ready for
+        // whichever operation the caller is waiting on.
+        forward |= SocketOperation::Read
+            | SocketOperation::Write
+            | SocketOperation::Error;
+    }
+    return forward & ops;
+}
+
+PollSocketService::PollSocketService(Network& network)
+    : m_network(network)
+    , m_pipe(network)
+{ }
+
+PollSocketService::~PollSocketService()
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_started)
+    {
+        FUSION_ASSERT(m_shutdown);
+        FUSION_ASSERT(!m_polling);
+    }
+
+    FUSION_ASSERT(m_index.empty());
+    FUSION_ASSERT(m_results.empty());
+}
+
+Result<void> PollSocketService::Add(
+    Socket sock,
+    SocketOperation events)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return Failure(E_FAILURE);
+    }
+
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+
+    if (!m_started)
+    {
+        return Failure(E_NOT_INITIALIZED)
+            .WithContext("pollset not yet initialized");
+    }
+
+    if (events == SocketOperation::None)
+    {
+        return Success;
+    }
+
+    if (auto iter = m_index.find(sock); iter != m_index.end())
+    {
+        SocketOperation& ops = m_ops[iter->second];
+        if ((ops | events) == ops)
+        {
+            return Success;
+        }
+
+        ops |= events;
+        m_fds[iter->second].events = ToPollEvents(ops);
+    }
+    else
+    {
+        if (auto result = ApplyBusyPoll(m_network, sock, m_busyPoll); !result)
+        {
+            return result.Error()
+                .WithContext("failed to enable busy polling on '{}'", sock);
+        }
+
+        m_index.emplace(sock, m_fds.size());
+        m_ops.push_back(events);
+        m_fds.push_back(pollfd{
+            .fd = sock,
+            .events = ToPollEvents(events),
+            .revents = 0,
+        });
+    }
+
+    m_dirty = true;
+
+    // Changes are picked up by the next Wait(), only a poll() already in
+    // progress has to be interrupted.
+    if (m_polling)
+    {
+        NotifyLocked(lock);
+    }
+    return Success;
+}
+
+Result<void> PollSocketService::CloseInternal(Socket sock)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+
+    if (auto iter = m_index.find(sock); iter != m_index.end())
+    {
+        Erase(iter);
+
+        if (m_polling)
+        {
+            NotifyLocked(lock);
+        }
+    }
+
+    return Success;
+}
+
+void PollSocketService::Erase(std::unordered_map<Socket, size_t>::iterator iter)
+{
+    const size_t slot = iter->second;
+    const size_t last = m_fds.size() - 1;
+
+    // Slot zero belongs to the notification pipe and is never erased.
+    FUSION_ASSERT(slot > 0);
+
+    if (slot != last)
+    {
+        m_fds[slot] = m_fds[last];
+        m_ops[slot] = m_ops[last];
+        m_index[m_fds[slot].fd] = slot;
+    }
+
+    m_fds.pop_back();
+    m_ops.pop_back();
+    m_index.erase(iter);
+    m_dirty = true;
+}
+
+Result<std::span<SocketEvent>>
+PollSocketService::ExecuteInternal(Clock::duration timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        FUSION_ASSERT(m_index.empty());
+        FUSION_ASSERT(m_results.empty());
+
+        return Failure(E_CANCELLED);
+    }
+
+    const Clock::duration spin = m_busyPoll.spin;
+    lock.unlock();
+
+    Stats stats;
+    auto result = SpinThenBlock(
+        spin,
+        timeout,
+        stats,
+        [this](Clock::duration t) { return Wait(t); });
+
+    lock.lock();
+    m_stats += stats;
+
+    if (!result)
+    {
+        return result.Error();
+    }
+    if (!*result || m_results.empty())
+    {
+        return std::span<SocketEvent>{};
+    }
+    return { m_results };
+}
+
+Result<bool> PollSocketService::Wait(Clock::duration timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        FUSION_ASSERT(m_index.empty());
+        FUSION_ASSERT(m_results.empty());
+
+        return Failure(E_CANCELLED);
+    }
+
+    FUSION_ASSERT(!m_polling);
+    FUSION_ASSERT(!m_fds.empty());
+
+    // Sockets registered from other threads while poll() runs must not move
+    // the array out from under the kernel, so poll() gets its own copy. It
+    // only needs refreshing when the registered set changed.
+    if (m_dirty)
+    {
+        m_polled.assign(m_fds.begin(), m_fds.end());
+        m_dirty = false;
+    }
+
+    int32_t timeoutMs = ToPollTimeout(timeout);
+
+    m_polling = true;
+    m_results.clear();
+
+    // A notification posted before poll() started must not be slept through.
+    if (m_notify)
+    {
+        timeoutMs = 0;
+    }
+    lock.unlock();
+
+    int res = ::poll(m_polled.data(), nfds_t(m_polled.size()), timeoutMs);
+    const bool interrupted = (res == SOCKET_ERROR && errno == EINTR);
+
+    lock.lock();
+
+    FUSION_ASSERT(m_polling);
+    m_polling = false;
+    bool notified = std::exchange(m_notify, false);
+    m_cond.notify_all();
+
+    if (m_shutdown)
+    {
+        return true;
+    }
+
+    if (res == SOCKET_ERROR)
+    {
+        if (interrupted)
+        {
+            return notified;
+        }
+        return GetLastNetworkFailure()
+            .WithContext("failed to execute poll() on '{}' sockets",
+                m_polled.size());
+    }
+
+    if (res == 0)
+    {
+        return notified;
+    }
+
+    if (m_polled[0].revents != 0)
+    {
+        notified = true;
+
+        if (auto result = m_pipe.Drain(); !result)
+        {
+            return result.Error()
+                .WithContext("failed to drain notification socket ({})",
+                    m_pipe.Reader());
+        }
+    }
+
+    size_t remaining = size_t(res) - (m_polled[0].revents != 0 ? 1 : 0);
+
+    for (size_t i = 1; i < m_polled.size() && remaining > 0; ++i)
+    {
+        const struct pollfd& fd = m_polled[i];
+        if (fd.revents == 0)
+        {
+            continue;
+        }
+        --remaining;
+
+        // The socket may have been removed or changed interest while
+        // poll() was running, filter against the current registration.
+        auto iter = m_index.find(fd.fd);
+        if (iter == m_index.end())
+        {
+            continue;
+        }
+
+        SocketOperation forward = FromPollEvents(fd.revents, m_ops[iter->second]);
+        if (forward != SocketOperation::None)
+        {
+            m_results.push_back(SocketEvent{
+                .sock = fd.fd,
+                .events = forward,
+            });
+        }
+    }
+    return notified || !m_results.empty();
+}
+
+void PollSocketService::Notify()
+{
+    std::unique_lock lock(m_mutex);
+    NotifyLocked(lock);
+}
+
+void PollSocketService::NotifyLocked(
+    const std::unique_lock<std::mutex>& lock)
+{
+    FUSION_ASSERT(lock.owns_lock());
+
+    constexpr char data[5] = { 'w', 'a', 'k', 'e', 0 };
+
+    if (!m_polling)
+    {
+        m_notify = true;
+        return;
+    }
+
+    m_network.Send(m_pipe.Writer(), data, 5);
+}
+
+Result<void> PollSocketService::Remove(
+    Socket sock,
+    SocketOperation events)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return Failure(E_FAILURE);
+    }
+
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure(E_INVALID_ARGUMENT)
+            .WithContext("invalid socket");
+    }
+
+    if (events == SocketOperation::None)
+    {
+        return Success;
+    }
+
+    if (auto iter = m_index.find(sock); iter != m_index.end())
+    {
+        SocketOperation& ops = m_ops[iter->second];
+        if ((ops & events) == SocketOperation::None)
+        {
+            return Success;
+        }
+
+        ops &= ~events;
+
+        if (ops == SocketOperation::None || ops == SocketOperation::Error)
+        {
+            // poll() always reports errors, a socket with only error
+            // interest left is dropped from the set.
+            Erase(iter);
+        }
+        else
+        {
+            m_fds[iter->second].events = ToPollEvents(ops);
+            m_dirty = true;
+        }
+
+        if (m_polling)
+        {
+            NotifyLocked(lock);
+        }
+    }
+
+    return Success;
+}
+
+Result<void> PollSocketService::SetBusyPoll(const BusyPoll& options)
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return Failure(E_FAILURE);
+    }
+
+    m_busyPoll = options;
+
+    for (const auto& [sock, slot] : m_index)
+    {
+        FUSION_UNUSED(slot);
+
+        if (auto result = ApplyBusyPoll(m_network, sock, options); !result)
+        {
+            return result.Error()
+                .WithContext("failed to enable busy polling on '{}'", sock);
+        }
+    }
+
+    return Success;
+}
+
+SocketService::Stats PollSocketService::GetStats() const
+{
+    std::unique_lock lock(m_mutex);
+    return m_stats;
+}
+
+Result<void> PollSocketService::Start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_started || m_shutdown)
+    {
+        return Failure{ E_FAILURE };
+    }
+
+    if (auto result = m_pipe.Start(
+        SocketPair::Type::NonBlocking); !result)
+    {
+        return result.Error();
+    }
+
+    m_fds.push_back(pollfd{
+        .fd = m_pipe.Reader(),
+        .events = POLLIN,
+        .revents = 0,
+    });
+    m_ops.push_back(SocketOperation::Read);
+    m_dirty = true;
+
+    m_started = true;
+    m_shutdown = false;
+    return Success;
+}
+
+void PollSocketService::Stop()
+{
+    Stop([&](Failure& result) {
+        std::lock_guard l(m_mutex);
+        FUSION_UNUSED(result);
+        FUSION_ASSERT(m_shutdown);
+        FUSION_ASSERT(m_index.empty());
+    });
+}
+
+void PollSocketService::Stop(std::function<void(Failure&)> fn)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_shutdown)
+    {
+        return;
+    }
+
+    m_shutdown = true;
+    m_index.clear();
+    m_results.clear();
+
+    NotifyLocked(lock);
+
+    if (m_polling)
+    {
+        while (m_polling) m_cond.wait(lock);
+    }
+
+    m_fds.clear();
+    m_ops.clear();
+    m_polled.clear();
+    m_pipe.Stop();
+
+    lock.unlock();
+    if (fn)
+    {
+        Failure f(E_SUCCESS);
+
+        fn(f);
+    }
+}
+}  // namespace Fusion::Internal
+
+#endif  // FUSION_PLATFORM_POSIX
@@ -19,7 +19,10 @@
 
 #include <Fusion/Internal/StandardNetwork.h>
 
+#include <cstring>
+#include <vector>
 #include <fcntl.h>
+#include <unistd.h>
 
 namespace Fusion::Internal
 {
@@ -41,7 +44,7 @@ StandardNetwork::Accept(Socket server) const
     if (client.sock = ::accept(
        server,
        addr,
-       &length); !client.sock)
+       &length); client.sock == INVALID_SOCKET)
     {
         return GetLastNetworkFailure()
             .WithContext("failed to accept() on '{}'", server);
@@ -134,6 +137,65 @@ Result<void> StandardNetwork::Connect(
     return Success;
 }
 
+Result<size_t> StandardNetwork::ConnectWithData(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t size) const
+{
+#if FUSION_PLATFORM_LINUX
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket");
+    }
+    if (size == 0)
+    {
+        return Network::ConnectWithData(sock, address, buffer, size);
+    }
+
+    FUSION_ASSERT(buffer);
+
+    SockAddrStorage buf = { 0 };
+    auto length = buf.size();
+    auto* addr = address.ToSockAddr(buf.data(), length);
+
+    if (!addr)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket address");
+    }
+
+    // With a cookie cached for the peer the data goes out in the SYN,
+    // otherwise the kernel requests one and sends the data once the
+    // handshake completes. A non-blocking socket without a cookie fails
+    // with E_NET_INPROGRESS and nothing is sent, as with Connect().
+    ssize_t result = ::sendto(
+        sock,
+        buffer,
+        size,
+        MSG_FASTOPEN | GetMessageOption(MessageOption::NoSignal),
+        addr,
+        static_cast<socklen_t>(length));
+
+    if (result == SOCKET_ERROR)
+    {
+        if (errno == EOPNOTSUPP)
+        {
+            // Client side Fast Open disabled through net.ipv4.tcp_fastopen.
+            return Network::ConnectWithData(sock, address, buffer, size);
+        }
+        return GetLastNetworkFailure()
+            .WithContext("failed to connect socket '{}' to '{}'",
+                sock, address);
+    }
+
+    return size_t(result);
+#else
+    return Network::ConnectWithData(sock, address, buffer, size);
+#endif
+}
+
 Result<Socket> StandardNetwork::CreateSocket(
     AddressFamily family,
     SocketProtocol proto,
@@ -144,7 +206,7 @@ Result<Socket> StandardNetwork::CreateSocket(
             GetSocketType(type),
             GetSocketProtocol(proto));
 
-    if (!sock)
+    if (sock == INVALID_SOCKET)
     {
         return GetLastNetworkFailure()
             .WithContext("failed to create socket for {}(family={},protocol={})",
@@ -154,6 +216,31 @@ Result<Socket> StandardNetwork::CreateSocket(
     return sock;
 }
 
+Result<std::array<Socket, 2>> StandardNetwork::CreateSocketPair(
+    AddressFamily family,
+    SocketType type) const
+{
+    if (family != AddressFamily::Unix)
+    {
+        return Failure{ E_NOT_SUPPORTED }
+            .WithContext("socket pairs require the unix address family");
+    }
+
+    int sockets[2] = { INVALID_SOCKET, INVALID_SOCKET };
+
+    if (::socketpair(
+        GetAddressFamily(family),
+        GetSocketType(type),
+        0,
+        sockets) == SOCKET_ERROR)
+    {
+        return GetLastNetworkFailure()
+            .WithContext("failed to create {} socket pair", type);
+    }
+
+    return std::array<Socket, 2>{ sockets[0], sockets[1] };
+}
+
 Result<SocketAddress>
 StandardNetwork::GetPeerName(Socket sock) const
 {
@@ -220,6 +307,11 @@ Result<void> StandardNetwork::GetSocketOption(
     {
         return Failure(E_INVALID_ARGUMENT);
     }
+    if (GetSocketOpt(option) == -1)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("socket option '{}' is not available", option);
+    }
 
     socklen_t length = static_cast<socklen_t>(size);
 
@@ -325,6 +417,22 @@ Result<Network::RecvFromData> StandardNetwork::RecvFrom(
     auto length = static_cast<socklen_t>(buf.size());
     auto* addr = reinterpret_cast<sockaddr*>(buf.data());
 
+#if FUSION_PLATFORM_LINUX
+    // recvmsg() is used so the segment size of datagrams coalesced by
+    // UDP_GRO can be picked up from the control messages.
+    struct iovec iov = { buffer, size };
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = { 0 };
+
+    struct msghdr msg = { 0 };
+    msg.msg_name = addr;
+    msg.msg_namelen = length;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t result = ::recvmsg(sock, &msg, GetMessageOption(flags));
+#else
     ssize_t result = ::recvfrom(
         sock,
         buffer,
@@ -332,6 +440,7 @@ Result<Network::RecvFromData> StandardNetwork::RecvFrom(
         GetMessageOption(flags),
         addr,
         &length);
+#endif
 
     if (result == SOCKET_ERROR)
     {
@@ -346,9 +455,200 @@ Result<Network::RecvFromData> StandardNetwork::RecvFrom(
     data.size = size;
     data.received = size_t(result);
 
+#if FUSION_PLATFORM_LINUX
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            int segment = 0;
+            memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+
+            data.segmentSize = size_t(segment);
+            break;
+        }
+    }
+#endif
+
     return data;
 }
 
+Result<Network::RecvDescriptorsData> StandardNetwork::RecvDescriptors(
+    Socket sock,
+    std::span<Socket> descriptors,
+    void* buffer,
+    size_t size) const
+{
+    // The kernel refuses to pass more than this many descriptors at once.
+    constexpr size_t SCM_MAX_FD = 253;
+
+    FUSION_ASSERT(buffer);
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket");
+    }
+
+    if (size == 0)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("descriptors are received with at least one byte");
+    }
+
+    size_t capacity = std::min(descriptors.size(), SCM_MAX_FD);
+    std::vector<uint8_t> control(CMSG_SPACE(sizeof(int) * std::max<size_t>(capacity, 1)));
+
+    struct iovec iov = { buffer, size };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    int flags = 0;
+#if FUSION_PLATFORM_LINUX
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+    ssize_t result = ::recvmsg(sock, &msg, flags);
+
+    if (result == SOCKET_ERROR)
+    {
+        return GetLastNetworkFailure()
+            .WithContext("failed recvmsg() from '{}' for '{}' bytes",
+                sock, size);
+    }
+
+    if (result == 0)
+    {
+        return Failure(E_NET_DISCONNECTED);
+    }
+
+    RecvDescriptorsData data;
+    data.received = size_t(result);
+
+    bool overflow = (msg.msg_flags & MSG_CTRUNC) != 0;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        {
+            continue;
+        }
+
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const uint8_t* fds = CMSG_DATA(cmsg);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            int fd = INVALID_SOCKET;
+            memcpy(&fd, fds + i * sizeof(int), sizeof(int));
+
+            if (data.count < descriptors.size())
+            {
+                descriptors[data.count++] = fd;
+            }
+            else
+            {
+                overflow = true;
+                ::close(fd);
+            }
+        }
+    }
+
+    if (overflow)
+    {
+        for (size_t i = 0; i < data.count; ++i)
+        {
+            ::close(descriptors[i]);
+        }
+        return Failure(E_NET_SIZE_EXCEEDED)
+            .WithContext("peer sent more descriptors than the '{}' expected",
+                descriptors.size());
+    }
+
+#if !FUSION_PLATFORM_LINUX
+    for (size_t i = 0; i < data.count; ++i)
+    {
+        (void)::fcntl(descriptors[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+
+    return data;
+}
+
+Result<size_t> StandardNetwork::SendDescriptors(
+    Socket sock,
+    std::span<const Socket> descriptors,
+    const void* buffer,
+    size_t size) const
+{
+    constexpr size_t SCM_MAX_FD = 253;
+    static const uint8_t empty = 0;
+
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket");
+    }
+
+    if (descriptors.size() > SCM_MAX_FD)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("'{}' descriptors exceed the limit of '{}'",
+                descriptors.size(), SCM_MAX_FD);
+    }
+
+    // Ancillary data cannot be sent without a payload.
+    if (size == 0)
+    {
+        buffer = &empty;
+        size = 1;
+    }
+
+    std::vector<uint8_t> control(CMSG_SPACE(sizeof(int) * descriptors.size()));
+
+    struct iovec iov = { const_cast<void*>(buffer), size };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (!descriptors.empty())
+    {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * descriptors.size());
+
+        uint8_t* fds = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < descriptors.size(); ++i)
+        {
+            int fd = descriptors[i];
+            memcpy(fds + i * sizeof(int), &fd, sizeof(int));
+        }
+    }
+
+    ssize_t result = ::sendmsg(
+        sock,
+        &msg,
+        GetMessageOption(MessageOption::NoSignal));
+
+    if (result == SOCKET_ERROR)
+    {
+        return GetLastNetworkFailure()
+            .WithContext("failed sendmsg() to '{}' with '{}' descriptors",
+                sock, descriptors.size());
+    }
+
+    return size_t(result);
+}
+
 Result<size_t> StandardNetwork::Send(
     Socket sock,
     const void* buffer,
@@ -430,6 +730,110 @@ Result<size_t> StandardNetwork::SendTo(
     return size_t(result);
 }
 
+Result<size_t> StandardNetwork::SendToSegmented(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t size,
+    size_t segmentSize,
+    MessageOption flags) const
+{
+#if FUSION_PLATFORM_LINUX
+    // The kernel splits at most this many segments from a single send.
+    constexpr size_t UDP_MAX_SEGMENTS = 64;
+    // Largest UDP payload, less the UDP and IPv6 headers.
+    constexpr size_t UDP_MAX_PAYLOAD = size_t(UINT16_MAX) - 8 - 40;
+
+    FUSION_ASSERT(buffer);
+    if (sock == INVALID_SOCKET)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket");
+    }
+    // A larger segment would round every send below down to nothing.
+    if (segmentSize == 0 || segmentSize > UDP_MAX_PAYLOAD)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid segment size '{}'", segmentSize);
+    }
+
+    if (size <= segmentSize)
+    {
+        return SendTo(sock, address, buffer, size, flags);
+    }
+
+    SockAddrStorage buf = { 0 };
+    size_t length = buf.size();
+    auto* addr = address.ToSockAddr(buf.data(), length);
+
+    if (!addr)
+    {
+        return Failure{ E_INVALID_ARGUMENT }
+            .WithContext("invalid socket address");
+    }
+
+    size_t maximum = std::min(
+        segmentSize * UDP_MAX_SEGMENTS,
+        UDP_MAX_PAYLOAD);
+    maximum -= maximum % segmentSize;
+
+    const auto* data = static_cast<const uint8_t*>(buffer);
+    size_t sent = 0;
+
+    while (sent < size)
+    {
+        size_t chunk = std::min(size - sent, maximum);
+
+        struct iovec iov = { const_cast<uint8_t*>(data + sent), chunk };
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = { 0 };
+
+        struct msghdr msg = { 0 };
+        msg.msg_name = addr;
+        msg.msg_namelen = static_cast<socklen_t>(length);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        if (chunk > segmentSize)
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+            auto segment = static_cast<uint16_t>(segmentSize);
+            memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+        }
+
+        ssize_t result = ::sendmsg(sock, &msg, GetMessageOption(flags));
+        if (result == SOCKET_ERROR)
+        {
+            if (sent > 0)
+            {
+                break;
+            }
+            return GetLastNetworkFailure()
+                .WithContext("failed sendmsg() to '{}' (address={},flags={},segment={}) for '{}' bytes",
+                    sock, address, flags, segmentSize, chunk);
+        }
+
+        sent += size_t(result);
+    }
+
+    return sent;
+#else
+    return Network::SendToSegmented(
+        sock,
+        address,
+        buffer,
+        size,
+        segmentSize,
+        flags);
+#endif
+}
+
 Result<void> StandardNetwork::SetBlocking(
     Socket sock,
     bool blocking) const
@@ -472,6 +876,11 @@ Result<void> StandardNetwork::SetSocketOption(
     {
         return Failure(E_INVALID_ARGUMENT);
     }
+    if (GetSocketOpt(option) == -1)
+    {
+        return Failure(E_NOT_SUPPORTED)
+            .WithContext("socket option '{}' is not available", option);
+    }
 
     int res = ::setsockopt(
         sock,
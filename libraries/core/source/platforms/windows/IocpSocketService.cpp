@@ -35,7 +35,7 @@ Result<void> IocpSocketService::Add(
     return Failure{ E_NOT_IMPLEMENTED };
 }
 
-Result<void> IocpSocketService::Close(Socket sock)
+Result<void> IocpSocketService::CloseInternal(Socket sock)
 {
     return Failure{ E_NOT_IMPLEMENTED };
 }
@@ -44,7 +44,7 @@ void IocpSocketService::Notify()
 {}
 
 Result<std::span<SocketEvent>>
-IocpSocketService::Execute(Clock::duration timeout)
+IocpSocketService::ExecuteInternal(Clock::duration timeout)
 {
     return Failure{ E_NOT_IMPLEMENTED };
 }
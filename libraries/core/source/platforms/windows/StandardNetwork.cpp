@@ -142,7 +142,7 @@ Result<Socket> StandardNetwork::CreateSocket(
         GetSocketType(type),
         GetSocketProtocol(proto));
 
-    if (!sock)
+    if (sock == INVALID_SOCKET)
     {
         return GetLastNetworkFailure();
     }
@@ -413,6 +413,23 @@ Result<size_t> StandardNetwork::SendTo(
     return size_t(result);
 }
 
+Result<size_t> StandardNetwork::SendToSegmented(
+    Socket sock,
+    const SocketAddress& address,
+    const void* buffer,
+    size_t size,
+    size_t segmentSize,
+    MessageOption flags) const
+{
+    return Network::SendToSegmented(
+        sock,
+        address,
+        buffer,
+        size,
+        segmentSize,
+        flags);
+}
+
 Result<void> StandardNetwork::SetBlocking(
     Socket sock,
     bool blocking) const
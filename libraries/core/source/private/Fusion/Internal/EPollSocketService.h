@@ -21,6 +21,8 @@
 
 #include <Fusion/Internal/Network.h>
 
+#include <sys/epoll.h>
+
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -48,24 +50,24 @@ public:
     //
     //
     //
-    Result<void> Close(Socket sock) override;
+    void Notify() override;
 
     //
     //
     //
-    void Notify() override;
+    Result<void> Remove(
+        Socket sock,
+        SocketOperation events) override;
 
     //
     //
     //
-    Result<std::span<SocketEvent>> Execute(Clock::duration timeout) override;
+    Result<void> SetBusyPoll(const BusyPoll& options) override;
 
     //
     //
     //
-    Result<void> Remove(
-        Socket sock,
-        SocketOperation events) override;
+    Stats GetStats() const override;
 
     //
     //
@@ -82,20 +84,39 @@ public:
     //
     void Stop(std::function<void(Failure&)> fn) override;
 
+protected:
+    //
+    //
+    //
+    Result<void> CloseInternal(Socket sock) override;
+
+    //
+    //
+    //
+    Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) override;
+
 private:
     void NotifyLocked(const std::unique_lock<std::mutex>&);
 
+    Result<bool> Wait(Clock::duration timeout);
+
     Network& m_network;
     SocketPair m_pipe;
 
+    bool m_notify{ false };
     bool m_polling{ false };
     bool m_shutdown{ false };
     bool m_started{ false };
 
     Socket m_poll{ INVALID_SOCKET };
 
-    std::mutex m_mutex;
+    mutable std::mutex m_mutex;
+
+    BusyPoll m_busyPoll;
+    Stats m_stats;
 
+    std::vector<struct epoll_event> m_buffer;
     std::vector<SocketEvent> m_results;
     std::unordered_map<Socket, SocketOperation> m_events;
 };
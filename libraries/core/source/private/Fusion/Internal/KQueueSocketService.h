@@ -44,39 +44,41 @@ public:
     //
     //
     //
-    Result<void> Close(Socket sock) override;
+    void Notify() override;
 
     //
     //
     //
-    void Notify() override;
+    Result<void> Remove(
+        Socket sock,
+        SocketOperation events) override;
 
     //
     //
     //
-    Result<std::span<SocketEvent>> Execute(Clock::duration timeout) override;
+    Result<void> Start() override;
 
     //
     //
     //
-    Result<void> Remove(
-        Socket sock,
-        SocketOperation events) override;
+    void Stop() override;
 
     //
     //
     //
-    Result<void> Start() override;
+    void Stop(std::function<void(Failure&)> fn) override;
 
+protected:
     //
     //
     //
-    void Stop() override;
+    Result<void> CloseInternal(Socket sock) override;
 
     //
     //
     //
-    void Stop(std::function<void(Failure&)> fn) override;
+    Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) override;
 
 private:
     Network& m_network;
@@ -19,6 +19,7 @@
 #include <Fusion/Network.h>
 #include <Fusion/Windows.h>
 
+#include <algorithm>
 #include <array>
 #include <variant>
 
@@ -46,6 +47,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -59,6 +61,35 @@
 #ifndef NO_ERROR
 #define NO_ERROR 0L
 #endif
+#if FUSION_PLATFORM_LINUX
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef TCP_FASTOPEN
+#define TCP_FASTOPEN 23
+#endif
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+#ifndef MSG_FASTOPEN
+#define MSG_FASTOPEN 0x20000000
+#endif
+#endif  // FUSION_PLATFORM_LINUX
 // FUSION_PLATFORM_POSIX -- END
 #else
 #error "Unsupported operating system"
@@ -229,4 +260,82 @@ SocketType GetSocketType(int32_t type);
 // structure.
 //
 void MapAddressInfo(const AddressInfo& addr, struct addrinfo& info);
+
+//
+// Apply the socket level options of a SocketService::BusyPoll to 'sock'.
+// Descriptors that are not sockets are left as they are.
+//
+Result<void> ApplyBusyPoll(
+    const Network& network,
+    Socket sock,
+    const SocketService::BusyPoll& options);
+
+//
+// Convert 'timeout' to the milliseconds poll(), epoll_wait() and friends
+// take. Negative waits forever (-1), anything else is rounded up so
+// sub-millisecond timeouts do not turn into a busy loop.
+//
+int32_t ToPollTimeout(Clock::duration timeout);
+
+//
+// Invoke 'wait' with a zero timeout until it reports activity or the spin
+// budget is spent, then block in 'wait' for what remains of 'timeout'. The
+// callable returns true once events are ready or the service was woken.
+//
+template<typename Fn>
+Result<bool> SpinThenBlock(
+    Clock::duration spin,
+    Clock::duration timeout,
+    SocketService::Stats& stats,
+    Fn&& wait)
+{
+    constexpr Clock::duration zero = Clock::duration::zero();
+    Clock::duration remaining = timeout;
+
+    if (spin > zero && timeout != zero)
+    {
+        const Clock::duration budget = (timeout > zero)
+            ? std::min(spin, timeout)
+            : spin;
+        const Clock::time_point start = Clock::now();
+        Clock::duration elapsed = zero;
+
+        do
+        {
+            ++stats.spinPolls;
+            Result<bool> result = wait(zero);
+            elapsed = Clock::now() - start;
+
+            if (!result || *result)
+            {
+                stats.spinTime += elapsed;
+                stats.spinWakeups += result ? 1 : 0;
+                return result;
+            }
+        }
+        while (elapsed < budget);
+
+        stats.spinTime += elapsed;
+
+        if (timeout > zero)
+        {
+            if (remaining = timeout - elapsed; remaining <= zero)
+            {
+                return false;
+            }
+        }
+    }
+
+    const Clock::time_point start = Clock::now();
+    ++stats.blocks;
+
+    Result<bool> result = wait(remaining);
+    stats.blockTime += Clock::now() - start;
+
+    if (result && *result)
+    {
+        ++stats.blockWakeups;
+    }
+    return result;
+}
 }  // namespace Fusion
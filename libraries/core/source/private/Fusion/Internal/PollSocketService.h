@@ -0,0 +1,147 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#pragma once
+
+#include <Fusion/Platform.h>
+#if FUSION_PLATFORM_POSIX
+
+#include <Fusion/Internal/Network.h>
+
+#include <poll.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Fusion::Internal
+{
+//
+// SocketService backed by poll(2).
+//
+// The pollfd array is kept between calls and updated in place by Add() and
+// Remove(), so unlike select() there is no FD_SETSIZE ceiling and no per-call
+// rebuild. The kernel writes into a second copy of the array which is only
+// refreshed after the registered set changed.
+//
+class PollSocketService final
+    : public SocketService
+{
+public:
+    PollSocketService(Network& network);
+    ~PollSocketService() override;
+
+public:
+    //
+    //
+    //
+    Result<void> Add(
+        Socket sock,
+        SocketOperation events) override;
+
+    //
+    //
+    //
+    void Notify() override;
+
+    //
+    //
+    //
+    Result<void> Remove(
+        Socket sock,
+        SocketOperation events) override;
+
+    //
+    //
+    //
+    Result<void> SetBusyPoll(const BusyPoll& options) override;
+
+    //
+    //
+    //
+    Stats GetStats() const override;
+
+    //
+    //
+    //
+    Result<void> Start() override;
+
+    //
+    //
+    //
+    void Stop() override;
+
+    //
+    //
+    //
+    void Stop(std::function<void(Failure&)> fn) override;
+
+protected:
+    //
+    //
+    //
+    Result<void> CloseInternal(Socket sock) override;
+
+    //
+    //
+    //
+    Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) override;
+
+private:
+    //
+    //
+    //
+    void NotifyLocked(const std::unique_lock<std::mutex>&);
+
+    //
+    //
+    //
+    void Erase(std::unordered_map<Socket, size_t>::iterator iter);
+
+    //
+    //
+    //
+    Result<bool> Wait(Clock::duration timeout);
+
+    Network& m_network;
+    SocketPair m_pipe;
+
+    bool m_polling{ false };
+    bool m_notify{ false };
+    bool m_started{ false };
+    bool m_shutdown{ false };
+    bool m_dirty{ true };
+
+    BusyPoll m_busyPoll;
+    Stats m_stats;
+
+    std::condition_variable m_cond;
+    mutable std::mutex m_mutex;
+
+    // Registered sockets, slot zero holds the notification pipe.
+    std::vector<struct pollfd> m_fds;
+    std::vector<SocketOperation> m_ops;
+    std::unordered_map<Socket, size_t> m_index;
+
+    // Copy of 'm_fds' handed to poll().
+    std::vector<struct pollfd> m_polled;
+    std::vector<SocketEvent> m_results;
+};
+}  // namespace Fusion::Internal
+
+#endif  // FUSION_PLATFORM_POSIX
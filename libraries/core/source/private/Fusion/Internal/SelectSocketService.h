@@ -44,24 +44,24 @@ public:
     //
     //
     //
-    Result<void> Close(Socket sock) override;
+    void Notify() override;
 
     //
     //
     //
-    void Notify() override;
+    Result<void> Remove(
+        Socket sock,
+        SocketOperation events) override;
 
     //
     //
     //
-    Result<std::span<SocketEvent>> Execute(Clock::duration timeout) override;
+    Result<void> SetBusyPoll(const BusyPoll& options) override;
 
     //
     //
     //
-    Result<void> Remove(
-        Socket sock,
-        SocketOperation events) override;
+    Stats GetStats() const override;
 
     //
     //
@@ -78,12 +78,29 @@ public:
     //
     void Stop(std::function<void(Failure&)> fn) override;
 
+protected:
+    //
+    //
+    //
+    Result<void> CloseInternal(Socket sock) override;
+
+    //
+    //
+    //
+    Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) override;
+
 private:
     //
     //
     //
     void NotifyLocked(const std::unique_lock<std::mutex>&);
 
+    //
+    //
+    //
+    Result<bool> Wait(Clock::duration timeout);
+
     Network& m_network;
     SocketPair m_pipe;
 
@@ -92,8 +109,11 @@ private:
     bool m_started{ false };
     bool m_shutdown{ false };
 
+    BusyPoll m_busyPoll;
+    Stats m_stats;
+
     std::condition_variable m_cond;
-    std::mutex m_mutex;
+    mutable std::mutex m_mutex;
     std::vector<SocketEvent> m_events;
     std::vector<SocketEvent> m_results;
 };
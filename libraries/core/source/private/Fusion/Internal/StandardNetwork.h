@@ -54,6 +54,15 @@ public:
         SocketProtocol proto,
         SocketType type) const override;
 
+#if FUSION_PLATFORM_POSIX
+    //
+    //
+    //
+    Result<std::array<Socket, 2>> CreateSocketPair(
+        AddressFamily family,
+        SocketType type) const override;
+#endif
+
     //
     //
     //
@@ -61,6 +70,17 @@ public:
         Socket sock,
         const SocketAddress& address) const override;
 
+#if FUSION_PLATFORM_POSIX
+    //
+    //
+    //
+    Result<size_t> ConnectWithData(
+        Socket sock,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t size) const override;
+#endif
+
     //
     //
     //
@@ -110,6 +130,26 @@ public:
         size_t length,
         MessageOption flags) const override;
 
+#if FUSION_PLATFORM_POSIX
+    //
+    //
+    //
+    Result<RecvDescriptorsData> RecvDescriptors(
+        Socket sock,
+        std::span<Socket> descriptors,
+        void* buffer,
+        size_t size) const override;
+
+    //
+    //
+    //
+    Result<size_t> SendDescriptors(
+        Socket sock,
+        std::span<const Socket> descriptors,
+        const void* buffer,
+        size_t size) const override;
+#endif
+
     //
     //
     //
@@ -129,6 +169,17 @@ public:
         size_t length,
         MessageOption flags) const override;
 
+    //
+    //
+    //
+    Result<size_t> SendToSegmented(
+        Socket sock,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t length,
+        size_t segmentSize,
+        MessageOption flags) const override;
+
     //
     //
     //
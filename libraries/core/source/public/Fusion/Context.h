@@ -20,7 +20,11 @@
 #include <Fusion/Types.h>
 
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace Fusion
 {
@@ -29,6 +33,12 @@ namespace Fusion
 //
 class Context final
 {
+public:
+    //
+    // Invoked once when the context is cancelled.
+    //
+    using CancelCallback = std::function<void()>;
+
 public:
     //
     //
@@ -84,20 +94,49 @@ public:
     void Cancel();
 
     //
-    //
+    // True once Cancel() was called or the deadline passed.
     //
     bool IsCancelled() const;
 
+    //
+    // True when the deadline passed, as opposed to Cancel() being called.
+    // Lets callers tell a timeout apart from an explicit cancellation.
+    //
+    bool IsExpired() const;
+
+    //
+    // The deadline set with CancelAt() or CancelAfter(), if any.
+    //
+    std::optional<Clock::time_point> Deadline() const;
+
     //
     //
     //
     void ReleaseDeadline();
 
+    //
+    // Register 'fn' to be called from the thread calling Cancel(), or right
+    // away when the context is already cancelled. Reaching the deadline
+    // invokes nothing, waiters are expected to bound their wait by
+    // Deadline(). Callbacks run with the context locked and must not call
+    // back into it. Returns an id for RemoveCallback().
+    //
+    uint64_t AddCallback(CancelCallback fn);
+
+    //
+    // Once this returns the callback is not running and will not be called.
+    //
+    void RemoveCallback(uint64_t id);
+
 private:
     struct State
     {
         std::atomic<bool> flag{ false };
         std::atomic<Clock::duration::rep> deadline{ 0 };
+
+        std::mutex mutex;
+        std::vector<std::pair<uint64_t, CancelCallback>> callbacks;
+        uint64_t nextCallback{ 1 };
     };
 
     std::shared_ptr<State> m_state;
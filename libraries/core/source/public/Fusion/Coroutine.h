@@ -0,0 +1,308 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#include <Fusion/Assert.h>
+#include <Fusion/DateTime.h>
+#include <Fusion/Network.h>
+#include <Fusion/Result.h>
+#include <Fusion/Thread.h>
+
+#include <coroutine>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace Fusion
+{
+template<typename T = void>
+class Task;
+
+namespace Internal
+{
+//
+// State shared by every Task promise: who to resume once the coroutine
+// finishes, or that nobody will and the frame frees itself.
+//
+class TaskPromiseBase
+{
+public:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<Promise> handle) noexcept;
+
+        void await_resume() const noexcept { }
+    };
+
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    [[noreturn]] void unhandled_exception() const noexcept;
+
+public:
+    std::coroutine_handle<> continuation;
+    bool detached{ false };
+};
+
+template<typename T>
+class TaskPromise final : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value);
+
+public:
+    std::optional<T> value;
+};
+
+template<>
+class TaskPromise<void> final : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept { }
+};
+}  // namespace Internal
+
+//
+// Lazily started coroutine producing a T. Nothing runs until the task is
+// awaited, which resumes the awaiting coroutine on whichever thread the
+// task finishes on, or detached to run on its own.
+//
+// Errors are values here as everywhere else: return a Result<T> rather
+// than throwing, an exception escaping a Task terminates the process.
+//
+template<typename T>
+class [[nodiscard]] Task final
+{
+public:
+    using promise_type = Internal::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+public:
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+public:
+    //
+    //
+    //
+    Task(Task&& task) noexcept;
+
+    //
+    //
+    //
+    Task& operator=(Task&& task) noexcept;
+
+    //
+    // Destroys the coroutine frame unless the task was detached.
+    //
+    ~Task();
+
+public:
+    //
+    // Start the coroutine without awaiting it. It runs on the calling
+    // thread until its first suspension and frees itself once finished.
+    //
+    void Detach();
+
+    //
+    //
+    //
+    bool Done() const;
+
+public:
+    bool await_ready() const noexcept;
+
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> caller) noexcept;
+
+    T await_resume();
+
+private:
+    friend promise_type;
+
+    explicit Task(Handle handle);
+
+private:
+    Handle m_handle;
+};
+
+//
+// co_await Schedule(executor) suspends the coroutine and resumes it as a
+// task posted to 'executor', a ThreadPool or Strand. A pool at its queue
+// capacity may refuse the task, the coroutine then carries on inline,
+// but never drops it once queued. A coroutine posted to a pool that
+// shuts down before running it is never resumed.
+//
+template<typename Executor>
+class ScheduleAwaiter final
+{
+public:
+    explicit ScheduleAwaiter(Executor& executor);
+
+public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept { }
+
+private:
+    Executor& m_executor;
+};
+
+//
+//
+//
+ScheduleAwaiter<ThreadPool> Schedule(ThreadPool& pool);
+
+//
+//
+//
+ScheduleAwaiter<Strand> Schedule(Strand& strand);
+
+//
+// Resumes coroutines waiting for socket readiness or timers.
+//
+// Awaiting Readable()/Writable() adds the interest to the SocketService
+// and suspends until Run() sees the event, after which the interest is
+// removed again. Only one coroutine may wait for each direction of a
+// socket. Sockets watched with SocketService::Watch() resume their
+// waiters with the watch's E_CANCELLED or E_NET_TIMEOUT.
+//
+// Coroutines suspend from any thread, Run() resumes them on the thread
+// calling it. Destroying the reactor resumes whatever still waits on it
+// with E_CANCELLED on the destroying thread, awaiting it again from there
+// fails straight away.
+//
+class Reactor final
+{
+public:
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+public:
+    class ReadyAwaiter final
+    {
+    public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        Result<void> await_resume();
+
+    private:
+        friend class Reactor;
+
+        ReadyAwaiter(Reactor& reactor, Socket sock, SocketOperation op);
+
+    private:
+        Reactor& m_reactor;
+        Socket m_sock{ INVALID_SOCKET };
+        SocketOperation m_op{ SocketOperation::None };
+        std::coroutine_handle<> m_handle;
+        Result<void> m_result{ Success };
+    };
+
+    class SleepAwaiter final
+    {
+    public:
+        bool await_ready() const;
+        bool await_suspend(std::coroutine_handle<> handle);
+        Result<void> await_resume();
+
+    private:
+        friend class Reactor;
+
+        SleepAwaiter(Reactor& reactor, Clock::time_point deadline);
+
+    private:
+        Reactor& m_reactor;
+        Clock::time_point m_deadline;
+        std::coroutine_handle<> m_handle;
+        Result<void> m_result{ Success };
+    };
+
+public:
+    //
+    // The service has to be started and outlive the reactor.
+    //
+    Reactor(SocketService& service);
+
+    //
+    // Resumes the coroutines still waiting with E_CANCELLED.
+    //
+    ~Reactor();
+
+public:
+    //
+    //
+    //
+    ReadyAwaiter Readable(Socket sock);
+
+    //
+    //
+    //
+    ReadyAwaiter Writable(Socket sock);
+
+    //
+    //
+    //
+    SleepAwaiter Sleep(Clock::duration duration);
+
+    //
+    //
+    //
+    SleepAwaiter SleepUntil(Clock::time_point deadline);
+
+    //
+    // Wait up to 'timeout', or for the next timer, for coroutines to become
+    // ready and resume them on this thread. A negative timeout waits until
+    // something is ready. Returns the number of coroutines resumed.
+    //
+    Result<size_t> Run(Clock::duration timeout);
+
+private:
+    struct Waiters
+    {
+        ReadyAwaiter* read{ nullptr };
+        ReadyAwaiter* write{ nullptr };
+    };
+
+private:
+    Result<void> Register(ReadyAwaiter& awaiter);
+    bool Register(SleepAwaiter& awaiter);
+
+private:
+    SocketService& m_service;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<Socket, Waiters> m_waiters;
+    std::multimap<Clock::time_point, SleepAwaiter*> m_timers;
+    bool m_stopped{ false };
+};
+}  // namespace Fusion
+
+#define FUSION_IMPL_COROUTINE 1
+#include <Fusion/Impl/Coroutine.h>
@@ -0,0 +1,349 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#include <Fusion/Assert.h>
+#include <Fusion/DateTime.h>
+#include <Fusion/Macros.h>
+#include <Fusion/Result.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace Fusion
+{
+template<typename T>
+class Future;
+
+template<typename T>
+class Promise;
+
+namespace Internal
+{
+//
+// Continuation registered on a FutureState. 'tag' is whatever was passed
+// to Attach(), so one object can listen to several states.
+//
+template<typename T>
+class FutureCallback
+{
+public:
+    virtual ~FutureCallback() = default;
+
+    virtual void Invoke(size_t tag, Result<T>&& result) = 0;
+};
+
+//
+// The one allocation behind a Future/Promise pair. Holds either the
+// result or the continuation waiting for it, whichever arrives first
+// hands itself to the other.
+//
+template<typename T>
+class FutureState
+{
+public:
+    FutureState() = default;
+    FutureState(const FutureState&) = delete;
+    FutureState& operator=(const FutureState&) = delete;
+    virtual ~FutureState() = default;
+
+public:
+    void Set(Result<T>&& result);
+
+    void Attach(
+        std::shared_ptr<FutureCallback<T>> callback,
+        size_t tag);
+
+    bool IsReady() const;
+
+    void Wait() const;
+
+    bool WaitFor(Clock::duration timeout) const;
+
+    Result<T> Take();
+
+private:
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cond;
+    std::optional<Result<T>> m_result;
+    std::shared_ptr<FutureCallback<T>> m_callback;
+    size_t m_tag{ 0 };
+    bool m_ready{ false };
+};
+
+//
+// Executor for Then() without one: runs the continuation on whichever
+// thread completed the future, or the caller's if it already had.
+//
+class InlineExecutor final
+{
+public:
+    template<typename Fn>
+    void Post(Fn&& fn) const
+    {
+        fn();
+    }
+};
+
+template<typename R>
+struct FutureValue
+{
+    using Type = R;
+};
+
+template<typename U>
+struct FutureValue<Result<U>>
+{
+    using Type = U;
+};
+
+template<typename T, typename Fn>
+struct ContinuationResult
+{
+    using Type = std::invoke_result_t<std::decay_t<Fn>&, T>;
+};
+
+template<typename Fn>
+struct ContinuationResult<void, Fn>
+{
+    using Type = std::invoke_result_t<std::decay_t<Fn>&>;
+};
+
+//
+// Value of the future returned by Then(fn): what 'fn' returns, with a
+// Result<U> flattened to U.
+//
+template<typename T, typename Fn>
+using ThenType =
+    typename FutureValue<typename ContinuationResult<T, Fn>::Type>::Type;
+
+template<typename T>
+using WhenAllType =
+    std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+template<typename T>
+using WhenAnyType =
+    std::conditional_t<std::is_void_v<T>, size_t, std::pair<size_t, T>>;
+
+//
+// Call 'fn' and fold what it returns, nothing, a U or a Result<U>, into
+// a Result<U>.
+//
+template<typename U, typename Fn, typename ...Args>
+Result<U> InvokeResult(Fn& fn, Args&& ...args);
+
+template<typename T, typename U, typename Fn, typename Executor>
+class ThenState;
+
+template<typename T>
+class WhenAllState;
+
+template<typename T>
+class WhenAnyState;
+}  // namespace Internal
+
+//
+// Result of an asynchronous operation that is composed rather than
+// waited on. Then() chains the next step onto the operation's completion
+// without a thread blocking in between, a Failure skips every step after
+// it and surfaces from the end of the chain.
+//
+// Each operation, whether a Promise, a Then() step, WhenAll() or
+// WhenAny(), costs a single shared allocation that holds its result and
+// its continuation together.
+//
+// Futures are single consumer: Get() and Then() take the result, after
+// either the future is no longer Valid().
+//
+template<typename T>
+class [[nodiscard]] Future final
+{
+public:
+    using ValueType = T;
+
+public:
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+public:
+    //
+    //
+    //
+    Future() = default;
+
+    //
+    //
+    //
+    Future(Future&& future) noexcept = default;
+
+    //
+    //
+    //
+    Future& operator=(Future&& future) noexcept = default;
+
+    //
+    //
+    //
+    bool Valid() const;
+
+    //
+    //
+    //
+    bool IsReady() const;
+
+    //
+    //
+    //
+    void Wait() const;
+
+    //
+    // Wait at most 'timeout' for the result, true if it arrived.
+    //
+    bool WaitFor(Clock::duration timeout) const;
+
+    //
+    // Block until the result is available and take it.
+    //
+    Result<T> Get();
+
+    //
+    // Run 'fn' with the value once this future succeeds, on the thread
+    // that completed it. 'fn' may return nothing, a U or a Result<U>, the
+    // returned future yields U. A failure is passed on without calling
+    // 'fn'.
+    //
+    template<typename Fn>
+    auto Then(Fn&& fn) -> Future<Internal::ThenType<T, Fn>>;
+
+    //
+    // Like Then(fn), with 'fn' posted to 'executor' instead. Anything with
+    // a Post(fn) works, a ThreadPool or a ThreadPool::Strand in
+    // particular; the executor has to outlive the chain. If the executor
+    // drops the task without running it the returned future fails with
+    // E_CANCELLED.
+    //
+    template<typename Fn, typename Executor>
+    auto Then(Fn&& fn, Executor& executor) -> Future<Internal::ThenType<T, Fn>>;
+
+private:
+    explicit Future(std::shared_ptr<Internal::FutureState<T>> state);
+
+    void Attach(
+        std::shared_ptr<Internal::FutureCallback<T>> callback,
+        size_t tag);
+
+private:
+    template<typename U>
+    friend class Future;
+
+    template<typename U>
+    friend class Promise;
+
+    template<typename U>
+    friend Future<Internal::WhenAllType<U>> WhenAll(
+        std::vector<Future<U>> futures);
+
+    template<typename U>
+    friend Future<Internal::WhenAnyType<U>> WhenAny(
+        std::vector<Future<U>> futures);
+
+private:
+    std::shared_ptr<Internal::FutureState<T>> m_state;
+};
+
+//
+// Producing side of a Future. A promise destroyed without a result fails
+// its future with E_CANCELLED, so a dropped producer never strands the
+// chain behind it.
+//
+template<typename T>
+class Promise final
+{
+public:
+    Promise(const Promise&) = delete;
+    Promise& operator=(const Promise&) = delete;
+
+public:
+    //
+    //
+    //
+    Promise();
+
+    //
+    //
+    //
+    Promise(Promise&& promise) noexcept;
+
+    //
+    //
+    //
+    Promise& operator=(Promise&& promise) noexcept;
+
+    //
+    //
+    //
+    ~Promise();
+
+    //
+    // The future observing this promise. Can only be taken once.
+    //
+    Future<T> GetFuture();
+
+    //
+    // Complete the future with a value or a Failure. Only the first call
+    // has an effect.
+    //
+    void Set(Result<T> result);
+
+private:
+    std::shared_ptr<Internal::FutureState<T>> m_state;
+    bool m_retrieved{ false };
+    bool m_set{ false };
+};
+
+//
+// A future that already holds 'result'.
+//
+template<typename T>
+Future<T> MakeReadyFuture(Result<T> result);
+
+//
+// Completes with every value, in input order, once all of 'futures' have
+// succeeded, or with the first failure as soon as one fails.
+//
+template<typename T>
+Future<Internal::WhenAllType<T>> WhenAll(std::vector<Future<T>> futures);
+
+//
+// Completes with the index and value, or the failure, of whichever of
+// 'futures' finishes first. An empty list fails with E_INVALID_ARGUMENT.
+//
+template<typename T>
+Future<Internal::WhenAnyType<T>> WhenAny(std::vector<Future<T>> futures);
+}  // namespace Fusion
+
+#define FUSION_IMPL_FUTURE 1
+#include <Fusion/Impl/Future.h>
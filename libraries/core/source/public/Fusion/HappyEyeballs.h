@@ -0,0 +1,80 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#include <Fusion/Context.h>
+#include <Fusion/DateTime.h>
+#include <Fusion/Network.h>
+
+#include <span>
+#include <vector>
+
+namespace Fusion
+{
+//
+// Tuning for ConnectHappyEyeballs(), the defaults follow RFC 8305.
+//
+struct HappyEyeballsParams
+{
+    //
+    // Time an attempt gets to complete before the next address is tried
+    // alongside it. A failed attempt starts the next one right away.
+    //
+    Clock::duration attemptDelay{ std::chrono::milliseconds(250) };
+
+    //
+    // Addresses of the first family tried before alternating with the
+    // other family.
+    //
+    size_t firstFamilyCount{ 1 };
+};
+
+//
+//
+//
+struct HappyEyeballsConnection
+{
+    Socket sock{ INVALID_SOCKET };
+    AddressInfo info;
+};
+
+//
+// Order 'addresses' for connection racing: 'firstFamilyCount' addresses of
+// the family listed first, then alternating between Inet6 and Inet4. The
+// relative order within a family is kept. Entries which are neither Inet4
+// nor Inet6 are dropped.
+//
+std::vector<AddressInfo> SortHappyEyeballs(
+    std::span<const AddressInfo> addresses,
+    size_t firstFamilyCount = 1);
+
+//
+// Connect to whichever of 'addresses' answers first (RFC 8305). Attempts
+// are started in SortHappyEyeballs() order, staggered by the attempt delay,
+// and run concurrently on a private SocketService so a black holed path
+// costs no more than the delay. The first established socket is returned
+// in non-blocking mode and every other attempt is closed. Fails with the
+// error of the last attempt when none succeeds, and with E_NET_TIMEOUT or
+// E_CANCELLED when 'ctx' ends first.
+//
+Result<HappyEyeballsConnection> ConnectHappyEyeballs(
+    Network& network,
+    std::span<const AddressInfo> addresses,
+    const Context& ctx,
+    const HappyEyeballsParams& params = {});
+}  // namespace Fusion
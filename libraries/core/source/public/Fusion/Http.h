@@ -0,0 +1,190 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#pragma once
+
+#include <Fusion/Network.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Fusion
+{
+//
+//
+//
+constexpr const Error E_HTTP_FAILURE{ 130, "E_HTTP_FAILURE" };
+
+//
+//
+//
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+//
+//
+//
+struct HttpRequest
+{
+    std::string method{ "GET" };
+    std::string url;
+    HttpHeaders headers;
+    std::string body;
+
+    //
+    // Total time allowed for the transfer, zero means no limit.
+    //
+    Clock::duration timeout{ 0 };
+};
+
+//
+//
+//
+struct HttpResponse
+{
+    long status{ 0 };
+    HttpHeaders headers;
+    std::string body;
+};
+
+//
+//
+//
+using HttpCompletion = std::function<void(Result<HttpResponse>)>;
+
+//
+// Concurrent HTTP client driven by a SocketService.
+//
+// Transfers run on a libcurl multi handle whose sockets and timers are
+// registered with the service, so any number of requests are serviced from
+// the thread calling Execute(). Connections are pooled by the multi handle and
+// reused across requests to the same host. At most 'maxInFlight' transfers
+// are active at once, further requests wait in submission order.
+//
+// The client is not thread safe, Submit() and Execute() must be called from
+// the thread that owns the SocketService.
+//
+class HttpClient final
+{
+public:
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+public:
+    struct Params
+    {
+        //
+        // Maximum number of transfers active at once.
+        //
+        size_t maxInFlight{ 64 };
+
+        //
+        // Upper bound of open connections, zero leaves it to libcurl.
+        //
+        size_t maxConnections{ 0 };
+
+        //
+        // Upper bound of open connections per host, zero means no limit.
+        //
+        size_t maxHostConnections{ 0 };
+
+        //
+        // Idle connections kept in the pool for reuse.
+        //
+        size_t connectionCacheSize{ 32 };
+    };
+
+public:
+    //
+    //
+    //
+    static Result<std::unique_ptr<HttpClient>> Create(
+        SocketService& service,
+        Params params);
+
+    //
+    //
+    //
+    HttpClient(SocketService& service, Params params);
+
+    //
+    // Outstanding transfers are completed with E_CANCELLED.
+    //
+    ~HttpClient();
+
+    //
+    //
+    //
+    Result<void> Submit(HttpRequest request, HttpCompletion completion);
+
+    //
+    // Wait up to 'timeout' for socket events or the next libcurl timer and
+    // advance all transfers. Completions are invoked from this call.
+    //
+    Result<void> Execute(Clock::duration timeout);
+
+    //
+    // Advance the transfers for events returned by a SocketService shared
+    // with other sockets. Events for unknown sockets are ignored.
+    //
+    Result<void> Process(std::span<const SocketEvent> events);
+
+    //
+    // Time until libcurl needs to be called again, Clock::duration::max()
+    // when no timer is pending.
+    //
+    Clock::duration Timeout() const;
+
+    //
+    //
+    //
+    size_t InFlight() const;
+
+    //
+    //
+    //
+    size_t Pending() const;
+
+private:
+    struct Transfer;
+
+    Result<void> Start();
+    Result<void> Activate(std::unique_ptr<Transfer>& transfer);
+    Result<void> Action(Socket sock, int events);
+    Result<void> Complete();
+
+    void Finish(Transfer& transfer, Result<HttpResponse> result);
+
+    static int OnSocket(void* easy, Socket sock, int what, void* userp, void*);
+    static int OnTimer(void* multi, long timeoutMs, void* userp);
+
+private:
+    SocketService& m_service;
+    Params m_params;
+    void* m_multi{ nullptr };
+
+    std::unordered_map<Socket, SocketOperation> m_sockets;
+    std::unordered_map<void*, std::unique_ptr<Transfer>> m_active;
+    std::deque<std::unique_ptr<Transfer>> m_pending;
+    std::vector<void*> m_handles;
+
+    Clock::time_point m_deadline{ Clock::time_point::max() };
+    bool m_stopping{ false };
+};
+}  // namespace Fusion
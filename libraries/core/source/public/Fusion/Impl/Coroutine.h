@@ -0,0 +1,184 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#if !defined(FUSION_IMPL_COROUTINE)
+#error "Coroutine impl included before main header"
+#endif
+
+#include <type_traits>
+#include <utility>
+
+namespace Fusion
+{
+// -------------------------------------------------------------
+// TaskPromise                                             START
+template<typename Promise>
+std::coroutine_handle<>
+Internal::TaskPromiseBase::FinalAwaiter::await_suspend(
+    std::coroutine_handle<Promise> handle) noexcept
+{
+    TaskPromiseBase& promise = handle.promise();
+
+    if (promise.continuation)
+    {
+        return promise.continuation;
+    }
+    if (promise.detached)
+    {
+        handle.destroy();
+    }
+    return std::noop_coroutine();
+}
+
+template<typename T>
+Task<T> Internal::TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{ Task<T>::Handle::from_promise(*this) };
+}
+
+template<typename T>
+template<typename U>
+void Internal::TaskPromise<T>::return_value(U&& result)
+{
+    value.emplace(std::forward<U>(result));
+}
+
+inline Task<void> Internal::TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{ Task<void>::Handle::from_promise(*this) };
+}
+// TaskPromise                                               END
+// -------------------------------------------------------------
+// Task                                                    START
+template<typename T>
+Task<T>::Task(Handle handle)
+    : m_handle(handle)
+{ }
+
+template<typename T>
+Task<T>::Task(Task&& task) noexcept
+    : m_handle(std::exchange(task.m_handle, {}))
+{ }
+
+template<typename T>
+Task<T>& Task<T>::operator=(Task&& task) noexcept
+{
+    if (this != &task)
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+        m_handle = std::exchange(task.m_handle, {});
+    }
+    return *this;
+}
+
+template<typename T>
+Task<T>::~Task()
+{
+    if (m_handle)
+    {
+        m_handle.destroy();
+    }
+}
+
+template<typename T>
+void Task<T>::Detach()
+{
+    FUSION_ASSERT(m_handle);
+
+    Handle handle = std::exchange(m_handle, {});
+
+    handle.promise().detached = true;
+    handle.resume();
+}
+
+template<typename T>
+bool Task<T>::Done() const
+{
+    return !m_handle || m_handle.done();
+}
+
+template<typename T>
+bool Task<T>::await_ready() const noexcept
+{
+    return !m_handle || m_handle.done();
+}
+
+template<typename T>
+std::coroutine_handle<> Task<T>::await_suspend(
+    std::coroutine_handle<> caller) noexcept
+{
+    m_handle.promise().continuation = caller;
+    return m_handle;
+}
+
+template<typename T>
+T Task<T>::await_resume()
+{
+    FUSION_ASSERT(m_handle && m_handle.done());
+
+    if constexpr (!std::is_void_v<T>)
+    {
+        return std::move(*m_handle.promise().value);
+    }
+}
+// Task                                                      END
+// -------------------------------------------------------------
+// ScheduleAwaiter                                         START
+template<typename Executor>
+ScheduleAwaiter<Executor>::ScheduleAwaiter(Executor& executor)
+    : m_executor(executor)
+{ }
+
+template<typename Executor>
+bool ScheduleAwaiter<Executor>::await_suspend(
+    std::coroutine_handle<> handle)
+{
+    if constexpr (std::is_same_v<Executor, ThreadPool>)
+    {
+        const uint64_t id = m_executor.SubmitTask([handle](Failure* error) {
+            if (!error)
+            {
+                handle.resume();
+            }
+        }, ThreadPool::Priority::Default, ThreadPool::Admission::Keep);
+
+        return id != UINT64_MAX;
+    }
+    else
+    {
+        m_executor.Post([handle]() { handle.resume(); });
+        return true;
+    }
+}
+
+inline ScheduleAwaiter<ThreadPool> Schedule(ThreadPool& pool)
+{
+    return ScheduleAwaiter<ThreadPool>{ pool };
+}
+
+inline ScheduleAwaiter<Strand> Schedule(Strand& strand)
+{
+    return ScheduleAwaiter<Strand>{ strand };
+}
+// ScheduleAwaiter                                           END
+// -------------------------------------------------------------
+}  // namespace Fusion
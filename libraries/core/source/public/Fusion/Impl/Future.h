@@ -0,0 +1,505 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#if !defined(FUSION_IMPL_FUTURE)
+#error "Future impl included before main header"
+#endif
+
+namespace Fusion
+{
+// -------------------------------------------------------------
+// FutureState                                             START
+template<typename T>
+void Internal::FutureState<T>::Set(Result<T>&& result)
+{
+    std::shared_ptr<FutureCallback<T>> callback;
+    {
+        std::lock_guard lock(m_mutex);
+
+        FUSION_ASSERT(!m_ready);
+        m_ready = true;
+
+        if (!m_callback)
+        {
+            m_result.emplace(std::move(result));
+
+            // Under the lock, a waiter woken early may otherwise release
+            // the state while this is still notifying it.
+            m_cond.notify_all();
+            return;
+        }
+        callback = std::move(m_callback);
+    }
+    callback->Invoke(m_tag, std::move(result));
+}
+
+template<typename T>
+void Internal::FutureState<T>::Attach(
+    std::shared_ptr<FutureCallback<T>> callback,
+    size_t tag)
+{
+    {
+        std::lock_guard lock(m_mutex);
+
+        FUSION_ASSERT(!m_callback);
+
+        if (!m_ready)
+        {
+            m_callback = std::move(callback);
+            m_tag = tag;
+            return;
+        }
+    }
+
+    // Ready results are only ever touched by their single consumer.
+    callback->Invoke(tag, std::move(*m_result));
+}
+
+template<typename T>
+bool Internal::FutureState<T>::IsReady() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_ready;
+}
+
+template<typename T>
+void Internal::FutureState<T>::Wait() const
+{
+    std::unique_lock lock(m_mutex);
+    m_cond.wait(lock, [this] { return m_ready; });
+}
+
+template<typename T>
+bool Internal::FutureState<T>::WaitFor(Clock::duration timeout) const
+{
+    std::unique_lock lock(m_mutex);
+    return m_cond.wait_for(lock, timeout, [this] { return m_ready; });
+}
+
+template<typename T>
+Result<T> Internal::FutureState<T>::Take()
+{
+    Wait();
+    return std::move(*m_result);
+}
+
+template<typename U, typename Fn, typename ...Args>
+Result<U> Internal::InvokeResult(Fn& fn, Args&& ...args)
+{
+    using ReturnType = std::invoke_result_t<Fn&, Args...>;
+
+    if constexpr (std::is_void_v<ReturnType>)
+    {
+        fn(std::forward<Args>(args)...);
+        return Success;
+    }
+    else
+    {
+        return fn(std::forward<Args>(args)...);
+    }
+}
+// FutureState                                               END
+// -------------------------------------------------------------
+// ThenState                                               START
+namespace Internal
+{
+//
+// A Then() step: the callback on the upstream state and the state of the
+// downstream future in one object. The input is parked here while the
+// step is queued so the posted task only carries a pointer and fits the
+// executor's inline storage.
+//
+template<typename T, typename U, typename Fn, typename Executor>
+class ThenState final
+    : public FutureState<U>
+    , public FutureCallback<T>
+    , public std::enable_shared_from_this<ThenState<T, U, Fn, Executor>>
+{
+public:
+    template<typename F>
+    ThenState(F&& fn, Executor& executor)
+        : m_fn(std::forward<F>(fn))
+        , m_executor(executor)
+    { }
+
+    void Invoke(size_t tag, Result<T>&& result) override
+    {
+        FUSION_UNUSED(tag);
+
+        m_input.emplace(std::move(result));
+        m_executor.Post(Runner(this->shared_from_this()));
+    }
+
+private:
+    //
+    // Runs the step once, or fails it if the executor destroys the task
+    // without running it.
+    //
+    class Runner final
+    {
+    public:
+        explicit Runner(std::shared_ptr<ThenState> state)
+            : m_state(std::move(state))
+        { }
+
+        Runner(Runner&& runner) noexcept
+            : m_state(std::move(runner.m_state))
+        { }
+
+        Runner(const Runner&) = delete;
+        Runner& operator=(const Runner&) = delete;
+        Runner& operator=(Runner&&) = delete;
+
+        ~Runner()
+        {
+            if (m_state)
+            {
+                m_state->Set(Failure(E_CANCELLED)
+                    .WithContext("continuation dropped by its executor"));
+            }
+        }
+
+        void operator()()
+        {
+            std::exchange(m_state, nullptr)->Run();
+        }
+
+    private:
+        std::shared_ptr<ThenState> m_state;
+    };
+
+    void Run()
+    {
+        Result<T> input = std::move(*m_input);
+        m_input.reset();
+
+        if (!input)
+        {
+            this->Set(std::move(input.Error()));
+        }
+        else if constexpr (std::is_void_v<T>)
+        {
+            this->Set(InvokeResult<U>(m_fn));
+        }
+        else
+        {
+            this->Set(InvokeResult<U>(m_fn, std::move(*input)));
+        }
+    }
+
+private:
+    Fn m_fn;
+    Executor& m_executor;
+    std::optional<Result<T>> m_input;
+};
+
+//
+// WhenAll(): listens to every input, tagged with its index.
+//
+template<typename T>
+class WhenAllState final
+    : public FutureState<WhenAllType<T>>
+    , public FutureCallback<T>
+{
+public:
+    explicit WhenAllState(size_t count)
+        : m_values(std::is_void_v<T> ? 0 : count)
+        , m_remaining(count)
+    { }
+
+    void Invoke(size_t tag, Result<T>&& result) override
+    {
+        if (!result)
+        {
+            if (!m_done.exchange(true, std::memory_order_acq_rel))
+            {
+                this->Set(std::move(result.Error()));
+            }
+            return;
+        }
+
+        if constexpr (!std::is_void_v<T>)
+        {
+            m_values[tag].emplace(std::move(*result));
+        }
+        else
+        {
+            FUSION_UNUSED(tag);
+        }
+
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1
+            || m_done.exchange(true, std::memory_order_acq_rel))
+        {
+            return;
+        }
+
+        if constexpr (std::is_void_v<T>)
+        {
+            this->Set(Result<void>(Success));
+        }
+        else
+        {
+            std::vector<T> values;
+            values.reserve(m_values.size());
+
+            for (auto& value : m_values)
+            {
+                values.push_back(std::move(*value));
+            }
+            this->Set(std::move(values));
+        }
+    }
+
+private:
+    using Slot = std::conditional_t<
+        std::is_void_v<T>, std::monostate, std::optional<T>>;
+
+    std::vector<Slot> m_values;
+    std::atomic<size_t> m_remaining;
+    std::atomic<bool> m_done{ false };
+};
+
+//
+// WhenAny(): the first input to complete wins, the rest are ignored.
+//
+template<typename T>
+class WhenAnyState final
+    : public FutureState<WhenAnyType<T>>
+    , public FutureCallback<T>
+{
+public:
+    void Invoke(size_t tag, Result<T>&& result) override
+    {
+        if (m_done.exchange(true, std::memory_order_acq_rel))
+        {
+            return;
+        }
+
+        if (!result)
+        {
+            this->Set(std::move(result.Error()));
+        }
+        else if constexpr (std::is_void_v<T>)
+        {
+            this->Set(tag);
+        }
+        else
+        {
+            this->Set(WhenAnyType<T>(tag, std::move(*result)));
+        }
+    }
+
+private:
+    std::atomic<bool> m_done{ false };
+};
+}  // namespace Internal
+// ThenState                                                 END
+// -------------------------------------------------------------
+// Future                                                  START
+template<typename T>
+Future<T>::Future(std::shared_ptr<Internal::FutureState<T>> state)
+    : m_state(std::move(state))
+{ }
+
+template<typename T>
+bool Future<T>::Valid() const
+{
+    return m_state != nullptr;
+}
+
+template<typename T>
+bool Future<T>::IsReady() const
+{
+    FUSION_ASSERT(m_state);
+    return m_state->IsReady();
+}
+
+template<typename T>
+void Future<T>::Wait() const
+{
+    FUSION_ASSERT(m_state);
+    m_state->Wait();
+}
+
+template<typename T>
+bool Future<T>::WaitFor(Clock::duration timeout) const
+{
+    FUSION_ASSERT(m_state);
+    return m_state->WaitFor(timeout);
+}
+
+template<typename T>
+Result<T> Future<T>::Get()
+{
+    FUSION_ASSERT(m_state);
+    return std::exchange(m_state, nullptr)->Take();
+}
+
+template<typename T>
+template<typename Fn>
+auto Future<T>::Then(Fn&& fn) -> Future<Internal::ThenType<T, Fn>>
+{
+    static Internal::InlineExecutor executor;
+
+    return Then(std::forward<Fn>(fn), executor);
+}
+
+template<typename T>
+template<typename Fn, typename Executor>
+auto Future<T>::Then(
+    Fn&& fn,
+    Executor& executor) -> Future<Internal::ThenType<T, Fn>>
+{
+    using U = Internal::ThenType<T, Fn>;
+    using State = Internal::ThenState<T, U, std::decay_t<Fn>, Executor>;
+
+    auto state = std::make_shared<State>(std::forward<Fn>(fn), executor);
+
+    Attach(state, 0);
+    return Future<U>(std::move(state));
+}
+
+template<typename T>
+void Future<T>::Attach(
+    std::shared_ptr<Internal::FutureCallback<T>> callback,
+    size_t tag)
+{
+    FUSION_ASSERT(m_state);
+    std::exchange(m_state, nullptr)->Attach(std::move(callback), tag);
+}
+// Future                                                    END
+// -------------------------------------------------------------
+// Promise                                                 START
+template<typename T>
+Promise<T>::Promise()
+    : m_state(std::make_shared<Internal::FutureState<T>>())
+{ }
+
+template<typename T>
+Promise<T>::Promise(Promise&& promise) noexcept
+    : m_state(std::move(promise.m_state))
+    , m_retrieved(promise.m_retrieved)
+    , m_set(promise.m_set)
+{ }
+
+template<typename T>
+Promise<T>& Promise<T>::operator=(Promise&& promise) noexcept
+{
+    if (this != &promise)
+    {
+        Promise discard(std::move(*this));
+
+        m_state = std::move(promise.m_state);
+        m_retrieved = promise.m_retrieved;
+        m_set = promise.m_set;
+    }
+    return *this;
+}
+
+template<typename T>
+Promise<T>::~Promise()
+{
+    if (m_state && !m_set)
+    {
+        m_state->Set(Failure(E_CANCELLED)
+            .WithContext("promise destroyed without a result"));
+    }
+}
+
+template<typename T>
+Future<T> Promise<T>::GetFuture()
+{
+    FUSION_ASSERT(m_state);
+    FUSION_ASSERT(!m_retrieved);
+
+    m_retrieved = true;
+    return Future<T>(m_state);
+}
+
+template<typename T>
+void Promise<T>::Set(Result<T> result)
+{
+    FUSION_ASSERT(m_state);
+
+    if (!std::exchange(m_set, true))
+    {
+        m_state->Set(std::move(result));
+    }
+}
+
+template<typename T>
+Future<T> MakeReadyFuture(Result<T> result)
+{
+    Promise<T> promise;
+    auto future = promise.GetFuture();
+
+    promise.Set(std::move(result));
+    return future;
+}
+// Promise                                                   END
+// -------------------------------------------------------------
+// WhenAll                                                 START
+template<typename T>
+Future<Internal::WhenAllType<T>> WhenAll(std::vector<Future<T>> futures)
+{
+    using Type = Internal::WhenAllType<T>;
+
+    if (futures.empty())
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            return MakeReadyFuture<void>(Success);
+        }
+        else
+        {
+            return MakeReadyFuture<Type>(Type{});
+        }
+    }
+
+    auto state = std::make_shared<Internal::WhenAllState<T>>(futures.size());
+
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        futures[i].Attach(state, i);
+    }
+    return Future<Type>(std::move(state));
+}
+
+template<typename T>
+Future<Internal::WhenAnyType<T>> WhenAny(std::vector<Future<T>> futures)
+{
+    using Type = Internal::WhenAnyType<T>;
+
+    if (futures.empty())
+    {
+        return MakeReadyFuture<Type>(Failure(E_INVALID_ARGUMENT)
+            .WithContext("WhenAny() of no futures"));
+    }
+
+    auto state = std::make_shared<Internal::WhenAnyState<T>>();
+
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        futures[i].Attach(state, i);
+    }
+    return Future<Type>(std::move(state));
+}
+// WhenAll                                                   END
+// -------------------------------------------------------------
+}  // namespace Fusion
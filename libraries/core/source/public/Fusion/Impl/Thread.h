@@ -20,6 +20,10 @@
 #error "Thread impl included before main header"
 #endif
 
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 namespace Fusion
@@ -209,8 +213,71 @@ std::future<Result<T>> ThreadPool::Future<T>::Release()
 // ThreadPool::Result                                        END
 // -------------------------------------------------------------
 // ThreadPool::Strand                                      START
+template<typename Fn>
+void ThreadPool::Strand::Post(Fn&& fn)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    Push(m_pool.CreateTask([
+            fn = std::forward<Fn>(fn)
+        ](Failure* error) mutable
+        {
+            if (!error)
+            {
+                fn();
+            }
+        }));
+}
+
+template<typename Fn>
+void ThreadPool::Strand::Dispatch(Fn&& fn)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    if (IsRunningInThisThread())
+    {
+        fn();
+        return;
+    }
+    Post(std::forward<Fn>(fn));
+}
 // ThreadPool::Strand                                        END
 // -------------------------------------------------------------
+// ThreadPool::TaskGroup                                   START
+template<typename Fn>
+void ThreadPool::TaskGroup::Spawn(
+    Fn&& fn,
+    Priority priority)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    Task* child = m_pool.CreateTask([
+            state = m_state,
+            fn = std::forward<Fn>(fn)
+        ](Failure* error) mutable
+        {
+            using ReturnType = std::invoke_result_t<Fn>;
+
+            if (error || IsCancelled(*state))
+            {
+                Finish(*state, error);
+            }
+            else if constexpr (std::is_void_v<ReturnType>)
+            {
+                fn();
+                Finish(*state, nullptr);
+            }
+            else
+            {
+                auto result = fn();
+                Finish(*state, result ? nullptr : &result.Error());
+            }
+        });
+
+    Push(child, priority);
+}
+// ThreadPool::TaskGroup                                     END
+// -------------------------------------------------------------
 // ThreadPool                                              START
 template<typename Fn>
 auto ThreadPool::Await(
@@ -222,62 +289,415 @@ auto ThreadPool::Await(
 
     using ReturnType = std::invoke_result_t<Fn>;
     using Type = Unwrapped<ReturnType>;
-    using PromiseType = std::promise<Result<Type>>;
 
-    auto promise = std::make_shared<PromiseType>();
-    auto future = promise->get_future();
+    std::promise<Result<Type>> promise;
+    auto future = promise.get_future();
 
-    CompletionHandler completer = [
+    uint64_t id = SubmitTask([
+            fn = std::forward<Fn>(fn),
             promise = std::move(promise)
-        ](void* result, Failure* error)
+        ](Failure* error) mutable
         {
             if (error)
             {
-                promise->set_value(*error);
+                promise.set_value(*error);
             }
             else if constexpr (std::is_void_v<ReturnType>)
             {
-                promise->set_value(Failure(E_SUCCESS));
+                fn();
+                promise.set_value(Success);
             }
             else
             {
-                promise->set_value(
-                    std::move(
-                        *static_cast<ReturnType*>(result)));
+                promise.set_value(fn());
             }
-        };
+        }, priority);
 
-    uint64_t id = SubmitTask(completer, [
+    return { *this, id, std::move(future) };
+}
+
+template<typename Fn>
+auto ThreadPool::Async(
+    Fn&& fn,
+    Priority priority)
+    -> Fusion::Future<
+        typename Internal::FutureValue<std::invoke_result_t<Fn>>::Type>
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    using Type =
+        typename Internal::FutureValue<std::invoke_result_t<Fn>>::Type;
+
+    Promise<Type> promise;
+    auto future = promise.GetFuture();
+
+    SubmitTask([
+            fn = std::forward<Fn>(fn),
+            promise = std::move(promise)
+        ](Failure* error) mutable
+        {
+            if (error)
+            {
+                promise.Set(*error);
+                return;
+            }
+            promise.Set(Internal::InvokeResult<Type>(fn));
+        }, priority);
+
+    return future;
+}
+
+template<typename Fn>
+auto ThreadPool::Dispatch(
+    Fn&& fn,
+    Priority priority)
+    ->std::future<
+        Fusion::Result<
+            Unwrapped<std::invoke_result_t<Fn>>>>
+{
+    return Await(std::forward<Fn>(fn), priority).Release();
+}
+
+template<typename Fn>
+uint64_t ThreadPool::Post(
+    Fn&& fn,
+    Priority priority)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    return SubmitTask([
             fn = std::forward<Fn>(fn)
-        ](CompletionHandler& completer) mutable
+        ](Failure* error) mutable
         {
-            if constexpr (std::is_void_v<ReturnType>)
+            if (!error)
             {
-                Failure reason(E_SUCCESS);
+                fn();
+            }
+        }, priority);
+}
 
+template<typename Fn>
+uint64_t ThreadPool::Post(
+    const char* name,
+    Fn&& fn,
+    Priority priority)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    Task* task = CreateTask([
+            fn = std::forward<Fn>(fn)
+        ](Failure* error) mutable
+        {
+            if (!error)
+            {
                 fn();
-                completer(nullptr, &reason);
             }
-            else
+        });
+
+    SetTaskName(task, name);
+    return EnqueueTask(task, priority);
+}
+
+template<typename Fn>
+ThreadPool::Task* ThreadPool::CreateTask(Fn&& fn)
+{
+    using Callable = std::decay_t<Fn>;
+
+    Task* task = AllocateTask();
+
+    if constexpr (sizeof(Callable) <= TASK_STORAGE
+        && alignof(Callable) <= alignof(std::max_align_t))
+    {
+        void* storage = InitTask(task, [](void* storage, Failure* error) {
+            Callable& callable = *static_cast<Callable*>(storage);
+
+            callable(error);
+            callable.~Callable();
+        });
+
+        new (storage) Callable(std::forward<Fn>(fn));
+    }
+    else
+    {
+        void* storage = InitTask(task, [](void* storage, Failure* error) {
+            std::unique_ptr<Callable> callable(
+                *static_cast<Callable**>(storage));
+
+            (*callable)(error);
+        });
+
+        new (storage) Callable*(new Callable(std::forward<Fn>(fn)));
+    }
+    return task;
+}
+
+template<typename Fn>
+uint64_t ThreadPool::SubmitTask(
+    Fn&& fn,
+    Priority priority,
+    Admission admission)
+{
+    return EnqueueTask(CreateTask(std::forward<Fn>(fn)), priority, admission);
+}
+
+template<typename Fn>
+uint64_t ThreadPool::SubmitTasks(
+    size_t count,
+    const Fn& fn,
+    Priority priority,
+    Admission admission)
+{
+    TaskList list;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Task* task = CreateTask([callable = fn, i](Failure* error) mutable {
+            callable(error, i);
+        });
+        AppendTask(list, task);
+    }
+    return EnqueueTasks(list, priority, admission);
+}
+
+template<typename Fn>
+uint64_t ThreadPool::DispatchAfter(
+    Clock::duration delay,
+    Fn&& fn,
+    Priority priority)
+{
+    return DispatchAt(Clock::now() + delay, std::forward<Fn>(fn), priority);
+}
+
+template<typename Fn>
+uint64_t ThreadPool::DispatchAt(
+    Clock::time_point deadline,
+    Fn&& fn,
+    Priority priority)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    Task* task = CreateTask([
+            fn = std::forward<Fn>(fn)
+        ](Failure* error) mutable
+        {
+            if (!error)
+            {
+                fn();
+            }
+        });
+
+    const uint64_t id = ReserveTaskId();
+    ArmTimer(task, id, deadline, priority, false);
+
+    return id;
+}
+
+template<typename Fn>
+uint64_t ThreadPool::DispatchEvery(
+    Clock::duration period,
+    Fn&& fn,
+    Priority priority)
+{
+    static_assert(std::is_invocable_v<Fn>, "");
+
+    // Every run moves the callable into a fresh slot for the next one, so
+    // it is never copied and the id stays the same for Cancel().
+    struct Periodic
+    {
+        ThreadPool* pool;
+        std::decay_t<Fn> fn;
+        uint64_t id;
+        Clock::time_point deadline;
+        Clock::duration period;
+        Priority priority;
+
+        void operator()(Failure* error)
+        {
+            if (error)
             {
-                ReturnType result = fn();
+                pool->ForgetTimer(id);
+                return;
+            }
+
+            fn();
+
+            const Clock::time_point now = Clock::now();
 
-                completer(&result, nullptr);
+            deadline += period;
+            if (deadline <= now)
+            {
+                deadline += period * ((now - deadline) / period + 1);
             }
-        }, priority);
 
-    return { *this, id, std::move(future) };
+            ThreadPool* owner = pool;
+            const uint64_t timer = id;
+            const Clock::time_point next = deadline;
+            const Priority level = priority;
+
+            owner->ArmTimer(
+                owner->CreateTask(std::move(*this)),
+                timer,
+                next,
+                level,
+                true);
+        }
+    };
+
+    period = std::max(period, Clock::duration(1));
+
+    const uint64_t id = ReserveTaskId();
+    const Clock::time_point deadline = Clock::now() + period;
+
+    Task* task = CreateTask(Periodic{
+        .pool = this,
+        .fn = std::forward<Fn>(fn),
+        .id = id,
+        .deadline = deadline,
+        .period = period,
+        .priority = priority,
+    });
+
+    ArmTimer(task, id, deadline, priority, true);
+    return id;
 }
 
 template<typename Fn>
-auto ThreadPool::Dispatch(
+uint64_t ThreadPool::SubmitBatch(
+    size_t count,
     Fn&& fn,
     Priority priority)
-    ->std::future<
-        Fusion::Result<
-            Unwrapped<std::invoke_result_t<Fn>>>>
 {
-    return Post(std::forward<Fn>(fn), priority).Release();
+    static_assert(std::is_invocable_v<Fn, size_t>, "");
+
+    return SubmitTasks(count, [
+            fn = std::forward<Fn>(fn)
+        ](Failure* error, size_t index) mutable
+        {
+            if (!error)
+            {
+                fn(index);
+            }
+        }, priority);
+}
+
+template<typename Fn>
+void ThreadPool::ParallelFor(
+    size_t begin,
+    size_t end,
+    size_t grain,
+    Fn&& fn)
+{
+    static_assert(std::is_invocable_v<Fn, size_t>, "");
+
+    if (begin >= end)
+    {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+
+    auto body = [&](size_t chunk) {
+        const size_t first = begin + chunk * grain;
+        const size_t last = first + std::min(grain, end - first);
+
+        for (size_t i = first; i < last; ++i)
+        {
+            fn(i);
+        }
+    };
+
+    RunChunks(
+        (end - begin + grain - 1) / grain,
+        [](void* context, size_t chunk) {
+            (*static_cast<decltype(body)*>(context))(chunk);
+        },
+        &body);
+}
+
+template<typename T, typename Fn, typename Combine>
+T ThreadPool::ParallelReduce(
+    size_t begin,
+    size_t end,
+    size_t grain,
+    T identity,
+    Fn&& fn,
+    Combine&& combine)
+{
+    static_assert(std::is_invocable_v<Fn, size_t>, "");
+
+    if (begin >= end)
+    {
+        return identity;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+
+    const size_t chunks = (end - begin + grain - 1) / grain;
+    std::vector<T> partial(chunks, identity);
+
+    ParallelFor(0, chunks, 1, [&](size_t chunk) {
+        const size_t first = begin + chunk * grain;
+        const size_t last = first + std::min(grain, end - first);
+
+        T value = identity;
+        for (size_t i = first; i < last; ++i)
+        {
+            value = combine(std::move(value), fn(i));
+        }
+        partial[chunk] = std::move(value);
+    });
+
+    T result = std::move(identity);
+    for (T& value : partial)
+    {
+        result = combine(std::move(result), std::move(value));
+    }
+    return result;
+}
+
+template<typename T, typename Compare>
+void ThreadPool::ParallelSort(
+    std::span<T> data,
+    Compare comp)
+{
+    const size_t size = data.size();
+    const size_t slices = std::min(
+        GetThreadCount() + 1,
+        (size + SORT_GRAIN - 1) / SORT_GRAIN);
+
+    if (slices <= 1)
+    {
+        std::sort(data.begin(), data.end(), comp);
+        return;
+    }
+
+    auto bound = [&](size_t slice) {
+        return data.begin() + (size * slice / slices);
+    };
+
+    ParallelFor(0, slices, 1, [&](size_t slice) {
+        std::sort(bound(slice), bound(slice + 1), comp);
+    });
+
+    for (size_t width = 1; width < slices; width *= 2)
+    {
+        const size_t pairs = (slices + 2 * width - 1) / (2 * width);
+
+        ParallelFor(0, pairs, 1, [&](size_t pair) {
+            const size_t first = pair * 2 * width;
+            const size_t middle = std::min(first + width, slices);
+            const size_t last = std::min(first + 2 * width, slices);
+
+            if (middle < last)
+            {
+                std::inplace_merge(
+                    bound(first),
+                    bound(middle),
+                    bound(last),
+                    comp);
+            }
+        });
+    }
 }
 // ThreadPool                                                END
 // -------------------------------------------------------------
@@ -18,6 +18,7 @@
 
 #include <Fusion/Fwd/Network.h>
 
+#include <Fusion/Context.h>
 #include <Fusion/DateTime.h>
 #include <Fusion/Enum.h>
 #include <Fusion/Result.h>
@@ -25,9 +26,12 @@
 #include <array>
 #include <iosfwd>
 #include <functional>
+#include <memory>
 #include <span>
+#include <string>
 #include <string_view>
 #include <variant>
+#include <vector>
 
 namespace Fusion
 {
@@ -287,6 +291,8 @@ std::ostream& operator<<(
 enum class SocketOpt : uint8_t
 {
     Broadcast,
+    BusyPoll,
+    BusyPollBudget,
     Debug,
     DontRoute,
     KeepAlive,
@@ -296,6 +302,7 @@ enum class SocketOpt : uint8_t
     MulticastTTL,
     NoDelay,
     OobInline,
+    PreferBusyPoll,
     RecvBuf,
     RecvLowMark,
     RecvTimeout,
@@ -305,11 +312,19 @@ enum class SocketOpt : uint8_t
     SendLowMark,
     SendTimeout,
     SocketError,
+    TcpCork,
+    TcpDeferAccept,
+    TcpFastOpen,
+    TcpFastOpenConnect,
     TcpKeepAlive,
     TcpKeepCount,
     TcpKeepIdle,
     TcpKeepInterval,
+    TcpNotSentLowMark,
+    TcpQuickAck,
     TimeToLive,
+    UdpGro,
+    UdpSegment,
 
     _Count
 };
@@ -1070,6 +1085,17 @@ namespace SocketOptions
     //
     using Broadcast = SocketOption<SocketOpt::Broadcast, bool>;
 
+    //
+    // Busy poll the device queue for up to this many microseconds on
+    // blocking reads (SO_BUSY_POLL, Linux only).
+    //
+    using BusyPoll = SocketOption<SocketOpt::BusyPoll, int32_t>;
+
+    //
+    // Packets processed per busy poll iteration (SO_BUSY_POLL_BUDGET).
+    //
+    using BusyPollBudget = SocketOption<SocketOpt::BusyPollBudget, int32_t>;
+
     //
     //
     //
@@ -1108,7 +1134,12 @@ namespace SocketOptions
     //
     //
     //
-    using NoDelay = SocketOption<SocketOpt::NoDelay, Clock::duration>;
+    using NoDelay = SocketOption<SocketOpt::NoDelay, bool>;
+
+    //
+    //
+    //
+    using PreferBusyPoll = SocketOption<SocketOpt::PreferBusyPoll, bool>;
 
     //
     //
@@ -1155,6 +1186,31 @@ namespace SocketOptions
     //
     using SocketError = SocketOption<SocketOpt::SocketError, int32_t>;
 
+    //
+    // Hold back partial segments until uncorked, so a response written in
+    // several calls leaves in as few packets as possible (TCP_CORK, Linux
+    // only).
+    //
+    using TcpCork = SocketOption<SocketOpt::TcpCork, bool>;
+
+    //
+    // Seconds a listener waits for the first data before waking Accept()
+    // (TCP_DEFER_ACCEPT, Linux only).
+    //
+    using TcpDeferAccept = SocketOption<SocketOpt::TcpDeferAccept, int32_t>;
+
+    //
+    // Length of the pending Fast Open queue on a listener, enables
+    // accepting data in the SYN (TCP_FASTOPEN, Linux only).
+    //
+    using TcpFastOpen = SocketOption<SocketOpt::TcpFastOpen, int32_t>;
+
+    //
+    // Defer the SYN of Connect() until the first Send() so its data can
+    // ride along (TCP_FASTOPEN_CONNECT, Linux only).
+    //
+    using TcpFastOpenConnect = SocketOption<SocketOpt::TcpFastOpenConnect, bool>;
+
     //
     //
     //
@@ -1175,10 +1231,36 @@ namespace SocketOptions
     //
     using TcpKeepInterval = SocketOption<SocketOpt::TcpKeepInterval, Clock::duration>;
 
+    //
+    // Unsent bytes above which the socket stops reporting writable, keeps
+    // data queued in the application where it can still be reprioritized
+    // (TCP_NOTSENT_LOWAT, Linux only).
+    //
+    using TcpNotSentLowMark = SocketOption<SocketOpt::TcpNotSentLowMark, int32_t>;
+
+    //
+    // Acknowledge immediately instead of delaying the ACK. The kernel
+    // clears this again on its own, set it after every receive (TCP_QUICKACK,
+    // Linux only).
+    //
+    using TcpQuickAck = SocketOption<SocketOpt::TcpQuickAck, bool>;
+
     //
     //
     //
     using TimeToLive = SocketOption<SocketOpt::TimeToLive, int32_t>;
+
+    //
+    // Let the kernel coalesce datagrams from the same peer into a single
+    // RecvFrom() (UDP_GRO, Linux only).
+    //
+    using UdpGro = SocketOption<SocketOpt::UdpGro, bool>;
+
+    //
+    // Default segment size applied to every send on the socket (UDP_SEGMENT,
+    // Linux only).
+    //
+    using UdpSegment = SocketOption<SocketOpt::UdpSegment, int32_t>;
 };
 
 //
@@ -1228,6 +1310,26 @@ public:
         SocketAddress address;
         void* buffer = nullptr;
         size_t size = 0;
+
+        //
+        // Size of each datagram when the kernel coalesced several datagrams
+        // from the same peer into 'buffer' (UdpGro), zero otherwise. The last
+        // segment may be shorter.
+        //
+        size_t segmentSize = 0;
+    };
+
+    //
+    //
+    //
+    struct RecvDescriptorsData
+    {
+        size_t received = 0;
+
+        //
+        // Number of descriptors written to the output span.
+        //
+        size_t count = 0;
     };
 
 public:
@@ -1257,6 +1359,27 @@ public:
     //
     Result<Socket> CreateSocket(SocketConfig config) const;
 
+    //
+    // Create a pair of connected sockets, only AddressFamily::Unix is
+    // supported.
+    //
+    virtual Result<std::array<Socket, 2>> CreateSocketPair(
+        AddressFamily family,
+        SocketType type) const;
+
+    //
+    // The time the network runs on, Clock::now() unless the network
+    // simulates time.
+    //
+    virtual Clock::time_point Now() const;
+
+    //
+    // The SocketService for a network whose sockets the system cannot
+    // poll, SocketService::Create() starts it in place of a system backend.
+    // Returns nullptr by default.
+    //
+    virtual std::unique_ptr<SocketService> CreateSocketService();
+
     //
     //
     //
@@ -1264,6 +1387,30 @@ public:
         Socket client,
         const SocketAddress& address) const = 0;
 
+    //
+    // Connect bounded by 'ctx'. The socket is switched to non-blocking mode
+    // and left that way. Fails with E_NET_TIMEOUT once the deadline passes
+    // and E_CANCELLED when the context is cancelled, which shuts the socket
+    // down to wake the waiting thread.
+    //
+    Result<void> Connect(
+        Socket client,
+        const SocketAddress& address,
+        const Context& ctx) const;
+
+    //
+    // Connect and send the first 'size' bytes of the request with the SYN
+    // using TCP Fast Open where supported. Without a Fast Open cookie for
+    // the server the data follows the handshake as usual. Other platforms
+    // fall back to Connect() followed by Send(). Returns the number of bytes
+    // sent.
+    //
+    virtual Result<size_t> ConnectWithData(
+        Socket client,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t size) const;
+
     //
     //
     //
@@ -1344,6 +1491,16 @@ public:
         void* buffer,
         size_t size) const;
 
+    //
+    // Wait until the socket is readable or 'ctx' ends, then receive. Fails
+    // as Connect() with a Context does.
+    //
+    Result<size_t> Recv(
+        Socket sock,
+        void* buffer,
+        size_t size,
+        const Context& ctx) const;
+
     //
     //
     //
@@ -1361,6 +1518,19 @@ public:
         void* buffer,
         size_t size) const;
 
+    //
+    // Receive up to 'size' bytes along with any descriptors passed by the
+    // peer with SendDescriptors(), AddressFamily::Unix sockets only. The
+    // received descriptors are owned by the caller. Fails with
+    // E_NET_SIZE_EXCEEDED, closing whatever arrived, when the peer sent
+    // more descriptors than 'descriptors' holds.
+    //
+    virtual Result<RecvDescriptorsData> RecvDescriptors(
+        Socket sock,
+        std::span<Socket> descriptors,
+        void* buffer,
+        size_t size) const;
+
     //
     //
     //
@@ -1378,6 +1548,29 @@ public:
         const void* buffer,
         size_t size) const;
 
+    //
+    // Wait until the socket is writable or 'ctx' ends, then send. On a
+    // blocking socket the send itself may outlast the deadline, only
+    // cancellation interrupts it.
+    //
+    Result<size_t> Send(
+        Socket sock,
+        const void* buffer,
+        size_t size,
+        const Context& ctx) const;
+
+    //
+    // Send 'size' bytes with 'descriptors' attached (SCM_RIGHTS). The
+    // descriptors stay open in this process, the peer receives duplicates.
+    // At least one byte is always sent since descriptors cannot travel on
+    // their own.
+    //
+    virtual Result<size_t> SendDescriptors(
+        Socket sock,
+        std::span<const Socket> descriptors,
+        const void* buffer,
+        size_t size) const;
+
     //
     //
     //
@@ -1397,6 +1590,31 @@ public:
         const void* buffer,
         size_t size) const;
 
+    //
+    // Send 'buffer' to 'address' as a train of 'segmentSize' datagrams, the
+    // last of which may be shorter. Where the platform supports UDP
+    // segmentation offload the whole train is handed to the kernel in a
+    // single call, otherwise each datagram is sent with SendTo(). Returns the
+    // number of bytes sent.
+    //
+    virtual Result<size_t> SendToSegmented(
+        Socket sock,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t size,
+        size_t segmentSize,
+        MessageOption flags) const;
+
+    //
+    //
+    //
+    Result<size_t> SendToSegmented(
+        Socket sock,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t size,
+        size_t segmentSize) const;
+
     //
     //
     //
@@ -1562,6 +1780,33 @@ Result<size_t> Poll(
     PollFd& fd,
     Clock::duration timeout);
 
+//
+// A listening socket and the name under which it is handed to a successor.
+//
+struct ListenerDescriptor
+{
+    std::string name;
+    Socket sock{ INVALID_SOCKET };
+};
+
+//
+// Pass 'listeners' over the connected AddressFamily::Unix stream socket
+// 'channel' for a zero-downtime restart. The successor keeps accepting on
+// the same sockets, pending connections in the accept queues are not lost.
+// The listeners remain open in this process until it closes them.
+//
+Result<void> SendListeners(
+    const Network& network,
+    Socket channel,
+    std::span<const ListenerDescriptor> listeners);
+
+//
+// Receive the listeners sent with SendListeners() on 'channel'.
+//
+Result<std::vector<ListenerDescriptor>> RecvListeners(
+    const Network& network,
+    Socket channel);
+
 //
 //
 //
@@ -1570,6 +1815,12 @@ struct SocketEvent
     Socket sock{ INVALID_SOCKET };
     SocketOperation events{ SocketOperation::None };
 
+    //
+    // E_CANCELLED or E_NET_TIMEOUT when the Context watching the socket
+    // ended, see SocketService::Watch().
+    //
+    Error error{ E_SUCCESS };
+
     bool operator==(const Socket& sock) const;
     bool operator!=(const Socket& sock) const;
     bool operator<(const Socket& sock) const;
@@ -1592,6 +1843,69 @@ public:
         Epoll,
         Iocp,
         Kqueue,
+        Poll,
+    };
+
+    //
+    // Spin-before-block configuration for latency critical loops. Execute()
+    // polls with a zero timeout for up to 'spin' before it blocks, trading
+    // a core for wakeup latency.
+    //
+    struct BusyPoll
+    {
+        //
+        // Time spent polling without blocking, zero disables spinning.
+        //
+        Clock::duration spin{ Clock::duration::zero() };
+
+        //
+        // SO_BUSY_POLL applied to every registered socket, zero leaves the
+        // socket untouched. Values above net.core.busy_read require
+        // CAP_NET_ADMIN.
+        //
+        std::chrono::microseconds socketBusyPoll{ 0 };
+
+        //
+        // SO_BUSY_POLL_BUDGET applied to every registered socket, zero
+        // leaves the kernel default.
+        //
+        int32_t socketBudget{ 0 };
+
+        //
+        // SO_PREFER_BUSY_POLL applied to every registered socket.
+        //
+        bool preferBusyPoll{ false };
+    };
+
+    //
+    //
+    //
+    struct Stats
+    {
+        //
+        // Zero timeout polls issued while spinning.
+        //
+        uint64_t spinPolls{ 0 };
+
+        //
+        // Calls to Execute() satisfied while spinning.
+        //
+        uint64_t spinWakeups{ 0 };
+
+        //
+        // Blocking polls issued after the spin budget ran out.
+        //
+        uint64_t blocks{ 0 };
+
+        //
+        // Blocking polls which returned with events.
+        //
+        uint64_t blockWakeups{ 0 };
+
+        Clock::duration spinTime{ Clock::duration::zero() };
+        Clock::duration blockTime{ Clock::duration::zero() };
+
+        Stats& operator+=(const Stats& stats);
     };
 
     //
@@ -1610,7 +1924,7 @@ public:
     //
     //
     //
-    virtual ~SocketService() = default;
+    virtual ~SocketService();
 
     //
     //
@@ -1620,9 +1934,9 @@ public:
         SocketOperation events) = 0;
 
     //
+    // Stop watching the socket and remove it from the service.
     //
-    //
-    virtual Result<void> Close(Socket sock) = 0;
+    Result<void> Close(Socket sock);
 
     //
     //
@@ -1635,9 +1949,10 @@ public:
     Result<std::span<SocketEvent>> Execute();
 
     //
+    // Wait up to 'timeout' for events, never past the deadline of a watched
+    // Context.
     //
-    //
-    virtual Result<std::span<SocketEvent>> Execute(Clock::duration timeout) = 0;
+    Result<std::span<SocketEvent>> Execute(Clock::duration timeout);
 
     //
     //
@@ -1646,6 +1961,17 @@ public:
         Socket sock,
         SocketOperation events) = 0;
 
+    //
+    // Configure spin-before-block polling. Socket level options are applied
+    // to registered sockets and to every socket added afterwards.
+    //
+    virtual Result<void> SetBusyPoll(const BusyPoll& options);
+
+    //
+    //
+    //
+    virtual Stats GetStats() const;
+
     //
     //
     //
@@ -1661,8 +1987,42 @@ public:
     //
     virtual void Stop(std::function<void(Failure&)> fn) = 0;
 
+    //
+    // Bind the pending operation on 'sock' to 'ctx'. Cancelling the context
+    // wakes Execute() and the deadline bounds its wait. When the context
+    // ends Execute() reports the socket once with SocketOperation::Error
+    // and SocketEvent::error set to E_CANCELLED or E_NET_TIMEOUT, after
+    // which it is no longer watched. The deadline is read when the watch is
+    // added, a later extension is honoured but an earlier one is not.
+    // Replaces a previous watch of the socket. Remove watches before
+    // destroying the service when their contexts may still be cancelled.
+    //
+    Result<void> Watch(Socket sock, const Context& ctx);
+
+    //
+    //
+    //
+    void Unwatch(Socket sock);
+
 protected:
-    SocketService() = default;
+    SocketService();
+
+    //
+    // Backend implementation of Execute(), 'timeout' is already bounded by
+    // the watched deadlines.
+    //
+    virtual Result<std::span<SocketEvent>> ExecuteInternal(
+        Clock::duration timeout) = 0;
+
+    //
+    // Backend implementation of Close().
+    //
+    virtual Result<void> CloseInternal(Socket sock) = 0;
+
+private:
+    struct Watches;
+
+    std::unique_ptr<Watches> m_watches;
 };
 
 }  // namespace Fusion
@@ -0,0 +1,173 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#pragma once
+
+#include <Fusion/Network.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Fusion
+{
+//
+// Per-connection write buffer with flow control.
+//
+// Data passed to Write() is sent immediately when nothing is queued, whatever
+// the socket does not accept is copied into a chain of fixed size chunks.
+// While data is queued the socket is registered for write interest with the
+// SocketService, Flush() drains the chain when the socket becomes writable
+// and drops the interest again once it is empty.
+//
+// Once the queued size reaches 'highWatermark' the queue pauses and the
+// producer is notified, it is resumed when Flush() brings the queue down to
+// 'lowWatermark'. Writes made while paused are still accepted up to
+// 'limit', beyond which Write() fails with E_NET_WOULD_BLOCK, so the memory
+// held per connection stays bounded even for producers ignoring the signal.
+//
+class OutboundQueue final
+{
+public:
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+
+public:
+    struct Params
+    {
+        //
+        // Queued size at which the producer is paused.
+        //
+        size_t highWatermark{ 1024 * 1024 };
+
+        //
+        // Queued size at which a paused producer is resumed.
+        //
+        size_t lowWatermark{ 256 * 1024 };
+
+        //
+        // Hard upper bound of queued bytes, zero uses twice the high
+        // watermark.
+        //
+        size_t limit{ 0 };
+
+        //
+        // Size of each buffer in the chain.
+        //
+        size_t chunkSize{ 16 * 1024 };
+
+        //
+        // Drained chunks kept for reuse instead of being freed.
+        //
+        size_t spareChunks{ 4 };
+    };
+
+    //
+    // Invoked with true when the queue pauses and false when it resumes.
+    //
+    using WatermarkCallback = std::function<void(bool paused)>;
+
+public:
+    //
+    //
+    //
+    static Result<std::unique_ptr<OutboundQueue>> Create(
+        Network& network,
+        SocketService& service,
+        Socket sock,
+        Params params,
+        WatermarkCallback callback = nullptr);
+
+    //
+    //
+    //
+    OutboundQueue(
+        Network& network,
+        SocketService& service,
+        Socket sock,
+        Params params,
+        WatermarkCallback callback);
+
+    //
+    // Drops write interest for the socket, queued data is discarded.
+    //
+    ~OutboundQueue();
+
+    //
+    // Send or queue 'size' bytes and return how many were accepted. A
+    // failure accepted nothing. Fewer than 'size' bytes are only returned
+    // when the socket took part of the data directly and then failed, or
+    // the rest could not be allocated or registered for write interest.
+    // The remainder is not queued and is the caller's to retry or drop.
+    //
+    Result<size_t> Write(const void* data, size_t size);
+
+    //
+    // Send as much of the queued data as the socket accepts. Called when the
+    // SocketService reports the socket writable.
+    //
+    Result<void> Flush();
+
+    //
+    //
+    //
+    Socket GetSocket() const;
+
+    //
+    //
+    //
+    bool IsPaused() const;
+
+    //
+    // Number of bytes queued and not yet accepted by the socket.
+    //
+    size_t Size() const;
+
+    //
+    // Number of bytes allocated for the chunk chain, including spares.
+    //
+    size_t Capacity() const;
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t begin{ 0 };
+        size_t end{ 0 };
+    };
+
+    Result<void> Reserve(size_t size);
+    void Append(const uint8_t* data, size_t size);
+    void Trim();
+    Result<void> SetWriteInterest(bool enabled);
+    void Release(Chunk chunk);
+    void Notify(bool paused);
+
+private:
+    Network& m_network;
+    SocketService& m_service;
+    Socket m_sock{ INVALID_SOCKET };
+    Params m_params;
+    WatermarkCallback m_callback;
+
+    std::deque<Chunk> m_chunks;
+    std::vector<Chunk> m_spares;
+    size_t m_size{ 0 };
+    bool m_paused{ false };
+    bool m_writeInterest{ false };
+};
+}  // namespace Fusion
@@ -0,0 +1,206 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#pragma once
+
+#include <Fusion/DateTime.h>
+#include <Fusion/Network.h>
+
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Fusion
+{
+//
+// Per-peer token bucket rate limiter.
+//
+// Each peer owns a bucket holding up to 'burst' tokens which refills at
+// 'rate' tokens per second. Buckets are refilled lazily from the elapsed
+// Clock time when the peer is next consulted, so idle peers cost nothing.
+//
+// Peers are spread over independently locked shards by the hash of their
+// address, threads admitting different peers rarely touch the same lock.
+// Every shard tracks its peers in least recently used order, the oldest
+// peer is dropped when the shard is full and peers idle for longer than
+// 'idleTimeout' are dropped as they are encountered. A dropped peer starts
+// over with a full bucket, which is exactly what it would have refilled to.
+//
+// Intended to be consulted on Accept() and per received message, both are
+// O(1).
+//
+class RateLimiter final
+{
+public:
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+public:
+    struct Params
+    {
+        //
+        // Tokens added to a bucket per second.
+        //
+        double rate{ 100.0 };
+
+        //
+        // Capacity of a bucket, the largest burst a peer may send.
+        //
+        double burst{ 100.0 };
+
+        //
+        // Upper bound of peers tracked at once across all shards.
+        //
+        size_t maxPeers{ 64 * 1024 };
+
+        //
+        // Peers not consulted for this long are forgotten, zero keeps them
+        // until evicted by 'maxPeers'.
+        //
+        Clock::duration idleTimeout{ std::chrono::minutes(5) };
+
+        //
+        // Number of independently locked shards, rounded up to a power of
+        // two.
+        //
+        size_t shards{ 16 };
+
+        //
+        // Treat every port of an address as a separate peer. By default all
+        // connections from the same host share a bucket.
+        //
+        bool includePort{ false };
+    };
+
+public:
+    //
+    //
+    //
+    static Result<std::unique_ptr<RateLimiter>> Create(Params params);
+
+    //
+    //
+    //
+    explicit RateLimiter(Params params);
+
+    ~RateLimiter();
+
+    //
+    // Take 'tokens' from the peer's bucket. Returns false, taking nothing,
+    // when the bucket holds fewer tokens.
+    //
+    bool TryAcquire(const SocketAddress& peer, double tokens = 1.0);
+
+    //
+    //
+    //
+    bool TryAcquire(const InetAddress& peer, double tokens = 1.0);
+
+    //
+    //
+    //
+    bool TryAcquire(const Inet6Address& peer, double tokens = 1.0);
+
+    //
+    // As above at an explicit point in time. 'now' is expected to not move
+    // backwards for a peer, an earlier time refills nothing.
+    //
+    bool TryAcquire(
+        const SocketAddress& peer,
+        double tokens,
+        Clock::time_point now);
+
+    //
+    // Time until the peer's bucket holds 'tokens', zero when they are
+    // available now.
+    //
+    Clock::duration RetryAfter(
+        const SocketAddress& peer,
+        double tokens = 1.0,
+        Clock::time_point now = Clock::now()) const;
+
+    //
+    // Forget the peer, its next request starts with a full bucket.
+    //
+    void Remove(const SocketAddress& peer);
+
+    //
+    // Drop every peer idle since before 'now - idleTimeout'. Idle peers are
+    // also dropped as they are encountered, calling this periodically only
+    // returns their memory sooner. Returns the number of peers dropped.
+    //
+    size_t Expire(Clock::time_point now = Clock::now());
+
+    //
+    //
+    //
+    void Clear();
+
+    //
+    // Number of peers currently tracked.
+    //
+    size_t Size() const;
+
+private:
+    struct Key
+    {
+        std::array<uint8_t, Inet6Address::SIZE> address{};
+        uint16_t port{ 0 };
+        AddressFamily family{ AddressFamily::None };
+        uint64_t hash{ 0 };
+
+        bool operator==(const Key& key) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const { return size_t(key.hash); }
+    };
+
+    struct Bucket
+    {
+        Key key;
+        double tokens{ 0 };
+        Clock::time_point updated;
+    };
+
+    using BucketList = std::list<Bucket>;
+
+    // Aligned so that neighbouring shard locks do not share a cache line.
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        BucketList lru;
+        std::unordered_map<Key, BucketList::iterator, KeyHash> index;
+    };
+
+    Key MakeKey(const SocketAddress& peer) const;
+    Key MakeKey(AddressFamily family, const uint8_t* address, size_t size) const;
+    Shard& GetShard(const Key& key) const;
+
+    bool TryAcquire(const Key& key, double tokens, Clock::time_point now);
+    void Refill(Bucket& bucket, Clock::time_point now) const;
+    void ExpireLocked(Shard& shard, Clock::time_point now);
+
+private:
+    Params m_params;
+    size_t m_shardCapacity{ 0 };
+    std::unique_ptr<Shard[]> m_shards;
+};
+}  // namespace Fusion
@@ -0,0 +1,164 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#include <Fusion/Network.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+
+namespace Fusion
+{
+//
+// Stream transport between co-located processes over shared memory.
+//
+// A memfd mapping holds two single producer, single consumer byte rings,
+// one per direction, so data moves with a memcpy instead of two kernel
+// copies and a pair of syscalls. Each side owns an eventfd which the peer
+// writes only when the side went to sleep waiting on data or space, steady
+// traffic in both directions runs without any syscalls at all.
+//
+// Send() and Recv() behave like their Network counterparts on a
+// non-blocking stream socket: partial transfers, E_NET_WOULD_BLOCK when
+// the ring is full or empty and E_NET_DISCONNECTED once the peer closed
+// its side and everything it sent was received. Ring positions the peer
+// could not have written honestly fail with E_FAILURE and close the
+// channel. Handle() becomes readable when an operation which would have
+// blocked can make progress and is meant to be registered with a
+// SocketService for SocketOperation::Read.
+//
+// The creating side hands Descriptors() to its peer, typically with
+// Network::SendDescriptors() over a Unix socket, and the peer attaches
+// with Open(). One thread may send while another receives, each direction
+// supports a single thread. Linux only, elsewhere Create() and Open() fail
+// with E_NOT_SUPPORTED.
+//
+class SharedMemoryChannel final
+{
+public:
+    SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+    SharedMemoryChannel& operator=(const SharedMemoryChannel&) = delete;
+
+public:
+    struct Params
+    {
+        //
+        // Bytes buffered per direction, rounded up to a power of two of at
+        // least 4KiB.
+        //
+        size_t capacity{ 1 << 20 };
+    };
+
+    //
+    //
+    //
+    static Result<std::unique_ptr<SharedMemoryChannel>> Create();
+
+    //
+    //
+    //
+    static Result<std::unique_ptr<SharedMemoryChannel>> Create(Params params);
+
+    //
+    // Attach to the channel whose Descriptors() were received from the
+    // creating process. Takes ownership of the descriptors, also when it
+    // fails.
+    //
+    static Result<std::unique_ptr<SharedMemoryChannel>> Open(
+        std::span<const Socket> descriptors);
+
+public:
+    SharedMemoryChannel();
+
+    ~SharedMemoryChannel();
+
+    //
+    // The shared memory and both eventfds, in the order Open() expects.
+    // They remain owned by the channel.
+    //
+    std::array<Socket, 3> Descriptors() const;
+
+    //
+    // Readable when a Send() or Recv() which failed with E_NET_WOULD_BLOCK
+    // may now make progress. Spurious readiness is possible.
+    //
+    Socket Handle() const;
+
+    //
+    // Bytes buffered per direction.
+    //
+    size_t Capacity() const;
+
+    //
+    //
+    //
+    Result<size_t> Send(const void* buffer, size_t size);
+
+    //
+    //
+    //
+    Result<size_t> Recv(void* buffer, size_t size);
+
+    //
+    // Close this side. The peer still receives what was sent before, after
+    // which its Recv() fails with E_NET_DISCONNECTED, its Send() fails
+    // right away. Also done by the destructor.
+    //
+    void Close();
+
+private:
+    struct Header;
+    struct Ring;
+
+    static size_t DataOffset();
+
+    Result<void> Map(Socket memory, size_t size, bool initialize);
+
+    uint8_t* Data(size_t ring) const;
+    void Drain() const;
+    void Signal(Socket event) const;
+    void Rearm();
+
+    //
+    // Close the channel after finding ring positions only a broken or
+    // hostile peer could have written.
+    //
+    Failure Corrupted(uint64_t head, uint64_t tail);
+
+private:
+    Header* m_header{ nullptr };
+    size_t m_size{ 0 };
+    size_t m_capacity{ 0 };
+    size_t m_side{ 0 };
+    std::array<Socket, 3> m_descriptors{
+        INVALID_SOCKET,
+        INVALID_SOCKET,
+        INVALID_SOCKET,
+    };
+
+    //
+    // Set while the last Send() or Recv() would have blocked, those are
+    // the conditions Handle() signals.
+    //
+    std::atomic<bool> m_sendBlocked{ false };
+    std::atomic<bool> m_recvBlocked{ false };
+    bool m_closed{ false };
+};
+}  // namespace Fusion
@@ -0,0 +1,330 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#pragma once
+
+#include <Fusion/DateTime.h>
+#include <Fusion/Network.h>
+
+#include <memory>
+
+namespace Fusion
+{
+namespace Internal
+{
+struct SimulatedState;
+}  // namespace Internal
+
+//
+// In-process Network for deterministic tests and benchmarks.
+//
+// Sockets are plain objects routed by address, nothing touches the system
+// and every address is local. Time is virtual: it only moves when a
+// SocketService created for this network waits in Execute(), when a
+// blocking operation waits for its data, or through Advance(). An idle
+// wait jumps straight to the next delivery, so a run spanning hours of
+// simulated time completes as fast as the code under test can go.
+//
+// Every connection direction is a link with the configured latency,
+// bandwidth and jitter. Streams stay reliable and ordered, a lost segment
+// arrives a retransmission timeout late and holds back the data behind
+// it. Datagrams are dropped by 'loss' and delayed by 'reorder', which lets
+// them overtake each other. All randomness comes from 'seed', the same
+// seed and the same calls replay the same run.
+//
+// SocketService::Create() on this network returns a service which waits
+// in virtual time. Simulated sockets are numbered past any system
+// descriptor: Poll() reports them as PollFlags::Invalid, and the Context
+// overloads of Connect(), Recv() and Send() fail with E_NOT_SUPPORTED.
+//
+class SimulatedNetwork final : public Network
+{
+public:
+    struct Params
+    {
+        //
+        // One-way delay of every link.
+        //
+        Clock::duration latency{ std::chrono::milliseconds(1) };
+
+        //
+        // Random extra delay of up to 'jitter' per segment.
+        //
+        Clock::duration jitter{ Clock::duration::zero() };
+
+        //
+        // Bytes per second of every link direction, zero is unlimited.
+        //
+        uint64_t bandwidth{ 0 };
+
+        //
+        // Probability of losing a segment or datagram.
+        //
+        double loss{ 0.0 };
+
+        //
+        // Probability of delaying a datagram by 'reorderDelay'.
+        //
+        double reorder{ 0.0 };
+        Clock::duration reorderDelay{ std::chrono::milliseconds(1) };
+
+        //
+        // Extra delay of a lost stream segment.
+        //
+        Clock::duration retransmitTimeout{ std::chrono::milliseconds(200) };
+
+        //
+        // Bytes a stream socket may have unread at its peer before Send()
+        // blocks.
+        //
+        size_t bufferSize{ 256 * 1024 };
+
+        uint64_t seed{ 1 };
+    };
+
+    //
+    //
+    //
+    struct Stats
+    {
+        uint64_t segments{ 0 };
+        uint64_t bytes{ 0 };
+        uint64_t lost{ 0 };
+        uint64_t connections{ 0 };
+    };
+
+    //
+    //
+    //
+    static Result<std::unique_ptr<SimulatedNetwork>> Create();
+
+    //
+    //
+    //
+    static Result<std::unique_ptr<SimulatedNetwork>> Create(Params params);
+
+public:
+    explicit SimulatedNetwork(Params params);
+
+    ~SimulatedNetwork() override;
+
+    //
+    // The current virtual time.
+    //
+    Clock::time_point Now() const override;
+
+    //
+    // Move virtual time forward by 'duration'.
+    //
+    void Advance(Clock::duration duration);
+
+    //
+    // Replace the link parameters, segments already in flight keep their
+    // delivery times. Lets a test inject loss or a latency spike mid-run.
+    //
+    Result<void> SetParams(Params params);
+
+    //
+    //
+    //
+    Stats GetStats() const;
+
+public:
+    using Network::Connect;
+    using Network::CreateSocket;
+    using Network::GetSocketOption;
+    using Network::Recv;
+    using Network::RecvFrom;
+    using Network::Send;
+    using Network::SendTo;
+    using Network::SendToSegmented;
+    using Network::SetSocketOption;
+
+    //
+    //
+    //
+    Result<AcceptedSocketData> Accept(Socket sock) const override;
+
+    //
+    //
+    //
+    Result<void> Bind(Socket sock, const SocketAddress& address) const override;
+
+    //
+    //
+    //
+    Result<Socket> CreateSocket(
+        AddressFamily family,
+        SocketProtocol proto,
+        SocketType type) const override;
+
+    //
+    // Both families are supported, the pair shares the link parameters.
+    //
+    Result<std::array<Socket, 2>> CreateSocketPair(
+        AddressFamily family,
+        SocketType type) const override;
+
+    //
+    //
+    //
+    std::unique_ptr<SocketService> CreateSocketService() override;
+
+    //
+    //
+    //
+    Result<void> Connect(
+        Socket sock,
+        const SocketAddress& address) const override;
+
+    //
+    // Not supported, waiting on a Context needs a system socket.
+    //
+    Result<void> Connect(
+        Socket sock,
+        const SocketAddress& address,
+        const Context& ctx) const;
+
+    //
+    //
+    //
+    Result<void> Close(Socket sock) const override;
+
+    //
+    //
+    //
+    Result<SocketAddress> GetPeerName(Socket sock) const override;
+
+    //
+    //
+    //
+    Result<SocketAddress> GetSockName(Socket sock) const override;
+
+    //
+    // Options are accepted and ignored, reads return zeroes.
+    //
+    Result<void> GetSocketOption(
+        Socket sock,
+        SocketOpt option,
+        void* data,
+        size_t size) const override;
+
+    //
+    //
+    //
+    Result<void> Listen(
+        Socket sock,
+        uint32_t backlog) const override;
+
+    //
+    //
+    //
+    Result<size_t> Recv(
+        Socket sock,
+        void* buffer,
+        size_t length,
+        MessageOption flags) const override;
+
+    //
+    // Not supported, waiting on a Context needs a system socket.
+    //
+    Result<size_t> Recv(
+        Socket sock,
+        void* buffer,
+        size_t length,
+        const Context& ctx) const;
+
+    //
+    //
+    //
+    Result<RecvFromData> RecvFrom(
+        Socket sock,
+        void* buffer,
+        size_t length,
+        MessageOption flags) const override;
+
+    //
+    //
+    //
+    Result<size_t> Send(
+        Socket sock,
+        const void* buffer,
+        size_t length,
+        MessageOption flags) const override;
+
+    //
+    // Not supported, waiting on a Context needs a system socket.
+    //
+    Result<size_t> Send(
+        Socket sock,
+        const void* buffer,
+        size_t length,
+        const Context& ctx) const;
+
+    //
+    //
+    //
+    Result<size_t> SendTo(
+        Socket sock,
+        const SocketAddress& address,
+        const void* buffer,
+        size_t length,
+        MessageOption flags) const override;
+
+    //
+    //
+    //
+    Result<void> SetBlocking(
+        Socket sock,
+        bool blocking) const override;
+
+    //
+    // Options are accepted and ignored.
+    //
+    Result<void> SetSocketOption(
+        Socket sock,
+        SocketOpt option,
+        const void* data,
+        size_t size) const override;
+
+    //
+    //
+    //
+    Result<void> Shutdown(
+        Socket sock,
+        SocketShutdownMode mode) const override;
+
+public:
+    //
+    //
+    //
+    Result<void> Start() override;
+
+    //
+    //
+    //
+    void Stop() override;
+
+    //
+    //
+    //
+    void Stop(std::function<void(Failure&)> fn) override;
+
+private:
+    std::shared_ptr<Internal::SimulatedState> m_state;
+};
+}  // namespace Fusion
@@ -18,13 +18,20 @@
 
 #include <Fusion/Fwd/Thread.h>
 
+#include <Fusion/Context.h>
+#include <Fusion/DateTime.h>
+#include <Fusion/Future.h>
 #include <Fusion/Macros.h>
 #include <Fusion/Result.h>
 
+#include <array>
+#include <condition_variable>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
@@ -200,6 +207,33 @@ public:
         Default = Normal,
     };
 
+    //
+    // What a submission does when the queues are at Options::queueCapacity.
+    // Submissions refused or dropped complete with E_INSUFFICIENT_RESOURCES:
+    // futures hold the failure and Post() returns UINT64_MAX.
+    //
+    enum class Overflow
+    {
+        //
+        // Wait for room. Submitters running on one of the pool's own
+        // workers are let through instead, they could otherwise wait on
+        // each other.
+        //
+        Block = 0,
+
+        //
+        // Refuse the new submission.
+        //
+        Reject,
+
+        //
+        // Make room by dropping the oldest queued task of the lowest
+        // priority, as long as it is not above the new one's, otherwise
+        // refuse the new submission.
+        //
+        DropOldest,
+    };
+
 public:
     //
     //
@@ -212,14 +246,167 @@ public:
         std::string_view threadName;
 
         //
-        //
+        // Workers started with the pool and kept for its lifetime, zero
+        // for one per hardware thread. Clamped to 'maxThreads' when set.
         //
         uint32_t threads{ 0 };
 
         //
+        // Ceiling the pool grows towards while queued work is starved.
+        // Zero keeps the pool at 'threads', growing is opt-in.
+        //
+        uint32_t maxThreads{ 0 };
+
+        //
+        // Queued work that waits this long with no idle worker and no task
+        // finishing meanwhile adds a worker. Zero disables the check.
+        //
+        Clock::duration stallTimeout{ std::chrono::milliseconds(50) };
+
+        //
+        // Workers above 'threads' exit after sitting idle for this long.
+        //
+        Clock::duration idleTimeout{ std::chrono::seconds(30) };
+
+        //
+        // Record wait and run time histograms, at the cost of three clock
+        // reads per task. Queue depths, steals and idle time are always
+        // counted.
+        //
+        bool collectStats{ false };
+
+        //
+        // Share of dequeues each priority gets while several are backlogged,
+        // indexed by Priority. Workers take turns between the levels in
+        // these proportions and only fall back to strict priority order
+        // when the level whose turn it is has nothing queued, so a level
+        // with a non-zero weight cannot be starved. All zero gives strict
+        // priority order.
+        //
+        std::array<uint8_t, size_t(Priority::High) + 1> weights{ 1, 4, 16 };
+
+        //
+        // Tasks the queues may hold before submissions overflow, zero for
+        // no limit. Timers coming due and work the pool queues for itself,
+        // strand turns and parallel helpers, are never refused but count
+        // towards it. Neither those nor task group runners are dropped.
+        //
+        size_t queueCapacity{ 0 };
+
+        //
+        //
+        //
+        Overflow overflow{ Overflow::Reject };
+    };
+
+    //
+    // How busy the pool is right now, for callers that want to shed work
+    // before submitting it.
+    //
+    struct Load
+    {
+        size_t queued{ 0 };
+
+        //
+        // Options::queueCapacity, zero if unbounded.
+        //
+        size_t capacity{ 0 };
+
+        //
+        // Workers running a task or looking for one.
         //
+        size_t busy{ 0 };
+
+        size_t threads{ 0 };
+    };
+
+    //
+    // A snapshot of what the pool has been doing, see GetStats().
+    //
+    struct Stats
+    {
+        static constexpr size_t PRIORITIES = size_t(Priority::High) + 1;
+
+        //
+        // Durations in power of two buckets, bucket 'i' counts samples of
+        // less than 2^i nanoseconds and the last one everything longer.
+        //
+        struct Histogram
+        {
+            static constexpr size_t BUCKETS = 32;
+
+            std::array<uint64_t, BUCKETS> buckets{};
+            uint64_t count{ 0 };
+            Clock::duration total{ Clock::duration::zero() };
+
+            //
+            // Upper bound of the bucket which holds the sample at 'fraction'
+            // of the way through, in (0, 1].
+            //
+            Clock::duration Percentile(double fraction) const;
+
+            //
+            //
+            //
+            Clock::duration Mean() const;
+
+            Histogram& operator+=(const Histogram& histogram);
+        };
+
+        //
+        //
+        //
+        struct Level
+        {
+            //
+            // Tasks currently queued at this priority.
+            //
+            size_t queued{ 0 };
+
+            //
+            // Time from being queued to starting to run.
+            //
+            Histogram wait;
+
+            //
+            //
+            //
+            Histogram run;
+        };
+
+        //
+        //
+        //
+        struct Worker
+        {
+            uint64_t tasks{ 0 };
+
+            //
+            // Tasks taken from another worker's queue.
+            //
+            uint64_t steals{ 0 };
+
+            //
+            // Time spent asleep waiting for work.
+            //
+            Clock::duration idle{ Clock::duration::zero() };
+
+            bool live{ false };
+        };
+
         //
-        uint8_t maxThreads{ UINT8_MAX };
+        // Timings of the tasks posted with a name, merged by name.
+        //
+        struct Named
+        {
+            std::string_view name;
+            Histogram wait;
+            Histogram run;
+        };
+
+        std::array<Level, PRIORITIES> priorities;
+        std::vector<Worker> workers;
+        std::vector<Named> named;
     };
 
 public:
@@ -337,37 +524,407 @@ public:
         Priority priority = Priority::Default)
         -> Future<Unwrapped<std::invoke_result_t<Fn>>>;
 
+    //
+    // Run 'fn' on the pool and return a Fusion::Future to chain further
+    // steps onto with Then(), WhenAll() or WhenAny() instead of a thread
+    // waiting for it. 'fn' may return nothing, a U or a Result<U>. Costs
+    // the future's shared state and nothing else for callables that fit
+    // a task slot. A task refused or cancelled by the pool fails the
+    // future with the pool's error.
+    //
+    template<typename Fn>
+    auto Async(
+        Fn&& fn,
+        Priority priority = Priority::Default)
+        -> Fusion::Future<
+               typename Internal::FutureValue<std::invoke_result_t<Fn>>::Type>;
+
+    //
+    // Run 'fn' on the pool without a way to observe its result. Callables
+    // that fit a task slot are stored inline, so this path does not
+    // allocate once the pool has warmed up. The returned id can be passed
+    // to Cancel().
+    //
+    template<typename Fn>
+    uint64_t Post(
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    // Like Post(), with the task's timings also recorded under 'name' when
+    // the pool collects stats. The name is kept by pointer and has to
+    // outlive the pool, a string literal is the intended use.
+    //
+    template<typename Fn>
+    uint64_t Post(
+        const char* name,
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    // Run 'fn' once 'delay' has passed. Pending timers live in a deadline
+    // ordered map serviced by the workers themselves, they cost no thread
+    // and O(log n) to add or cancel. The returned id can be passed to
+    // Cancel().
+    //
+    template<typename Fn>
+    uint64_t DispatchAfter(
+        Clock::duration delay,
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    //
+    //
+    template<typename Fn>
+    uint64_t DispatchAt(
+        Clock::time_point deadline,
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    // Run 'fn' every 'period', first after one period. Ticks missed while
+    // the pool was busy are skipped rather than run back to back. Runs
+    // until Cancel() is called with the returned id.
+    //
+    template<typename Fn>
+    uint64_t DispatchEvery(
+        Clock::duration period,
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    // Post 'count' tasks each running fn(index), index in [0, count). The
+    // batch is queued under a single lock with a single round of wakeups.
+    // Task ids are consecutive, starting with the one returned.
+    //
+    template<typename Fn>
+    uint64_t SubmitBatch(
+        size_t count,
+        Fn&& fn,
+        Priority priority = Priority::Default);
+
+    //
+    // Run fn(index) for every index in [begin, end) and return once all
+    // have finished. The range is split into chunks of 'grain' indices
+    // that the pool's workers and the calling thread claim until none
+    // are left, so calling this from inside a task cannot deadlock.
+    //
+    template<typename Fn>
+    void ParallelFor(
+        size_t begin,
+        size_t end,
+        size_t grain,
+        Fn&& fn);
+
+    //
+    // Combine fn(index) over [begin, end), starting every chunk from
+    // 'identity'. Chunk results are combined in index order, so 'combine'
+    // must be associative; it need not be commutative.
+    //
+    template<typename T, typename Fn, typename Combine>
+    T ParallelReduce(
+        size_t begin,
+        size_t end,
+        size_t grain,
+        T identity,
+        Fn&& fn,
+        Combine&& combine);
+
+    //
+    // Sort 'data' by sorting one slice per worker in parallel, then
+    // merging neighbouring slices pairwise.
+    //
+    template<typename T, typename Compare = std::less<>>
+    void ParallelSort(
+        std::span<T> data,
+        Compare comp = {});
+
+    //
+    // Workers currently running, between Options::threads and
+    // Options::maxThreads.
+    //
+    size_t GetThreadCount() const;
+
+    //
+    // Gathered from relaxed per-worker counters without stopping the
+    // pool, so the figures are not an atomic cut across workers.
+    //
+    Stats GetStats() const;
+
+    //
+    // Cheap enough to call before every submission.
+    //
+    Load GetLoad() const;
+
+public:
+    //
+    // Marks the calling worker as blocked, e.g. in synchronous I/O, for
+    // the lifetime of the scope. If queued work is left without an idle
+    // worker the pool adds one right away instead of waiting for the
+    // stall timeout. Has no effect outside of the pool's workers.
+    //
+    class Blocking final
+    {
+    public:
+        Blocking(const Blocking&) = delete;
+        Blocking& operator=(const Blocking&) = delete;
+
+    public:
+        //
+        //
+        //
+        explicit Blocking(ThreadPool& pool);
+
+        //
+        //
+        //
+        ~Blocking();
+
+    private:
+        ThreadPool* m_pool{ nullptr };
+    };
+
 private:
-    using CompletionHandler = std::function<void(
-        void* result,
-        Failure* error)>;
+    //
+    // Callables up to this size are constructed in place inside the task
+    // slot, larger ones are moved to the heap.
+    //
+    static constexpr size_t TASK_STORAGE = 72;
 
-    using TaskFn = std::function<void(
-        CompletionHandler& completer)>;
+    //
+    // Invokes and destroys the callable held in a task slot. 'error' is set
+    // when the task is cancelled rather than run.
+    //
+    using TaskFn = void(*)(void* storage, Failure* error);
+
+    //
+    //
+    //
+    using ChunkFn = void(*)(void* context, size_t chunk);
+
+    //
+    // Slices below this size are sorted without splitting any further.
+    //
+    static constexpr size_t SORT_GRAIN = 4096;
 
 private:
     class Queue;
+    struct Scheduler;
     struct Task;
     struct Thread;
 
+    template<typename Executor>
+    friend class ScheduleAwaiter;
+
     //
+    // How a submission is treated under Options::queueCapacity.
+    //
+    enum class Admission
+    {
+        //
+        // Refused or dropped as Options::overflow says.
+        //
+        Default = 0,
+
+        //
+        // Refused as Options::overflow says, but never dropped once queued.
+        // For tasks whose loss would strand work queued elsewhere.
+        //
+        Keep,
+
+        //
+        // Work the pool queues for itself, never refused nor dropped.
+        //
+        Internal,
+    };
+
+    struct TaskList
+    {
+        Task* head{ nullptr };
+        Task* tail{ nullptr };
+        size_t count{ 0 };
+    };
+
+    //
+    // Store 'fn', invocable as void(Failure*), in a task slot.
+    //
+    template<typename Fn>
+    Task* CreateTask(Fn&& fn);
+
     //
     //
+    //
+    template<typename Fn>
     uint64_t SubmitTask(
-        CompletionHandler& completer,
-        TaskFn fn,
-        Priority priority);
+        Fn&& fn,
+        Priority priority,
+        Admission admission = Admission::Default);
+
+    //
+    // Store 'count' copies of 'fn', invocable as void(Failure*, size_t),
+    // each bound to its index, and queue them as one batch.
+    //
+    template<typename Fn>
+    uint64_t SubmitTasks(
+        size_t count,
+        const Fn& fn,
+        Priority priority,
+        Admission admission = Admission::Default);
+
+    //
+    // Run fn(context, chunk) for every chunk in [0, chunks) on the pool
+    // and the calling thread. Helpers that never got to run are cancelled
+    // once the caller runs out of chunks.
+    //
+    void RunChunks(
+        size_t chunks,
+        ChunkFn fn,
+        void* context);
+
+    //
+    // Queue 'task' under 'id' once 'deadline' passes. Periodic timers
+    // call this again for every run and are dropped if cancelled meanwhile.
+    //
+    void ArmTimer(
+        Task* task,
+        uint64_t id,
+        Clock::time_point deadline,
+        Priority priority,
+        bool periodic);
+
+    //
+    // Drop the bookkeeping of a periodic timer whose task was cancelled.
+    //
+    void ForgetTimer(uint64_t id);
+
+    //
+    // Move every timer that is due onto the injection queue.
+    //
+    void FireTimers();
+
+    //
+    //
+    //
+    uint64_t ReserveTaskId();
+
+    //
+    // Take a free task slot. Workers draw from a private cache and only
+    // touch the shared free list to refill it.
+    //
+    Task* AllocateTask();
+
+    //
+    // Set the function that runs the slot's callable and return the
+    // storage to construct it in.
+    //
+    static void* InitTask(Task* task, TaskFn fn);
+
+    //
+    //
+    //
+    static void SetTaskName(Task* task, const char* name);
+
+    //
+    // Tasks submitted from a worker go to its own queue, everything else
+    // to the shared injection queue.
+    //
+    uint64_t EnqueueTask(
+        Task* task,
+        Priority priority,
+        Admission admission = Admission::Default);
 
     //
     //
     //
-    static std::optional<Task> DequeueTask(Queue& queue);
+    static void AppendTask(TaskList& list, Task* task);
+
+    //
+    // Queue a whole list at once, ids are assigned in list order. A list
+    // refused by admission is completed with the failure and UINT64_MAX
+    // returned.
+    //
+    uint64_t EnqueueTasks(
+        TaskList& list,
+        Priority priority,
+        Admission admission = Admission::Default);
+
+    //
+    // Reserve room for 'count' tasks of 'priority' under the queue
+    // capacity, applying the overflow policy when there is none.
+    //
+    Result<void> Admit(size_t count, Priority priority);
+
+    //
+    // Drop the oldest queued task at or below 'priority' that was admitted
+    // with Admission::Default. Returns false if there is none.
+    //
+    bool DropOldest(Priority priority);
+
+    //
+    // Queue tasks which already carry their id.
+    //
+    void PushTasks(TaskList& list, Priority priority);
+
+    //
+    // Run or cancel the task, then return its slot.
+    //
+    void CompleteTask(Task* task, Failure* error);
+
+    //
+    //
+    //
+    void ReleaseTask(Task* task);
+
+    //
+    // Take a dequeued task out of the cancel index. A task that Cancel()
+    // got to first is released instead and false returned.
+    //
+    bool ClaimTask(Task* task);
+
+    //
+    // Let go of a task cancelled while queued, see Task::released.
+    //
+    void ReleaseCancelled(Task* task);
+
+    //
+    // Take a task for 'worker', trying the priority whose turn it is in
+    // the weighted rotation before the others from the highest down. Each
+    // level is looked for in the worker's own queue first, then the
+    // injection queue, then stealing from the other workers. Sleeps while
+    // there is none, returns nullptr once the pool shuts down. 'level'
+    // receives the priority it was queued at.
+    //
+    Task* DequeueTask(size_t worker, size_t& level);
 
     //
     //
     //
     static void RunThread(ThreadPool* pool, Thread& thread);
 
+    //
+    // Start a worker in the first free slot, if below the ceiling. Called
+    // with the scheduler's pool lock held.
+    //
+    bool AddThreadLocked();
+
+    //
+    // Start 'thread', joining what is left of the worker that used the
+    // slot before.
+    //
+    void StartThreadLocked(Thread& thread);
+
+    //
+    // Let an idle worker above the initial count exit. Returns false if
+    // the pool is already down to it.
+    //
+    bool RetireThread(size_t worker);
+
+    //
+    // Runs on its own thread and adds workers while queued work stalls.
+    //
+    void Supervise();
+
 public:
     //
     //
@@ -390,30 +947,144 @@ public:
         ~Strand();
 
         //
-        //
+        // Returns a handle to the same strand, work posted through either
+        // is serialized with the other.
         //
         Strand Duplicate() const;
 
+        //
+        // Queue 'fn' to run on the pool after everything already posted to
+        // the strand. Tasks of one strand never run concurrently.
+        //
+        template<typename Fn>
+        void Post(Fn&& fn);
+
+        //
+        // Like Post(), but runs 'fn' immediately when called from a task
+        // already executing on this strand.
+        //
+        template<typename Fn>
+        void Dispatch(Fn&& fn);
+
+        //
+        //
+        //
+        bool IsRunningInThisThread() const;
+
     private:
         struct State;
 
+        //
+        // Tasks run per turn on a worker before the strand yields it and
+        // reschedules behind other work.
+        //
+        static constexpr size_t BATCH = 64;
+
     private:
         //
         //
         //
-        Strand(std::shared_ptr<State> state);
+        Strand(ThreadPool& pool, std::shared_ptr<State> state);
+
+        //
+        // Links 'task' into the strand's queue and schedules the strand on
+        // the pool when it was idle.
+        //
+        void Push(Task* task);
 
         //
         //
         //
-        bool IsRunningInThisThread() const;
+        static void Schedule(const std::shared_ptr<State>& state);
+
+        //
+        // Runs up to BATCH queued tasks, or cancels all of them when the
+        // pool itself is shutting down.
+        //
+        static void Run(const std::shared_ptr<State>& state, Failure* error);
+
+    private:
+        ThreadPool& m_pool;
+        std::shared_ptr<State> m_state;
+    };
+
+    //
+    // Fan-out/fan-in over the pool. Children are kept in the group until a
+    // worker or the thread in Wait() takes them, so waiting runs whatever
+    // has not started yet instead of sleeping on it, and a task waiting on
+    // its own children cannot deadlock the pool.
+    //
+    class TaskGroup final
+    {
+    public:
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+    public:
+        //
+        //
+        //
+        explicit TaskGroup(ThreadPool& pool);
+
+        //
+        // Children not started by the time 'context' is cancelled are
+        // skipped.
+        //
+        TaskGroup(ThreadPool& pool, Context context);
+
+        //
+        // Cancels and waits for children still outstanding.
+        //
+        ~TaskGroup();
+
+        //
+        // Run 'fn', returning void or a Result, as a child of the group.
+        // The first child to fail cancels the rest.
+        //
+        template<typename Fn>
+        void Spawn(
+            Fn&& fn,
+            Priority priority = Priority::Default);
 
         //
+        // Run queued children on this thread, then wait for the ones
+        // already running elsewhere. Returns the first child failure, or
+        // E_CANCELLED if the group was cancelled.
         //
+        Result<void> Wait();
+
+        //
+        // Skip the children that have not started. Running ones can poll
+        // IsCancelled() to stop early.
         //
-        void Run();
+        void Cancel();
+
+        //
+        //
+        //
+        bool IsCancelled() const;
 
     private:
+        struct State;
+
+    private:
+        //
+        // Hold 'child' in the group and queue a runner for it on the pool.
+        //
+        void Push(Task* child, Priority priority);
+
+        //
+        // Called by every child once, with the failure if it had one.
+        //
+        static void Finish(State& state, const Failure* failure);
+
+        //
+        //
+        //
+        static bool IsCancelled(const State& state);
+
+    private:
+        ThreadPool& m_pool;
         std::shared_ptr<State> m_state;
     };
 
@@ -425,13 +1096,62 @@ public:
 private:
     Options m_options;
     std::vector<Thread> m_threads;
-    std::unique_ptr<Queue> m_queue;
+    std::unique_ptr<Scheduler> m_scheduler;
+};
+
+//
+// Counts outstanding work and lets threads wait for it to drain, for
+// fan-in over work that is not a ThreadPool task, see TaskGroup for that.
+//
+class WaitGroup final
+{
+public:
+    WaitGroup(const WaitGroup&) = delete;
+    WaitGroup& operator=(const WaitGroup&) = delete;
+
+public:
+    WaitGroup() = default;
+
+    //
+    //
+    //
+    ~WaitGroup();
+
+    //
+    //
+    //
+    void Add(size_t count = 1);
+
+    //
+    //
+    //
+    void Done();
+
+    //
+    // Block until every Add() has been matched by a Done().
+    //
+    void Wait();
+
+    //
+    // Returns false if work was still outstanding after 'timeout'.
+    //
+    bool WaitFor(Clock::duration timeout);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    size_t m_count{ 0 };
 };
 
 //
 //
 //
 using Strand = ThreadPool::Strand;
+
+//
+//
+//
+using TaskGroup = ThreadPool::TaskGroup;
 }  // namespace Fusion
 
 #define FUSION_CALLSTACK_ENTRY(T, value) \
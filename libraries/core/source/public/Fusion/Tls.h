@@ -0,0 +1,293 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#pragma once
+
+#include <Fusion/Macros.h>
+#include <Fusion/Network.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct bio_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+struct ssl_st;
+
+namespace Fusion
+{
+//
+//
+//
+constexpr const Error E_TLS_FAILURE{ 120, "E_TLS_FAILURE" };
+
+//
+//
+//
+constexpr const Error E_TLS_HANDSHAKE{ 121, "E_TLS_HANDSHAKE" };
+
+//
+//
+//
+enum class TlsMode : uint8_t
+{
+    Client,
+    Server,
+};
+
+//
+// PEM encoded certificate and private key pair.
+//
+struct TlsCertificate
+{
+    std::string certificate;
+    std::string privateKey;
+};
+
+//
+// Generate a self-signed EC (P-256) certificate for the given host name.
+// Intended for tests and local development only.
+//
+Result<TlsCertificate> CreateSelfSignedCertificate(
+    std::string_view hostname,
+    Clock::duration validity = std::chrono::hours(24));
+
+//
+//
+//
+class TlsContext final
+{
+public:
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+public:
+    struct Params
+    {
+        //
+        //
+        //
+        TlsMode mode{ TlsMode::Client };
+
+        //
+        // PEM encoded certificate (and optional chain) presented to the peer.
+        // Required in server mode.
+        //
+        std::string_view certificate;
+
+        //
+        // PEM encoded private key matching 'certificate'.
+        //
+        std::string_view privateKey;
+
+        //
+        // PEM encoded certificates trusted when verifying the peer. When
+        // empty the platform default verify paths are used.
+        //
+        std::string_view trustedCertificates;
+
+        //
+        // Verify the peer certificate chain (and the server name for
+        // clients). Server contexts then require a client certificate.
+        //
+        bool verifyPeer{ true };
+
+        //
+        // Maximum number of sessions kept for resumption. Client contexts
+        // cache sessions per server name, server contexts configure the
+        // internal session-id cache. Zero disables resumption caching.
+        //
+        size_t sessionCacheSize{ 256 };
+
+        //
+        // Hand the record layer to the kernel (kTLS) once the handshake
+        // completes. Only honored on Linux for TLS 1.2 AES-GCM sessions,
+        // streams silently stay in user space when it is not available.
+        // A socket the kernel accepted only part of the keys for cannot
+        // go back, the stream then fails with E_TLS_FAILURE.
+        //
+        bool kernelTls{ false };
+    };
+
+public:
+    //
+    //
+    //
+    static Result<std::unique_ptr<TlsContext>> Create(Params params);
+
+    //
+    //
+    //
+    explicit TlsContext(Params params);
+
+    //
+    //
+    //
+    ~TlsContext();
+
+    //
+    //
+    //
+    TlsMode Mode() const;
+
+    //
+    // Number of client sessions currently held for resumption.
+    //
+    size_t CachedSessions() const;
+
+private:
+    friend class TlsStream;
+
+    Result<void> Start();
+
+    ssl_session_st* FindSession(const std::string& name);
+    void StoreSession(const std::string& name, ssl_session_st* session);
+
+    static int OnNewSession(ssl_st* ssl, ssl_session_st* session);
+
+private:
+    Params m_params;
+    ssl_ctx_st* m_ctx{ nullptr };
+
+    using SessionList = std::list<std::pair<std::string, ssl_session_st*>>;
+
+    mutable std::mutex m_mutex;
+    SessionList m_sessions FUSION_GUARDED_BY(m_mutex);
+    std::unordered_map<
+        std::string,
+        SessionList::iterator> m_sessionMap FUSION_GUARDED_BY(m_mutex);
+};
+
+//
+// A TLS session layered over a non-blocking stream socket.
+//
+// The SSL engine is run over memory BIOs so the stream never blocks on the
+// socket itself. Every call returns E_NET_WOULD_BLOCK when it needs more I/O
+// and Interest() reports which readiness events should be registered on the
+// SocketService before calling again.
+//
+class TlsStream final
+{
+public:
+    TlsStream(const TlsStream&) = delete;
+    TlsStream& operator=(const TlsStream&) = delete;
+
+public:
+    //
+    //
+    //
+    static Result<std::unique_ptr<TlsStream>> Create(
+        TlsContext& context,
+        Network& network,
+        Socket sock,
+        std::string_view serverName = {});
+
+    //
+    //
+    //
+    TlsStream(
+        TlsContext& context,
+        Network& network,
+        Socket sock);
+
+    //
+    //
+    //
+    ~TlsStream();
+
+    //
+    //
+    //
+    Result<void> Handshake();
+
+    //
+    //
+    //
+    SocketOperation Interest() const;
+
+    //
+    //
+    //
+    bool IsEstablished() const;
+
+    //
+    //
+    //
+    bool IsKernelTls() const;
+
+    //
+    //
+    //
+    bool IsResumed() const;
+
+    //
+    //
+    //
+    Result<size_t> Recv(void* buffer, size_t size);
+
+    //
+    //
+    //
+    Result<size_t> Send(const void* buffer, size_t size);
+
+    //
+    // Flush any encrypted bytes still pending for the socket.
+    //
+    Result<void> Flush();
+
+    //
+    //
+    //
+    Result<void> Shutdown();
+
+    //
+    //
+    //
+    Socket GetSocket() const;
+
+private:
+    friend class TlsContext;
+
+    Result<void> Start(std::string_view serverName);
+
+    Result<void> Fill();
+    Result<void> EnableKernelTls();
+    Failure KernelFailure() const;
+    Failure GetSslFailure(int result, const Error& error) const;
+
+private:
+    TlsContext& m_context;
+    Network& m_network;
+    Socket m_sock{ INVALID_SOCKET };
+
+    ssl_st* m_ssl{ nullptr };
+    bio_st* m_rbio{ nullptr };
+    bio_st* m_wbio{ nullptr };
+
+    std::string m_serverName;
+    std::vector<uint8_t> m_outgoing;
+    size_t m_outgoingOffset{ 0 };
+
+    bool m_established{ false };
+    bool m_kernelTls{ false };
+    bool m_kernelPending{ false };
+    bool m_kernelFailed{ false };
+    bool m_wantRead{ false };
+};
+}  // namespace Fusion
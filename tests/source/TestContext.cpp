@@ -24,3 +24,49 @@ TEST(ContextTests, ContextTest)
     Context ctx;
     FUSION_UNUSED(ctx);
 }
+
+TEST(ContextTests, CancelCallbacks)
+{
+    Context ctx;
+    Context copy = ctx;
+
+    size_t called = 0;
+    uint64_t first = ctx.AddCallback([&] { ++called; });
+    uint64_t second = copy.AddCallback([&] { called += 10; });
+
+    ctx.RemoveCallback(second);
+    FUSION_UNUSED(first);
+
+    ASSERT_FALSE(copy.IsCancelled());
+    copy.Cancel();
+    ASSERT_TRUE(ctx.IsCancelled());
+    ASSERT_FALSE(ctx.IsExpired());
+    ASSERT_EQ(called, 1);
+
+    // Callbacks run once, late registrations run immediately.
+    ctx.Cancel();
+    ASSERT_EQ(called, 1);
+    ctx.AddCallback([&] { called += 100; });
+    ASSERT_EQ(called, 101);
+}
+
+TEST(ContextTests, Deadline)
+{
+    using namespace std::chrono_literals;
+
+    Context ctx;
+    ASSERT_FALSE(ctx.Deadline());
+
+    ctx.CancelAfter(1h);
+    ASSERT_TRUE(ctx.Deadline());
+    ASSERT_GT(*ctx.Deadline(), Clock::now() + 59min);
+    ASSERT_FALSE(ctx.IsCancelled());
+
+    ctx.CancelAt(Clock::now() - 1s);
+    ASSERT_TRUE(ctx.IsCancelled());
+    ASSERT_TRUE(ctx.IsExpired());
+
+    ctx.ReleaseDeadline();
+    ASSERT_FALSE(ctx.Deadline());
+    ASSERT_FALSE(ctx.IsCancelled());
+}
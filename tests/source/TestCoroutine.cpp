@@ -0,0 +1,277 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Coroutine.h>
+#include <Fusion/Memory.h>
+
+#include <array>
+#include <atomic>
+#include <future>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+Task<int> Add(int a, int b)
+{
+    co_return a + b;
+}
+
+Task<int> Sum()
+{
+    const int first = co_await Add(1, 2);
+    const int second = co_await Add(3, 4);
+
+    co_return first + second;
+}
+
+template<typename T>
+Task<void> Capture(Task<T> task, std::promise<T>& result)
+{
+    result.set_value(co_await task);
+}
+
+Task<bool> HopThreads(ThreadPool& pool, Strand& strand)
+{
+    co_await Schedule(pool);
+    const bool onPool = pool.IsRunningInThisThread();
+
+    co_await Schedule(strand);
+    co_return onPool && strand.IsRunningInThisThread();
+}
+
+Task<bool> Hop(ThreadPool& pool)
+{
+    co_await Schedule(pool);
+    co_return pool.IsRunningInThisThread();
+}
+
+Task<Result<size_t>> ReadWhenReady(
+    Reactor& reactor,
+    Network& network,
+    Socket sock,
+    std::array<char, 16>& buffer)
+{
+    if (auto ready = co_await reactor.Readable(sock); !ready)
+    {
+        co_return ready.Error();
+    }
+    co_return network.Recv(sock, buffer.data(), buffer.size());
+}
+
+Task<Clock::duration> Nap(Reactor& reactor, Clock::duration duration)
+{
+    const Clock::time_point start = Clock::now();
+
+    co_await reactor.Sleep(duration);
+    co_return Clock::now() - start;
+}
+
+Task<Result<void>> Doze(Reactor& reactor, Clock::duration duration)
+{
+    co_return co_await reactor.Sleep(duration);
+}
+}  // namespace
+
+TEST(CoroutineTests, Task)
+{
+    std::promise<int> result;
+    Capture(Sum(), result).Detach();
+
+    ASSERT_EQ(result.get_future().get(), 10);
+}
+
+TEST(CoroutineTests, Schedule)
+{
+    ThreadPool pool(ThreadPool::Options{ .threads = 2 });
+    Strand strand(pool);
+
+    std::promise<bool> result;
+    Capture(HopThreads(pool, strand), result).Detach();
+
+    ASSERT_TRUE(result.get_future().get());
+}
+
+TEST(CoroutineTests, ScheduleRefused)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<bool> started{ false };
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .queueCapacity = 1,
+        .overflow = ThreadPool::Overflow::Reject,
+    });
+
+    pool.Post([&started, opened]() {
+        started = true;
+        opened.wait();
+    });
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+    pool.Post([]() { });
+
+    // The full pool refuses the resume, the coroutine carries on here.
+    std::promise<bool> result;
+    Capture(Hop(pool), result).Detach();
+
+    std::future<bool> future = result.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    ASSERT_FALSE(future.get());
+
+    gate.set_value();
+}
+
+class ReactorTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+    std::unique_ptr<SocketService> service;
+    std::unique_ptr<Reactor> reactor;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+        FUSION_ASSERT_RESULT(
+            SocketService::Create(*network),
+            [&](std::unique_ptr<SocketService> s) {
+                service = std::move(s);
+            });
+
+        reactor = std::make_unique<Reactor>(*service);
+    }
+
+    void TearDown() override
+    {
+        reactor.reset();
+
+        if (service)
+        {
+            service->Stop();
+            service.reset();
+        }
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    // Run the reactor until 'future' is ready.
+    template<typename T>
+    void RunUntil(std::future<T>& future)
+    {
+        while (future.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready)
+        {
+            FUSION_ASSERT_RESULT(reactor->Run(std::chrono::seconds(5)));
+        }
+    }
+};
+
+TEST_F(ReactorTests, Readable)
+{
+    std::array<Socket, 2> pair{ INVALID_SOCKET, INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocketPair(AddressFamily::Unix, SocketType::Stream),
+        [&](std::array<Socket, 2> p) {
+            pair = p;
+        });
+    FUSION_SCOPE_GUARD([&] {
+        (void)network->Close(pair[0]);
+        (void)network->Close(pair[1]);
+    });
+
+    std::array<char, 16> buffer{};
+    std::promise<Result<size_t>> result;
+    auto future = result.get_future();
+
+    Capture(ReadWhenReady(*reactor, *network, pair[1], buffer), result)
+        .Detach();
+
+    // Suspended until the peer writes.
+    FUSION_ASSERT_RESULT(
+        reactor->Run(std::chrono::milliseconds(10)),
+        [](size_t resumed) { ASSERT_EQ(resumed, 0); });
+
+    FUSION_ASSERT_RESULT(network->Send(pair[0], "ping", 4));
+    ASSERT_NO_FATAL_FAILURE(RunUntil(future));
+
+    FUSION_ASSERT_RESULT(
+        future.get(),
+        [&](size_t received) {
+            ASSERT_EQ(std::string_view(buffer.data(), received), "ping");
+        });
+}
+
+TEST_F(ReactorTests, Sleep)
+{
+    std::promise<Clock::duration> result;
+    auto future = result.get_future();
+
+    Capture(Nap(*reactor, std::chrono::milliseconds(20)), result).Detach();
+    ASSERT_NO_FATAL_FAILURE(RunUntil(future));
+
+    ASSERT_GE(future.get(), std::chrono::milliseconds(20));
+}
+
+TEST_F(ReactorTests, Destroy)
+{
+    using namespace std::chrono_literals;
+
+    std::array<Socket, 2> pair{ INVALID_SOCKET, INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocketPair(AddressFamily::Unix, SocketType::Stream),
+        [&](std::array<Socket, 2> p) {
+            pair = p;
+        });
+    FUSION_SCOPE_GUARD([&] {
+        (void)network->Close(pair[0]);
+        (void)network->Close(pair[1]);
+    });
+
+    std::array<char, 16> buffer{};
+    std::promise<Result<size_t>> read;
+    std::promise<Result<void>> slept;
+    auto readFuture = read.get_future();
+    auto sleptFuture = slept.get_future();
+
+    Capture(ReadWhenReady(*reactor, *network, pair[1], buffer), read)
+        .Detach();
+    Capture(Doze(*reactor, 1h), slept).Detach();
+
+    FUSION_ASSERT_RESULT(
+        reactor->Run(10ms),
+        [](size_t resumed) { ASSERT_EQ(resumed, 0); });
+
+    // Neither coroutine is left suspended on the destroyed reactor.
+    reactor.reset();
+
+    ASSERT_EQ(readFuture.wait_for(0s), std::future_status::ready);
+    ASSERT_EQ(sleptFuture.wait_for(0s), std::future_status::ready);
+    FUSION_ASSERT_ERROR(readFuture.get(), E_CANCELLED);
+    FUSION_ASSERT_ERROR(sleptFuture.get(), E_CANCELLED);
+}
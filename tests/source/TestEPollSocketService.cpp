@@ -82,3 +82,63 @@ TEST_F(SocketServiceTests, EPollStartupShutdown)
     }
 #endif  // FUSION_PLATFORM_LINUX
 }
+
+TEST_F(SocketServiceTests, EPollBusyPoll)
+{
+#if FUSION_PLATFORM_LINUX
+    using namespace std::chrono;
+
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(
+            SocketService::Type::Epoll,
+            *network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+
+    SocketService::BusyPoll busyPoll;
+    busyPoll.spin = milliseconds(2);
+    FUSION_ASSERT_RESULT(service->SetBusyPoll(busyPoll));
+
+    FUSION_ASSERT_RESULT(
+        service->Add(pair->Reader(), SocketOperation::Read));
+
+    std::span<SocketEvent> events;
+
+    // Nothing is readable, the spin budget is spent before blocking.
+    FUSION_ASSERT_RESULT(
+        service->Execute(milliseconds(5)),
+        [&](auto ev) {
+            events = std::move(ev);
+        });
+    ASSERT_TRUE(events.empty());
+
+    SocketService::Stats stats = service->GetStats();
+    ASSERT_GT(stats.spinPolls, 0);
+    ASSERT_EQ(stats.spinWakeups, 0);
+    ASSERT_EQ(stats.blocks, 1);
+    ASSERT_GE(stats.spinTime, milliseconds(2));
+
+    // Pending data is picked up while spinning without ever blocking.
+    constexpr std::string_view message = "spin"sv;
+    FUSION_ASSERT_RESULT(network->Send(
+        pair->Writer(),
+        message.data(),
+        message.size()));
+
+    FUSION_ASSERT_RESULT(
+        service->Execute(milliseconds(100)),
+        [&](auto ev) {
+            events = std::move(ev);
+        });
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].sock, pair->Reader());
+
+    stats = service->GetStats();
+    ASSERT_EQ(stats.spinWakeups, 1);
+    ASSERT_EQ(stats.blocks, 1);
+
+    FUSION_ASSERT_RESULT(
+        service->Remove(pair->Reader(), SocketOperation::Read));
+#endif  // FUSION_PLATFORM_LINUX
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Future.h>
+#include <Fusion/Thread.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(FutureTests, Then)
+{
+    Promise<int> promise;
+
+    auto future = promise.GetFuture()
+        .Then([](int value) { return value * 2; })
+        .Then([](int value) { return std::to_string(value); });
+
+    ASSERT_FALSE(future.IsReady());
+    promise.Set(21);
+
+    auto result = future.Get();
+    FUSION_ASSERT_RESULT(result);
+    ASSERT_EQ(*result, "42");
+    ASSERT_FALSE(future.Valid());
+
+    // Attached after the value arrived, the continuation runs right away.
+    auto ready = MakeReadyFuture<int>(1)
+        .Then([](int value) { FUSION_UNUSED(value); });
+
+    ASSERT_TRUE(ready.IsReady());
+    FUSION_ASSERT_RESULT(ready.Get());
+}
+
+TEST(FutureTests, Failure)
+{
+    std::atomic<int> calls{ 0 };
+
+    auto failed = MakeReadyFuture<int>(Failure(E_NOT_FOUND))
+        .Then([&](int value) { ++calls; return value; })
+        .Then([&](int value) { ++calls; FUSION_UNUSED(value); });
+
+    FUSION_ASSERT_ERROR(failed.Get(), E_NOT_FOUND);
+    ASSERT_EQ(calls, 0);
+
+    auto rejected = MakeReadyFuture<int>(1)
+        .Then([](int value) -> Result<int> {
+            FUSION_UNUSED(value);
+            return Failure(E_INVALID_ARGUMENT);
+        })
+        .Then([&](int value) { ++calls; return value; });
+
+    FUSION_ASSERT_ERROR(rejected.Get(), E_INVALID_ARGUMENT);
+    ASSERT_EQ(calls, 0);
+
+    Future<int> broken;
+    {
+        Promise<int> promise;
+        broken = promise.GetFuture();
+    }
+    FUSION_ASSERT_ERROR(broken.Get(), E_CANCELLED);
+}
+
+TEST(FutureTests, Executor)
+{
+    ThreadPool pool(ThreadPool::Options{ .threads = 2 });
+    Strand strand(pool);
+
+    const auto caller = std::this_thread::get_id();
+
+    auto future = pool.Async([] { return 20; })
+        .Then([&](int value) {
+            EXPECT_NE(std::this_thread::get_id(), caller);
+            return value + 1;
+        }, pool)
+        .Then([&](int value) {
+            EXPECT_TRUE(strand.IsRunningInThisThread());
+            return value * 2;
+        }, strand);
+
+    auto result = future.Get();
+    FUSION_ASSERT_RESULT(result);
+    ASSERT_EQ(*result, 42);
+
+    auto failed = pool.Async([]() -> Result<void> {
+            return Failure(E_NOT_FOUND);
+        })
+        .Then([] { return 1; }, pool);
+
+    FUSION_ASSERT_ERROR(failed.Get(), E_NOT_FOUND);
+}
+
+TEST(FutureTests, WhenAll)
+{
+    ThreadPool pool(ThreadPool::Options{ .threads = 2 });
+
+    std::vector<Future<size_t>> futures;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        futures.push_back(pool.Async([i] { return i * i; }));
+    }
+
+    auto all = WhenAll(std::move(futures))
+        .Then([](std::vector<size_t> values) {
+            size_t sum = 0;
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                EXPECT_EQ(values[i], i * i);
+                sum += values[i];
+            }
+            return sum;
+        });
+
+    auto result = all.Get();
+    FUSION_ASSERT_RESULT(result);
+    ASSERT_EQ(*result, 1240u);
+
+    Promise<void> pending;
+    std::vector<Future<void>> steps;
+    steps.push_back(pool.Async([] { }));
+    steps.push_back(MakeReadyFuture<void>(Failure(E_NOT_FOUND)));
+    steps.push_back(pending.GetFuture());
+
+    // The first failure completes the whole, without waiting for the rest.
+    FUSION_ASSERT_ERROR(WhenAll(std::move(steps)).Get(), E_NOT_FOUND);
+
+    FUSION_ASSERT_RESULT(WhenAll(std::vector<Future<int>>{}).Get());
+}
+
+TEST(FutureTests, WhenAny)
+{
+    std::vector<Promise<int>> promises(3);
+    std::vector<Future<int>> futures;
+
+    for (auto& promise : promises)
+    {
+        futures.push_back(promise.GetFuture());
+    }
+
+    auto any = WhenAny(std::move(futures));
+    ASSERT_FALSE(any.IsReady());
+
+    promises[1].Set(7);
+    promises[0].Set(3);
+
+    auto result = any.Get();
+    FUSION_ASSERT_RESULT(result);
+    ASSERT_EQ(result->first, 1u);
+    ASSERT_EQ(result->second, 7);
+
+    FUSION_ASSERT_ERROR(
+        WhenAny(std::vector<Future<int>>{}).Get(),
+        E_INVALID_ARGUMENT);
+}
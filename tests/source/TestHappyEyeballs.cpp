@@ -0,0 +1,241 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/HappyEyeballs.h>
+#include <Fusion/Memory.h>
+
+#include <thread>
+#include <vector>
+
+class HappyEyeballsTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+    std::vector<Socket> sockets;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+    }
+
+    void TearDown() override
+    {
+        for (Socket sock : sockets)
+        {
+            (void)network->Close(sock);
+        }
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    void Listen(SocketConfig config, SocketAddress bind, SocketAddress& address)
+    {
+        Socket listener{ INVALID_SOCKET };
+        FUSION_ASSERT_RESULT(
+            network->CreateSocket(config),
+            [&](Socket s) {
+                listener = s;
+            });
+        sockets.push_back(listener);
+
+        FUSION_ASSERT_RESULT(network->Bind(listener, bind));
+        FUSION_ASSERT_RESULT(network->Listen(listener, 16));
+        FUSION_ASSERT_RESULT(
+            network->GetSockName(listener),
+            [&](SocketAddress name) {
+                address = name;
+            });
+    }
+
+    static AddressInfo Info(SocketAddress address)
+    {
+        return AddressInfo{
+            .family = address.Family(),
+            .type = SocketType::Stream,
+            .protocol = SocketProtocol::Tcp,
+            .address = address,
+        };
+    }
+};
+
+TEST_F(HappyEyeballsTests, Sort)
+{
+    std::vector<AddressInfo> addresses = {
+        Info({ InaddrLoopback6, 1 }),
+        Info({ InaddrLoopback6, 2 }),
+        Info({ InaddrLoopback, 3 }),
+        Info({ InaddrLoopback6, 4 }),
+        Info({ InaddrLoopback, 5 }),
+        AddressInfo{},
+    };
+
+    auto ports = [](const std::vector<AddressInfo>& sorted) {
+        std::vector<uint16_t> p;
+        for (const AddressInfo& info : sorted)
+        {
+            p.push_back(info.address.Family() == AddressFamily::Inet6
+                ? info.address.Inet6().port
+                : info.address.Inet().port);
+        }
+        return p;
+    };
+
+    ASSERT_EQ(ports(SortHappyEyeballs(addresses)),
+        (std::vector<uint16_t>{ 1, 3, 2, 5, 4 }));
+    ASSERT_EQ(ports(SortHappyEyeballs(addresses, 2)),
+        (std::vector<uint16_t>{ 1, 2, 3, 4, 5 }));
+    ASSERT_TRUE(SortHappyEyeballs({}).empty());
+}
+
+TEST_F(HappyEyeballsTests, FallsBackToInet4)
+{
+    SocketAddress address;
+    ASSERT_NO_FATAL_FAILURE(Listen(TCPv4, { InaddrLoopback, 0 }, address));
+
+    // Nothing listens on the Inet6 loopback, the attempt is refused and the
+    // Inet4 address is tried without waiting out the attempt delay.
+    std::vector<AddressInfo> addresses = {
+        Info({ InaddrLoopback6, address.Inet().port }),
+        Info(address),
+    };
+
+    HappyEyeballsParams params;
+    params.attemptDelay = std::chrono::seconds(30);
+
+    Context ctx(std::chrono::seconds(10));
+    auto start = Clock::now();
+
+    FUSION_ASSERT_RESULT(
+        ConnectHappyEyeballs(*network, addresses, ctx, params),
+        [&](HappyEyeballsConnection connection) {
+            sockets.push_back(connection.sock);
+            ASSERT_EQ(connection.info.address.Family(), AddressFamily::Inet4);
+        });
+    ASSERT_LT(Clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(HappyEyeballsTests, PrefersFirstFamily)
+{
+    SocketAddress address4;
+    SocketAddress address6;
+    ASSERT_NO_FATAL_FAILURE(Listen(TCPv4, { InaddrLoopback, 0 }, address4));
+    ASSERT_NO_FATAL_FAILURE(Listen(TCPv6, { InaddrLoopback6, 0 }, address6));
+
+    std::vector<AddressInfo> addresses = { Info(address6), Info(address4) };
+
+    FUSION_ASSERT_RESULT(
+        ConnectHappyEyeballs(*network, addresses, Context()),
+        [&](HappyEyeballsConnection connection) {
+            sockets.push_back(connection.sock);
+            ASSERT_EQ(connection.info.address.Family(), AddressFamily::Inet6);
+        });
+}
+
+TEST_F(HappyEyeballsTests, Failures)
+{
+    SocketAddress address;
+    ASSERT_NO_FATAL_FAILURE(Listen(TCPv4, { InaddrLoopback, 0 }, address));
+
+    // The listener only exists on Inet4, both of these are refused.
+    std::vector<AddressInfo> refused = {
+        Info({ InaddrLoopback6, address.Inet().port }),
+    };
+    FUSION_ASSERT_ERROR(
+        ConnectHappyEyeballs(*network, refused, Context()),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_CONN_REFUSED); });
+
+    std::vector<AddressInfo> addresses = { Info(address) };
+    Context cancelled;
+    cancelled.Cancel();
+
+    FUSION_ASSERT_ERROR(
+        ConnectHappyEyeballs(*network, addresses, cancelled),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_CANCELLED); });
+
+    FUSION_ASSERT_FAILURE(ConnectHappyEyeballs(*network, {}, Context()));
+}
+
+#if FUSION_PLATFORM_LINUX
+TEST_F(HappyEyeballsTests, BlackHoledFirstAddress)
+{
+    using namespace std::chrono_literals;
+
+    SocketAddress address4;
+    SocketAddress address6;
+    ASSERT_NO_FATAL_FAILURE(Listen(TCPv4, { InaddrLoopback, 0 }, address4));
+
+    Socket listener{ INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocket(TCPv6),
+        [&](Socket s) {
+            listener = s;
+        });
+    sockets.push_back(listener);
+
+    FUSION_ASSERT_RESULT(network->Bind(listener, { InaddrLoopback6, 0 }));
+    FUSION_ASSERT_RESULT(network->Listen(listener, 0));
+    FUSION_ASSERT_RESULT(
+        network->GetSockName(listener),
+        [&](SocketAddress name) {
+            address6 = name;
+        });
+
+    // Linux drops SYNs while the accept queue is full, an unaccepted
+    // connection beyond the backlog leaves later attempts hanging.
+    for (int i = 0; i < 2; ++i)
+    {
+        Socket filler{ INVALID_SOCKET };
+        FUSION_ASSERT_RESULT(
+            network->CreateSocket(TCPv6),
+            [&](Socket s) {
+                filler = s;
+            });
+        sockets.push_back(filler);
+
+        FUSION_ASSERT_RESULT(network->SetBlocking(filler, false));
+        (void)network->Connect(filler, address6);
+    }
+    std::this_thread::sleep_for(50ms);
+
+    std::vector<AddressInfo> addresses = { Info(address6), Info(address4) };
+
+    HappyEyeballsParams params;
+    params.attemptDelay = 100ms;
+
+    auto start = Clock::now();
+
+    FUSION_ASSERT_RESULT(
+        ConnectHappyEyeballs(*network, addresses, Context(10s), params),
+        [&](HappyEyeballsConnection connection) {
+            sockets.push_back(connection.sock);
+            ASSERT_EQ(connection.info.address.Family(), AddressFamily::Inet4);
+        });
+
+    auto elapsed = Clock::now() - start;
+    ASSERT_GE(elapsed, 100ms);
+    ASSERT_LT(elapsed, 5s);
+}
+#endif  // FUSION_PLATFORM_LINUX
@@ -0,0 +1,384 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Http.h>
+#include <Fusion/Memory.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal keep-alive HTTP/1.1 server which echoes the request path.
+class HttpStub
+{
+public:
+    explicit HttpStub(Network& network)
+        : m_network(network)
+    { }
+
+    ~HttpStub()
+    {
+        Stop();
+    }
+
+    Result<uint16_t> Start()
+    {
+        if (auto result = m_network.CreateSocket(TCPv4); !result)
+        {
+            return result.Error();
+        }
+        else
+        {
+            m_listener = *result;
+        }
+
+        SocketAddress address{ InaddrLoopback, 0 };
+        if (auto result = m_network.Bind(m_listener, address); !result)
+        {
+            return result.Error();
+        }
+        if (auto result = m_network.Listen(m_listener, 64); !result)
+        {
+            return result.Error();
+        }
+
+        auto name = m_network.GetSockName(m_listener);
+        if (!name)
+        {
+            return name.Error();
+        }
+
+        m_thread = std::thread([this] { Run(); });
+        return name->Inet().port;
+    }
+
+    void Stop()
+    {
+        if (m_listener != INVALID_SOCKET)
+        {
+            (void)m_network.Shutdown(m_listener, SocketShutdownMode::Both);
+        }
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        if (m_listener != INVALID_SOCKET)
+        {
+            (void)m_network.Close(m_listener);
+            m_listener = INVALID_SOCKET;
+        }
+
+        std::unique_lock lock(m_mutex);
+        for (Socket sock : m_clients)
+        {
+            (void)m_network.Shutdown(sock, SocketShutdownMode::Both);
+        }
+        for (std::thread& thread : m_workers)
+        {
+            thread.join();
+        }
+        for (Socket sock : m_clients)
+        {
+            (void)m_network.Close(sock);
+        }
+        m_workers.clear();
+        m_clients.clear();
+    }
+
+    size_t Connections() const
+    {
+        return m_connections;
+    }
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            auto accepted = m_network.Accept(m_listener);
+            if (!accepted)
+            {
+                return;
+            }
+
+            ++m_connections;
+
+            std::unique_lock lock(m_mutex);
+            m_clients.push_back(accepted->sock);
+            m_workers.emplace_back(
+                [this, sock = accepted->sock] { Serve(sock); });
+        }
+    }
+
+    void Serve(Socket sock)
+    {
+        std::string request;
+        std::array<char, 512> buffer{};
+
+        while (true)
+        {
+            size_t end = request.find("\r\n\r\n");
+            if (end == std::string::npos)
+            {
+                auto received = m_network.Recv(
+                    sock,
+                    buffer.data(),
+                    buffer.size());
+                if (!received || *received == 0)
+                {
+                    return;
+                }
+                request.append(buffer.data(), *received);
+                continue;
+            }
+
+            size_t start = request.find(' ') + 1;
+            std::string path = request.substr(
+                start,
+                request.find(' ', start) - start);
+            request.erase(0, end + 4);
+
+            std::string response = fmt::format(
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Length: {}\r\n"
+                "X-Fusion: stub\r\n"
+                "\r\n"
+                "{}",
+                path.size(),
+                path);
+
+            if (!m_network.Send(sock, response.data(), response.size()))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    Network& m_network;
+    Socket m_listener{ INVALID_SOCKET };
+    std::thread m_thread;
+    std::atomic<size_t> m_connections{ 0 };
+
+    std::mutex m_mutex;
+    std::vector<Socket> m_clients;
+    std::vector<std::thread> m_workers;
+};
+
+class HttpClientTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+    std::unique_ptr<SocketService> service;
+    std::unique_ptr<HttpStub> stub;
+    uint16_t port{ 0 };
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+        FUSION_ASSERT_RESULT(
+            SocketService::Create(*network),
+            [&](std::unique_ptr<SocketService> s) {
+                service = std::move(s);
+            });
+
+        stub = std::make_unique<HttpStub>(*network);
+        FUSION_ASSERT_RESULT(
+            stub->Start(),
+            [&](uint16_t p) {
+                port = p;
+            });
+    }
+
+    void TearDown() override
+    {
+        stub.reset();
+
+        if (service)
+        {
+            service->Stop();
+            service.reset();
+        }
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+};
+
+TEST_F(HttpClientTests, ConcurrentRequestsReuseConnections)
+{
+    constexpr size_t REQUESTS = 32;
+    constexpr size_t WINDOW = 4;
+
+    HttpClient::Params params;
+    params.maxInFlight = WINDOW;
+
+    std::unique_ptr<HttpClient> client;
+    FUSION_ASSERT_RESULT(
+        HttpClient::Create(*service, params),
+        [&](std::unique_ptr<HttpClient> c) {
+            client = std::move(c);
+        });
+
+    size_t completed = 0;
+    size_t maxInFlight = 0;
+
+    for (size_t i = 0; i < REQUESTS; ++i)
+    {
+        HttpRequest request;
+        request.url = fmt::format("http://127.0.0.1:{}/item/{}", port, i);
+
+        FUSION_ASSERT_RESULT(client->Submit(
+            std::move(request),
+            [&, i](Result<HttpResponse> result) {
+                ++completed;
+                FUSION_ASSERT_RESULT(std::move(result), [&](HttpResponse response) {
+                    EXPECT_EQ(response.status, 200);
+                    EXPECT_EQ(response.body, fmt::format("/item/{}", i));
+
+                    auto header = std::find_if(
+                        response.headers.begin(),
+                        response.headers.end(),
+                        [](const auto& h) { return h.first == "X-Fusion"; });
+                    ASSERT_NE(header, response.headers.end());
+                    EXPECT_EQ(header->second, "stub");
+                });
+            }));
+
+        maxInFlight = std::max(maxInFlight, client->InFlight());
+    }
+
+    ASSERT_EQ(client->InFlight(), WINDOW);
+    ASSERT_EQ(client->Pending(), REQUESTS - WINDOW);
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (completed < REQUESTS && Clock::now() < deadline)
+    {
+        FUSION_ASSERT_RESULT(client->Execute(std::chrono::milliseconds(100)));
+        maxInFlight = std::max(maxInFlight, client->InFlight());
+    }
+
+    ASSERT_EQ(completed, REQUESTS);
+    ASSERT_LE(maxInFlight, WINDOW);
+    ASSERT_EQ(client->InFlight(), 0);
+    ASSERT_EQ(client->Pending(), 0);
+
+    // Every transfer after the first window rides an existing connection.
+    ASSERT_LE(stub->Connections(), WINDOW);
+}
+
+TEST_F(HttpClientTests, ConnectionRefused)
+{
+    // Bind without listening to reserve a port nobody accepts on.
+    Socket sock{ INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocket(TCPv4),
+        [&](Socket s) {
+            sock = s;
+        });
+    FUSION_SCOPE_GUARD([&] { (void)network->Close(sock); });
+
+    SocketAddress address{ InaddrLoopback, 0 };
+    FUSION_ASSERT_RESULT(network->Bind(sock, address));
+
+    uint16_t closedPort = 0;
+    FUSION_ASSERT_RESULT(
+        network->GetSockName(sock),
+        [&](SocketAddress name) {
+            closedPort = name.Inet().port;
+        });
+
+    std::unique_ptr<HttpClient> client;
+    FUSION_ASSERT_RESULT(
+        HttpClient::Create(*service, HttpClient::Params{}),
+        [&](std::unique_ptr<HttpClient> c) {
+            client = std::move(c);
+        });
+
+    bool done = false;
+
+    HttpRequest request;
+    request.url = fmt::format("http://127.0.0.1:{}/", closedPort);
+
+    FUSION_ASSERT_RESULT(client->Submit(
+        std::move(request),
+        [&](Result<HttpResponse> result) {
+            done = true;
+            ASSERT_FALSE(result);
+            EXPECT_EQ(result.Error().Error(), E_NET_CONN_REFUSED);
+        }));
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (!done && Clock::now() < deadline)
+    {
+        FUSION_ASSERT_RESULT(client->Execute(std::chrono::milliseconds(100)));
+    }
+    ASSERT_TRUE(done);
+}
+
+TEST_F(HttpClientTests, DestroyCancelsOutstanding)
+{
+    HttpClient::Params params;
+    params.maxInFlight = 1;
+
+    std::unique_ptr<HttpClient> client;
+    FUSION_ASSERT_RESULT(
+        HttpClient::Create(*service, params),
+        [&](std::unique_ptr<HttpClient> c) {
+            client = std::move(c);
+        });
+
+    size_t cancelled = 0;
+    HttpClient* raw = client.get();
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        HttpRequest request;
+        request.url = fmt::format("http://127.0.0.1:{}/", port);
+
+        FUSION_ASSERT_RESULT(client->Submit(
+            std::move(request),
+            [&](Result<HttpResponse> result) {
+                ASSERT_FALSE(result);
+                EXPECT_EQ(result.Error().Error(), E_CANCELLED);
+                ++cancelled;
+
+                // Resubmitting from a cancelled completion is refused.
+                HttpRequest retry;
+                retry.url = fmt::format("http://127.0.0.1:{}/", port);
+                auto retried = raw->Submit(std::move(retry), nullptr);
+                ASSERT_FALSE(retried);
+                EXPECT_EQ(retried.Error().Error(), E_CANCELLED);
+            }));
+    }
+
+    FUSION_ASSERT_FAILURE(client->Submit(HttpRequest{}, nullptr));
+
+    client.reset();
+    ASSERT_EQ(cancelled, 3);
+}
@@ -13,3 +13,378 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  **/
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Memory.h>
+#include <Fusion/Network.h>
+
+#include <array>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+class NetworkTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+    }
+
+    void TearDown() override
+    {
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    void BindUdp(Socket& sock, SocketAddress& address)
+    {
+        FUSION_ASSERT_RESULT(
+            network->CreateSocket(UDPv4),
+            [&](Socket s) {
+                sock = s;
+            });
+
+        SocketAddress any{ InaddrLoopback, 0 };
+        FUSION_ASSERT_RESULT(network->Bind(sock, any));
+        FUSION_ASSERT_RESULT(
+            network->GetSockName(sock),
+            [&](SocketAddress name) {
+                address = name;
+            });
+    }
+};
+
+TEST_F(NetworkTests, SendToSegmented)
+{
+    constexpr size_t SEGMENT = 1000;
+    constexpr size_t COUNT = 10;
+
+    Socket receiver{ INVALID_SOCKET };
+    Socket sender{ INVALID_SOCKET };
+    SocketAddress receiverAddress;
+    SocketAddress senderAddress;
+
+    FUSION_SCOPE_GUARD([&] {
+        (void)network->Close(receiver);
+        (void)network->Close(sender);
+    });
+    ASSERT_NO_FATAL_FAILURE(BindUdp(receiver, receiverAddress));
+    ASSERT_NO_FATAL_FAILURE(BindUdp(sender, senderAddress));
+
+    // Coalescing is best effort, the receive loop below copes either way.
+    bool gro = bool(network->SetSocketOption(
+        receiver,
+        SocketOptions::UdpGro(true)));
+
+    std::vector<uint8_t> payload(SEGMENT * COUNT + SEGMENT / 2);
+    std::iota(payload.begin(), payload.end(), uint8_t(0));
+
+    FUSION_ASSERT_FAILURE(network->SendToSegmented(
+        sender,
+        receiverAddress,
+        payload.data(),
+        payload.size(),
+        0));
+
+    // Segments beyond the largest UDP payload are refused, not looped on.
+    constexpr size_t UDP_MAX_PAYLOAD = size_t(UINT16_MAX) - 8 - 40;
+    std::vector<uint8_t> large(UDP_MAX_PAYLOAD + 2);
+
+    FUSION_ASSERT_ERROR(
+        network->SendToSegmented(
+            sender,
+            receiverAddress,
+            large.data(),
+            large.size(),
+            UDP_MAX_PAYLOAD + 1),
+        E_INVALID_ARGUMENT);
+
+    FUSION_ASSERT_RESULT(
+        network->SendToSegmented(
+            sender,
+            receiverAddress,
+            payload.data(),
+            payload.size(),
+            SEGMENT),
+        [&](size_t sent) {
+            ASSERT_EQ(sent, payload.size());
+        });
+
+    std::vector<uint8_t> received;
+    std::vector<uint8_t> buffer(UINT16_MAX);
+    size_t datagrams = 0;
+
+    while (received.size() < payload.size())
+    {
+        FUSION_ASSERT_RESULT(
+            network->RecvFrom(receiver, buffer.data(), buffer.size()),
+            [&](Network::RecvFromData data) {
+                ASSERT_EQ(data.address, senderAddress);
+
+                if (data.segmentSize == 0)
+                {
+                    ASSERT_LE(data.received, SEGMENT);
+                    ++datagrams;
+                }
+                else
+                {
+                    ASSERT_TRUE(gro);
+                    ASSERT_EQ(data.segmentSize, SEGMENT);
+                    datagrams += (data.received + SEGMENT - 1) / SEGMENT;
+                }
+                received.insert(
+                    received.end(),
+                    buffer.begin(),
+                    buffer.begin() + data.received);
+            });
+    }
+
+    ASSERT_EQ(datagrams, COUNT + 1);
+    ASSERT_EQ(received, payload);
+}
+
+TEST_F(NetworkTests, ListenerHandoff)
+{
+#if FUSION_PLATFORM_POSIX
+    std::array<Socket, 2> channel{ INVALID_SOCKET, INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocketPair(AddressFamily::Unix, SocketType::Stream),
+        [&](std::array<Socket, 2> socks) {
+            channel = socks;
+        });
+
+    std::vector<ListenerDescriptor> listeners;
+    std::vector<Socket> inherited;
+    Socket client{ INVALID_SOCKET };
+
+    FUSION_SCOPE_GUARD([&] {
+        for (Socket sock : channel)
+        {
+            (void)network->Close(sock);
+        }
+        for (const ListenerDescriptor& listener : listeners)
+        {
+            (void)network->Close(listener.sock);
+        }
+        for (Socket sock : inherited)
+        {
+            (void)network->Close(sock);
+        }
+        (void)network->Close(client);
+    });
+
+    for (std::string name : { "http", "https", "admin" })
+    {
+        ListenerDescriptor listener{ .name = name };
+        FUSION_ASSERT_RESULT(
+            network->CreateSocket(TCPv4),
+            [&](Socket s) {
+                listener.sock = s;
+            });
+        listeners.push_back(listener);
+
+        SocketAddress any{ InaddrLoopback, 0 };
+        FUSION_ASSERT_RESULT(network->Bind(listener.sock, any));
+        FUSION_ASSERT_RESULT(network->Listen(listener.sock, 16));
+    }
+
+    SocketAddress address;
+    FUSION_ASSERT_RESULT(
+        network->GetSockName(listeners[1].sock),
+        [&](SocketAddress name) {
+            address = name;
+        });
+
+    // A connection waiting in the accept queue survives the handoff.
+    FUSION_ASSERT_RESULT(
+        network->CreateSocket(TCPv4),
+        [&](Socket s) {
+            client = s;
+        });
+    FUSION_ASSERT_RESULT(network->Connect(client, address));
+
+    FUSION_ASSERT_RESULT(SendListeners(*network, channel[0], listeners));
+
+    FUSION_ASSERT_RESULT(
+        RecvListeners(*network, channel[1]),
+        [&](std::vector<ListenerDescriptor> received) {
+            ASSERT_EQ(received.size(), listeners.size());
+
+            for (size_t i = 0; i < received.size(); ++i)
+            {
+                inherited.push_back(received[i].sock);
+
+                ASSERT_EQ(received[i].name, listeners[i].name);
+                ASSERT_NE(received[i].sock, listeners[i].sock);
+            }
+        });
+
+    // The predecessor goes away, its accept queue does not.
+    for (ListenerDescriptor& listener : listeners)
+    {
+        FUSION_ASSERT_RESULT(network->Close(listener.sock));
+        listener.sock = INVALID_SOCKET;
+    }
+
+    FUSION_ASSERT_RESULT(
+        network->Accept(inherited[1]),
+        [&](Network::AcceptedSocketData accepted) {
+            FUSION_ASSERT_RESULT(network->Send(client, "x", 1));
+
+            char byte = 0;
+            FUSION_ASSERT_RESULT(network->Recv(accepted.sock, &byte, 1));
+            ASSERT_EQ(byte, 'x');
+            FUSION_ASSERT_RESULT(network->Close(accepted.sock));
+        });
+#endif  // FUSION_PLATFORM_POSIX
+}
+
+TEST_F(NetworkTests, RecvDescriptorsOverflow)
+{
+#if FUSION_PLATFORM_POSIX
+    std::array<Socket, 2> channel{ INVALID_SOCKET, INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->CreateSocketPair(AddressFamily::Unix, SocketType::Stream),
+        [&](std::array<Socket, 2> socks) {
+            channel = socks;
+        });
+    FUSION_SCOPE_GUARD([&] {
+        (void)network->Close(channel[0]);
+        (void)network->Close(channel[1]);
+    });
+
+    std::array<Socket, 2> sent = channel;
+    FUSION_ASSERT_RESULT(
+        network->SendDescriptors(channel[0], sent, nullptr, 0),
+        [](size_t size) {
+            ASSERT_EQ(size, 1);
+        });
+
+    std::array<Socket, 1> received{ INVALID_SOCKET };
+    char byte = 0;
+
+    FUSION_ASSERT_ERROR(
+        network->RecvDescriptors(channel[1], received, &byte, 1),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_SIZE_EXCEEDED); });
+#endif  // FUSION_PLATFORM_POSIX
+}
+
+TEST_F(NetworkTests, ConnectWithData)
+{
+    using namespace SocketOptions;
+
+    Socket listener{ INVALID_SOCKET };
+    Socket client{ INVALID_SOCKET };
+
+    FUSION_SCOPE_GUARD([&] {
+        (void)network->Close(listener);
+        (void)network->Close(client);
+    });
+
+    FUSION_ASSERT_RESULT(
+        network->CreateSocket(TCPv4),
+        [&](Socket s) {
+            listener = s;
+        });
+
+#if FUSION_PLATFORM_LINUX
+    FUSION_ASSERT_RESULT(network->SetSocketOption(listener, TcpFastOpen(16)));
+#endif
+
+    SocketAddress any{ InaddrLoopback, 0 };
+    FUSION_ASSERT_RESULT(network->Bind(listener, any));
+    FUSION_ASSERT_RESULT(network->Listen(listener, 16));
+
+    SocketAddress address;
+    FUSION_ASSERT_RESULT(
+        network->GetSockName(listener),
+        [&](SocketAddress name) {
+            address = name;
+        });
+
+    FUSION_ASSERT_RESULT(
+        network->CreateSocket(TCPv4),
+        [&](Socket s) {
+            client = s;
+        });
+
+    // Whether or not a cookie is cached the request reaches the server, on
+    // a blocking socket the call only returns once it was sent.
+    const std::string request = "GET / HTTP/1.1\r\n\r\n";
+    FUSION_ASSERT_RESULT(
+        network->ConnectWithData(client, address, request.data(), request.size()),
+        [&](size_t sent) {
+            ASSERT_EQ(sent, request.size());
+        });
+
+    Socket server{ INVALID_SOCKET };
+    FUSION_ASSERT_RESULT(
+        network->Accept(listener),
+        [&](Network::AcceptedSocketData accepted) {
+            server = accepted.sock;
+        });
+    FUSION_SCOPE_GUARD([&] { (void)network->Close(server); });
+
+    std::string received;
+    std::array<char, 64> buffer{};
+
+    while (received.size() < request.size())
+    {
+        auto result = network->Recv(server, buffer.data(), buffer.size());
+        ASSERT_TRUE(result);
+        ASSERT_GT(*result, 0);
+        received.append(buffer.data(), *result);
+    }
+    ASSERT_EQ(received, request);
+}
+
+TEST_F(NetworkTests, RecvWithContext)
+{
+    using namespace std::chrono_literals;
+
+    std::unique_ptr<SocketPair> pair;
+    FUSION_ASSERT_RESULT(
+        SocketPair::Create(*network, SocketPair::Type::Blocking),
+        [&](std::unique_ptr<SocketPair> p) {
+            pair = std::move(p);
+        });
+    FUSION_SCOPE_GUARD([&] { pair->Stop(); });
+
+    std::array<char, 16> buffer{};
+
+    Context timeout(30ms);
+    FUSION_ASSERT_ERROR(
+        network->Recv(pair->Reader(), buffer.data(), buffer.size(), timeout),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_TIMEOUT); });
+
+    Context ctx(10s);
+    FUSION_ASSERT_RESULT(network->Send(pair->Writer(), "ping", 4, ctx));
+    FUSION_ASSERT_RESULT(
+        network->Recv(pair->Reader(), buffer.data(), buffer.size(), ctx),
+        [](size_t size) { ASSERT_EQ(size, 4); });
+
+    // Cancellation wakes a blocked reader without waiting for the deadline.
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(20ms);
+        ctx.Cancel();
+    });
+
+    auto start = Clock::now();
+    FUSION_ASSERT_ERROR(
+        network->Recv(pair->Reader(), buffer.data(), buffer.size(), ctx),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_CANCELLED); });
+    canceller.join();
+    ASSERT_LT(Clock::now() - start, 5s);
+}
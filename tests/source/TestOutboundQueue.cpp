@@ -0,0 +1,196 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/OutboundQueue.h>
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+class OutboundQueueTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+    std::unique_ptr<SocketService> service;
+    std::unique_ptr<SocketPair> pair;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+        FUSION_ASSERT_RESULT(
+            SocketService::Create(*network),
+            [&](std::unique_ptr<SocketService> s) {
+                service = std::move(s);
+            });
+        FUSION_ASSERT_RESULT(
+            SocketPair::Create(
+                *network,
+                SocketPair::Type::NonBlocking),
+            [&](std::unique_ptr<SocketPair> p) {
+                pair = std::move(p);
+            });
+    }
+
+    void TearDown() override
+    {
+        if (service)
+        {
+            service->Stop();
+            service.reset();
+        }
+        if (pair)
+        {
+            pair->Stop();
+            pair.reset();
+        }
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    bool IsWritable(Socket sock)
+    {
+        auto result = service->Execute(std::chrono::milliseconds(10));
+        if (!result)
+        {
+            return false;
+        }
+        for (const SocketEvent& event : *result)
+        {
+            if (event.sock == sock)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+TEST_F(OutboundQueueTests, InvalidParams)
+{
+    OutboundQueue::Params params;
+    params.lowWatermark = params.highWatermark + 1;
+
+    FUSION_ASSERT_FAILURE(OutboundQueue::Create(
+        *network,
+        *service,
+        pair->Writer(),
+        params));
+
+    params = OutboundQueue::Params{};
+    params.limit = params.highWatermark - 1;
+
+    FUSION_ASSERT_FAILURE(OutboundQueue::Create(
+        *network,
+        *service,
+        pair->Writer(),
+        params));
+}
+
+TEST_F(OutboundQueueTests, PauseAndResume)
+{
+    OutboundQueue::Params params;
+    params.highWatermark = 64 * 1024;
+    params.lowWatermark = 16 * 1024;
+    params.chunkSize = 4 * 1024;
+
+    std::vector<bool> signals;
+    std::unique_ptr<OutboundQueue> queue;
+
+    FUSION_ASSERT_RESULT(
+        OutboundQueue::Create(
+            *network,
+            *service,
+            pair->Writer(),
+            params,
+            [&](bool paused) { signals.push_back(paused); }),
+        [&](std::unique_ptr<OutboundQueue> q) {
+            queue = std::move(q);
+        });
+
+    // Nothing was ever queued, the socket is not polled for writes.
+    ASSERT_FALSE(IsWritable(pair->Writer()));
+
+    std::array<uint8_t, 1024> message{};
+    std::vector<uint8_t> sent;
+
+    // Produce until the queue asks us to stop, the socket buffer absorbs the
+    // first writes without anything being queued.
+    while (!queue->IsPaused())
+    {
+        for (uint8_t& byte : message)
+        {
+            byte = uint8_t(sent.size() % 251);
+            sent.push_back(byte);
+        }
+        FUSION_ASSERT_RESULT(
+            queue->Write(message.data(), message.size()),
+            [&](size_t accepted) { ASSERT_EQ(accepted, message.size()); });
+    }
+
+    ASSERT_EQ(signals.size(), 1);
+    ASSERT_TRUE(signals[0]);
+    ASSERT_GE(queue->Size(), params.highWatermark);
+
+    // Producers ignoring the signal are cut off at the hard limit.
+    std::vector<uint8_t> large(params.highWatermark * 2);
+    FUSION_ASSERT_ERROR(
+        queue->Write(large.data(), large.size()),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_WOULD_BLOCK); });
+
+    std::vector<uint8_t> received;
+    std::array<uint8_t, 8192> buffer{};
+
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (received.size() < sent.size() && Clock::now() < deadline)
+    {
+        while (true)
+        {
+            auto result = network->Recv(pair->Reader(), buffer.data(), buffer.size());
+            if (!result)
+            {
+                ASSERT_EQ(result.Error().Error(), E_NET_WOULD_BLOCK);
+                break;
+            }
+            received.insert(received.end(), buffer.begin(), buffer.begin() + *result);
+        }
+
+        if (queue->Size() > 0)
+        {
+            ASSERT_TRUE(IsWritable(pair->Writer()));
+            FUSION_ASSERT_RESULT(queue->Flush());
+        }
+        ASSERT_LE(queue->Capacity(), params.highWatermark * 2 + params.chunkSize);
+    }
+
+    ASSERT_EQ(received, sent);
+    ASSERT_EQ(queue->Size(), 0);
+    ASSERT_FALSE(queue->IsPaused());
+
+    ASSERT_EQ(signals.size(), 2);
+    ASSERT_FALSE(signals[1]);
+
+    // The write interest is dropped once the queue drained.
+    ASSERT_FALSE(IsWritable(pair->Writer()));
+}
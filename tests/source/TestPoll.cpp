@@ -17,3 +17,52 @@
 #include <Fusion/Tests/Tests.h>
 
 #include <Fusion/Internal/Network.h>
+
+#include <array>
+#include <chrono>
+
+TEST(PollTests, ReadableAndWritable)
+{
+    using namespace std::chrono;
+
+    std::unique_ptr<Network> network;
+    FUSION_ASSERT_RESULT(
+        Network::Create(),
+        [&](std::unique_ptr<Network> n) {
+            network = std::move(n);
+        });
+
+    std::unique_ptr<SocketPair> pair;
+    FUSION_ASSERT_RESULT(
+        SocketPair::Create(*network, SocketPair::Type::NonBlocking),
+        [&](std::unique_ptr<SocketPair> p) {
+            pair = std::move(p);
+        });
+
+    std::array<PollFd, 2> fds;
+    fds[0].sock = pair->Reader();
+    fds[0].events = PollFlags::Read;
+    fds[1].sock = pair->Writer();
+    fds[1].events = PollFlags::Write;
+
+    FUSION_ASSERT_RESULT(
+        Poll(fds.data(), fds.size(), milliseconds(100)),
+        [&](size_t ready) {
+            ASSERT_EQ(ready, 1);
+        });
+    ASSERT_EQ(fds[0].events, PollFlags::None);
+    ASSERT_TRUE(+(fds[1].events & PollFlags::Write));
+
+    FUSION_ASSERT_RESULT(network->Send(pair->Writer(), "x", 1));
+
+    fds[0].events = PollFlags::Read;
+    FUSION_ASSERT_RESULT(
+        Poll(fds[0], milliseconds(100)),
+        [&](size_t ready) {
+            ASSERT_EQ(ready, 1);
+        });
+    ASSERT_TRUE(+(fds[0].events & PollFlags::Read));
+
+    pair->Stop();
+    network->Stop();
+}
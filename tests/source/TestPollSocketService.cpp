@@ -0,0 +1,230 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Fixtures/SocketService.h>
+
+#include <Fusion/Memory.h>
+#include <Fusion/Platform.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if FUSION_PLATFORM_POSIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+TEST_F(SocketServiceTests, PollStartupShutdown)
+{
+#if FUSION_PLATFORM_POSIX
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(
+            SocketService::Type::Poll,
+            *network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+
+    Manager manager(*network, *service);
+    {
+        manager.conns.push_back({
+            .sock = pair->Reader(),
+        });
+        manager.conns.push_back({
+            .sock = pair->Writer(),
+        });
+    }
+
+    std::string message = "write this first";
+    std::span<SocketEvent> events;
+
+    Connection& one = manager.conns[0];
+    Connection& two = manager.conns[1];
+
+    QueueRead(manager, one, 128);
+    QueueWrite(manager, two, message);
+
+    // Process the connections.
+    // Only connection 'two' has data ready to write so it should immeadietly
+    // come up for action.
+
+    FUSION_ASSERT_RESULT(
+        service->Execute(std::chrono::milliseconds(100)),
+        [&](auto ev) {
+            events = std::move(ev);
+        });
+
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].sock, two.sock);
+    ASSERT_TRUE(+(events[0].events & SocketOperation::Write));
+    ProcessWrite(manager, two);
+
+    // At this point the service should trigger the read operation on
+    // connection 'one'.
+    FUSION_ASSERT_RESULT(
+        service->Execute(std::chrono::milliseconds(100)),
+        [&](auto ev) {
+            events = std::move(ev);
+        });
+
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].sock, one.sock);
+    ASSERT_TRUE(+(events[0].events & SocketOperation::Read));
+    ProcessRead(manager, one);
+    {
+        std::string data;
+        Consume(one, data, message.size());
+        ASSERT_EQ(data, message);
+    }
+#endif  // FUSION_PLATFORM_POSIX
+}
+
+TEST_F(SocketServiceTests, PollAddRemoveNotify)
+{
+#if FUSION_PLATFORM_POSIX
+    using namespace std::chrono;
+
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(
+            SocketService::Type::Poll,
+            *network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+
+    std::vector<std::unique_ptr<SocketPair>> pairs;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        FUSION_ASSERT_RESULT(
+            SocketPair::Create(*network, SocketPair::Type::NonBlocking),
+            [&](std::unique_ptr<SocketPair> p) {
+                pairs.push_back(std::move(p));
+            });
+        FUSION_ASSERT_RESULT(
+            service->Add(pairs.back()->Reader(), SocketOperation::Read));
+    }
+
+    auto readable = [&]() {
+        std::vector<Socket> socks;
+
+        auto result = service->Execute(milliseconds(100));
+        EXPECT_TRUE(result);
+
+        for (const SocketEvent& ev : result ? *result : std::span<SocketEvent>{})
+        {
+            socks.push_back(ev.sock);
+        }
+        std::sort(socks.begin(), socks.end());
+        return socks;
+    };
+
+    auto send = [&](SocketPair& p) {
+        FUSION_ASSERT_RESULT(network->Send(p.Writer(), "x", 1));
+    };
+
+    send(*pairs[2]);
+    send(*pairs[5]);
+    {
+        std::vector<Socket> expected{ pairs[2]->Reader(), pairs[5]->Reader() };
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(readable(), expected);
+    }
+
+    // Removing a socket from the middle moves the last one into its slot.
+    FUSION_ASSERT_RESULT(
+        service->Remove(pairs[2]->Reader(), SocketOperation::Read));
+    send(*pairs[7]);
+    {
+        std::vector<Socket> expected{ pairs[5]->Reader(), pairs[7]->Reader() };
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(readable(), expected);
+    }
+
+    FUSION_ASSERT_RESULT(pairs[5]->Drain());
+    FUSION_ASSERT_RESULT(pairs[7]->Drain());
+
+    // A blocked Execute() is woken from another thread.
+    std::thread waker([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        service->Notify();
+    });
+
+    auto start = Clock::now();
+    FUSION_ASSERT_RESULT(
+        service->Execute(seconds(10)),
+        [&](std::span<SocketEvent> events) {
+            ASSERT_TRUE(events.empty());
+        });
+    waker.join();
+    ASSERT_LT(Clock::now() - start, seconds(5));
+
+    for (auto& p : pairs)
+    {
+        (void)service->Remove(p->Reader(), SocketOperation::Read);
+        p->Stop();
+    }
+#endif  // FUSION_PLATFORM_POSIX
+}
+
+TEST_F(SocketServiceTests, PollHighDescriptor)
+{
+#if FUSION_PLATFORM_POSIX
+    // Past FD_SETSIZE, where a select() based service would stop working.
+    constexpr int HIGH_FD = 1500;
+
+    struct rlimit limit{};
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &limit), 0);
+
+    const struct rlimit original = limit;
+    FUSION_SCOPE_GUARD([&] { ::setrlimit(RLIMIT_NOFILE, &original); });
+
+    if (limit.rlim_cur <= rlim_t(HIGH_FD))
+    {
+        if (limit.rlim_max <= rlim_t(HIGH_FD))
+        {
+            GTEST_SKIP() << "descriptor limit too low";
+        }
+        limit.rlim_cur = HIGH_FD + 1;
+        ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &limit), 0);
+    }
+
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(
+            SocketService::Type::Poll,
+            *network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+
+    ASSERT_EQ(::dup2(pair->Reader(), HIGH_FD), HIGH_FD);
+    FUSION_SCOPE_GUARD([&] { ::close(HIGH_FD); });
+
+    const Socket sock = Socket(HIGH_FD);
+    FUSION_ASSERT_RESULT(service->Add(sock, SocketOperation::Read));
+    FUSION_ASSERT_RESULT(network->Send(pair->Writer(), "x", 1));
+
+    FUSION_ASSERT_RESULT(
+        service->Execute(std::chrono::milliseconds(100)),
+        [&](std::span<SocketEvent> events) {
+            ASSERT_EQ(events.size(), 1);
+            ASSERT_EQ(events[0].sock, sock);
+            ASSERT_TRUE(+(events[0].events & SocketOperation::Read));
+        });
+
+    FUSION_ASSERT_RESULT(service->Remove(sock, SocketOperation::Read));
+#endif  // FUSION_PLATFORM_POSIX
+}
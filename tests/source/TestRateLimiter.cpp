@@ -0,0 +1,174 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/RateLimiter.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST(RateLimiterTests, InvalidParams)
+{
+    RateLimiter::Params params;
+    params.rate = 0;
+    FUSION_ASSERT_FAILURE(RateLimiter::Create(params));
+
+    params = RateLimiter::Params{};
+    params.burst = 0.5;
+    FUSION_ASSERT_FAILURE(RateLimiter::Create(params));
+
+    params = RateLimiter::Params{};
+    params.maxPeers = 0;
+    FUSION_ASSERT_FAILURE(RateLimiter::Create(params));
+}
+
+TEST(RateLimiterTests, BurstAndRefill)
+{
+    using namespace std::chrono_literals;
+
+    RateLimiter::Params params;
+    params.rate = 10;
+    params.burst = 5;
+
+    std::unique_ptr<RateLimiter> limiter;
+    FUSION_ASSERT_RESULT(
+        RateLimiter::Create(params),
+        [&](std::unique_ptr<RateLimiter> l) {
+            limiter = std::move(l);
+        });
+
+    const SocketAddress peer{ InaddrLoopback, 4000 };
+    const SocketAddress other{ InetAddress{ { 10, 0, 0, 1 } }, 4000 };
+    const Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+        ASSERT_TRUE(limiter->TryAcquire(peer, 1, start));
+    }
+    ASSERT_FALSE(limiter->TryAcquire(peer, 1, start));
+    ASSERT_EQ(limiter->RetryAfter(peer, 1, start), 100ms);
+
+    // Peers do not share buckets, connections from the same host do.
+    ASSERT_TRUE(limiter->TryAcquire(other, 1, start));
+    ASSERT_FALSE(limiter->TryAcquire(
+        SocketAddress{ InaddrLoopback, 4001 }, 1, start));
+
+    // Refilled at 10 tokens per second, never beyond the burst.
+    ASSERT_FALSE(limiter->TryAcquire(peer, 1, start + 50ms));
+    ASSERT_TRUE(limiter->TryAcquire(peer, 1, start + 100ms));
+    ASSERT_TRUE(limiter->TryAcquire(peer, 5, start + 10s));
+    ASSERT_FALSE(limiter->TryAcquire(peer, 1, start + 10s));
+
+    // An IPv4 host reaching a dual stack socket is the same peer.
+    ASSERT_FALSE(limiter->TryAcquire(
+        SocketAddress{ InaddrLoopback6in4, 4000 }, 1, start + 10s));
+
+    ASSERT_EQ(limiter->Size(), 2);
+    limiter->Remove(peer);
+    ASSERT_EQ(limiter->Size(), 1);
+    ASSERT_TRUE(limiter->TryAcquire(peer, 5, start + 10s));
+}
+
+TEST(RateLimiterTests, EvictsIdleAndLeastRecentlyUsed)
+{
+    using namespace std::chrono_literals;
+
+    RateLimiter::Params params;
+    params.rate = 1;
+    params.burst = 1;
+    params.maxPeers = 4;
+    params.shards = 1;
+    params.idleTimeout = 1s;
+
+    std::unique_ptr<RateLimiter> limiter;
+    FUSION_ASSERT_RESULT(
+        RateLimiter::Create(params),
+        [&](std::unique_ptr<RateLimiter> l) {
+            limiter = std::move(l);
+        });
+
+    const Clock::time_point start = Clock::now();
+    auto peer = [](uint8_t n) {
+        return SocketAddress{ InetAddress{ { 10, 0, 0, n } }, 0 };
+    };
+
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(limiter->TryAcquire(peer(i), 1, start));
+    }
+
+    // Touch the first peer so the second becomes the eviction candidate.
+    ASSERT_FALSE(limiter->TryAcquire(peer(0), 1, start));
+    ASSERT_TRUE(limiter->TryAcquire(peer(4), 1, start));
+    ASSERT_EQ(limiter->Size(), 4);
+
+    // The evicted peer is back with a full bucket, the others are not.
+    ASSERT_TRUE(limiter->TryAcquire(peer(1), 1, start));
+    ASSERT_FALSE(limiter->TryAcquire(peer(0), 1, start));
+
+    ASSERT_EQ(limiter->Expire(start + 500ms), 0);
+    ASSERT_EQ(limiter->Expire(start + 2s), 4);
+    ASSERT_EQ(limiter->Size(), 0);
+}
+
+TEST(RateLimiterTests, Concurrent)
+{
+    constexpr size_t THREADS = 4;
+    constexpr size_t PEERS = 64;
+
+    RateLimiter::Params params;
+    params.rate = 1e-3;
+    params.burst = 100;
+
+    std::unique_ptr<RateLimiter> limiter;
+    FUSION_ASSERT_RESULT(
+        RateLimiter::Create(params),
+        [&](std::unique_ptr<RateLimiter> l) {
+            limiter = std::move(l);
+        });
+
+    std::atomic<size_t> admitted{ 0 };
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < 200; ++i)
+            {
+                for (uint8_t p = 0; p < PEERS; ++p)
+                {
+                    SocketAddress peer{ InetAddress{ { 192, 168, 0, p } }, 0 };
+                    if (limiter->TryAcquire(peer))
+                    {
+                        ++admitted;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every peer got its burst and (practically) nothing more.
+    ASSERT_GE(admitted, PEERS * 100);
+    ASSERT_LE(admitted, PEERS * 101);
+    ASSERT_EQ(limiter->Size(), PEERS);
+}
@@ -0,0 +1,362 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Memory.h>
+#include <Fusion/SharedMemoryChannel.h>
+
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#if FUSION_PLATFORM_LINUX
+#include <sys/mman.h>
+
+class SharedMemoryChannelTests : public testing::Test
+{
+public:
+    std::unique_ptr<Network> network;
+    std::unique_ptr<SharedMemoryChannel> client;
+    std::unique_ptr<SharedMemoryChannel> server;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+    }
+
+    void TearDown() override
+    {
+        client.reset();
+        server.reset();
+
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    // Create a channel and attach to it through descriptors passed over a
+    // Unix socket, as a peer process would.
+    void Connect(size_t capacity)
+    {
+        SharedMemoryChannel::Params params;
+        params.capacity = capacity;
+
+        FUSION_ASSERT_RESULT(
+            SharedMemoryChannel::Create(params),
+            [&](std::unique_ptr<SharedMemoryChannel> c) {
+                client = std::move(c);
+            });
+
+        std::array<Socket, 2> pair{ INVALID_SOCKET, INVALID_SOCKET };
+        FUSION_ASSERT_RESULT(
+            network->CreateSocketPair(AddressFamily::Unix, SocketType::Stream),
+            [&](std::array<Socket, 2> p) {
+                pair = p;
+            });
+        FUSION_SCOPE_GUARD([&] {
+            (void)network->Close(pair[0]);
+            (void)network->Close(pair[1]);
+        });
+
+        const std::array<Socket, 3> descriptors = client->Descriptors();
+        const char tag = 'c';
+        FUSION_ASSERT_RESULT(
+            network->SendDescriptors(pair[0], descriptors, &tag, 1));
+
+        std::array<Socket, 3> received{};
+        char buffer = 0;
+        FUSION_ASSERT_RESULT(
+            network->RecvDescriptors(pair[1], received, &buffer, 1),
+            [&](Network::RecvDescriptorsData data) {
+                ASSERT_EQ(data.count, received.size());
+            });
+
+        FUSION_ASSERT_RESULT(
+            SharedMemoryChannel::Open(received),
+            [&](std::unique_ptr<SharedMemoryChannel> c) {
+                server = std::move(c);
+            });
+    }
+};
+
+TEST_F(SharedMemoryChannelTests, SendRecv)
+{
+    ASSERT_NO_FATAL_FAILURE(Connect(1));
+    ASSERT_EQ(client->Capacity(), 4096);
+    ASSERT_EQ(server->Capacity(), 4096);
+
+    std::array<char, 16> buffer{};
+    FUSION_ASSERT_ERROR(
+        server->Recv(buffer.data(), buffer.size()),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_WOULD_BLOCK); });
+
+    FUSION_ASSERT_RESULT(
+        client->Send("ping", 4),
+        [](size_t sent) { ASSERT_EQ(sent, 4); });
+    FUSION_ASSERT_RESULT(
+        server->Recv(buffer.data(), buffer.size()),
+        [&](size_t received) {
+            ASSERT_EQ(std::string_view(buffer.data(), received), "ping");
+        });
+
+    FUSION_ASSERT_RESULT(
+        server->Send("pong", 4),
+        [](size_t sent) { ASSERT_EQ(sent, 4); });
+    FUSION_ASSERT_RESULT(
+        client->Recv(buffer.data(), buffer.size()),
+        [&](size_t received) {
+            ASSERT_EQ(std::string_view(buffer.data(), received), "pong");
+        });
+
+    // Fill the ring, the rest of the write is refused until the peer reads.
+    std::vector<uint8_t> data(6000);
+    std::iota(data.begin(), data.end(), uint8_t(0));
+
+    FUSION_ASSERT_RESULT(
+        client->Send(data.data(), data.size()),
+        [](size_t sent) { ASSERT_EQ(sent, 4096); });
+    FUSION_ASSERT_ERROR(
+        client->Send(data.data() + 4096, data.size() - 4096),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_WOULD_BLOCK); });
+
+    std::vector<uint8_t> out(data.size());
+    FUSION_ASSERT_RESULT(
+        server->Recv(out.data(), 3000),
+        [](size_t received) { ASSERT_EQ(received, 3000); });
+
+    // Wraps around the end of the ring.
+    FUSION_ASSERT_RESULT(
+        client->Send(data.data() + 4096, data.size() - 4096),
+        [](size_t sent) { ASSERT_EQ(sent, 1904); });
+    FUSION_ASSERT_RESULT(
+        server->Recv(out.data() + 3000, out.size() - 3000),
+        [](size_t received) { ASSERT_EQ(received, 3000); });
+    ASSERT_EQ(out, data);
+
+    // What was sent before closing is still received.
+    FUSION_ASSERT_RESULT(client->Send("bye", 3));
+    client->Close();
+
+    FUSION_ASSERT_ERROR(
+        server->Send("x", 1),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_DISCONNECTED); });
+    FUSION_ASSERT_RESULT(
+        server->Recv(buffer.data(), buffer.size()),
+        [](size_t received) { ASSERT_EQ(received, 3); });
+    FUSION_ASSERT_ERROR(
+        server->Recv(buffer.data(), buffer.size()),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NET_DISCONNECTED); });
+}
+
+TEST_F(SharedMemoryChannelTests, CorruptTail)
+{
+    ASSERT_NO_FATAL_FAILURE(Connect(1));
+
+    // Map the channel as a misbehaving peer would and move the tail of
+    // ring 0 past its capacity. The header is 64 bytes, each ring keeps
+    // its head and tail on cache lines of their own.
+    constexpr size_t TAIL_OFFSET = 128;
+
+    void* mapping = ::mmap(
+        nullptr,
+        4096,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        client->Descriptors()[0],
+        0);
+    ASSERT_NE(mapping, MAP_FAILED);
+    FUSION_SCOPE_GUARD([&] { ::munmap(mapping, 4096); });
+
+    auto* tail = reinterpret_cast<std::atomic<uint64_t>*>(
+        static_cast<uint8_t*>(mapping) + TAIL_OFFSET);
+    tail->store(3 * 4096);
+
+    std::array<char, 16> buffer{};
+    FUSION_ASSERT_ERROR(server->Recv(buffer.data(), buffer.size()), E_FAILURE);
+    FUSION_ASSERT_ERROR(
+        server->Recv(buffer.data(), buffer.size()),
+        E_NET_DISCONNECTED);
+}
+
+TEST_F(SharedMemoryChannelTests, Open)
+{
+    std::array<Socket, 2> descriptors{ INVALID_SOCKET, INVALID_SOCKET };
+    FUSION_ASSERT_FAILURE(SharedMemoryChannel::Open(descriptors));
+
+    SharedMemoryChannel::Params params;
+    params.capacity = 0;
+    FUSION_ASSERT_FAILURE(SharedMemoryChannel::Create(params));
+}
+
+TEST_F(SharedMemoryChannelTests, SocketService)
+{
+    using namespace std::chrono_literals;
+
+    ASSERT_NO_FATAL_FAILURE(Connect(4096));
+
+    std::unique_ptr<SocketService> service;
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(*network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+    FUSION_SCOPE_GUARD([&] {
+        (void)service->Close(server->Handle());
+        service->Stop();
+    });
+
+    FUSION_ASSERT_RESULT(
+        service->Add(server->Handle(), SocketOperation::Read));
+
+    // Stream far more than the ring holds, both sides sleep on their
+    // eventfd whenever the other falls behind.
+    std::vector<uint8_t> data(1 << 20);
+    std::iota(data.begin(), data.end(), uint8_t(0));
+
+    std::thread sender([&] {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            auto result = client->Send(data.data() + sent, data.size() - sent);
+            if (result)
+            {
+                sent += *result;
+                continue;
+            }
+            if (result.Error().Error() != E_NET_WOULD_BLOCK)
+            {
+                break;
+            }
+
+            PollFd fd{ .sock = client->Handle(), .events = PollFlags::Read };
+            (void)Poll(fd, 1s);
+        }
+        client->Close();
+    });
+    FUSION_SCOPE_GUARD([&] { sender.join(); });
+
+    std::vector<uint8_t> received;
+    std::array<uint8_t, 1500> buffer{};
+    auto deadline = Clock::now() + 30s;
+
+    while (Clock::now() < deadline)
+    {
+        auto result = server->Recv(buffer.data(), buffer.size());
+        if (result)
+        {
+            received.insert(received.end(), buffer.begin(), buffer.begin() + *result);
+            continue;
+        }
+        if (result.Error().Error() == E_NET_DISCONNECTED)
+        {
+            break;
+        }
+        ASSERT_EQ(result.Error().Error(), E_NET_WOULD_BLOCK);
+        FUSION_ASSERT_RESULT(service->Execute(1s));
+    }
+
+    ASSERT_EQ(received.size(), data.size());
+    ASSERT_EQ(received, data);
+}
+
+TEST_F(SharedMemoryChannelTests, Duplex)
+{
+    using namespace std::chrono_literals;
+
+    ASSERT_NO_FATAL_FAILURE(Connect(4096));
+
+    // Each side sends and receives from its own thread at the same time,
+    // all four sleep on the one eventfd of their side. A wakeup drained
+    // by the wrong direction shows up as a poll() running into its
+    // timeout.
+    std::vector<uint8_t> data(1 << 20);
+    std::iota(data.begin(), data.end(), uint8_t(0));
+
+    std::atomic<size_t> stalls{ 0 };
+
+    auto wait = [&](SharedMemoryChannel& channel) {
+        PollFd fd{ .sock = channel.Handle(), .events = PollFlags::Read };
+        if (auto polled = Poll(fd, 5s); polled && *polled == 0)
+        {
+            ++stalls;
+        }
+    };
+
+    auto send = [&](SharedMemoryChannel& channel) {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            auto result = channel.Send(data.data() + sent, data.size() - sent);
+            if (result)
+            {
+                sent += *result;
+                continue;
+            }
+            if (result.Error().Error() != E_NET_WOULD_BLOCK)
+            {
+                return;
+            }
+            wait(channel);
+        }
+    };
+
+    auto recv = [&](SharedMemoryChannel& channel, std::vector<uint8_t>& out) {
+        std::array<uint8_t, 256> buffer{};
+        while (out.size() < data.size())
+        {
+            auto result = channel.Recv(buffer.data(), buffer.size());
+            if (result)
+            {
+                out.insert(out.end(), buffer.begin(), buffer.begin() + *result);
+                continue;
+            }
+            if (result.Error().Error() != E_NET_WOULD_BLOCK)
+            {
+                return;
+            }
+            wait(channel);
+        }
+    };
+
+    std::vector<uint8_t> toServer;
+    std::vector<uint8_t> toClient;
+    {
+        std::thread clientSend([&] { send(*client); });
+        std::thread serverSend([&] { send(*server); });
+        std::thread clientRecv([&] { recv(*client, toClient); });
+        std::thread serverRecv([&] { recv(*server, toServer); });
+
+        clientSend.join();
+        serverSend.join();
+        clientRecv.join();
+        serverRecv.join();
+    }
+
+    ASSERT_EQ(stalls, 0u);
+    ASSERT_EQ(toServer, data);
+    ASSERT_EQ(toClient, data);
+}
+#endif  // FUSION_PLATFORM_LINUX
@@ -167,3 +167,51 @@ TEST_F(SocketOptionTests, ReuseAddress)
         ReuseAddress(&reuse)));
     ASSERT_TRUE(reuse);
 }
+
+TEST_F(SocketOptionTests, NoDelay)
+{
+    using namespace SocketOptions;
+
+    bool enabled = true;
+    FUSION_ASSERT_RESULT(network->GetSocketOption(
+        sock, NoDelay(&enabled)));
+    ASSERT_FALSE(enabled);
+
+    FUSION_ASSERT_RESULT(network->SetSocketOption(
+        sock,
+        NoDelay(true)));
+    FUSION_ASSERT_RESULT(network->GetSocketOption(
+        sock,
+        NoDelay(&enabled)));
+    ASSERT_TRUE(enabled);
+}
+
+TEST_F(SocketOptionTests, LatencyOptions)
+{
+    using namespace SocketOptions;
+
+#if FUSION_PLATFORM_LINUX
+    bool cork = false;
+    FUSION_ASSERT_RESULT(network->SetSocketOption(sock, TcpCork(true)));
+    FUSION_ASSERT_RESULT(network->GetSocketOption(sock, TcpCork(&cork)));
+    ASSERT_TRUE(cork);
+
+    FUSION_ASSERT_RESULT(network->SetSocketOption(sock, TcpQuickAck(true)));
+
+    int32_t lowMark = 0;
+    FUSION_ASSERT_RESULT(network->SetSocketOption(
+        sock,
+        TcpNotSentLowMark(16 * 1024)));
+    FUSION_ASSERT_RESULT(network->GetSocketOption(
+        sock,
+        TcpNotSentLowMark(&lowMark)));
+    ASSERT_EQ(lowMark, 16 * 1024);
+
+    FUSION_ASSERT_RESULT(network->SetSocketOption(sock, TcpDeferAccept(1)));
+    FUSION_ASSERT_RESULT(network->SetSocketOption(sock, TcpFastOpen(16)));
+#else
+    FUSION_ASSERT_ERROR(
+        network->SetSocketOption(sock, TcpCork(true)),
+        [](const Failure& f) { ASSERT_EQ(f.Error(), E_NOT_SUPPORTED); });
+#endif
+}
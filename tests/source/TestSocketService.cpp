@@ -187,3 +187,73 @@ void SocketServiceTests::SetUp()
         });
 }
 }  // namespace Fusion
+
+TEST_F(SocketServiceTests, WatchContext)
+{
+    using namespace std::chrono_literals;
+
+    FUSION_ASSERT_RESULT(
+        SocketService::Create(*network),
+        [&](std::unique_ptr<SocketService> s) {
+            service = std::move(s);
+        });
+
+    // Execute() may wake spuriously, collect until something is reported.
+    auto execute = [&](std::vector<SocketEvent>& events) {
+        auto deadline = Clock::now() + 5s;
+        while (events.empty() && Clock::now() < deadline)
+        {
+            FUSION_ASSERT_RESULT(
+                service->Execute(10s),
+                [&](std::span<SocketEvent> e) {
+                    events.assign(e.begin(), e.end());
+                });
+        }
+    };
+
+    // Nothing is ever written, only the watches end the waits.
+    FUSION_ASSERT_RESULT(service->Add(pair->Reader(), SocketOperation::Read));
+
+    auto start = Clock::now();
+    std::vector<SocketEvent> events;
+
+    Context timeout(50ms);
+    FUSION_ASSERT_RESULT(service->Watch(pair->Reader(), timeout));
+
+    ASSERT_NO_FATAL_FAILURE(execute(events));
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].sock, pair->Reader());
+    ASSERT_EQ(events[0].events, SocketOperation::Error);
+    ASSERT_EQ(events[0].error, E_NET_TIMEOUT);
+    ASSERT_GE(Clock::now() - start, 50ms);
+
+    Context cancel;
+    FUSION_ASSERT_RESULT(service->Watch(pair->Reader(), cancel));
+
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(20ms);
+        cancel.Cancel();
+    });
+
+    start = Clock::now();
+    events.clear();
+
+    ASSERT_NO_FATAL_FAILURE(execute(events));
+    canceller.join();
+
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].error, E_CANCELLED);
+    ASSERT_LT(Clock::now() - start, 5s);
+
+    // The watch ended with the event, closing drops a pending one.
+    Context unwatched(1ms);
+    FUSION_ASSERT_RESULT(service->Watch(pair->Reader(), unwatched));
+    FUSION_ASSERT_RESULT(service->Close(pair->Reader()));
+
+    std::this_thread::sleep_for(5ms);
+    FUSION_ASSERT_RESULT(
+        service->Execute(20ms),
+        [&](std::span<SocketEvent> e) {
+            ASSERT_TRUE(e.empty());
+        });
+}
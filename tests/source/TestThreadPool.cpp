@@ -18,11 +18,21 @@
 
 #include <Fusion/Thread.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace
 {
 class ThreadPoolTests : public testing::Test
 {
 public:
+    static constexpr uint32_t THREADS = 2;
+
     std::unique_ptr<ThreadPool> pool;
 
 public:
@@ -31,7 +41,7 @@ public:
         pool = std::make_unique<ThreadPool>(
             ThreadPool::Options{
                 .threadName = "ThreadPool Tests",
-                .threads = 2,
+                .threads = THREADS,
             });
         EXPECT_TRUE(pool);
     }
@@ -72,3 +82,930 @@ TEST_F(ThreadPoolTests, PostWithResultValue)
 
     ASSERT_EQ(value, 42);
 }
+
+TEST_F(ThreadPoolTests, NestedSubmissions)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t OUTER = 32;
+    static constexpr size_t INNER = 32;
+
+    std::atomic<size_t> count{ 0 };
+    std::mutex mutex;
+    std::vector<std::future<Result<void>>> inner;
+
+    std::vector<std::future<Result<void>>> outer;
+    outer.reserve(OUTER);
+
+    for (size_t i = 0; i < OUTER; ++i)
+    {
+        // Tasks submitted from a worker land on its own queue and are
+        // spread over the pool by stealing.
+        outer.push_back(pool->Await([&]() {
+            for (size_t j = 0; j < INNER; ++j)
+            {
+                auto future = pool->Await([&]() { ++count; }).Release();
+
+                std::lock_guard lock(mutex);
+                inner.push_back(std::move(future));
+            }
+        }).Release());
+    }
+
+    for (auto& future : outer)
+    {
+        FUSION_ASSERT_RESULT(future.get());
+    }
+    for (auto& future : inner)
+    {
+        FUSION_ASSERT_RESULT(future.get());
+    }
+
+    ASSERT_EQ(count.load(), OUTER * INNER);
+}
+
+TEST_F(ThreadPoolTests, CancelQueuedTask)
+{
+    ASSERT_TRUE(pool);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    // More blocked tasks than there are workers so the target below stays
+    // queued until the gate opens.
+    const size_t blockers = THREADS + 1;
+
+    std::vector<std::future<Result<void>>> blocked;
+    for (size_t i = 0; i < blockers; ++i)
+    {
+        blocked.push_back(pool->Await([opened]() { opened.wait(); }).Release());
+    }
+
+    bool ran = false;
+    auto target = pool->Await([&]() { ran = true; });
+    target.Cancel();
+
+    gate.set_value();
+
+    FUSION_ASSERT_ERROR(target->get(), E_CANCELLED);
+    for (auto& future : blocked)
+    {
+        FUSION_ASSERT_RESULT(future.get());
+    }
+    ASSERT_FALSE(ran);
+}
+
+TEST_F(ThreadPoolTests, CancelRacingWorkers)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t COUNT = 10000;
+
+    std::atomic<size_t> ran{ 0 };
+    std::vector<uint64_t> ids;
+    std::vector<std::future<Result<void>>> futures;
+
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        auto future = pool->Await([&]() { ++ran; });
+
+        ids.push_back(future.GetId());
+        futures.push_back(future.Release());
+
+        // Cancel a task submitted a little earlier, which workers may be
+        // dequeuing right now.
+        if (i >= 8 && i % 2 == 0)
+        {
+            pool->Cancel(ids[i - 8]);
+        }
+    }
+
+    size_t cancelled = 0;
+    for (auto& future : futures)
+    {
+        if (auto result = future.get(); !result)
+        {
+            FUSION_ASSERT_ERROR(result, E_CANCELLED);
+            ++cancelled;
+        }
+    }
+
+    ASSERT_LE(cancelled, COUNT / 2);
+    ASSERT_EQ(ran.load() + cancelled, COUNT);
+}
+
+TEST_F(ThreadPoolTests, Post)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t COUNT = 1000;
+
+    std::atomic<size_t> count{ 0 };
+    std::promise<void> done;
+
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        pool->Post([&]() {
+            if (++count == COUNT)
+            {
+                done.set_value();
+            }
+        });
+    }
+
+    done.get_future().wait();
+    ASSERT_EQ(count.load(), COUNT);
+}
+
+TEST_F(ThreadPoolTests, PostLargeCallable)
+{
+    ASSERT_TRUE(pool);
+
+    // Too big for a task slot, stored on the heap instead.
+    std::array<uint8_t, 512> data{};
+    data.back() = 42;
+
+    std::promise<uint8_t> result;
+    pool->Post([data, &result]() { result.set_value(data.back()); });
+
+    ASSERT_EQ(result.get_future().get(), 42);
+}
+
+TEST_F(ThreadPoolTests, StrandOrdering)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t PRODUCERS = 4;
+    static constexpr size_t COUNT = 1000;
+
+    Strand strand(*pool);
+
+    // Only ever touched from inside the strand.
+    std::array<size_t, PRODUCERS> next{};
+    size_t total = 0;
+    bool ordered = true;
+
+    std::atomic<bool> inside{ false };
+    bool overlapped = false;
+
+    std::promise<void> done;
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < PRODUCERS; ++p)
+    {
+        producers.emplace_back([&, p]() {
+            for (size_t i = 0; i < COUNT; ++i)
+            {
+                strand.Post([&, p, i]() {
+                    overlapped |= inside.exchange(true);
+                    ordered &= (next[p]++ == i);
+                    inside = false;
+
+                    if (++total == PRODUCERS * COUNT)
+                    {
+                        done.set_value();
+                    }
+                });
+            }
+        });
+    }
+
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    done.get_future().wait();
+
+    ASSERT_TRUE(ordered);
+    ASSERT_FALSE(overlapped);
+}
+
+TEST_F(ThreadPoolTests, StrandDispatch)
+{
+    ASSERT_TRUE(pool);
+
+    Strand strand(*pool);
+    Strand duplicate = strand.Duplicate();
+
+    ASSERT_FALSE(strand.IsRunningInThisThread());
+
+    std::vector<int> order;
+    std::promise<void> done;
+
+    strand.Post([&]() {
+        EXPECT_TRUE(pool->IsRunningInThisThread());
+        EXPECT_TRUE(duplicate.IsRunningInThisThread());
+
+        // Dispatch from inside the strand runs inline, Post queues.
+        duplicate.Post([&]() {
+            order.push_back(3);
+            done.set_value();
+        });
+        duplicate.Dispatch([&]() { order.push_back(1); });
+        order.push_back(2);
+    });
+
+    done.get_future().wait();
+    ASSERT_EQ(order, (std::vector<int>{ 1, 2, 3 }));
+}
+
+TEST_F(ThreadPoolTests, SubmitBatch)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t COUNT = 1000;
+
+    std::vector<std::atomic<uint32_t>> hits(COUNT);
+    std::atomic<size_t> count{ 0 };
+    std::promise<void> done;
+
+    pool->SubmitBatch(COUNT, [&](size_t index) {
+        ++hits[index];
+
+        if (++count == COUNT)
+        {
+            done.set_value();
+        }
+    });
+
+    done.get_future().wait();
+
+    for (const auto& hit : hits)
+    {
+        ASSERT_EQ(hit.load(), 1u);
+    }
+}
+
+TEST_F(ThreadPoolTests, ParallelFor)
+{
+    ASSERT_TRUE(pool);
+
+    std::vector<uint32_t> values(100000, 0);
+
+    pool->ParallelFor(0, values.size(), 1024, [&](size_t i) {
+        values[i] = uint32_t(i * 2);
+    });
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        ASSERT_EQ(values[i], i * 2);
+    }
+
+    // Nested inside a task the caller takes part, so this cannot deadlock
+    // even with every worker busy.
+    auto future = pool->Await([&]() {
+        std::atomic<size_t> count{ 0 };
+
+        pool->ParallelFor(0, 1000, 10, [&](size_t) { ++count; });
+        return count.load();
+    });
+
+    ASSERT_EQ(*future->get(), 1000u);
+}
+
+TEST_F(ThreadPoolTests, ParallelReduce)
+{
+    ASSERT_TRUE(pool);
+
+    const uint64_t sum = pool->ParallelReduce(
+        size_t(1), size_t(100001), 1000,
+        uint64_t(0),
+        [](size_t i) { return uint64_t(i); },
+        [](uint64_t a, uint64_t b) { return a + b; });
+
+    ASSERT_EQ(sum, 5000050000u);
+
+    // Not commutative, chunks must be combined in order.
+    const std::string text = pool->ParallelReduce(
+        size_t(0), size_t(26), 3,
+        std::string(),
+        [](size_t i) { return std::string(1, char('a' + i)); },
+        [](std::string a, const std::string& b) { return a + b; });
+
+    ASSERT_EQ(text, "abcdefghijklmnopqrstuvwxyz");
+}
+
+TEST_F(ThreadPoolTests, ParallelSort)
+{
+    ASSERT_TRUE(pool);
+
+    std::vector<uint32_t> values(50000);
+
+    uint32_t seed = 12345;
+    for (uint32_t& value : values)
+    {
+        seed = seed * 1664525 + 1013904223;
+        value = seed;
+    }
+
+    std::vector<uint32_t> expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    pool->ParallelSort(std::span<uint32_t>(values));
+    ASSERT_EQ(values, expected);
+
+    pool->ParallelSort(std::span<uint32_t>(values), std::greater<>{});
+    ASSERT_TRUE(std::is_sorted(values.begin(), values.end(), std::greater<>{}));
+}
+
+TEST_F(ThreadPoolTests, DispatchAfter)
+{
+    ASSERT_TRUE(pool);
+
+    const Clock::time_point start = Clock::now();
+    std::promise<Clock::time_point> fired;
+
+    pool->DispatchAfter(std::chrono::milliseconds(20), [&]() {
+        fired.set_value(Clock::now());
+    });
+
+    ASSERT_GE(fired.get_future().get() - start, std::chrono::milliseconds(20));
+}
+
+TEST_F(ThreadPoolTests, DispatchAtMany)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t COUNT = 1000;
+
+    std::atomic<size_t> count{ 0 };
+    std::promise<void> done;
+
+    const Clock::time_point now = Clock::now();
+
+    // Deadlines arrive out of order, including some already in the past.
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        const auto offset = std::chrono::microseconds((i * 7919) % 30000);
+
+        pool->DispatchAt(now + offset - std::chrono::milliseconds(1), [&]() {
+            if (++count == COUNT)
+            {
+                done.set_value();
+            }
+        });
+    }
+
+    done.get_future().wait();
+    ASSERT_EQ(count.load(), COUNT);
+}
+
+TEST_F(ThreadPoolTests, CancelTimer)
+{
+    ASSERT_TRUE(pool);
+
+    std::atomic<bool> cancelled{ false };
+    std::promise<void> fired;
+
+    const uint64_t id = pool->DispatchAfter(std::chrono::milliseconds(20), [&]() {
+        cancelled = true;
+    });
+    pool->DispatchAfter(std::chrono::milliseconds(40), [&]() {
+        fired.set_value();
+    });
+
+    pool->Cancel(id);
+    fired.get_future().wait();
+
+    ASSERT_FALSE(cancelled.load());
+}
+
+TEST_F(ThreadPoolTests, DispatchEvery)
+{
+    ASSERT_TRUE(pool);
+
+    std::atomic<size_t> count{ 0 };
+    std::promise<void> ticked;
+
+    const uint64_t id = pool->DispatchEvery(std::chrono::milliseconds(5), [&]() {
+        if (++count == 3)
+        {
+            ticked.set_value();
+        }
+    });
+
+    ticked.get_future().wait();
+    pool->Cancel(id);
+
+    // At most a run already underway completes after Cancel().
+    const size_t stopped = count.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    ASSERT_LE(count.load(), stopped + 1);
+}
+
+TEST(ThreadPoolSizingTests, ThreadCount)
+{
+    // Without a ceiling the pool stays at the size it started with.
+    ThreadPool fixed(ThreadPool::Options{ .threads = 2 });
+    ASSERT_EQ(fixed.GetThreadCount(), 2);
+    ASSERT_EQ(fixed.GetStats().workers.size(), 2u);
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 3,
+        .maxThreads = 8,
+    });
+    ASSERT_EQ(pool.GetThreadCount(), 3);
+
+    ThreadPool clamped(ThreadPool::Options{
+        .threads = 16,
+        .maxThreads = 4,
+    });
+    ASSERT_EQ(clamped.GetThreadCount(), 4);
+}
+
+TEST(ThreadPoolSizingTests, GrowWhenBlocking)
+{
+    std::promise<void> queued;
+    std::promise<void> gate;
+    std::promise<void> done;
+
+    // Without the supervisor only the blocking scope can add a worker.
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 2,
+        .stallTimeout = Clock::duration::zero(),
+    });
+
+    pool.Post([&]() {
+        queued.get_future().wait();
+
+        ThreadPool::Blocking blocking(pool);
+        gate.get_future().wait();
+    });
+    pool.Post([&]() { done.set_value(); });
+
+    queued.set_value();
+    done.get_future().wait();
+
+    ASSERT_EQ(pool.GetThreadCount(), 2);
+    gate.set_value();
+}
+
+TEST(ThreadPoolSizingTests, GrowWhenStalled)
+{
+    std::promise<void> gate;
+    std::promise<void> done;
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 2,
+        .stallTimeout = std::chrono::milliseconds(5),
+        .idleTimeout = std::chrono::milliseconds(20),
+    });
+
+    pool.Post([&]() { gate.get_future().wait(); });
+    pool.Post([&]() { done.set_value(); });
+
+    done.get_future().wait();
+    ASSERT_EQ(pool.GetThreadCount(), 2);
+
+    gate.set_value();
+
+    // The extra worker leaves again once it has been idle long enough.
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    while (pool.GetThreadCount() > 1 && Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_EQ(pool.GetThreadCount(), 1);
+}
+
+TEST(ThreadPoolStatsTests, Stats)
+{
+    static constexpr size_t COUNT = 64;
+    static constexpr size_t NAMED = 3;
+    static constexpr size_t TOTAL = 2 + COUNT + NAMED;
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 2,
+        .maxThreads = 2,
+        .collectStats = true,
+    });
+
+    std::atomic<size_t> started{ 0 };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        pool.Post([&started, opened]() {
+            ++started;
+            opened.wait();
+        });
+    }
+    while (started.load() < 2)
+    {
+        std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        pool.Post([]() { });
+    }
+    for (size_t i = 0; i < NAMED; ++i)
+    {
+        pool.Post("named", []() { }, ThreadPool::Priority::Low);
+    }
+
+    ThreadPool::Stats stats = pool.GetStats();
+    ASSERT_EQ(stats.priorities[size_t(ThreadPool::Priority::Normal)].queued, COUNT);
+    ASSERT_EQ(stats.priorities[size_t(ThreadPool::Priority::Low)].queued, NAMED);
+
+    gate.set_value();
+
+    // Counters are bumped after a task returns, poll until the last one is in.
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    size_t tasks = 0;
+
+    while (tasks < TOTAL && Clock::now() < deadline)
+    {
+        stats = pool.GetStats();
+
+        tasks = 0;
+        for (const auto& worker : stats.workers)
+        {
+            tasks += worker.tasks;
+        }
+    }
+    ASSERT_EQ(tasks, TOTAL);
+    ASSERT_EQ(stats.workers.size(), 2);
+
+    size_t runs = 0;
+    for (const auto& level : stats.priorities)
+    {
+        ASSERT_EQ(level.queued, 0);
+        runs += level.run.count;
+    }
+    ASSERT_EQ(runs, TOTAL);
+
+    const auto& low = stats.priorities[size_t(ThreadPool::Priority::Low)];
+    ASSERT_EQ(low.wait.count, NAMED);
+    ASSERT_GT(low.wait.Percentile(0.5), Clock::duration::zero());
+    ASSERT_GE(low.wait.Percentile(1.0), low.wait.Percentile(0.5));
+
+    ASSERT_EQ(stats.named.size(), 1);
+    ASSERT_EQ(stats.named[0].name, "named");
+    ASSERT_EQ(stats.named[0].run.count, NAMED);
+}
+
+TEST(ThreadPoolPriorityTests, WeightedShares)
+{
+    static constexpr size_t HIGH = 200;
+    static constexpr size_t LOW = 10;
+
+    std::promise<void> gate;
+    std::promise<void> done;
+
+    std::mutex mutex;
+    std::vector<ThreadPool::Priority> order;
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+        .weights = { 1, 0, 4 },
+    });
+
+    const auto record = [&](ThreadPool::Priority priority) {
+        std::lock_guard lock(mutex);
+
+        order.push_back(priority);
+        if (order.size() == HIGH + LOW)
+        {
+            done.set_value();
+        }
+    };
+
+    // Holds the only worker until everything below is queued.
+    std::atomic<bool> started{ false };
+    pool.Post([&]() {
+        started = true;
+        gate.get_future().wait();
+    }, ThreadPool::Priority::High);
+
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < HIGH; ++i)
+    {
+        pool.Post([&]() {
+            record(ThreadPool::Priority::High);
+        }, ThreadPool::Priority::High);
+    }
+    for (size_t i = 0; i < LOW; ++i)
+    {
+        pool.Post([&]() {
+            record(ThreadPool::Priority::Low);
+        }, ThreadPool::Priority::Low);
+    }
+
+    gate.set_value();
+    done.get_future().wait();
+
+    std::lock_guard lock(mutex);
+
+    // With a backlog of both, Low gets one dequeue in five instead of
+    // waiting for every High task to finish.
+    size_t low = 0;
+    for (size_t i = 0; i < 5 * LOW; ++i)
+    {
+        low += (order[i] == ThreadPool::Priority::Low) ? 1 : 0;
+    }
+    ASSERT_GE(low, LOW - 1);
+}
+
+namespace
+{
+//
+// Runs a task on every worker of 'pool' that holds it until 'opened' is
+// ready, and returns once all of them have started.
+//
+void Occupy(ThreadPool& pool, size_t workers, std::shared_future<void> opened)
+{
+    std::atomic<size_t> started{ 0 };
+
+    for (size_t i = 0; i < workers; ++i)
+    {
+        pool.Post([&started, opened]() {
+            ++started;
+            opened.wait();
+        }, ThreadPool::Priority::High);
+    }
+    while (started.load() < workers)
+    {
+        std::this_thread::yield();
+    }
+}
+}
+
+TEST(ThreadPoolAdmissionTests, Reject)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+        .queueCapacity = 2,
+        .overflow = ThreadPool::Overflow::Reject,
+    });
+
+    Occupy(pool, 1, opened);
+
+    auto first = pool.Dispatch([]() { return 1; });
+    auto second = pool.Dispatch([]() { return 2; });
+    auto refused = pool.Dispatch([]() { return 3; });
+
+    ASSERT_EQ(pool.Post([]() { }), UINT64_MAX);
+
+    const ThreadPool::Load load = pool.GetLoad();
+    ASSERT_EQ(load.queued, 2);
+    ASSERT_EQ(load.capacity, 2);
+    ASSERT_EQ(load.busy, 1);
+
+    FUSION_ASSERT_ERROR(refused.get(), E_INSUFFICIENT_RESOURCES);
+
+    gate.set_value();
+
+    FUSION_ASSERT_RESULT(first.get());
+    FUSION_ASSERT_RESULT(second.get());
+}
+
+TEST(ThreadPoolAdmissionTests, DropOldest)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+        .queueCapacity = 2,
+        .overflow = ThreadPool::Overflow::DropOldest,
+    });
+
+    Occupy(pool, 1, opened);
+
+    auto oldest = pool.Dispatch([]() { }, ThreadPool::Priority::Low);
+    auto kept = pool.Dispatch([]() { });
+    auto newest = pool.Dispatch([]() { });
+
+    // Nothing queued is at or below Low any more.
+    auto refused = pool.Dispatch([]() { }, ThreadPool::Priority::Low);
+
+    FUSION_ASSERT_ERROR(oldest.get(), E_INSUFFICIENT_RESOURCES);
+    FUSION_ASSERT_ERROR(refused.get(), E_INSUFFICIENT_RESOURCES);
+
+    gate.set_value();
+
+    FUSION_ASSERT_RESULT(kept.get());
+    FUSION_ASSERT_RESULT(newest.get());
+}
+
+TEST(ThreadPoolAdmissionTests, DropOldestKeepsStrands)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+        .queueCapacity = 2,
+        .overflow = ThreadPool::Overflow::DropOldest,
+    });
+
+    Occupy(pool, 1, opened);
+
+    // The strand's turn is the oldest queued task, dropping it would
+    // strand both tasks behind it.
+    ThreadPool::Strand strand(pool);
+    std::atomic<size_t> count{ 0 };
+
+    strand.Post([&]() { ++count; });
+    strand.Post([&]() { ++count; });
+
+    auto dropped = pool.Dispatch([]() { });
+    auto kept = pool.Dispatch([]() { });
+
+    FUSION_ASSERT_ERROR(dropped.get(), E_INSUFFICIENT_RESOURCES);
+
+    gate.set_value();
+
+    FUSION_ASSERT_RESULT(kept.get());
+
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    while (count.load() < 2 && Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(count.load(), 2);
+}
+
+TEST(ThreadPoolAdmissionTests, Block)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+        .queueCapacity = 1,
+        .overflow = ThreadPool::Overflow::Block,
+    });
+
+    Occupy(pool, 1, opened);
+
+    std::atomic<size_t> count{ 0 };
+    pool.Post([&]() { ++count; });
+
+    std::atomic<bool> submitted{ false };
+    std::thread submitter([&]() {
+        pool.Post([&]() { ++count; });
+        submitted = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(submitted.load());
+
+    gate.set_value();
+    submitter.join();
+
+    ASSERT_TRUE(submitted.load());
+
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    while (count.load() < 2 && Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(count.load(), 2);
+}
+
+TEST_F(ThreadPoolTests, TaskGroup)
+{
+    ASSERT_TRUE(pool);
+
+    static constexpr size_t COUNT = 256;
+
+    std::atomic<size_t> count{ 0 };
+
+    TaskGroup group(*pool);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        group.Spawn([&]() { ++count; });
+    }
+
+    FUSION_ASSERT_RESULT(group.Wait());
+    ASSERT_EQ(count.load(), COUNT);
+}
+
+namespace
+{
+size_t Sum(ThreadPool& pool, size_t begin, size_t end)
+{
+    if (end - begin <= 4)
+    {
+        size_t total = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            total += i;
+        }
+        return total;
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    size_t left = 0;
+    size_t right = 0;
+
+    TaskGroup group(pool);
+    group.Spawn([&]() { left = Sum(pool, begin, middle); });
+    group.Spawn([&]() { right = Sum(pool, middle, end); });
+    FUSION_UNUSED(group.Wait());
+
+    return left + right;
+}
+}
+
+TEST(TaskGroupTests, NestedOnSingleWorker)
+{
+    // Every level waits on its children from inside a task, with a single
+    // worker that only works because waiting runs them.
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+    });
+
+    size_t total = 0;
+
+    auto future = pool.Dispatch([&]() { total = Sum(pool, 0, 1000); });
+    FUSION_ASSERT_RESULT(future.get());
+
+    ASSERT_EQ(total, 999 * 1000 / 2);
+}
+
+TEST(TaskGroupTests, Failure)
+{
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+    });
+
+    std::atomic<size_t> ran{ 0 };
+
+    TaskGroup group(pool);
+    group.Spawn([]() -> Result<void> { return Failure(E_NOT_FOUND); });
+    group.Spawn([&]() { ++ran; });
+
+    FUSION_ASSERT_ERROR(group.Wait(), E_NOT_FOUND);
+    ASSERT_TRUE(group.IsCancelled());
+    ASSERT_LE(ran.load(), 1);
+}
+
+TEST(TaskGroupTests, Context)
+{
+    ThreadPool pool(ThreadPool::Options{
+        .threads = 1,
+        .maxThreads = 1,
+    });
+
+    Context context;
+    context.Cancel();
+
+    std::atomic<size_t> ran{ 0 };
+
+    TaskGroup group(pool, context);
+    for (size_t i = 0; i < 8; ++i)
+    {
+        group.Spawn([&]() { ++ran; });
+    }
+
+    FUSION_ASSERT_ERROR(group.Wait(), E_CANCELLED);
+    ASSERT_EQ(ran.load(), 0);
+}
+
+TEST(WaitGroupTests, Wait)
+{
+    static constexpr size_t COUNT = 4;
+
+    WaitGroup wait;
+    std::atomic<size_t> count{ 0 };
+    std::vector<std::thread> threads;
+
+    wait.Add(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        threads.emplace_back([&]() {
+            ++count;
+            wait.Done();
+        });
+    }
+
+    wait.Wait();
+    ASSERT_EQ(count.load(), COUNT);
+    ASSERT_TRUE(wait.WaitFor(Clock::duration::zero()));
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
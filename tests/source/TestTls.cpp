@@ -0,0 +1,317 @@
+/**
+ * Copyright 2015-2024 Daniel Weiner
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include <Fusion/Tests/Tests.h>
+
+#include <Fusion/Tls.h>
+
+#include <array>
+#include <chrono>
+
+class TlsTests : public testing::Test
+{
+public:
+    static constexpr std::string_view HOSTNAME = "localhost"sv;
+
+    struct Session
+    {
+        std::unique_ptr<SocketPair> pair;
+        std::unique_ptr<TlsStream> client;
+        std::unique_ptr<TlsStream> server;
+    };
+
+    std::unique_ptr<Network> network;
+    std::unique_ptr<SocketService> service;
+    std::unique_ptr<TlsContext> clientContext;
+    std::unique_ptr<TlsContext> serverContext;
+    TlsCertificate certificate;
+
+    void SetUp() override
+    {
+        FUSION_ASSERT_RESULT(
+            Network::Create(),
+            [&](std::unique_ptr<Network> n) {
+                network = std::move(n);
+            });
+        FUSION_ASSERT_RESULT(
+            SocketService::Create(*network),
+            [&](std::unique_ptr<SocketService> s) {
+                service = std::move(s);
+            });
+        FUSION_ASSERT_RESULT(
+            CreateSelfSignedCertificate(HOSTNAME),
+            [&](TlsCertificate cert) {
+                certificate = std::move(cert);
+            });
+
+        TlsContext::Params serverParams;
+        serverParams.mode = TlsMode::Server;
+        serverParams.certificate = certificate.certificate;
+        serverParams.privateKey = certificate.privateKey;
+        serverParams.verifyPeer = false;
+
+        FUSION_ASSERT_RESULT(
+            TlsContext::Create(serverParams),
+            [&](std::unique_ptr<TlsContext> c) {
+                serverContext = std::move(c);
+            });
+
+        TlsContext::Params clientParams;
+        clientParams.mode = TlsMode::Client;
+        clientParams.trustedCertificates = certificate.certificate;
+
+        FUSION_ASSERT_RESULT(
+            TlsContext::Create(clientParams),
+            [&](std::unique_ptr<TlsContext> c) {
+                clientContext = std::move(c);
+            });
+    }
+
+    void TearDown() override
+    {
+        if (service)
+        {
+            service->Stop();
+            service.reset();
+        }
+        if (network)
+        {
+            network->Stop();
+            network.reset();
+        }
+    }
+
+    void Connect(Session& session)
+    {
+        FUSION_ASSERT_RESULT(
+            SocketPair::Create(
+                *network,
+                SocketPair::Type::NonBlocking),
+            [&](std::unique_ptr<SocketPair> p) {
+                session.pair = std::move(p);
+            });
+        FUSION_ASSERT_RESULT(
+            TlsStream::Create(
+                *clientContext,
+                *network,
+                session.pair->Writer(),
+                HOSTNAME),
+            [&](std::unique_ptr<TlsStream> s) {
+                session.client = std::move(s);
+            });
+        FUSION_ASSERT_RESULT(
+            TlsStream::Create(
+                *serverContext,
+                *network,
+                session.pair->Reader()),
+            [&](std::unique_ptr<TlsStream> s) {
+                session.server = std::move(s);
+            });
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            for (TlsStream* stream : { session.client.get(), session.server.get() })
+            {
+                if (auto result = stream->Handshake(); !result)
+                {
+                    ASSERT_EQ(result.Error().Error(), E_NET_WOULD_BLOCK)
+                        << result.Error().Summary();
+                }
+            }
+
+            if (session.client->IsEstablished()
+                && session.server->IsEstablished())
+            {
+                return;
+            }
+            Wait(session);
+        }
+        FAIL() << "handshake did not complete";
+    }
+
+    // Block on the SocketService until either stream can make progress.
+    void Wait(Session& session)
+    {
+        std::array<TlsStream*, 2> streams = {
+            session.client.get(),
+            session.server.get(),
+        };
+
+        for (TlsStream* stream : streams)
+        {
+            FUSION_ASSERT_RESULT(
+                service->Add(stream->GetSocket(), stream->Interest()));
+        }
+
+        FUSION_ASSERT_RESULT(
+            service->Execute(std::chrono::milliseconds(100)));
+
+        for (TlsStream* stream : streams)
+        {
+            FUSION_ASSERT_RESULT(
+                service->Remove(
+                    stream->GetSocket(),
+                    SocketOperation::Read
+                    | SocketOperation::Write
+                    | SocketOperation::Error));
+        }
+    }
+
+    void Transfer(
+        Session& session,
+        TlsStream& from,
+        TlsStream& to,
+        std::string_view message)
+    {
+        FUSION_ASSERT_RESULT(
+            from.Send(message.data(), message.size()),
+            [&](size_t sent) {
+                ASSERT_EQ(sent, message.size());
+            });
+
+        std::string received;
+        std::array<char, 256> buffer{};
+
+        for (size_t i = 0; i < 100 && received.size() < message.size(); ++i)
+        {
+            auto result = to.Recv(buffer.data(), buffer.size());
+            if (result)
+            {
+                received.append(buffer.data(), *result);
+                continue;
+            }
+
+            ASSERT_EQ(result.Error().Error(), E_NET_WOULD_BLOCK)
+                << result.Error().Summary();
+            FUSION_ASSERT_RESULT(from.Flush());
+            Wait(session);
+        }
+        ASSERT_EQ(received, message);
+    }
+};
+
+TEST_F(TlsTests, SelfSignedCertificate)
+{
+    ASSERT_NE(certificate.certificate.find("BEGIN CERTIFICATE"), std::string::npos);
+    ASSERT_NE(certificate.privateKey.find("PRIVATE KEY"), std::string::npos);
+
+    FUSION_ASSERT_FAILURE(CreateSelfSignedCertificate(""sv));
+}
+
+TEST_F(TlsTests, HandshakeAndExchange)
+{
+    Session session;
+    Connect(session);
+    ASSERT_TRUE(session.client->IsEstablished());
+    ASSERT_TRUE(session.server->IsEstablished());
+    ASSERT_FALSE(session.client->IsResumed());
+
+    Transfer(session, *session.client, *session.server, "ping from the client"sv);
+    Transfer(session, *session.server, *session.client, "pong from the server"sv);
+
+    FUSION_ASSERT_RESULT(session.client->Shutdown());
+
+    std::array<char, 64> buffer{};
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto result = session.server->Recv(buffer.data(), buffer.size());
+        ASSERT_FALSE(result);
+
+        if (result.Error().Error() != E_NET_WOULD_BLOCK)
+        {
+            ASSERT_EQ(result.Error().Error(), E_NET_DISCONNECTED);
+            break;
+        }
+        Wait(session);
+    }
+}
+
+TEST_F(TlsTests, SessionResumption)
+{
+    {
+        Session session;
+        Connect(session);
+        ASSERT_FALSE(session.client->IsResumed());
+
+        // Session tickets are delivered after the handshake, reading
+        // application data on the client picks them up.
+        Transfer(session, *session.server, *session.client, "ticket"sv);
+
+        // Sessions of connections torn down without close_notify are
+        // invalidated and will not be offered again.
+        FUSION_ASSERT_RESULT(session.client->Shutdown());
+    }
+    ASSERT_EQ(clientContext->CachedSessions(), 1);
+
+    Session session;
+    Connect(session);
+    ASSERT_TRUE(session.client->IsResumed());
+    ASSERT_TRUE(session.server->IsResumed());
+
+    Transfer(session, *session.client, *session.server, "resumed"sv);
+}
+
+TEST_F(TlsTests, RejectsUntrustedPeer)
+{
+    TlsContext::Params params;
+    params.mode = TlsMode::Client;
+
+    FUSION_ASSERT_RESULT(
+        CreateSelfSignedCertificate(HOSTNAME),
+        [&](TlsCertificate other) {
+            params.trustedCertificates = other.certificate;
+
+            FUSION_ASSERT_RESULT(
+                TlsContext::Create(params),
+                [&](std::unique_ptr<TlsContext> c) {
+                    clientContext = std::move(c);
+                });
+        });
+
+    Session session;
+    FUSION_ASSERT_RESULT(
+        SocketPair::Create(
+            *network,
+            SocketPair::Type::NonBlocking),
+        [&](std::unique_ptr<SocketPair> p) {
+            session.pair = std::move(p);
+        });
+    FUSION_ASSERT_RESULT(
+        TlsStream::Create(*clientContext, *network, session.pair->Writer(), HOSTNAME),
+        [&](std::unique_ptr<TlsStream> s) {
+            session.client = std::move(s);
+        });
+    FUSION_ASSERT_RESULT(
+        TlsStream::Create(*serverContext, *network, session.pair->Reader()),
+        [&](std::unique_ptr<TlsStream> s) {
+            session.server = std::move(s);
+        });
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        (void)session.server->Handshake();
+
+        auto result = session.client->Handshake();
+        if (!result && result.Error().Error() != E_NET_WOULD_BLOCK)
+        {
+            ASSERT_EQ(result.Error().Error(), E_TLS_HANDSHAKE);
+            return;
+        }
+        ASSERT_FALSE(session.client->IsEstablished());
+        Wait(session);
+    }
+    FAIL() << "client accepted an untrusted certificate";
+}